@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_audio_buffer.h
+ * @brief Lock-free audio ring and its block slab for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* Needs only APR and the APT base types, so the ring can be tested on its own */
+#ifndef ELEVENLABS_AUDIO_BUFFER_H
+#define ELEVENLABS_AUDIO_BUFFER_H
+
+#include "apt.h"
+#include "apr_pools.h"
+#include "apr_thread_mutex.h"
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define ELEVENLABS_AUDIO_BLOCK_SIZE (64 * 1024)    /* Unit a ring borrows from the slab; a power of two */
+#define ELEVENLABS_SLAB_SPARE_BLOCKS 64            /* Returned blocks kept for reuse, the rest are freed */
+
+typedef struct audio_buffer_t audio_buffer_t;
+typedef struct elevenlabs_slab_t elevenlabs_slab_t;
+typedef struct elevenlabs_slab_free_t elevenlabs_slab_free_t;
+
+/* Engine-wide pool of fixed-size audio blocks. A ring borrows a block when the producer
+   first writes into it and hands it back once the consumer has read past it, so memory
+   follows the audio in flight rather than the number of channels. */
+struct elevenlabs_slab_t {
+    _Atomic(elevenlabs_slab_free_t *) free_list;  /* Spare blocks: pushed lock-free, popped under mutex */
+    apr_thread_mutex_t *mutex;
+    atomic_ulong blocks;            /* Taken from the heap, in use or spare */
+    atomic_ulong spare;
+    atomic_ulong in_use;
+    atomic_ulong peak;              /* Most blocks in use at once */
+};
+
+/* Audio buffer: fixed-capacity single-producer/single-consumer ring.
+   Producer is the HTTP thread (write_callback), consumer is the MPF media thread
+   (elevenlabs_synth_stream_read). head/tail are free-running byte counters, so the
+   frame path needs no lock and copies at most one frame per read. Storage is a slot
+   per block of the ring, filled from the slab on demand and emptied as it drains. */
+struct audio_buffer_t {
+    _Atomic(uint8_t *) *blocks;     /* capacity / ELEVENLABS_AUDIO_BLOCK_SIZE slots, NULL until borrowed */
+    elevenlabs_slab_t *slab;
+    apr_size_t capacity;            /* Power of two, at least one block */
+    apr_size_t mask;                /* capacity - 1 */
+    atomic_size_t head;             /* Bytes written so far (producer-owned) */
+    atomic_size_t tail;             /* Bytes read so far (consumer-owned) */
+    atomic_size_t flush_pos;        /* Consumer skips everything below this after clear */
+    apr_pool_t *pool;
+};
+
+/* Writable region of the ring handed out by audio_buffer_reserve(); crosses at most one block boundary */
+typedef struct audio_buffer_span_t {
+    uint8_t *data[2];
+    apr_size_t len[2];
+} audio_buffer_span_t;
+
+/* Audio block slab (implemented in elevenlabs_slab.c) */
+elevenlabs_slab_t* elevenlabs_slab_create(apr_pool_t *pool);
+uint8_t* elevenlabs_slab_borrow(elevenlabs_slab_t *slab);
+void elevenlabs_slab_return(elevenlabs_slab_t *slab, uint8_t *block);
+void elevenlabs_slab_destroy(elevenlabs_slab_t *slab);
+
+/* Audio ring (implemented in elevenlabs_audio_buffer.c) */
+audio_buffer_t* audio_buffer_create(apr_pool_t *pool, elevenlabs_slab_t *slab, apr_size_t capacity);
+apt_bool_t audio_buffer_write(audio_buffer_t *buffer, const uint8_t *data, apr_size_t size);
+apt_bool_t audio_buffer_reserve(audio_buffer_t *buffer, apr_size_t size, audio_buffer_span_t *span);
+void audio_buffer_commit(audio_buffer_t *buffer, apr_size_t size);
+apr_size_t audio_buffer_read_frame(audio_buffer_t *buffer, uint8_t *frame, apr_size_t frame_size);
+apr_size_t audio_buffer_available(audio_buffer_t *buffer);
+apr_size_t audio_buffer_space(audio_buffer_t *buffer);
+void audio_buffer_clear(audio_buffer_t *buffer);
+void audio_buffer_collect(audio_buffer_t *buffer);
+void audio_buffer_destroy(audio_buffer_t *buffer);
+
+#endif /* ELEVENLABS_AUDIO_BUFFER_H */
@@ -11,6 +11,13 @@
 #ifndef ELEVENLABS_DEFS_H
 #define ELEVENLABS_DEFS_H
 
-/* Add common constants or macros here as needed */
+#include "apt_log.h"
+
+/* Plugin identifier for logging */
+#define ELEVENLABS_SYNTH_LOG_SOURCE   elevenlabs_synth_log_source
+#define ELEVENLABS_SYNTH_LOG_SOURCE_TAG "ELEVENLABS_SYNTH"
+#define ELEVENLABS_SYNTH_LOG_MARK ELEVENLABS_SYNTH_LOG_SOURCE, __FILE__, __LINE__
+
+extern APR_DECLARE_DATA apt_log_source_t* elevenlabs_synth_log_source;
 
 #endif /* ELEVENLABS_DEFS_H */
@@ -33,14 +33,17 @@
  #include "apr_thread_mutex.h"
  #include "apr_thread_cond.h"
  #include "apr_thread_proc.h"
+ #include "apr_thread_pool.h"
+ #include "apr_hash.h"
+ #include "apr_tables.h"
  #include "curl/curl.h"
+ #include "elevenlabs_defs.h"
+ #include "elevenlabs_audio_buffer.h"
+ #include <stdatomic.h>
+ #include <limits.h>
  
  #define ELEVENLABS_SYNTH_ENGINE_TASK_NAME "ElevenLabs Synth Engine"
- 
- /* Plugin identifier for logging */
- #define ELEVENLABS_SYNTH_LOG_SOURCE   elevenlabs_synth_log_source
- #define ELEVENLABS_SYNTH_LOG_SOURCE_TAG "ELEVENLABS_SYNTH"
- #define ELEVENLABS_SYNTH_LOG_MARK ELEVENLABS_SYNTH_LOG_SOURCE, __FILE__, __LINE__
+ #define ELEVENLABS_CONFIG_FILE "conf/mrcpengine.xml"  /* Relative to the server working directory */
  
  /* Default configuration values */
  #define DEFAULT_MODEL_ID "eleven_multilingual_v2"
@@ -51,6 +54,50 @@
  #define DEFAULT_FALLBACK_ULAW_TO_PCM TRUE
  #define DEFAULT_CACHE_ENABLED FALSE
  #define DEFAULT_CACHE_DIR "./data/11labs"
+ #define DEFAULT_BUFFER_HIGH_WATER_MS 4000
+ #define DEFAULT_BUFFER_LOW_WATER_MS 2000
+ #define DEFAULT_HTTP_WORKER_THREADS 0     /* 0 = one per online CPU */
+ #define MAX_HTTP_WORKER_THREADS 64
+ #define DEFAULT_CONSUMER_TASKS 1          /* Engine tasks processing channel requests */
+ #define MAX_CONSUMER_TASKS 64
+ #define DEFAULT_HTTP_WARM_CONNECTIONS 1          /* Per worker loop, 0 = no pre-warming */
+ #define MAX_HTTP_WARM_CONNECTIONS 16
+ #define DEFAULT_CACHE_IO_THREADS 2
+ #define DEFAULT_CACHE_MEMORY_MAX_BYTES (64 * 1024 * 1024)
+ #define DEFAULT_CACHE_MAX_BYTES (1024 * 1024 * 1024)  /* 0 = unbounded */
+ #define DEFAULT_CACHE_MAX_ENTRIES 100000              /* 0 = unbounded */
+ #define DEFAULT_CACHE_EVICTION_POLICY "lru"
+ #define DEFAULT_CACHE_SINGLE_FLIGHT TRUE
+ #define ELEVENLABS_FLIGHT_CHUNK_SIZE (64 * 1024)   /* Holds two decoded curl writes */
+ #define ELEVENLABS_CACHE_INDEX_FILE "index.txt"
+ #define ELEVENLABS_CACHE_KEY_VERSION "v2"     /* Prefix of canonical cache keys */
+ #define DEFAULT_SEGMENT_MODE "none"           /* none | sentence | clause */
+ #define DEFAULT_SEGMENT_LOOKAHEAD 1
+ #define MAX_SEGMENT_LOOKAHEAD 4
+ #define DEFAULT_SEGMENT_MIN_CHARS 40
+ #define DEFAULT_SEGMENT_MAX_CHARS 400
+ #define DEFAULT_HTTP_KEEPALIVE_INTERVAL_MS 30000 /* 0 = warm once at engine open only */
+ #define DEFAULT_HEDGE_BUDGET_PERCENT 0          /* 0 = never send hedged requests */
+ #define DEFAULT_HEDGE_AFTER_MS 0                /* 0 = adaptive, from recent TTFB */
+ #define DEFAULT_HEDGE_PERCENTILE 95
+ #define ELEVENLABS_TTFB_WINDOW 128              /* Recent TTFB samples the percentile is taken over */
+ #define ELEVENLABS_HEDGE_MIN_SAMPLES 20         /* Adaptive hedging waits for this many */
+ #define ELEVENLABS_HEDGE_BURST 10               /* Hedges the budget can save up */
+ #define DEFAULT_PREBUFFER_MAX_MS 0              /* 0 = play audio as soon as it arrives */
+ #define MAX_PREBUFFER_MAX_MS 2000
+ #define ELEVENLABS_PREBUFFER_MEASURE_MS 40      /* Arrival observed this long before judging its rate */
+ #define ELEVENLABS_PREBUFFER_MS_PER_CHAR 70     /* Speech duration estimate per character of text */
+ #define ELEVENLABS_PREBUFFER_HORIZON_MS 3000    /* Audio still to come assumed when there is no text */
+ #define DEFAULT_METRICS_INTERVAL_MS 10000      /* How often metrics_file is rewritten */
+ #define MIN_METRICS_INTERVAL_MS 1000
+ #define ELEVENLABS_HISTOGRAM_BUCKETS 12
+ #define ELEVENLABS_METRICS_HTTP_CODES 12       /* Status codes counted by name; see elevenlabs_metrics.c */
+ #define DEFAULT_WS_BASE_URL "wss://api.elevenlabs.io/v1/text-to-speech"
+ #define DEFAULT_WS_INACTIVITY_TIMEOUT 180       /* Seconds; the API's maximum */
+ 
+ /* Vendor-Specific-Parameters of SPEAK and CONTROL for incremental text */
+ #define ELEVENLABS_VSP_STREAM_INPUT "elevenlabs.stream-input"  /* SPEAK: more text follows */
+ #define ELEVENLABS_VSP_STREAM_END "elevenlabs.stream-end"      /* Last text of the utterance */
  
  /* Audio format constants */
  #define SAMPLE_RATE 8000
@@ -63,14 +110,20 @@
  #define ELEVENLABS_API_KEY_HEADER "xi-api-key"
  #define ELEVENLABS_CONTENT_TYPE "application/json"
  
- extern APR_DECLARE_DATA apt_log_source_t* elevenlabs_synth_log_source;
 
  /* Forward declarations */
  typedef struct elevenlabs_synth_engine_t elevenlabs_synth_engine_t;
  typedef struct elevenlabs_synth_channel_t elevenlabs_synth_channel_t;
  typedef struct elevenlabs_synth_msg_t elevenlabs_synth_msg_t;
+ typedef struct elevenlabs_synth_shard_t elevenlabs_synth_shard_t;
  typedef struct elevenlabs_http_client_t elevenlabs_http_client_t;
- typedef struct audio_buffer_t audio_buffer_t;
+ typedef struct elevenlabs_http_pool_t elevenlabs_http_pool_t;
+ typedef struct elevenlabs_http_worker_t elevenlabs_http_worker_t;
+ typedef struct elevenlabs_synth_lane_t elevenlabs_synth_lane_t;
+ typedef struct elevenlabs_flight_t elevenlabs_flight_t;
+ typedef struct elevenlabs_flight_registry_t elevenlabs_flight_registry_t;
+ typedef struct elevenlabs_ws_session_t elevenlabs_ws_session_t;
+ typedef struct elevenlabs_metrics_t elevenlabs_metrics_t;
  
  /* Configuration structure */
  typedef struct {
@@ -87,71 +140,473 @@
     /* Note: optimize_streaming_latency removed — deprecated by ElevenLabs, causes HTTP 400 on newer models */
     apt_bool_t cache_enabled;        /* Enable/disable local audio caching */
     char *cache_dir;                 /* Cache directory path */
+    uint32_t cache_io_threads;       /* I/O workers for cache lookups and file access */
+    apr_size_t cache_memory_max_bytes; /* Byte budget of the in-memory tier, 0 = disabled */
+    apr_size_t cache_max_bytes;      /* Disk cache size bound, 0 = unbounded */
+    uint32_t cache_max_entries;      /* Disk cache file count bound, 0 = unbounded */
+    char *cache_eviction_policy;     /* "lru" or "lfu" */
+    char *cache_preload_manifest;    /* Manifest whose hot prompts are loaded into memory at open */
+    apt_bool_t cache_single_flight;  /* Identical concurrent misses share one download */
+    /* Buffering / backpressure */
+    uint32_t buffer_high_water_ms;   /* Pause the HTTP transfer when this much audio is queued */
+    uint32_t buffer_low_water_ms;    /* Resume the transfer once playback drains below this */
+    /* Request processing */
+    uint32_t consumer_tasks;         /* Engine tasks; each channel stays on one of them */
+    /* HTTP event loops */
+    uint32_t http_worker_threads;    /* curl_multi worker threads, 0 = one per CPU */
+    uint32_t http_warm_connections;  /* Connections each worker opens to base_url at engine open */
+    uint32_t http_keepalive_interval_ms; /* Period of the keep-alive request on warm connections */
+    /* Hedged requests */
+    uint32_t hedge_budget_percent;   /* Share of requests that may be duplicated, 0 = off */
+    uint32_t hedge_after_ms;         /* Duplicate when no audio after this long, 0 = adaptive */
+    uint32_t hedge_percentile;       /* Adaptive delay: this percentile of recent TTFB */
+    /* Metrics */
+    char *metrics_file;              /* Prometheus text file written periodically, NULL = off */
+    uint32_t metrics_interval_ms;    /* Period of those writes */
+    /* Playback */
+    uint32_t prebuffer_max_ms;       /* Most a SPEAK's playback is held back to avoid underruns, 0 = off */
+    /* Segmentation */
+    char *segment_mode;              /* "none", "sentence" or "clause" */
+    uint32_t segment_lookahead;      /* Segments downloaded ahead of the one playing */
+    uint32_t segment_min_chars;      /* Shorter pieces are merged into the next one */
+    uint32_t segment_max_chars;      /* Longer ones are cut at a space */
+    /* WebSocket stream input */
+    char *ws_base_url;               /* ws:// or wss:// base of the stream-input endpoint */
+    uint32_t ws_inactivity_timeout;  /* Seconds the API keeps an idle socket open */
  } elevenlabs_config_t;
  
- /* Audio buffer structure for frame accumulation */
- typedef struct audio_buffer_t {
-     uint8_t *buffer;
+ /* Cached audio mapped read-only into memory. Immutable once created and refcounted,
+    so any number of channels can play it at once while the memory tier holds on to it. */
+ typedef struct elevenlabs_cache_blob_t {
+     void *addr;                          /* Whole-file mapping */
      apr_size_t size;
-     apr_size_t capacity;
-     apr_thread_mutex_t *mutex;
-     apr_pool_t *pool;  /* Add pool for memory allocation */
- } audio_buffer_t;
+     const uint8_t *data;                 /* Audio payload (past any WAV header) */
+     apr_size_t len;
+     atomic_size_t ready;                 /* Payload bytes already faulted in by the I/O worker */
+     atomic_int refs;                     /* Mapping + struct freed when this drops to 0 */
+     char key[64];                        /* Cache key (memory tier index) */
+     struct elevenlabs_cache_blob_t *lru_prev;  /* Memory tier recency list (tier mutex) */
+     struct elevenlabs_cache_blob_t *lru_next;
+ } elevenlabs_cache_blob_t;
+ 
+ /* Piece of a shared download's audio; never rewritten once ready covers it */
+ typedef struct elevenlabs_flight_chunk_t {
+     _Atomic(struct elevenlabs_flight_chunk_t *) next;  /* Linked before ready reaches it */
+     uint8_t data[ELEVENLABS_FLIGHT_CHUNK_SIZE];
+ } elevenlabs_flight_chunk_t;
+ 
+ #define ELEVENLABS_FLIGHT_ABANDONED UINT_MAX  /* Subscriber count of a cancelled flight */
  
- /* HTTP client structure */
+ /* One download shared by every SPEAK of the same uncached request. Its HTTP client
+    appends to the chunk list and each subscriber plays it from the start at its own
+    pace, however late it joined. The transfer is paced by the subscriber furthest
+    ahead. Refcounted like a blob. */
+ struct elevenlabs_flight_t {
+     char key[64];                        /* Cache key (registry index) */
+     elevenlabs_flight_registry_t *registry;
+     elevenlabs_http_client_t *client;    /* Download; the registry's, so valid after it ended */
+     apr_pool_t *pool;                    /* The download's request memory */
+     elevenlabs_flight_chunk_t *head;
+     elevenlabs_flight_chunk_t *tail;     /* Writer side (HTTP worker) */
+     apr_size_t tail_used;
+     atomic_size_t ready;                 /* Bytes appended so far */
+     atomic_size_t played;                /* Bytes played by the subscriber furthest ahead */
+     apr_size_t high_water_bytes;         /* Pause the transfer this far ahead of played */
+     apr_size_t low_water_bytes;          /* Resume it once played is this close again */
+     atomic_int paused;                   /* Transfer paused at high water */
+     atomic_int done;                     /* Download ended, ready is final */
+     atomic_int refs;                     /* Subscribers + the running download */
+     atomic_uint subscribers;             /* ELEVENLABS_FLIGHT_ABANDONED once cancelled */
+     atomic_int cacheable;                /* Writes a cache file, so it outlives its subscribers */
+     apt_bool_t listed;                   /* Still joinable (registry mutex) */
+ };
+ 
+ /* One channel playing a blob, or a shared download as it arrives. Created by SPEAK,
+    then owned by the media thread. */
+ typedef struct elevenlabs_cache_playback_t {
+     elevenlabs_cache_blob_t *blob;
+     elevenlabs_flight_t *flight;         /* Instead of blob */
+     elevenlabs_flight_chunk_t *chunk;    /* Chunk holding pos (flight only) */
+     apr_size_t chunk_pos;
+     apr_size_t pos;                      /* Bytes already played (media thread) */
+     unsigned gen;                        /* SPEAK generation this playback belongs to */
+ } elevenlabs_cache_playback_t;
+ 
+ /* In-memory cache tier in front of the disk cache: blobs indexed by cache key, evicted
+    least recently used first once their mapped size exceeds the byte budget */
+ typedef struct elevenlabs_cache_memory_t {
+     apr_thread_mutex_t *mutex;           /* Guards index, the LRU list and bytes */
+     apr_hash_t *index;
+     elevenlabs_cache_blob_t *lru_head;   /* Most recently used */
+     elevenlabs_cache_blob_t *lru_tail;
+     apr_size_t bytes;
+     apr_size_t max_bytes;
+     atomic_ulong hits;
+     atomic_ulong misses;
+     atomic_ulong evictions;
+     apr_pool_t *pool;
+ } elevenlabs_cache_memory_t;
+ 
+ /* Prompt manifest line (see elevenlabs_manifest.c); NULL fields take the configured value */
+ typedef struct {
+     const char *voice_id;
+     const char *model_id;
+     const char *output_format;
+     const char *text;
+     apt_bool_t hot;                      /* Preloaded into the memory tier at engine open */
+ } elevenlabs_manifest_entry_t;
+ 
+ /* Disk cache index entry, one per cached file */
+ typedef struct elevenlabs_cache_entry_t {
+     char key[64];
+     char name[80];                       /* File name inside cache_dir */
+     apr_off_t size;
+     apr_time_t last_access;
+     apr_uint32_t hits;
+     apt_bool_t seen;                     /* Found by the directory scan (recovery only) */
+ } elevenlabs_cache_entry_t;
+ 
+ /* Disk cache manager: an in-memory index of cache_dir, persisted to index.txt, and a
+    background thread that evicts by LRU or LFU and checkpoints the index */
+ typedef struct elevenlabs_cache_disk_t {
+     apr_thread_mutex_t *mutex;           /* Guards index, totals and dirty */
+     apr_thread_cond_t *cond;             /* Wakes the background thread */
+     apr_hash_t *index;                   /* key -> elevenlabs_cache_entry_t */
+     apr_size_t bytes;
+     unsigned entries;
+     apr_size_t max_bytes;
+     unsigned max_entries;
+     apt_bool_t lfu;
+     apt_bool_t dirty;                    /* Index changed since the last checkpoint */
+     apt_bool_t running;
+     apr_thread_t *thread;
+     atomic_ulong evictions;
+     const char *dir;
+     const char *index_path;
+     apr_pool_t *work_pool;               /* Scratch pool of the background thread */
+     apr_pool_t *pool;
+ } elevenlabs_cache_disk_t;
+ 
+ /* Engine-wide registry of in-flight downloads by cache key, with the HTTP clients
+    that run them; idle clients are reused by the next flight */
+ struct elevenlabs_flight_registry_t {
+     apr_thread_mutex_t *mutex;           /* Guards index, clients, idle, flight->listed */
+     apr_hash_t *index;                   /* key -> elevenlabs_flight_t */
+     apr_array_header_t *clients;         /* Every download client, for destroy */
+     apr_array_header_t *idle;            /* Download clients not running a flight */
+     elevenlabs_http_pool_t *http_pool;
+     apr_thread_pool_t *io_pool;
+     elevenlabs_cache_memory_t *memory_cache;
+     elevenlabs_cache_disk_t *disk_cache;
+     atomic_ulong started;                /* Downloads started */
+     atomic_ulong joined;                 /* SPEAKs served by a download already running */
+     apr_pool_t *pool;
+ };
+ 
+ /* Warm-up handle owned by a worker loop */
+ typedef struct elevenlabs_http_warm_t {
+     CURL *curl;
+     apr_time_t next_due;                 /* Next warm-up / keep-alive request, 0 = none */
+     apt_bool_t in_flight;
+     apt_bool_t completed;                /* Initial warm-up finished (either way) */
+     apt_bool_t failed;                   /* Last attempt failed; retrying */
+ } elevenlabs_http_warm_t;
+ 
+ /* HTTP worker: one thread running a curl_multi loop over epoll. Other threads never
+    touch the multi handle; they queue clients on the pending list and wake the loop. */
+ struct elevenlabs_http_worker_t {
+     CURLM *multi;
+     int epoll_fd;
+     int wake_fd;                         /* eventfd that interrupts epoll_wait */
+     apr_thread_t *thread;
+     apr_thread_mutex_t *mutex;           /* Guards pending */
+     elevenlabs_http_client_t *pending;   /* Clients with a submit, stop or resume to apply */
+     elevenlabs_http_client_t *transfers; /* Clients in the multi handle (worker-owned) */
+     elevenlabs_http_client_t *reaping;   /* Released clients to destroy once idle (mutex) */
+     apt_bool_t timer_armed;              /* libcurl timer state (worker-owned) */
+     apr_time_t timer_deadline;
+     apr_time_t hedge_next;               /* Earliest hedge deadline of its transfers, 0 = none */
+     atomic_int running;
+     elevenlabs_http_warm_t *warm;        /* Pre-warmed connections (worker-owned) */
+     unsigned warm_count;
+     unsigned warm_finished;
+     unsigned warm_ready;                 /* Initial warm-ups that succeeded */
+     apr_time_t warm_started;
+     unsigned index;
+     elevenlabs_http_pool_t *http_pool;
+     const elevenlabs_config_t *config;
+     apr_pool_t *pool;
+ };
+ 
+ /* Engine-wide HTTP state shared by all channels through a CURLSH handle */
+ struct elevenlabs_http_pool_t {
+     CURLSH *share;
+     apr_thread_mutex_t *locks[CURL_LOCK_DATA_LAST];  /* One lock per shared data class */
+     elevenlabs_http_worker_t **workers;
+     unsigned worker_count;
+     atomic_uint next_worker;          /* Round-robin channel placement */
+     atomic_ulong connections_new;     /* Transfers that had to open a connection */
+     atomic_ulong connections_reused;  /* Transfers served on an existing connection */
+     /* Hedged requests, see elevenlabs_http_pool_hedge_delay() */
+     atomic_uint ttfb_ms[ELEVENLABS_TTFB_WINDOW]; /* Recent request-to-first-audio times */
+     atomic_uint ttfb_count;
+     atomic_uint ttfb_percentile_ms;   /* hedge_percentile of the window, 0 = too few samples */
+     atomic_uint hedge_tokens;         /* Budget, in hundredths of a hedge */
+     atomic_ulong hedges_fired;
+     atomic_ulong hedges_won;          /* ... whose duplicate delivered audio first */
+     atomic_uint ws_sessions;          /* WebSocket threads not yet wound down */
+     elevenlabs_metrics_t *metrics;    /* The engine's, NULL in the tools */
+     apr_pool_t *pool;
+ };
+ 
+ /* Text frame queued for a WebSocket session */
+ typedef struct elevenlabs_ws_msg_t {
+     struct elevenlabs_ws_msg_t *next;
+     apr_size_t len;
+     char data[];
+ } elevenlabs_ws_msg_t;
+ 
+ /* A channel's WebSocket to the multi-context stream-input endpoint: opened by the
+    first streamed SPEAK and kept for the session, one context per utterance. Its own
+    thread sends queued text and produces audio into the channel's first lane ring. */
+ struct elevenlabs_ws_session_t {
+     CURL *curl;                          /* Connect-only handle carrying the socket */
+     curl_socket_t sock;                  /* CURL_SOCKET_BAD while disconnected (thread-owned) */
+     char *url;                           /* Endpoint the socket is connected to (thread-owned) */
+     apr_thread_t *thread;
+     int wake_fd;                         /* eventfd: text queued or shutting down */
+     apt_bool_t woken;                    /* ... drained while waiting on the socket (thread-owned) */
+     atomic_int running;
+     apr_thread_mutex_t *mutex;           /* Guards the outbox, target, context, cancelled and audio_buffer */
+     elevenlabs_ws_msg_t *outbox;
+     elevenlabs_ws_msg_t *outbox_tail;
+     char *target_url;                    /* Endpoint the current utterance needs (malloc) */
+     unsigned context;                    /* Utterance being produced, 0 = none */
+     apt_bool_t cancelled;                /* ... stopped: its audio is dropped */
+     atomic_uint context_done;            /* Last utterance fully produced into the ring */
+     unsigned context_final;              /* Last utterance the server finished (thread-owned) */
+     /* Receive side (thread-owned) */
+     uint8_t *rx;                         /* Raw bytes not yet parsed into frames */
+     apr_size_t rx_len;
+     apr_size_t rx_cap;
+     char *message;                       /* Text message reassembled from fragments */
+     apr_size_t message_len;
+     apr_size_t message_cap;
+     uint8_t *pending;                    /* Decoded audio waiting for ring space */
+     apr_size_t pending_len;
+     apr_size_t pending_off;
+     apr_size_t pending_cap;
+     unsigned pending_context;
+     /* Output */
+     audio_buffer_t *audio_buffer;        /* NULL once the session is destroyed */
+     apr_size_t high_water_bytes;         /* Socket is not read while this much is queued */
+     const elevenlabs_config_t *config;
+     elevenlabs_http_pool_t *http_pool;
+     apr_pool_t *scratch;                 /* Cleared every loop (thread-owned) */
+     apr_pool_t *pool;                    /* The session's own, destroyed by its thread */
+ };
+ 
+ /* Race between a request and its hedged duplicate (worker-owned) */
+typedef enum {
+    ELEVENLABS_HEDGE_NONE,               /* No duplicate sent */
+    ELEVENLABS_HEDGE_RACING,             /* Duplicate in flight, no audio from either yet */
+    ELEVENLABS_HEDGE_LOST,               /* Original delivered first, or the duplicate failed */
+    ELEVENLABS_HEDGE_WON                 /* Duplicate delivered first and became client->curl */
+} elevenlabs_hedge_state_e;
+
+/* HTTP client structure */
  typedef struct elevenlabs_http_client_t {
      CURL *curl;
      char *url;
      char *post_data;
      audio_buffer_t *audio_buffer;
-     apt_bool_t stopped;
+     atomic_int stopped;                 /* Set by any thread; the transfer's callbacks abort on it */
      apr_thread_mutex_t *mutex;
      apr_thread_cond_t *cond;
      apr_pool_t *pool;
+     apr_pool_t *request_pool;           /* Memory of the current request, cleared when the next starts */
      const elevenlabs_config_t *config;
-     const char *request_voice_id;      /* Voice ID for current request (pure ID, no lang suffix) */
+     elevenlabs_http_pool_t *http_pool;  /* Engine-wide shared DNS/TLS state */
+     const char *request_voice_id;      /* Voice of the current request, NULL = config's (mutex) */
     const char *request_language_code;  /* Language code parsed from voice_id suffix, e.g. "en" */
+    const char *request_legacy_text;    /* SSML prompt as read before v2 cache keys, NULL = the text itself (mutex) */
     /* Error response buffering */
     apt_bool_t http_error;          /* TRUE if last response was HTTP >= 400 */
     char error_body[4096];          /* Accumulated error response body */
     size_t error_body_len;          /* Current length of error_body */
-    apr_thread_t *thread;           /* Background HTTP thread */
+    /* Worker hand-off */
+    elevenlabs_http_worker_t *worker;   /* Event loop that runs this client's requests */
+    apr_thread_pool_t *io_pool;         /* I/O workers for cache lookups */
+    elevenlabs_cache_memory_t *memory_cache; /* In-memory tier, NULL when disabled */
+    elevenlabs_cache_disk_t *disk_cache;    /* Disk cache index, NULL when caching is off */
+    elevenlabs_synth_lane_t *lane;      /* Channel lane this client streams into */
+    elevenlabs_flight_registry_t *flights; /* Shared downloads, NULL when single flight is off */
+    elevenlabs_flight_t *flight;        /* Shared download this client runs, instead of a ring */
+    apt_bool_t io_pending;              /* Cache lookup or .part creation queued or running (mutex) */
+    unsigned lookup_gen;                /* SPEAK generation the lookup belongs to */
+    /* Start queued behind a request that has not let go yet; run by whichever thread
+       makes the client idle, so the consumer task never waits for a worker or the disk */
+    char *deferred_text;                /* malloc'd, NULL if none (mutex) */
+    char *deferred_voice_id;            /* malloc'd like the text, NULL = config's voice */
+    char *deferred_legacy_text;
+    const elevenlabs_config_t *deferred_config;
+    unsigned deferred_gen;
+    atomic_int start_deferred;          /* Queued or being started; the media thread plays nothing */
+    apt_bool_t released;                /* Handed to the reaper, never started again (mutex) */
+    char *api_key_header;
+    apt_bool_t busy;                    /* Request handed to the worker, not finished yet (mutex) */
+    apt_bool_t pending_queued;          /* On worker->pending (worker mutex) */
+    struct elevenlabs_http_client_t *pending_next;
+    apt_bool_t attached;                /* In the worker's transfer list (worker-owned) */
+    struct elevenlabs_http_client_t *active_next;
+    struct elevenlabs_http_client_t *reap_next; /* On worker->reaping (worker mutex) */
+    unsigned request_count;             /* Requests finished on this session (worker-owned) */
     struct curl_slist *headers;     /* HTTP headers for current request */
     apr_time_t start_time;          /* For measuring time-to-first-byte */
     apt_bool_t first_chunk_logged;  /* Whether first-chunk latency was logged */
     /* Caching state */
     apt_bool_t cache_playback_mode; /* If TRUE, read from local cache instead of HTTP */
     char *cache_key;                /* Deterministic cache key */
+    char *cache_key_legacy;         /* Pre-canonical key of the same request, if its file exists */
+    char *cache_path_legacy;        /* File under the legacy key; renamed to cache_path_final on a hit */
     char *cache_path_tmp;           /* Temporary path while writing (e.g., .part) */
     char *cache_path_final;         /* Final cache file path (e.g., .wav) */
     apr_file_t *cache_fp;           /* Open file while caching */
     apr_size_t cache_data_bytes;    /* Number of audio payload bytes written (for WAV header) */
+    /* Backpressure: write_callback pauses at high water, stream_read asks to resume at low water */
+    apr_size_t high_water_bytes;
+    apr_size_t low_water_bytes;
+    atomic_int paused;              /* Transfer paused with CURL_WRITEFUNC_PAUSE */
+    atomic_int resume_requested;    /* Set by the media thread, honored on the worker thread */
+    apr_time_t last_data_time;      /* Last accepted chunk or resume; drives the read timeout */
+    /* Hedging: a duplicate of a request whose first audio is late (worker-owned) */
+    CURL *hedge_curl;               /* Duplicate's handle; trades places with curl when it wins */
+    elevenlabs_hedge_state_e hedge_state;
+    apt_bool_t hedge_attached;      /* hedge_curl is in the worker's multi handle */
+    apt_bool_t hedge_http_error;    /* Duplicate got an HTTP error status */
+    apr_time_t hedge_deadline;      /* Send the duplicate if no audio by then, 0 = never */
  } elevenlabs_http_client_t;
  
+ /* Latency histogram with fixed buckets; counts are per bucket, made cumulative on export */
+ typedef struct {
+     const unsigned *bounds;              /* ELEVENLABS_HISTOGRAM_BUCKETS upper bounds in ms, ascending */
+     atomic_ulong counts[ELEVENLABS_HISTOGRAM_BUCKETS + 1];  /* The last one is above every bound */
+     atomic_ulong sum_ms;
+ } elevenlabs_histogram_t;
+ 
+ /* Engine-wide counters not kept by the modules themselves. Updated with relaxed atomics
+    from any thread, the media threads included; only the writer thread reads them. */
+ struct elevenlabs_metrics_t {
+     elevenlabs_histogram_t ttfb;         /* HTTP request to first audio byte */
+     elevenlabs_histogram_t synthesis;    /* HTTP request to end of a successful transfer */
+     elevenlabs_histogram_t first_audio;  /* SPEAK to first audio played */
+     elevenlabs_histogram_t stop;         /* STOP received to its response sent */
+     elevenlabs_histogram_t barge_in;     /* BARGE-IN-OCCURRED received to the first silent frame */
+     atomic_ulong requests;               /* HTTP synthesis requests sent */
+     atomic_ulong requests_ok;
+     atomic_ulong requests_stopped;       /* Stopped by STOP, barge-in or a newer SPEAK */
+     atomic_ulong requests_timeout;
+     atomic_ulong requests_failed;        /* Connection, TLS and other transport errors */
+     atomic_ulong http_errors[ELEVENLABS_METRICS_HTTP_CODES + 1];  /* By status; the last is any other */
+     atomic_long requests_active;
+     atomic_ulong audio_bytes;            /* Received from the API, before G.711 decoding */
+     atomic_ulong cache_hits_memory;
+     atomic_ulong cache_hits_disk;
+     atomic_ulong cache_misses;
+     atomic_long channels_active;
+     /* File writer */
+     apr_thread_t *thread;
+     apr_thread_mutex_t *mutex;
+     apr_thread_cond_t *cond;
+     apt_bool_t running;
+     apr_pool_t *work_pool;
+     apr_pool_t *pool;
+ };
+ 
+ /* Relaxed: nothing is ordered on a metric */
+ #define ELEVENLABS_METRIC_ADD(metrics, field, n) \
+     do { if (metrics) atomic_fetch_add_explicit(&(metrics)->field, (n), memory_order_relaxed); } while (0)
+ 
+ /* One engine consumer task. A channel is pinned to one at creation, so its requests
+    keep their order while different channels are processed in parallel. */
+ struct elevenlabs_synth_shard_t {
+     apt_consumer_task_t *task;
+     elevenlabs_synth_engine_t *engine;
+     unsigned index;
+     /* Relaxed atomics, read by the metrics writer */
+     atomic_long queued;                  /* Messages signalled, not yet processed */
+     atomic_ulong processed;
+     atomic_ulong wait_us;                /* Sum of signal-to-processing delays */
+     atomic_ulong busy_us;                /* Sum of processing times */
+ };
+ 
  /* ElevenLabs synthesizer engine */
  struct elevenlabs_synth_engine_t {
-     apt_consumer_task_t *task;
+     elevenlabs_synth_shard_t *shards;
+     unsigned shard_count;
      elevenlabs_config_t config;
+     elevenlabs_http_pool_t *http_pool;
+     apr_thread_pool_t *io_pool;        /* Cache I/O workers */
+     elevenlabs_cache_memory_t *memory_cache;
+     elevenlabs_cache_disk_t *disk_cache;
+     elevenlabs_flight_registry_t *flights;  /* Single-flight registry, NULL when off */
+     elevenlabs_metrics_t *metrics;
+     elevenlabs_slab_t *audio_slab;     /* Storage of every channel's rings */
+     /* Synthesis stats, updated by the media threads */
+     atomic_ulong stats_speaks;           /* SPEAKs that produced audio */
+     atomic_ulong stats_first_audio_ms;   /* Sum of SPEAK-to-first-audio latencies */
+     atomic_ulong stats_segments;         /* Segments played */
+     atomic_ulong stats_segments_cached;  /* ... of which from the memory or disk cache */
+     atomic_ulong stats_prebuffered;      /* Segments whose playback was held back */
+     atomic_ulong stats_prebuffer_ms;     /* Sum of those holds */
+     atomic_ulong stats_underruns;        /* Segments that ran dry midway, once per gap */
      apr_pool_t *pool;
  };
  
+ /* One segment in flight on a channel: streamed by its HTTP client into its ring, or
+    played from a cache blob. Segment i of a SPEAK runs on lane i % lane_count. */
+ struct elevenlabs_synth_lane_t {
+     elevenlabs_synth_channel_t *channel;
+     elevenlabs_http_client_t *http_client;
+     audio_buffer_t *audio_buffer;
+     elevenlabs_cache_playback_t *playback;                   /* Media-thread owned */
+     _Atomic(elevenlabs_cache_playback_t *) playback_pending; /* Handed over by the lookup */
+     atomic_uint playback_gen;                                /* Generation still playing, 0 = none */
+     atomic_uint segment;                 /* Segment started here, ELEVENLABS_SEGMENT_NONE if none */
+     apt_bool_t from_cache;               /* Current segment played from a blob (media thread) */
+     apt_bool_t streaming;                /* Segment fed by the channel's WebSocket instead */
+     /* Adaptive prebuffer of the segment playing here (media thread) */
+     apt_bool_t primed;                   /* Playback started, no more holding back */
+     apt_bool_t played;                   /* Some of the segment's audio went out */
+     apr_time_t arrival_start;            /* Its audio first seen queued, 0 = not yet */
+     apr_size_t arrival_head;             /* Ring head at that time */
+     apr_size_t arrival_queued;           /* Audio queued at that time */
+     apr_interval_time_t held;            /* Playback held back so far */
+ };
+ #define ELEVENLABS_SEGMENT_NONE ((unsigned)-1)
+ 
  /* ElevenLabs synthesizer channel */
 struct elevenlabs_synth_channel_t {
      /** Back pointer to engine */
      elevenlabs_synth_engine_t *elevenlabs_engine;
      /** Engine channel base */
      mrcp_engine_channel_t *channel;
+     /** Consumer task all requests of this channel are processed on */
+     elevenlabs_synth_shard_t *shard;
      
      /** Active (in-progress) speak request */
      mrcp_message_t *speak_request;
      /** Pending stop response */
      mrcp_message_t *stop_response;
+     /** Arrival of the request being dispatched (consumer task) */
+     apr_time_t request_time;
+     /** Arrival of a BARGE-IN-OCCURRED that killed the SPEAK; taken by the first silent frame */
+     _Atomic(apr_time_t) barge_in_time;
      
-     /** HTTP client for ElevenLabs API */
-     elevenlabs_http_client_t *http_client;
-     
-     /** Audio buffer for frame accumulation */
-     audio_buffer_t *audio_buffer;
+     /** Segment lanes, each with its HTTP client and audio buffer; lane_count is
+         segment_lookahead + 1 when segmentation is on, else 1 */
+     elevenlabs_synth_lane_t *lanes;
+     unsigned lane_count;
      
      /** Frame size in bytes */
      apr_size_t frame_size;
@@ -163,11 +618,35 @@ struct elevenlabs_synth_channel_t {
      apt_bool_t synthesizing;
      /** Counter for sending IN-PROGRESS events */
      int progress_counter;
+     
+     /** Segments of the active SPEAK, played in order across the lanes */
+     char **segments;                     /* Consumer task, set before playback starts */
+     const char *voice_id;                /* Voice of the active SPEAK (consumer task) */
+     const char *legacy_text;             /* Its prompt as read before v2 cache keys, NULL = as segmented */
+     unsigned segment_count;
+     unsigned segment_next;               /* Next segment to start (consumer task) */
+     atomic_uint segment_playing;         /* Segment being played (media thread) */
+     apr_time_t speak_time;               /* SPEAK arrival, for first-audio latency */
+     apt_bool_t first_audio_sent;         /* Media thread */
+     apr_interval_time_t prebuffer_held;  /* Playback held back in this SPEAK (media thread) */
+     unsigned underruns;                  /* Mid-segment underruns in this SPEAK (media thread) */
+     apt_bool_t underrun;                 /* The last frame ran short (media thread) */
+     atomic_int paused;                   /* PAUSE in effect: no frames, audio kept (consumer task) */
+     apr_time_t paused_since;             /* Start of the pause seen by the media thread, 0 = none */
+     
+     /** Cache hit playback hand-over; see elevenlabs_synth_lane_t */
+     unsigned speak_gen;                  /* Bumped per segment started (consumer task) */
+     atomic_uint cancel_gen;              /* Playbacks up to this generation are dropped */
+     
+     /** Incremental text over WebSocket (see elevenlabs_ws.c) */
+     elevenlabs_ws_session_t *ws;         /* Created by the first streamed SPEAK */
+     unsigned ws_context;                 /* Utterance of the active streamed SPEAK, 0 = none */
 }; /* Message types for task communication */
  typedef enum {
      ELEVENLABS_SYNTH_MSG_OPEN_CHANNEL,
      ELEVENLABS_SYNTH_MSG_CLOSE_CHANNEL,
-     ELEVENLABS_SYNTH_MSG_REQUEST_PROCESS
+     ELEVENLABS_SYNTH_MSG_REQUEST_PROCESS,
+     ELEVENLABS_SYNTH_MSG_SEGMENT_NEXT    /* Media thread finished a segment; start more */
  } elevenlabs_synth_msg_type_e;
  
  /* Task message structure */
@@ -175,8 +654,12 @@ struct elevenlabs_synth_channel_t {
      elevenlabs_synth_msg_type_e type;
      mrcp_engine_channel_t *channel;
      mrcp_message_t *request; /* MRCP request message */
+     apr_time_t queued;       /* When it was signalled to the task */
  };
  
+ /* Configuration (implemented in elevenlabs_synth_engine.c) */
+ apt_bool_t elevenlabs_config_load(elevenlabs_config_t *config, const char *config_file, apr_pool_t *pool);
+ 
  /* Engine methods */
  apt_bool_t elevenlabs_synth_engine_destroy(mrcp_engine_t *engine);
  apt_bool_t elevenlabs_synth_engine_open(mrcp_engine_t *engine);
@@ -202,22 +685,146 @@ struct elevenlabs_synth_channel_t {
  elevenlabs_http_client_t* elevenlabs_http_client_create(apr_pool_t *pool);
  void elevenlabs_http_client_destroy(elevenlabs_http_client_t *client);
  apt_bool_t elevenlabs_http_client_stop(elevenlabs_http_client_t *client);
+ void elevenlabs_http_client_cancel(elevenlabs_http_client_t *client);
+ void elevenlabs_http_client_release(elevenlabs_http_client_t *client);
+ void elevenlabs_http_client_free(elevenlabs_http_client_t *client);
+ void elevenlabs_http_client_drained(elevenlabs_http_client_t *client);
  apt_bool_t elevenlabs_http_client_start_synthesis(elevenlabs_http_client_t *client, 
                                                    const char *text, 
+                                                   const char *voice_id,
+                                                   const char *legacy_text,
                                                    elevenlabs_synth_channel_t *channel);
+ void elevenlabs_http_client_complete(elevenlabs_http_client_t *client, CURLcode res);
+CURL* elevenlabs_http_client_hedge_prepare(elevenlabs_http_client_t *client);
+void elevenlabs_http_client_hedge_promote(elevenlabs_http_client_t *client);
+ apt_bool_t elevenlabs_http_client_start_flight(elevenlabs_http_client_t *client,
+                                                const elevenlabs_http_client_t *request,
+                                                elevenlabs_flight_t *flight);
+ 
+ /* Cached audio blobs and the memory tier (implemented in elevenlabs_cache.c) */
+ elevenlabs_cache_blob_t* elevenlabs_cache_blob_open(const char *path, apr_size_t header_len,
+                                                     const char *key, apt_bool_t keep);
+ void elevenlabs_cache_blob_ref(elevenlabs_cache_blob_t *blob);
+ void elevenlabs_cache_blob_unref(elevenlabs_cache_blob_t *blob);
+ void elevenlabs_cache_blob_prefault(elevenlabs_cache_blob_t *blob);
+ elevenlabs_cache_memory_t* elevenlabs_cache_memory_create(apr_pool_t *pool, apr_size_t max_bytes);
+ void elevenlabs_cache_memory_destroy(elevenlabs_cache_memory_t *memory_cache);
+ elevenlabs_cache_blob_t* elevenlabs_cache_memory_get(elevenlabs_cache_memory_t *memory_cache, const char *key);
+ void elevenlabs_cache_memory_put(elevenlabs_cache_memory_t *memory_cache, elevenlabs_cache_blob_t *blob);
+ void elevenlabs_cache_memory_fill(elevenlabs_cache_memory_t *memory_cache, apr_thread_pool_t *io_pool,
+                                   const char *path, const char *key);
+ 
+ /* Disk cache index and eviction (implemented in elevenlabs_cache_disk.c) */
+ elevenlabs_cache_disk_t* elevenlabs_cache_disk_open(apr_pool_t *pool, const elevenlabs_config_t *config);
+ void elevenlabs_cache_disk_close(elevenlabs_cache_disk_t *disk_cache);
+ apt_bool_t elevenlabs_cache_disk_lookup(elevenlabs_cache_disk_t *disk_cache, const char *key);
+ void elevenlabs_cache_disk_insert(elevenlabs_cache_disk_t *disk_cache, const char *key,
+                                   const char *name, apr_off_t size);
+ void elevenlabs_cache_disk_remove(elevenlabs_cache_disk_t *disk_cache, const char *key);
+ 
+ /* Single-flight downloads (implemented in elevenlabs_flight.c) */
+ elevenlabs_flight_registry_t* elevenlabs_flight_registry_create(apr_pool_t *pool, elevenlabs_http_pool_t *http_pool,
+                                                                 apr_thread_pool_t *io_pool,
+                                                                 elevenlabs_cache_memory_t *memory_cache,
+                                                                 elevenlabs_cache_disk_t *disk_cache);
+ void elevenlabs_flight_registry_destroy(elevenlabs_flight_registry_t *registry);
+ elevenlabs_flight_t* elevenlabs_flight_join(elevenlabs_flight_registry_t *registry,
+                                             const elevenlabs_http_client_t *request);
+ void elevenlabs_flight_leave(elevenlabs_flight_t *flight);
+ void elevenlabs_flight_played(elevenlabs_flight_t *flight, apr_size_t pos);
+ apt_bool_t elevenlabs_flight_pace(elevenlabs_flight_t *flight, apr_size_t size);
+ apt_bool_t elevenlabs_flight_abandoned(const elevenlabs_flight_t *flight);
+ apt_bool_t elevenlabs_flight_reserve(elevenlabs_flight_t *flight, apr_size_t size, audio_buffer_span_t *span);
+ void elevenlabs_flight_commit(elevenlabs_flight_t *flight, apr_size_t size);
+ void elevenlabs_flight_finish(elevenlabs_flight_t *flight);
+ 
+ /* Cache hit playback (implemented in elevenlabs_synth_channel.c) */
+ void elevenlabs_channel_playback_publish(elevenlabs_synth_lane_t *lane,
+                                          elevenlabs_cache_blob_t *blob, unsigned gen);
+ void elevenlabs_channel_playback_publish_flight(elevenlabs_synth_lane_t *lane,
+                                                 elevenlabs_flight_t *flight, unsigned gen);
+ void elevenlabs_channel_playback_cancel(elevenlabs_synth_channel_t *synth_channel);
+
+ /* Adaptive prebuffer, media thread (implemented in elevenlabs_synth_channel.c) */
+ apt_bool_t elevenlabs_lane_prebuffer(elevenlabs_synth_channel_t *synth_channel,
+                                      elevenlabs_synth_lane_t *lane, unsigned segment,
+                                      apr_size_t frame_size, apr_time_t now);
+ void elevenlabs_channel_prebuffer_resume(elevenlabs_synth_channel_t *synth_channel, apr_interval_time_t pause);
+
+ /* Shared HTTP pool (implemented in elevenlabs_http_pool.c) */
+ elevenlabs_http_pool_t* elevenlabs_http_pool_create(apr_pool_t *pool, const elevenlabs_config_t *config);
+ void elevenlabs_http_pool_destroy(elevenlabs_http_pool_t *http_pool);
+ void elevenlabs_http_pool_attach(elevenlabs_http_pool_t *http_pool, elevenlabs_http_client_t *client);
+ void elevenlabs_http_pool_setup_easy(elevenlabs_http_pool_t *http_pool, CURL *curl);
+ void elevenlabs_http_pool_record(elevenlabs_http_pool_t *http_pool, CURL *curl);
+apr_interval_time_t elevenlabs_http_pool_hedge_delay(elevenlabs_http_pool_t *http_pool,
+                                                     const elevenlabs_config_t *config);
+apt_bool_t elevenlabs_http_pool_hedge_take(elevenlabs_http_pool_t *http_pool);
+void elevenlabs_http_pool_ttfb_record(elevenlabs_http_pool_t *http_pool, const elevenlabs_config_t *config,
+                                      apr_interval_time_t ttfb);
+
+ /* HTTP worker loops (implemented in elevenlabs_http_worker.c) */
+ elevenlabs_http_worker_t* elevenlabs_http_worker_create(unsigned index, elevenlabs_http_pool_t *http_pool,
+                                                         const elevenlabs_config_t *config, apr_pool_t *pool);
+ void elevenlabs_http_worker_destroy(elevenlabs_http_worker_t *worker);
+ void elevenlabs_http_worker_notify(elevenlabs_http_worker_t *worker, elevenlabs_http_client_t *client);
+ void elevenlabs_http_worker_reap(elevenlabs_http_worker_t *worker, elevenlabs_http_client_t *client);
 
  /* Caching helpers (implemented in elevenlabs_http.c) */
  apt_bool_t elevenlabs_cache_compute_key(apr_pool_t *pool,
                                          const char *voice_id,
                                          const char *model_id,
                                          const char *output_format,
+                                         const char *language_code,
                                          const char *text,
-                                         char **out_key_hex);
+                                         char **out_key);
+ apt_bool_t elevenlabs_cache_compute_legacy_key(apr_pool_t *pool,
+                                                const char *voice_id,
+                                                const char *model_id,
+                                                const char *output_format,
+                                                const char *text,
+                                                char **out_key_hex);
+ char* elevenlabs_text_normalize(apr_pool_t *pool, const char *text);
  apt_bool_t elevenlabs_cache_ensure_dir(apr_pool_t *pool, const char *dir);
+ void elevenlabs_voice_split(apr_pool_t *pool, const char *raw_voice_id,
+                             const char **voice_id, const char **language_code);
+ const char* elevenlabs_text_strip_tags(apr_pool_t *pool, const char *model_id, const char *text);
+ const char* elevenlabs_cache_file_ext(const char *output_format);
+ apt_bool_t elevenlabs_cache_request_key(apr_pool_t *pool, const elevenlabs_config_t *config,
+                                         const char *raw_voice_id, const char *text, char **out_key);
+ 
+ /* WebSocket stream input (implemented in elevenlabs_ws.c) */
+ elevenlabs_ws_session_t* elevenlabs_ws_session_create(const elevenlabs_config_t *config,
+                                                       elevenlabs_http_pool_t *http_pool,
+                                                       audio_buffer_t *audio_buffer, apr_size_t high_water_bytes);
+ void elevenlabs_ws_session_destroy(elevenlabs_ws_session_t *ws);
+ unsigned elevenlabs_ws_session_begin(elevenlabs_ws_session_t *ws, apr_pool_t *pool, const char *raw_voice_id,
+                                      const char *text, apt_bool_t end);
+ apt_bool_t elevenlabs_ws_session_append(elevenlabs_ws_session_t *ws, apr_pool_t *pool, unsigned context,
+                                         const char *text, apt_bool_t end);
+ void elevenlabs_ws_session_cancel(elevenlabs_ws_session_t *ws, unsigned context);
+ apt_bool_t elevenlabs_ws_session_finished(elevenlabs_ws_session_t *ws, unsigned context);
+ char* elevenlabs_json_escape(apr_pool_t *pool, const char *src);
+ 
+ /* Metrics (implemented in elevenlabs_metrics.c) */
+ elevenlabs_metrics_t* elevenlabs_metrics_create(apr_pool_t *pool);
+ void elevenlabs_histogram_observe(elevenlabs_histogram_t *histogram, apr_interval_time_t value);
+ void elevenlabs_metrics_request_done(elevenlabs_metrics_t *metrics, CURLcode res, long http_code,
+                                      apr_interval_time_t elapsed);
+ char* elevenlabs_metrics_render(apr_pool_t *pool, const elevenlabs_synth_engine_t *engine);
+ void elevenlabs_metrics_writer_start(elevenlabs_synth_engine_t *engine);
+ void elevenlabs_metrics_writer_stop(elevenlabs_synth_engine_t *engine);
+ 
+ /* Text segmentation (implemented in elevenlabs_segment.c) */
+ char** elevenlabs_text_segment(apr_pool_t *pool, const char *text,
+                                const elevenlabs_config_t *config, unsigned *count);
  
- /* Audio buffer utilities */
- audio_buffer_t* audio_buffer_create(apr_pool_t *pool, apr_size_t capacity);
- apt_bool_t audio_buffer_write(audio_buffer_t *buffer, const uint8_t *data, apr_size_t size);
- void audio_buffer_destroy(audio_buffer_t *buffer);
+ /* Prompt manifests and cache preload (implemented in elevenlabs_manifest.c) */
+ apr_array_header_t* elevenlabs_manifest_load(apr_pool_t *pool, const char *path);
+ const elevenlabs_config_t* elevenlabs_manifest_config(apr_pool_t *pool, const elevenlabs_config_t *config,
+                                                       const elevenlabs_manifest_entry_t *entry);
+ void elevenlabs_cache_preload(apr_pool_t *pool, const elevenlabs_config_t *config,
+                               const apr_array_header_t *entries, elevenlabs_cache_disk_t *disk_cache,
+                               elevenlabs_cache_memory_t *memory_cache, apr_thread_pool_t *io_pool);
  
  #endif /* ELEVENLABS_SYNTH_H */
@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file g711_decode.h
+ * @brief G.711 (μ-law / A-law) decoders used by the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/*
+ * Copyright 2025 ElevenLabs TTS Plugin for UniMRCP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef G711_DECODE_H
+#define G711_DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Block decoder signature shared by all kernels */
+typedef void (*g711_decode_fn)(const uint8_t* in, size_t n, int16_t* out);
+
+/** One implementation of the G.711 decoders (scalar, SSE2, AVX2, NEON) */
+typedef struct {
+    const char *name;
+    g711_decode_fn ulaw;
+    g711_decode_fn alaw;
+} g711_kernel_t;
+
+/**
+ * Convert μ-law encoded audio data to 16-bit PCM
+ * 
+ * @param in Input μ-law buffer
+ * @param n Number of bytes to convert
+ * @param out Output 16-bit PCM buffer (must be at least n * 2 bytes, any alignment)
+ */
+void ulaw_to_s16(const uint8_t* in, size_t n, int16_t* out);
+
+/**
+ * Convert A-law encoded audio data to 16-bit PCM
+ * 
+ * @param in Input A-law buffer
+ * @param n Number of bytes to convert
+ * @param out Output 16-bit PCM buffer (must be at least n * 2 bytes, any alignment)
+ */
+void alaw_to_s16(const uint8_t* in, size_t n, int16_t* out);
+
+/**
+ * Convert single μ-law byte to 16-bit PCM sample
+ * 
+ * @param ulaw_byte μ-law encoded byte
+ * @return 16-bit PCM sample
+ */
+int16_t ulaw_byte_to_s16(uint8_t ulaw_byte);
+
+/**
+ * Convert single A-law byte to 16-bit PCM sample
+ * 
+ * @param alaw_byte A-law encoded byte
+ * @return 16-bit PCM sample
+ */
+int16_t alaw_byte_to_s16(uint8_t alaw_byte);
+
+/**
+ * Select the fastest kernel supported by the running CPU.
+ * Optional: until it is called the scalar kernel is used.
+ */
+void g711_decode_init(void);
+
+/**
+ * Kernels compiled into this build, scalar reference first; entries the
+ * running CPU cannot execute are left out. Used for tests and benchmarks.
+ * 
+ * @param count Receives the number of entries
+ * @return Kernel table
+ */
+const g711_kernel_t* g711_decode_kernels(size_t *count);
+
+/**
+ * Name of the kernel currently in use
+ */
+const char* g711_decode_kernel_name(void);
+
+#endif /* G711_DECODE_H */
@@ -0,0 +1,263 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_audio_buffer.c
+ * @brief Lock-free SPSC audio ring for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+#include "elevenlabs_defs.h"
+#include "elevenlabs_audio_buffer.h"
+#include <string.h>
+
+audio_buffer_t* audio_buffer_create(apr_pool_t *pool, elevenlabs_slab_t *slab, apr_size_t initial_capacity)
+{
+    /* Ring indices are masked, so capacity must be a power of two. One block on top:
+       the block the consumer is in goes back whole, so the producer stops short of it. */
+    apr_size_t capacity = ELEVENLABS_AUDIO_BLOCK_SIZE;
+    while (capacity < initial_capacity + ELEVENLABS_AUDIO_BLOCK_SIZE) {
+        capacity <<= 1;
+    }
+    
+    audio_buffer_t *buffer = apr_palloc(pool, sizeof(audio_buffer_t));
+    if (!buffer || !slab) {
+        return NULL;
+    }
+    
+    /* Only the slots up front; blocks are borrowed as audio arrives */
+    apr_size_t block_count = capacity / ELEVENLABS_AUDIO_BLOCK_SIZE;
+    buffer->blocks = apr_palloc(pool, block_count * sizeof(*buffer->blocks));
+    if (!buffer->blocks) {
+        return NULL;
+    }
+    for (apr_size_t i = 0; i < block_count; i++) {
+        atomic_init(&buffer->blocks[i], NULL);
+    }
+    
+    buffer->slab = slab;
+    buffer->capacity = capacity;
+    buffer->mask = capacity - 1;
+    atomic_init(&buffer->head, 0);
+    atomic_init(&buffer->tail, 0);
+    atomic_init(&buffer->flush_pos, 0);
+    buffer->pool = pool;
+    
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, 
+           "Created audio ring buffer with capacity: %zu bytes (%zu blocks, borrowed on demand)",
+           capacity, block_count);
+    
+    return buffer;
+}
+
+/* Slot of the block holding byte pos */
+static _Atomic(uint8_t *)* audio_buffer_slot(audio_buffer_t *buffer, apr_size_t pos)
+{
+    return &buffer->blocks[(pos & buffer->mask) / ELEVENLABS_AUDIO_BLOCK_SIZE];
+}
+
+/* Both sides are gone: whatever is still borrowed goes back */
+void audio_buffer_destroy(audio_buffer_t *buffer)
+{
+    if (!buffer) {
+        return;
+    }
+    
+    for (apr_size_t i = 0; i < buffer->capacity / ELEVENLABS_AUDIO_BLOCK_SIZE; i++) {
+        uint8_t *block = atomic_exchange_explicit(&buffer->blocks[i], NULL, memory_order_relaxed);
+        if (block) {
+            elevenlabs_slab_return(buffer->slab, block);
+        }
+    }
+}
+
+/* Effective read position: a pending clear moves the consumer forward */
+static apr_size_t audio_buffer_read_pos(audio_buffer_t *buffer, memory_order order)
+{
+    apr_size_t tail = atomic_load_explicit(&buffer->tail, order);
+    apr_size_t flush = atomic_load_explicit(&buffer->flush_pos, memory_order_acquire);
+    return ((apr_ssize_t)(flush - tail) > 0) ? flush : tail;
+}
+
+/* Free space as seen by the producer. Counted from the start of the consumer's block,
+   which is not the producer's to reuse until the consumer has left it; a clear frees
+   space once the consumer has collected it. */
+apr_size_t audio_buffer_space(audio_buffer_t *buffer)
+{
+    if (!buffer) {
+        return 0;
+    }
+    apr_size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    apr_size_t tail = atomic_load_explicit(&buffer->tail, memory_order_acquire);
+    return (tail & ~(apr_size_t)(ELEVENLABS_AUDIO_BLOCK_SIZE - 1)) + buffer->capacity - head;
+}
+
+/* Bytes ready for the consumer */
+apr_size_t audio_buffer_available(audio_buffer_t *buffer)
+{
+    if (!buffer) {
+        return 0;
+    }
+    apr_size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    apr_size_t tail = audio_buffer_read_pos(buffer, memory_order_relaxed);
+    return head - tail;
+}
+
+/* Producer side: the block holding byte pos, borrowed now if its slot is empty. The
+   consumer empties a slot before publishing the tail that lets the producer reuse it. */
+static uint8_t* audio_buffer_block(audio_buffer_t *buffer, apr_size_t pos)
+{
+    _Atomic(uint8_t *) *slot = audio_buffer_slot(buffer, pos);
+    uint8_t *block = atomic_load_explicit(slot, memory_order_relaxed);
+    if (!block) {
+        block = elevenlabs_slab_borrow(buffer->slab);
+        atomic_store_explicit(slot, block, memory_order_relaxed);
+    }
+    return block;
+}
+
+/* Describe size bytes from pos on, at most one block's worth */
+static apt_bool_t audio_buffer_span_at(audio_buffer_t *buffer, apr_size_t pos, apr_size_t size,
+                                       audio_buffer_span_t *span)
+{
+    apr_size_t offset = pos & (ELEVENLABS_AUDIO_BLOCK_SIZE - 1);
+    apr_size_t first = ELEVENLABS_AUDIO_BLOCK_SIZE - offset;
+    if (first > size) {
+        first = size;
+    }
+    
+    uint8_t *block = audio_buffer_block(buffer, pos);
+    uint8_t *next = first < size ? audio_buffer_block(buffer, pos + first) : NULL;
+    if (!block || (first < size && !next)) {
+        return FALSE;
+    }
+    span->data[0] = block + offset;
+    span->len[0] = first;
+    span->data[1] = next;
+    span->len[1] = size - first;
+    return TRUE;
+}
+
+/* Producer side, zero-copy: describe where the next size bytes go so the caller can
+   produce them in place (e.g. decode G.711 straight into the ring). Nothing becomes
+   visible to the consumer until audio_buffer_commit(). At most one block per call. */
+apt_bool_t audio_buffer_reserve(audio_buffer_t *buffer, apr_size_t size, audio_buffer_span_t *span)
+{
+    if (!buffer || !span || size == 0 || size > ELEVENLABS_AUDIO_BLOCK_SIZE) {
+        return FALSE;
+    }
+    
+    if (audio_buffer_space(buffer) < size) {
+        return FALSE;
+    }
+    
+    apr_size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    return audio_buffer_span_at(buffer, head, size, span);
+}
+
+/* Publish reserved bytes only after they are in place */
+void audio_buffer_commit(audio_buffer_t *buffer, apr_size_t size)
+{
+    apr_size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    atomic_store_explicit(&buffer->head, head + size, memory_order_release);
+}
+
+/* Producer side: copy all of data into the ring or nothing if it does not fit */
+apt_bool_t audio_buffer_write(audio_buffer_t *buffer, const uint8_t *data, apr_size_t size)
+{
+    if (!buffer || !data || size == 0 || audio_buffer_space(buffer) < size) {
+        return FALSE;
+    }
+    
+    /* A block at a time, published once at the end */
+    apr_size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    for (apr_size_t done = 0; done < size; ) {
+        audio_buffer_span_t span;
+        apr_size_t n = size - done;
+        if (n > ELEVENLABS_AUDIO_BLOCK_SIZE) {
+            n = ELEVENLABS_AUDIO_BLOCK_SIZE;
+        }
+        if (!audio_buffer_span_at(buffer, head + done, n, &span)) {
+            return FALSE;
+        }
+        memcpy(span.data[0], data + done, span.len[0]);
+        if (span.len[1] > 0) {
+            memcpy(span.data[1], data + done + span.len[0], span.len[1]);
+        }
+        done += n;
+    }
+    
+    audio_buffer_commit(buffer, size);
+    return TRUE;
+}
+
+/* Consumer side: give back the blocks between from and to that it has left for good */
+static void audio_buffer_release(audio_buffer_t *buffer, apr_size_t from, apr_size_t to)
+{
+    for (apr_size_t block = from / ELEVENLABS_AUDIO_BLOCK_SIZE; block < to / ELEVENLABS_AUDIO_BLOCK_SIZE; block++) {
+        _Atomic(uint8_t *) *slot = audio_buffer_slot(buffer, block * ELEVENLABS_AUDIO_BLOCK_SIZE);
+        uint8_t *data = atomic_exchange_explicit(slot, NULL, memory_order_relaxed);
+        if (data) {
+            elevenlabs_slab_return(buffer->slab, data);
+        }
+    }
+}
+
+/* Consumer side: copy up to one frame out of the ring, O(frame_size) */
+apr_size_t audio_buffer_read_frame(audio_buffer_t *buffer, uint8_t *frame, apr_size_t frame_size)
+{
+    if (!buffer || !frame || frame_size == 0) {
+        return 0;
+    }
+    
+    apr_size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    apr_size_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+    apr_size_t pos = audio_buffer_read_pos(buffer, memory_order_relaxed);
+    apr_size_t available = head - pos;
+    apr_size_t bytes_to_read = (available >= frame_size) ? frame_size : available;
+    
+    for (apr_size_t done = 0; done < bytes_to_read; ) {
+        apr_size_t offset = (pos + done) & (ELEVENLABS_AUDIO_BLOCK_SIZE - 1);
+        apr_size_t n = ELEVENLABS_AUDIO_BLOCK_SIZE - offset;
+        if (n > bytes_to_read - done) {
+            n = bytes_to_read - done;
+        }
+        uint8_t *block = atomic_load_explicit(audio_buffer_slot(buffer, pos + done), memory_order_relaxed);
+        memcpy(frame + done, block + offset, n);
+        done += n;
+    }
+    
+    /* Hand the space back to the producer, and the blocks left behind to the slab */
+    audio_buffer_release(buffer, tail, pos + bytes_to_read);
+    atomic_store_explicit(&buffer->tail, pos + bytes_to_read, memory_order_release);
+    return bytes_to_read;
+}
+
+/* Drop buffered audio. Safe from any thread: rather than touching the consumer-owned
+   tail, it records the current head and the consumer skips up to it on its next read. */
+void audio_buffer_clear(audio_buffer_t *buffer)
+{
+    if (!buffer) {
+        return;
+    }
+    
+    apr_size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    atomic_store_explicit(&buffer->flush_pos, head, memory_order_release);
+}
+
+/* Consumer side: skip what a clear dropped without reading, returning its blocks.
+   Cheap enough to run every frame for rings that are not being played. */
+void audio_buffer_collect(audio_buffer_t *buffer)
+{
+    if (!buffer) {
+        return;
+    }
+    
+    apr_size_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+    apr_size_t flush = atomic_load_explicit(&buffer->flush_pos, memory_order_acquire);
+    if ((apr_ssize_t)(flush - tail) > 0) {
+        audio_buffer_release(buffer, tail, flush);
+        atomic_store_explicit(&buffer->tail, flush, memory_order_release);
+    }
+}
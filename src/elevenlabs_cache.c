@@ -0,0 +1,307 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_cache.c
+ * @brief Cached audio blobs and the in-memory cache tier for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+#include "elevenlabs_synth.h"
+#include "apr_strings.h"
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* A blob is a cache file mapped read-only. Nothing writes to it after creation and it
+   is refcounted, so channels, I/O workers and the memory tier all share the one
+   mapping, and whoever drops the last reference unmaps it on whatever thread. */
+elevenlabs_cache_blob_t* elevenlabs_cache_blob_open(const char *path, apr_size_t header_len,
+                                                    const char *key, apt_bool_t keep)
+{
+  if (!path) {
+    return NULL;
+  }
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (apr_size_t)st.st_size <= header_len) {
+    close(fd);
+    return NULL;
+  }
+  void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); /* The mapping keeps the file referenced */
+  if (addr == MAP_FAILED) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Failed to map cached audio: %s", path);
+    return NULL;
+  }
+  if (keep) {
+    /* Kept by the memory tier and replayed: read it all in, keep the pages */
+#ifdef MADV_WILLNEED
+    madvise(addr, (size_t)st.st_size, MADV_WILLNEED);
+#endif
+  } else {
+    /* Played front to back once: read ahead aggressively, drop pages behind us */
+#ifdef MADV_SEQUENTIAL
+    madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+  }
+
+  /* Not pool memory: the last reference may be dropped on any thread */
+  elevenlabs_cache_blob_t *blob = malloc(sizeof(elevenlabs_cache_blob_t));
+  if (!blob) {
+    munmap(addr, (size_t)st.st_size);
+    return NULL;
+  }
+  blob->addr = addr;
+  blob->size = (apr_size_t)st.st_size;
+  blob->data = (const uint8_t *)addr + header_len;
+  blob->len = blob->size - header_len;
+  blob->key[0] = '\0';
+  if (key) {
+    apr_cpystrn(blob->key, key, sizeof(blob->key));
+  }
+  blob->lru_prev = NULL;
+  blob->lru_next = NULL;
+  atomic_init(&blob->ready, 0);
+  atomic_init(&blob->refs, 1);
+  return blob;
+}
+
+void elevenlabs_cache_blob_ref(elevenlabs_cache_blob_t *blob)
+{
+  atomic_fetch_add(&blob->refs, 1);
+}
+
+void elevenlabs_cache_blob_unref(elevenlabs_cache_blob_t *blob)
+{
+  if (blob && atomic_fetch_sub(&blob->refs, 1) == 1) {
+    munmap(blob->addr, blob->size);
+    free(blob);
+  }
+}
+
+/* I/O worker: touch the mapping front to back so the media thread never blocks on a
+   page fault, publishing how far it is safe to read as it goes. The caller holds one
+   reference; once it is the only one left, nobody is going to play the blob. */
+void elevenlabs_cache_blob_prefault(elevenlabs_cache_blob_t *blob)
+{
+  const apr_size_t step = 64 * 1024;
+  const long page = sysconf(_SC_PAGESIZE) > 0 ? sysconf(_SC_PAGESIZE) : 4096;
+  const volatile uint8_t *base = (const volatile uint8_t *)blob->addr;
+  apr_size_t header_len = (apr_size_t)(blob->data - (const uint8_t *)blob->addr);
+
+  for (apr_size_t off = 0; off < blob->size && atomic_load(&blob->refs) > 1; off += step) {
+    apr_size_t end = off + step < blob->size ? off + step : blob->size;
+    for (apr_size_t p = off; p < end; p += (apr_size_t)page) {
+      (void)base[p];
+    }
+    (void)base[end - 1];
+    atomic_store_explicit(&blob->ready, end > header_len ? end - header_len : 0, memory_order_release);
+  }
+}
+
+/**
+ * Create the in-memory cache tier
+ */
+elevenlabs_cache_memory_t* elevenlabs_cache_memory_create(apr_pool_t *pool, apr_size_t max_bytes)
+{
+  elevenlabs_cache_memory_t *memory_cache = apr_pcalloc(pool, sizeof(elevenlabs_cache_memory_t));
+  memory_cache->pool = pool;
+  memory_cache->max_bytes = max_bytes;
+  memory_cache->index = apr_hash_make(pool);
+  if (apr_thread_mutex_create(&memory_cache->mutex, APR_THREAD_MUTEX_DEFAULT, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "Failed to create memory cache mutex");
+    return NULL;
+  }
+  atomic_init(&memory_cache->hits, 0);
+  atomic_init(&memory_cache->misses, 0);
+  atomic_init(&memory_cache->evictions, 0);
+
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "Memory cache tier created (budget %lu bytes)", (unsigned long)max_bytes);
+  return memory_cache;
+}
+
+/**
+ * Destroy the memory tier; blobs still being played survive until their last reference
+ */
+void elevenlabs_cache_memory_destroy(elevenlabs_cache_memory_t *memory_cache)
+{
+  if (!memory_cache) {
+    return;
+  }
+
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "Memory cache stats: hits=%lu misses=%lu evictions=%lu bytes=%lu",
+          (unsigned long)atomic_load(&memory_cache->hits),
+          (unsigned long)atomic_load(&memory_cache->misses),
+          (unsigned long)atomic_load(&memory_cache->evictions),
+          (unsigned long)memory_cache->bytes);
+
+  elevenlabs_cache_blob_t *blob = memory_cache->lru_head;
+  while (blob) {
+    elevenlabs_cache_blob_t *next = blob->lru_next;
+    elevenlabs_cache_blob_unref(blob);
+    blob = next;
+  }
+  memory_cache->lru_head = NULL;
+  memory_cache->lru_tail = NULL;
+  memory_cache->bytes = 0;
+  apr_hash_clear(memory_cache->index);
+
+  apr_thread_mutex_destroy(memory_cache->mutex);
+  memory_cache->mutex = NULL;
+}
+
+/* LRU list helpers; called with the tier mutex held */
+static void elevenlabs_cache_memory_unlink(elevenlabs_cache_memory_t *memory_cache,
+                                           elevenlabs_cache_blob_t *blob)
+{
+  if (blob->lru_prev) {
+    blob->lru_prev->lru_next = blob->lru_next;
+  } else {
+    memory_cache->lru_head = blob->lru_next;
+  }
+  if (blob->lru_next) {
+    blob->lru_next->lru_prev = blob->lru_prev;
+  } else {
+    memory_cache->lru_tail = blob->lru_prev;
+  }
+  blob->lru_prev = NULL;
+  blob->lru_next = NULL;
+}
+
+static void elevenlabs_cache_memory_push_front(elevenlabs_cache_memory_t *memory_cache,
+                                               elevenlabs_cache_blob_t *blob)
+{
+  blob->lru_prev = NULL;
+  blob->lru_next = memory_cache->lru_head;
+  if (memory_cache->lru_head) {
+    memory_cache->lru_head->lru_prev = blob;
+  } else {
+    memory_cache->lru_tail = blob;
+  }
+  memory_cache->lru_head = blob;
+}
+
+/* Look a key up; a hit returns a new reference the caller must drop */
+elevenlabs_cache_blob_t* elevenlabs_cache_memory_get(elevenlabs_cache_memory_t *memory_cache, const char *key)
+{
+  if (!memory_cache || !key) {
+    return NULL;
+  }
+
+  apr_thread_mutex_lock(memory_cache->mutex);
+  elevenlabs_cache_blob_t *blob = apr_hash_get(memory_cache->index, key, APR_HASH_KEY_STRING);
+  if (blob) {
+    if (memory_cache->lru_head != blob) {
+      elevenlabs_cache_memory_unlink(memory_cache, blob);
+      elevenlabs_cache_memory_push_front(memory_cache, blob);
+    }
+    elevenlabs_cache_blob_ref(blob);
+  }
+  apr_thread_mutex_unlock(memory_cache->mutex);
+
+  atomic_fetch_add(blob ? &memory_cache->hits : &memory_cache->misses, 1);
+  return blob;
+}
+
+/* Keep a blob in memory, evicting least recently used ones to stay within budget.
+   The tier takes its own reference; a key already present keeps its blob. */
+void elevenlabs_cache_memory_put(elevenlabs_cache_memory_t *memory_cache, elevenlabs_cache_blob_t *blob)
+{
+  if (!memory_cache || !blob || !blob->key[0] || blob->size > memory_cache->max_bytes) {
+    return;
+  }
+
+  elevenlabs_cache_blob_t *evicted = NULL;
+  unsigned long evicted_count = 0;
+
+  apr_thread_mutex_lock(memory_cache->mutex);
+  if (apr_hash_get(memory_cache->index, blob->key, APR_HASH_KEY_STRING)) {
+    apr_thread_mutex_unlock(memory_cache->mutex);
+    return;
+  }
+  while (memory_cache->lru_tail && memory_cache->bytes + blob->size > memory_cache->max_bytes) {
+    elevenlabs_cache_blob_t *victim = memory_cache->lru_tail;
+    elevenlabs_cache_memory_unlink(memory_cache, victim);
+    apr_hash_set(memory_cache->index, victim->key, APR_HASH_KEY_STRING, NULL);
+    memory_cache->bytes -= victim->size;
+    /* Released after unlocking; lru_next is free to chain them meanwhile */
+    victim->lru_next = evicted;
+    evicted = victim;
+    evicted_count++;
+  }
+  elevenlabs_cache_blob_ref(blob);
+  elevenlabs_cache_memory_push_front(memory_cache, blob);
+  apr_hash_set(memory_cache->index, blob->key, APR_HASH_KEY_STRING, blob);
+  memory_cache->bytes += blob->size;
+  apr_thread_mutex_unlock(memory_cache->mutex);
+
+  if (evicted_count) {
+    atomic_fetch_add(&memory_cache->evictions, evicted_count);
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+            "Memory cache evicted %lu entries", evicted_count);
+  }
+  while (evicted) {
+    elevenlabs_cache_blob_t *next = evicted->lru_next;
+    evicted->lru_next = NULL;
+    elevenlabs_cache_blob_unref(evicted);
+    evicted = next;
+  }
+}
+
+typedef struct elevenlabs_cache_fill_t {
+  elevenlabs_cache_memory_t *memory_cache;
+  char *path;
+  char *key;
+} elevenlabs_cache_fill_t;
+
+static void* APR_THREAD_FUNC elevenlabs_cache_memory_fill_task(apr_thread_t *thd, void *data)
+{
+  elevenlabs_cache_fill_t *fill = (elevenlabs_cache_fill_t *)data;
+  elevenlabs_cache_blob_t *blob = elevenlabs_cache_blob_open(fill->path, strstr(fill->path, ".wav") ? 44 : 0,
+                                                             fill->key, TRUE);
+  if (blob) {
+    elevenlabs_cache_memory_put(fill->memory_cache, blob);
+    elevenlabs_cache_blob_prefault(blob);
+    elevenlabs_cache_blob_unref(blob);
+  }
+  free(fill->path);
+  free(fill->key);
+  free(fill);
+  return NULL;
+}
+
+/* Load a freshly written cache file into the memory tier on an I/O worker */
+void elevenlabs_cache_memory_fill(elevenlabs_cache_memory_t *memory_cache, apr_thread_pool_t *io_pool,
+                                  const char *path, const char *key)
+{
+  if (!memory_cache || !io_pool || !path || !key) {
+    return;
+  }
+
+  /* Not pool memory: the request that wrote the file may be long gone when this runs */
+  elevenlabs_cache_fill_t *fill = malloc(sizeof(elevenlabs_cache_fill_t));
+  if (!fill) {
+    return;
+  }
+  fill->memory_cache = memory_cache;
+  fill->path = strdup(path);
+  fill->key = strdup(key);
+  if (!fill->path || !fill->key ||
+      apr_thread_pool_push(io_pool, elevenlabs_cache_memory_fill_task, fill,
+                           APR_THREAD_TASK_PRIORITY_NORMAL, NULL) != APR_SUCCESS) {
+    free(fill->path);
+    free(fill->key);
+    free(fill);
+  }
+}
@@ -0,0 +1,453 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_cache_disk.c
+ * @brief Disk cache index, size bounds and eviction for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+#include "elevenlabs_synth.h"
+#include "apr_strings.h"
+#include "apr_file_io.h"
+#include "apr_file_info.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* The index is a text file in cache_dir, one line per cached file:
+       <name> <size> <last access, usec since epoch> <hits>
+   under a header that says whether the engine shut down cleanly. While the engine
+   runs the file on disk is marked dirty, so after a crash the next open rescans the
+   directory: unknown files are adopted, missing ones dropped, .part orphans deleted. */
+#define ELEVENLABS_CACHE_INDEX_MAGIC "elevenlabs-cache-index 1"
+#define ELEVENLABS_CACHE_EVICT_CHECK_INTERVAL apr_time_from_sec(10)
+#define ELEVENLABS_CACHE_CHECKPOINT_INTERVAL apr_time_from_sec(60)
+
+/* Cache file names are <key><ext>; the key is everything before the first dot */
+static apt_bool_t elevenlabs_cache_disk_key_from_name(const char *name, char *key, apr_size_t key_size)
+{
+  const char *dot = strchr(name, '.');
+  apr_size_t len = dot ? (apr_size_t)(dot - name) : strlen(name);
+  if (len == 0 || len >= key_size || strlen(name) >= sizeof(((elevenlabs_cache_entry_t *)0)->name)) {
+    return FALSE;
+  }
+  memcpy(key, name, len);
+  key[len] = '\0';
+  return TRUE;
+}
+
+/* Add or update an entry; called with the mutex held (or before the thread starts) */
+static elevenlabs_cache_entry_t* elevenlabs_cache_disk_put(elevenlabs_cache_disk_t *disk_cache, const char *key,
+                                                           const char *name, apr_off_t size)
+{
+  elevenlabs_cache_entry_t *entry = apr_hash_get(disk_cache->index, key, APR_HASH_KEY_STRING);
+  if (entry) {
+    disk_cache->bytes -= (apr_size_t)entry->size;
+  } else {
+    /* Not pool memory: entries come and go for the life of the engine */
+    entry = calloc(1, sizeof(elevenlabs_cache_entry_t));
+    if (!entry) {
+      return NULL;
+    }
+    apr_cpystrn(entry->key, key, sizeof(entry->key));
+    apr_hash_set(disk_cache->index, entry->key, APR_HASH_KEY_STRING, entry);
+    disk_cache->entries++;
+  }
+  apr_cpystrn(entry->name, name, sizeof(entry->name));
+  entry->size = size;
+  disk_cache->bytes += (apr_size_t)size;
+  disk_cache->dirty = TRUE;
+  return entry;
+}
+
+static void elevenlabs_cache_disk_drop(elevenlabs_cache_disk_t *disk_cache, elevenlabs_cache_entry_t *entry)
+{
+  apr_hash_set(disk_cache->index, entry->key, APR_HASH_KEY_STRING, NULL);
+  disk_cache->bytes -= (apr_size_t)entry->size;
+  disk_cache->entries--;
+  disk_cache->dirty = TRUE;
+  free(entry);
+}
+
+static apt_bool_t elevenlabs_cache_disk_over_limit(const elevenlabs_cache_disk_t *disk_cache)
+{
+  return (disk_cache->max_bytes && disk_cache->bytes > disk_cache->max_bytes) ||
+         (disk_cache->max_entries && disk_cache->entries > disk_cache->max_entries);
+}
+
+/* Read index.txt; returns TRUE only if it was written by a clean shutdown */
+static apt_bool_t elevenlabs_cache_disk_load(elevenlabs_cache_disk_t *disk_cache)
+{
+  apr_file_t *fp = NULL;
+  if (apr_file_open(&fp, disk_cache->index_path, APR_FOPEN_READ | APR_FOPEN_BUFFERED,
+                    APR_OS_DEFAULT, disk_cache->pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+            "No disk cache index yet: %s", disk_cache->index_path);
+    return FALSE;
+  }
+
+  char line[256];
+  apt_bool_t clean = FALSE;
+  if (apr_file_gets(line, sizeof(line), fp) != APR_SUCCESS ||
+      strncmp(line, ELEVENLABS_CACHE_INDEX_MAGIC, strlen(ELEVENLABS_CACHE_INDEX_MAGIC)) != 0) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+            "Ignoring unrecognized disk cache index: %s", disk_cache->index_path);
+    apr_file_close(fp);
+    return FALSE;
+  }
+  clean = strstr(line, " clean") != NULL;
+
+  while (apr_file_gets(line, sizeof(line), fp) == APR_SUCCESS) {
+    char name[80];
+    char key[64];
+    long long size = 0;
+    long long last_access = 0;
+    unsigned hits = 0;
+    if (sscanf(line, "%79s %lld %lld %u", name, &size, &last_access, &hits) != 4 ||
+        !elevenlabs_cache_disk_key_from_name(name, key, sizeof(key))) {
+      continue;
+    }
+    elevenlabs_cache_entry_t *entry = elevenlabs_cache_disk_put(disk_cache, key, name, (apr_off_t)size);
+    if (entry) {
+      entry->last_access = (apr_time_t)last_access;
+      entry->hits = hits;
+    }
+  }
+  apr_file_close(fp);
+  return clean;
+}
+
+/* Reconcile the index with cache_dir after an unclean shutdown (or with no index) */
+static void elevenlabs_cache_disk_scan(elevenlabs_cache_disk_t *disk_cache)
+{
+  apr_dir_t *dir = NULL;
+  if (apr_dir_open(&dir, disk_cache->dir, disk_cache->pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+            "Failed to scan cache directory: %s", disk_cache->dir);
+    return;
+  }
+
+  apr_hash_index_t *hi;
+  for (hi = apr_hash_first(NULL, disk_cache->index); hi; hi = apr_hash_next(hi)) {
+    ((elevenlabs_cache_entry_t *)apr_hash_this_val(hi))->seen = FALSE;
+  }
+
+  unsigned adopted = 0, orphans = 0, missing = 0;
+  apr_finfo_t finfo;
+  apr_status_t rv;
+  while ((rv = apr_dir_read(&finfo, APR_FINFO_NAME | APR_FINFO_TYPE | APR_FINFO_SIZE | APR_FINFO_MTIME,
+                            dir)) == APR_SUCCESS || rv == APR_INCOMPLETE) {
+    if (finfo.filetype != APR_REG || !finfo.name ||
+        strncmp(finfo.name, ELEVENLABS_CACHE_INDEX_FILE, strlen(ELEVENLABS_CACHE_INDEX_FILE)) == 0) {
+      continue;
+    }
+    apr_size_t len = strlen(finfo.name);
+    if (len > 5 && strcmp(finfo.name + len - 5, ".part") == 0) {
+      /* A download that never finished; nothing can be writing it before open */
+      apr_file_remove(apr_psprintf(disk_cache->pool, "%s/%s", disk_cache->dir, finfo.name), disk_cache->pool);
+      orphans++;
+      continue;
+    }
+    char key[64];
+    if (!elevenlabs_cache_disk_key_from_name(finfo.name, key, sizeof(key))) {
+      continue;
+    }
+    apt_bool_t known = apr_hash_get(disk_cache->index, key, APR_HASH_KEY_STRING) != NULL;
+    elevenlabs_cache_entry_t *entry = elevenlabs_cache_disk_put(disk_cache, key, finfo.name, finfo.size);
+    if (entry) {
+      if (!known) {
+        entry->last_access = finfo.mtime;
+        adopted++;
+      }
+      entry->seen = TRUE;
+    }
+  }
+  apr_dir_close(dir);
+
+  /* Deleting the current entry during iteration is allowed by apr_hash */
+  for (hi = apr_hash_first(NULL, disk_cache->index); hi; hi = apr_hash_next(hi)) {
+    elevenlabs_cache_entry_t *entry = apr_hash_this_val(hi);
+    if (!entry->seen) {
+      elevenlabs_cache_disk_drop(disk_cache, entry);
+      missing++;
+    }
+  }
+
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "Disk cache recovered: %u files adopted, %u stale entries dropped, %u orphaned .part files removed",
+          adopted, missing, orphans);
+}
+
+/* Write the index to index.txt.tmp and rename it into place. The entries are copied
+   under the mutex and written without it, so lookups never wait on the file. */
+static void elevenlabs_cache_disk_save(elevenlabs_cache_disk_t *disk_cache, apt_bool_t clean, apr_pool_t *pool)
+{
+  apr_thread_mutex_lock(disk_cache->mutex);
+  unsigned count = disk_cache->entries;
+  elevenlabs_cache_entry_t *snapshot = malloc(sizeof(elevenlabs_cache_entry_t) * (count ? count : 1));
+  if (!snapshot) {
+    apr_thread_mutex_unlock(disk_cache->mutex);
+    return;
+  }
+  unsigned n = 0;
+  apr_hash_index_t *hi;
+  for (hi = apr_hash_first(NULL, disk_cache->index); hi && n < count; hi = apr_hash_next(hi)) {
+    snapshot[n++] = *(elevenlabs_cache_entry_t *)apr_hash_this_val(hi);
+  }
+  disk_cache->dirty = FALSE;
+  apr_thread_mutex_unlock(disk_cache->mutex);
+
+  const char *tmp_path = apr_psprintf(pool, "%s.tmp", disk_cache->index_path);
+  apr_file_t *fp = NULL;
+  if (apr_file_open(&fp, tmp_path, APR_FOPEN_CREATE | APR_FOPEN_WRITE | APR_FOPEN_TRUNCATE | APR_FOPEN_BUFFERED,
+                    APR_OS_DEFAULT, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Failed to write disk cache index: %s", tmp_path);
+    free(snapshot);
+    return;
+  }
+  apr_file_printf(fp, "%s %s\n", ELEVENLABS_CACHE_INDEX_MAGIC, clean ? "clean" : "dirty");
+  for (unsigned i = 0; i < n; i++) {
+    apr_file_printf(fp, "%s %lld %lld %u\n", snapshot[i].name, (long long)snapshot[i].size,
+                    (long long)snapshot[i].last_access, (unsigned)snapshot[i].hits);
+  }
+  apr_file_close(fp);
+  free(snapshot);
+  if (apr_file_rename(tmp_path, disk_cache->index_path, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+            "Failed to replace disk cache index: %s", disk_cache->index_path);
+  }
+}
+
+static int elevenlabs_cache_disk_cmp_lru(const void *a, const void *b)
+{
+  const elevenlabs_cache_entry_t *ea = *(elevenlabs_cache_entry_t * const *)a;
+  const elevenlabs_cache_entry_t *eb = *(elevenlabs_cache_entry_t * const *)b;
+  return (ea->last_access > eb->last_access) - (ea->last_access < eb->last_access);
+}
+
+static int elevenlabs_cache_disk_cmp_lfu(const void *a, const void *b)
+{
+  const elevenlabs_cache_entry_t *ea = *(elevenlabs_cache_entry_t * const *)a;
+  const elevenlabs_cache_entry_t *eb = *(elevenlabs_cache_entry_t * const *)b;
+  if (ea->hits != eb->hits) {
+    return ea->hits < eb->hits ? -1 : 1;
+  }
+  return elevenlabs_cache_disk_cmp_lru(a, b);
+}
+
+/* Evict down to 90% of each bound so eviction does not run on every insert */
+static void elevenlabs_cache_disk_evict(elevenlabs_cache_disk_t *disk_cache, apr_pool_t *pool)
+{
+  apr_thread_mutex_lock(disk_cache->mutex);
+  if (!elevenlabs_cache_disk_over_limit(disk_cache)) {
+    apr_thread_mutex_unlock(disk_cache->mutex);
+    return;
+  }
+  unsigned count = disk_cache->entries;
+  elevenlabs_cache_entry_t **order = malloc(sizeof(elevenlabs_cache_entry_t *) * count);
+  if (!order) {
+    apr_thread_mutex_unlock(disk_cache->mutex);
+    return;
+  }
+  unsigned n = 0;
+  apr_hash_index_t *hi;
+  for (hi = apr_hash_first(NULL, disk_cache->index); hi && n < count; hi = apr_hash_next(hi)) {
+    order[n++] = apr_hash_this_val(hi);
+  }
+  qsort(order, n, sizeof(elevenlabs_cache_entry_t *),
+        disk_cache->lfu ? elevenlabs_cache_disk_cmp_lfu : elevenlabs_cache_disk_cmp_lru);
+
+  apr_size_t target_bytes = disk_cache->max_bytes - disk_cache->max_bytes / 10;
+  unsigned target_entries = disk_cache->max_entries - disk_cache->max_entries / 10;
+  unsigned victims = 0;
+  apr_size_t freed = 0;
+  while (victims < n &&
+         ((disk_cache->max_bytes && disk_cache->bytes > target_bytes) ||
+          (disk_cache->max_entries && disk_cache->entries > target_entries))) {
+    elevenlabs_cache_entry_t *entry = order[victims++];
+    apr_hash_set(disk_cache->index, entry->key, APR_HASH_KEY_STRING, NULL);
+    disk_cache->bytes -= (apr_size_t)entry->size;
+    disk_cache->entries--;
+    freed += (apr_size_t)entry->size;
+  }
+  disk_cache->dirty = TRUE;
+  apr_size_t bytes = disk_cache->bytes;
+  unsigned entries = disk_cache->entries;
+  apr_thread_mutex_unlock(disk_cache->mutex);
+
+  /* Unlinked outside the lock. A blob still playing keeps its mapping; a download of
+     the same key landing in between loses its file, and the next lookup notices the
+     missing file, drops the entry and fetches it again. */
+  for (unsigned i = 0; i < victims; i++) {
+    apr_file_remove(apr_psprintf(pool, "%s/%s", disk_cache->dir, order[i]->name), pool);
+    free(order[i]);
+  }
+  free(order);
+
+  atomic_fetch_add(&disk_cache->evictions, victims);
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "Disk cache evicted %u files (%lu bytes, %s), now %u files, %lu bytes",
+          victims, (unsigned long)freed, disk_cache->lfu ? "LFU" : "LRU", entries, (unsigned long)bytes);
+}
+
+/* Background thread: enforce the bounds and checkpoint the index */
+static void* APR_THREAD_FUNC elevenlabs_cache_disk_run(apr_thread_t *thread, void *data)
+{
+  elevenlabs_cache_disk_t *disk_cache = (elevenlabs_cache_disk_t *)data;
+  apr_time_t last_save = apr_time_now();
+
+  apr_thread_mutex_lock(disk_cache->mutex);
+  while (disk_cache->running) {
+    if (!elevenlabs_cache_disk_over_limit(disk_cache)) {
+      apr_thread_cond_timedwait(disk_cache->cond, disk_cache->mutex, ELEVENLABS_CACHE_EVICT_CHECK_INTERVAL);
+    }
+    if (!disk_cache->running) {
+      break;
+    }
+    apt_bool_t dirty = disk_cache->dirty;
+    apr_thread_mutex_unlock(disk_cache->mutex);
+
+    elevenlabs_cache_disk_evict(disk_cache, disk_cache->work_pool);
+    if (dirty && apr_time_now() - last_save >= ELEVENLABS_CACHE_CHECKPOINT_INTERVAL) {
+      elevenlabs_cache_disk_save(disk_cache, FALSE, disk_cache->work_pool);
+      last_save = apr_time_now();
+    }
+    apr_pool_clear(disk_cache->work_pool);
+
+    apr_thread_mutex_lock(disk_cache->mutex);
+  }
+  apr_thread_mutex_unlock(disk_cache->mutex);
+  return NULL;
+}
+
+/**
+ * Load (or rebuild) the disk cache index and start the eviction thread
+ */
+elevenlabs_cache_disk_t* elevenlabs_cache_disk_open(apr_pool_t *pool, const elevenlabs_config_t *config)
+{
+  if (!config || !config->cache_dir) {
+    return NULL;
+  }
+
+  elevenlabs_cache_disk_t *disk_cache = apr_pcalloc(pool, sizeof(elevenlabs_cache_disk_t));
+  disk_cache->pool = pool;
+  disk_cache->dir = config->cache_dir;
+  disk_cache->index_path = apr_psprintf(pool, "%s/%s", config->cache_dir, ELEVENLABS_CACHE_INDEX_FILE);
+  disk_cache->index = apr_hash_make(pool);
+  disk_cache->max_bytes = config->cache_max_bytes;
+  disk_cache->max_entries = config->cache_max_entries;
+  disk_cache->lfu = config->cache_eviction_policy && strcasecmp(config->cache_eviction_policy, "lfu") == 0;
+  atomic_init(&disk_cache->evictions, 0);
+  if (apr_thread_mutex_create(&disk_cache->mutex, APR_THREAD_MUTEX_DEFAULT, pool) != APR_SUCCESS ||
+      apr_thread_cond_create(&disk_cache->cond, pool) != APR_SUCCESS ||
+      apr_pool_create(&disk_cache->work_pool, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "Failed to create disk cache index");
+    return NULL;
+  }
+
+  apr_time_t started = apr_time_now();
+  if (!elevenlabs_cache_disk_load(disk_cache)) {
+    elevenlabs_cache_disk_scan(disk_cache);
+  }
+  /* Marked dirty on disk until a clean close rewrites it */
+  elevenlabs_cache_disk_save(disk_cache, FALSE, pool);
+
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "Disk cache index loaded in %ld ms: %u files, %lu bytes (max %lu bytes, %u files, %s eviction)",
+          (long)apr_time_as_msec(apr_time_now() - started), disk_cache->entries,
+          (unsigned long)disk_cache->bytes, (unsigned long)disk_cache->max_bytes,
+          disk_cache->max_entries, disk_cache->lfu ? "LFU" : "LRU");
+
+  disk_cache->running = TRUE;
+  if (apr_thread_create(&disk_cache->thread, NULL, elevenlabs_cache_disk_run, disk_cache, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+            "Failed to start disk cache eviction thread, cache size is not bounded");
+    disk_cache->running = FALSE;
+    disk_cache->thread = NULL;
+  }
+  return disk_cache;
+}
+
+/**
+ * Stop the eviction thread and write the index back as clean
+ */
+void elevenlabs_cache_disk_close(elevenlabs_cache_disk_t *disk_cache)
+{
+  if (!disk_cache) {
+    return;
+  }
+  if (disk_cache->thread) {
+    apr_status_t rv = APR_SUCCESS;
+    apr_thread_mutex_lock(disk_cache->mutex);
+    disk_cache->running = FALSE;
+    apr_thread_cond_signal(disk_cache->cond);
+    apr_thread_mutex_unlock(disk_cache->mutex);
+    apr_thread_join(&rv, disk_cache->thread);
+    disk_cache->thread = NULL;
+  }
+
+  elevenlabs_cache_disk_save(disk_cache, TRUE, disk_cache->pool);
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "Disk cache index saved: %u files, %lu bytes, %lu evictions",
+          disk_cache->entries, (unsigned long)disk_cache->bytes,
+          (unsigned long)atomic_load(&disk_cache->evictions));
+
+  apr_hash_index_t *hi;
+  for (hi = apr_hash_first(NULL, disk_cache->index); hi; hi = apr_hash_next(hi)) {
+    free(apr_hash_this_val(hi));
+  }
+  apr_hash_clear(disk_cache->index);
+  disk_cache->entries = 0;
+  disk_cache->bytes = 0;
+}
+
+/* Answer a lookup from the index, recording the access; no filesystem call */
+apt_bool_t elevenlabs_cache_disk_lookup(elevenlabs_cache_disk_t *disk_cache, const char *key)
+{
+  if (!disk_cache || !key) {
+    return FALSE;
+  }
+  apr_thread_mutex_lock(disk_cache->mutex);
+  elevenlabs_cache_entry_t *entry = apr_hash_get(disk_cache->index, key, APR_HASH_KEY_STRING);
+  if (entry) {
+    entry->hits++;
+    entry->last_access = apr_time_now();
+    disk_cache->dirty = TRUE;
+  }
+  apr_thread_mutex_unlock(disk_cache->mutex);
+  return entry != NULL;
+}
+
+/* Record a file that was just renamed into cache_dir */
+void elevenlabs_cache_disk_insert(elevenlabs_cache_disk_t *disk_cache, const char *key,
+                                  const char *name, apr_off_t size)
+{
+  if (!disk_cache || !key || !name) {
+    return;
+  }
+  apr_thread_mutex_lock(disk_cache->mutex);
+  elevenlabs_cache_entry_t *entry = elevenlabs_cache_disk_put(disk_cache, key, name, size);
+  if (entry) {
+    entry->last_access = apr_time_now();
+  }
+  if (elevenlabs_cache_disk_over_limit(disk_cache)) {
+    apr_thread_cond_signal(disk_cache->cond);
+  }
+  apr_thread_mutex_unlock(disk_cache->mutex);
+}
+
+/* Forget an entry whose file turned out to be gone */
+void elevenlabs_cache_disk_remove(elevenlabs_cache_disk_t *disk_cache, const char *key)
+{
+  if (!disk_cache || !key) {
+    return;
+  }
+  apr_thread_mutex_lock(disk_cache->mutex);
+  elevenlabs_cache_entry_t *entry = apr_hash_get(disk_cache->index, key, APR_HASH_KEY_STRING);
+  if (entry) {
+    elevenlabs_cache_disk_drop(disk_cache, entry);
+  }
+  apr_thread_mutex_unlock(disk_cache->mutex);
+}
@@ -0,0 +1,389 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_flight.c
+ * @brief Single-flight downloads shared by identical concurrent SPEAKs for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* When a campaign starts, many channels ask for the same uncached prompt at once. The
+   first miss for a key starts a flight: a download on one of the registry's own HTTP
+   clients, which writes the cache file once and appends the audio to a chunk list.
+   Every later miss for the key subscribes to it instead of opening its own stream.
+
+   A subscriber leaving (STOP, barge-in, channel close) runs on the media or consumer
+   thread, so it takes no lock: it drops the subscriber count and its reference. When
+   the last one leaves, a download that writes a cache file carries on without
+   listeners, since the next call will want it; any other download is cancelled.
+
+   The transfer is paced like a lane's: it pauses once it is high water ahead of the
+   subscriber furthest along, and resumes when that one drains to low water. A PAUSEd
+   or slower subscriber plays what is already buffered, so the chunks are kept until
+   the last subscriber is done, which is the size of the cache file anyway. With nobody
+   listening, a cache fill runs unpaced. */
+
+#include "elevenlabs_synth.h"
+#include "apr_strings.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+static void elevenlabs_flight_unref(elevenlabs_flight_t *flight)
+{
+  if (atomic_fetch_sub(&flight->refs, 1) == 1) {
+    elevenlabs_flight_chunk_t *chunk = flight->head;
+    while (chunk) {
+      elevenlabs_flight_chunk_t *next = atomic_load(&chunk->next);
+      free(chunk);
+      chunk = next;
+    }
+    free(flight);
+  }
+}
+
+/**
+ * Create the registry; download clients are created on demand
+ */
+elevenlabs_flight_registry_t* elevenlabs_flight_registry_create(apr_pool_t *pool, elevenlabs_http_pool_t *http_pool,
+                                                                apr_thread_pool_t *io_pool,
+                                                                elevenlabs_cache_memory_t *memory_cache,
+                                                                elevenlabs_cache_disk_t *disk_cache)
+{
+  elevenlabs_flight_registry_t *registry = apr_pcalloc(pool, sizeof(elevenlabs_flight_registry_t));
+  registry->pool = pool;
+  registry->index = apr_hash_make(pool);
+  registry->clients = apr_array_make(pool, 8, sizeof(elevenlabs_http_client_t *));
+  registry->idle = apr_array_make(pool, 8, sizeof(elevenlabs_http_client_t *));
+  registry->http_pool = http_pool;
+  registry->io_pool = io_pool;
+  registry->memory_cache = memory_cache;
+  registry->disk_cache = disk_cache;
+  if (apr_thread_mutex_create(&registry->mutex, APR_THREAD_MUTEX_DEFAULT, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "Failed to create single-flight registry mutex");
+    return NULL;
+  }
+  atomic_init(&registry->started, 0);
+  atomic_init(&registry->joined, 0);
+  return registry;
+}
+
+/**
+ * Destroy the registry. Channels are gone, so flights still running are headless
+ * cache fills; they are stopped and their partial files discarded.
+ */
+void elevenlabs_flight_registry_destroy(elevenlabs_flight_registry_t *registry)
+{
+  if (!registry) {
+    return;
+  }
+  for (int i = 0; i < registry->clients->nelts; i++) {
+    elevenlabs_http_client_stop(APR_ARRAY_IDX(registry->clients, i, elevenlabs_http_client_t *));
+  }
+  /* Each stopped download returns its client from the worker thread */
+  for (;;) {
+    apr_thread_mutex_lock(registry->mutex);
+    apt_bool_t all_idle = registry->idle->nelts == registry->clients->nelts;
+    apr_thread_mutex_unlock(registry->mutex);
+    if (all_idle) {
+      break;
+    }
+    apr_sleep(1000);
+  }
+  for (int i = 0; i < registry->clients->nelts; i++) {
+    elevenlabs_http_client_t *client = APR_ARRAY_IDX(registry->clients, i, elevenlabs_http_client_t *);
+    apr_pool_t *client_pool = client->pool;
+    elevenlabs_http_client_destroy(client);
+    apr_pool_destroy(client_pool);
+  }
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "Single-flight stats: downloads=%lu, joined=%lu, clients=%d",
+          atomic_load(&registry->started), atomic_load(&registry->joined), registry->clients->nelts);
+  apr_thread_mutex_destroy(registry->mutex);
+}
+
+/* A download client for a new flight. Each has its own unmanaged pool: it is used on
+   the consumer task, the I/O workers and the HTTP worker in turn, never at once.
+   Called without the registry mutex. */
+static elevenlabs_http_client_t* elevenlabs_flight_client_get(elevenlabs_flight_registry_t *registry)
+{
+  apr_thread_mutex_lock(registry->mutex);
+  if (registry->idle->nelts > 0) {
+    elevenlabs_http_client_t *client = *(elevenlabs_http_client_t **)apr_array_pop(registry->idle);
+    apr_thread_mutex_unlock(registry->mutex);
+    return client;
+  }
+  apr_thread_mutex_unlock(registry->mutex);
+
+  apr_pool_t *client_pool;
+  if (apr_pool_create_unmanaged_ex(&client_pool, NULL, NULL) != APR_SUCCESS) {
+    return NULL;
+  }
+  elevenlabs_http_client_t *client = elevenlabs_http_client_create(client_pool);
+  if (!client) {
+    apr_pool_destroy(client_pool);
+    return NULL;
+  }
+  client->io_pool = registry->io_pool;
+  client->memory_cache = registry->memory_cache;
+  client->disk_cache = registry->disk_cache;
+  elevenlabs_http_pool_attach(registry->http_pool, client);
+  apr_thread_mutex_lock(registry->mutex);
+  APR_ARRAY_PUSH(registry->clients, elevenlabs_http_client_t *) = client;
+  apr_thread_mutex_unlock(registry->mutex);
+  return client;
+}
+
+/* Add a subscriber unless the last one already cancelled the download */
+static apt_bool_t elevenlabs_flight_subscribe(elevenlabs_flight_t *flight)
+{
+  unsigned subscribers = atomic_load(&flight->subscribers);
+  while (subscribers != ELEVENLABS_FLIGHT_ABANDONED) {
+    if (atomic_compare_exchange_weak(&flight->subscribers, &subscribers, subscribers + 1)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/* Let a transfer paused at high water go on; media or consumer thread */
+static void elevenlabs_flight_resume(elevenlabs_flight_t *flight)
+{
+  if (atomic_exchange(&flight->paused, 0)) {
+    /* The client may run the next flight by now; a stray resume only costs it a write
+       that pauses again */
+    elevenlabs_http_client_t *client = flight->client;
+    atomic_store(&client->resume_requested, 1);
+    elevenlabs_http_worker_notify(client->worker, client);
+  }
+}
+
+/**
+ * Subscribe to the download of request->cache_key, starting it from the request a lane
+ * client has prepared if none is running. Returns a subscriber reference, to be
+ * released with elevenlabs_flight_leave(), or NULL if the lane should download itself.
+ */
+elevenlabs_flight_t* elevenlabs_flight_join(elevenlabs_flight_registry_t *registry,
+                                            const elevenlabs_http_client_t *request)
+{
+  if (!registry || !request->cache_key) {
+    return NULL;
+  }
+
+  apr_thread_mutex_lock(registry->mutex);
+  elevenlabs_flight_t *flight = apr_hash_get(registry->index, request->cache_key, APR_HASH_KEY_STRING);
+  if (flight && elevenlabs_flight_subscribe(flight)) {
+    atomic_fetch_add(&flight->refs, 1);
+    apr_thread_mutex_unlock(registry->mutex);
+    atomic_fetch_add(&registry->joined, 1);
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+            "Joined synthesis in flight: %s (%lu bytes received, %u subscribers)",
+            flight->key, (unsigned long)atomic_load(&flight->ready), atomic_load(&flight->subscribers));
+    return flight;
+  }
+  apr_thread_mutex_unlock(registry->mutex);
+
+  /* Not pool memory: released on whichever thread lets go of it last */
+  flight = calloc(1, sizeof(elevenlabs_flight_t));
+  elevenlabs_http_client_t *client = flight ? elevenlabs_flight_client_get(registry) : NULL;
+  if (flight) {
+    flight->head = malloc(sizeof(elevenlabs_flight_chunk_t));
+  }
+  if (!client || !flight->head) {
+    if (client) {
+      apr_thread_mutex_lock(registry->mutex);
+      APR_ARRAY_PUSH(registry->idle, elevenlabs_http_client_t *) = client;
+      apr_thread_mutex_unlock(registry->mutex);
+    }
+    if (flight) {
+      free(flight->head);
+      free(flight);
+    }
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Cannot start a shared download, downloading alone");
+    return NULL;
+  }
+  apr_cpystrn(flight->key, request->cache_key, sizeof(flight->key));
+  flight->registry = registry;
+  flight->client = client;
+  atomic_init(&flight->head->next, NULL);
+  flight->tail = flight->head;
+  flight->tail_used = 0;
+  atomic_init(&flight->ready, 0);
+  atomic_init(&flight->played, 0);
+  flight->high_water_bytes = request->high_water_bytes;
+  flight->low_water_bytes = request->low_water_bytes;
+  atomic_init(&flight->paused, 0);
+  atomic_init(&flight->done, 0);
+  atomic_init(&flight->refs, 2);
+  atomic_init(&flight->subscribers, 1);
+  atomic_init(&flight->cacheable, 0);
+
+  /* Joinable from now on. Starting it may wait for the client's previous download to
+     let go, which must not hold up joins of other keys. */
+  apr_thread_mutex_lock(registry->mutex);
+  elevenlabs_flight_t *abandoned = apr_hash_get(registry->index, flight->key, APR_HASH_KEY_STRING);
+  if (abandoned) {
+    /* Its finish must not unlist this one */
+    abandoned->listed = FALSE;
+  }
+  flight->listed = TRUE;
+  apr_hash_set(registry->index, flight->key, APR_HASH_KEY_STRING, flight);
+  apr_thread_mutex_unlock(registry->mutex);
+
+  if (!elevenlabs_http_client_start_flight(client, request, flight)) {
+    /* Ends empty for anyone who joined meanwhile */
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Cannot start a shared download, downloading alone");
+    elevenlabs_flight_finish(flight);
+    elevenlabs_flight_leave(flight);
+    return NULL;
+  }
+
+  atomic_fetch_add(&registry->started, 1);
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG, "Started shared download: %s", flight->key);
+  return flight;
+}
+
+/**
+ * Release a subscriber reference. The last subscriber cancels the download unless it
+ * is filling the cache. Takes no lock: this is the media thread letting go.
+ */
+void elevenlabs_flight_leave(elevenlabs_flight_t *flight)
+{
+  if (!flight) {
+    return;
+  }
+  if (atomic_fetch_sub(&flight->subscribers, 1) == 1 && !atomic_load(&flight->done)) {
+    if (atomic_load(&flight->cacheable)) {
+      /* Nobody paces it any more */
+      elevenlabs_flight_resume(flight);
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+              "Last subscriber left, download continues into the cache: %s", flight->key);
+    } else {
+      /* Unless a join got in first, nobody joins it from now on and the worker drops it */
+      unsigned none = 0;
+      if (atomic_compare_exchange_strong(&flight->subscribers, &none, ELEVENLABS_FLIGHT_ABANDONED)) {
+        elevenlabs_http_client_t *client = flight->client;
+        elevenlabs_http_worker_notify(client->worker, client);
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+                "Last subscriber left, shared download cancelled: %s", flight->key);
+      }
+    }
+  }
+  elevenlabs_flight_unref(flight);
+}
+
+/* Media thread: a subscriber has played pos bytes. The furthest one paces the transfer. */
+void elevenlabs_flight_played(elevenlabs_flight_t *flight, apr_size_t pos)
+{
+  apr_size_t played = atomic_load(&flight->played);
+  while (pos > played && !atomic_compare_exchange_weak(&flight->played, &played, pos)) {
+  }
+  if (atomic_load_explicit(&flight->paused, memory_order_relaxed) &&
+      atomic_load(&flight->ready) - atomic_load(&flight->played) < flight->low_water_bytes) {
+    elevenlabs_flight_resume(flight);
+  }
+}
+
+/* HTTP worker: whether appending size bytes would run the download past high water
+   ahead of its subscribers, in which case it is marked paused. An empty backlog always
+   accepts, so a write larger than high water cannot stall. */
+apt_bool_t elevenlabs_flight_pace(elevenlabs_flight_t *flight, apr_size_t size)
+{
+  unsigned subscribers = atomic_load(&flight->subscribers);
+  if (subscribers == 0 || subscribers == ELEVENLABS_FLIGHT_ABANDONED) {
+    return FALSE;
+  }
+  apr_size_t queued = atomic_load_explicit(&flight->ready, memory_order_relaxed) - atomic_load(&flight->played);
+  if (queued == 0 || queued + size <= flight->high_water_bytes) {
+    return FALSE;
+  }
+  atomic_store(&flight->paused, 1);
+  /* The last subscriber may have left, or the leader drained, before it saw the flag */
+  subscribers = atomic_load(&flight->subscribers);
+  queued = atomic_load_explicit(&flight->ready, memory_order_relaxed) - atomic_load(&flight->played);
+  if (subscribers == 0 || subscribers == ELEVENLABS_FLIGHT_ABANDONED || queued < flight->low_water_bytes) {
+    return !atomic_exchange(&flight->paused, 0);
+  }
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+          "Shared download at high water (%zu bytes ahead), pausing transfer: %s", queued, flight->key);
+  return TRUE;
+}
+
+/* HTTP worker: every subscriber left a download that fills no cache file */
+apt_bool_t elevenlabs_flight_abandoned(const elevenlabs_flight_t *flight)
+{
+  return flight && atomic_load(&flight->subscribers) == ELEVENLABS_FLIGHT_ABANDONED;
+}
+
+/* HTTP worker: writable space for size bytes at the end of the audio, in the tail chunk
+   and, past its end, a new one. A chunk holds two decoded curl writes, so no write
+   spans more than two. */
+apt_bool_t elevenlabs_flight_reserve(elevenlabs_flight_t *flight, apr_size_t size, audio_buffer_span_t *span)
+{
+  apr_size_t space = ELEVENLABS_FLIGHT_CHUNK_SIZE - flight->tail_used;
+  span->data[0] = flight->tail->data + flight->tail_used;
+  if (size <= space) {
+    span->len[0] = size;
+    span->data[1] = NULL;
+    span->len[1] = 0;
+    return TRUE;
+  }
+  if (size - space > ELEVENLABS_FLIGHT_CHUNK_SIZE) {
+    return FALSE;
+  }
+  elevenlabs_flight_chunk_t *chunk = atomic_load_explicit(&flight->tail->next, memory_order_relaxed);
+  if (!chunk) {
+    chunk = malloc(sizeof(elevenlabs_flight_chunk_t));
+    if (!chunk) {
+      return FALSE;
+    }
+    atomic_init(&chunk->next, NULL);
+    /* Readers only follow it once ready covers it */
+    atomic_store_explicit(&flight->tail->next, chunk, memory_order_release);
+  }
+  span->len[0] = space;
+  span->data[1] = chunk->data;
+  span->len[1] = size - space;
+  return TRUE;
+}
+
+/* HTTP worker: publish size reserved bytes to the subscribers */
+void elevenlabs_flight_commit(elevenlabs_flight_t *flight, apr_size_t size)
+{
+  apr_size_t space = ELEVENLABS_FLIGHT_CHUNK_SIZE - flight->tail_used;
+  if (size > space) {
+    flight->tail = atomic_load_explicit(&flight->tail->next, memory_order_relaxed);
+    flight->tail_used = size - space;
+  } else {
+    flight->tail_used += size;
+  }
+  atomic_fetch_add_explicit(&flight->ready, size, memory_order_release);
+}
+
+/**
+ * HTTP worker: the download ended, completed or not, and its cache file is settled.
+ * Subscribers play out what arrived; the client goes back to the idle list.
+ */
+void elevenlabs_flight_finish(elevenlabs_flight_t *flight)
+{
+  elevenlabs_flight_registry_t *registry = flight->registry;
+  elevenlabs_http_client_t *client = flight->client;
+  apr_thread_mutex_lock(registry->mutex);
+  if (flight->listed) {
+    apr_hash_set(registry->index, flight->key, APR_HASH_KEY_STRING, NULL);
+    flight->listed = FALSE;
+  }
+  if (client->flight == flight) {
+    client->flight = NULL;
+    client->pool = apr_pool_parent_get(flight->pool);
+  }
+  APR_ARRAY_PUSH(registry->idle, elevenlabs_http_client_t *) = client;
+  if (flight->pool) {
+    apr_pool_destroy(flight->pool);
+    flight->pool = NULL;
+  }
+  atomic_store_explicit(&flight->done, 1, memory_order_release);
+  apr_thread_mutex_unlock(registry->mutex);
+  elevenlabs_flight_unref(flight);
+}
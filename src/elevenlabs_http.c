@@ -9,7 +9,7 @@
  */
 
 #include "elevenlabs_synth.h"
-#include "ulaw_decode.h"
+#include "g711_decode.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -19,7 +19,7 @@
 
 /* Escape a string for safe embedding in a JSON string value.
    Handles: " \ / and control characters (\n \r \t \b \f). */
-static char* json_escape_string(apr_pool_t *pool, const char *src)
+char* elevenlabs_json_escape(apr_pool_t *pool, const char *src)
 {
   if (!src) return apr_pstrdup(pool, "");
   /* Worst case: every char becomes \uXXXX (6 bytes) */
@@ -50,12 +50,59 @@ static char* json_escape_string(apr_pool_t *pool, const char *src)
   return dst;
 }
 
-/* Callback function for libcurl to receive data */
-static size_t write_callback(void *contents, size_t size, size_t nmemb,
-                             void *userp) {
-  elevenlabs_http_client_t *client = (elevenlabs_http_client_t *)userp;
-  size_t total_size = size * nmemb;
+static void* APR_THREAD_FUNC elevenlabs_cache_lookup_task(apr_thread_t *thd, void *data);
+static apt_bool_t elevenlabs_http_client_begin(elevenlabs_http_client_t *client, const char *text,
+                                               const char *request_voice_id, const char *request_legacy_text,
+                                               const elevenlabs_config_t *config, unsigned gen,
+                                               char *deferred);
+
+/* Block until neither an HTTP worker nor an I/O worker holds the client */
+static void elevenlabs_http_client_wait_idle(elevenlabs_http_client_t *client)
+{
+  apr_thread_mutex_lock(client->mutex);
+  while (client->busy) {
+    apr_thread_cond_wait(client->cond, client->mutex);
+  }
+  apr_thread_mutex_unlock(client->mutex);
+}
 
+/* Drop a start queued behind the request (mutex held) */
+static void elevenlabs_http_client_deferred_free(elevenlabs_http_client_t *client)
+{
+  free(client->deferred_text);
+  client->deferred_text = NULL;
+  free(client->deferred_voice_id);
+  client->deferred_voice_id = NULL;
+  free(client->deferred_legacy_text);
+  client->deferred_legacy_text = NULL;
+}
+
+/* The request has let go of the client (mutex held). A start deferred behind it takes
+   the client over at once, still busy and kept from the worker by io_pending, and is
+   returned for the caller to run once the mutex is released; else the client is idle. */
+static char* elevenlabs_http_client_idle(elevenlabs_http_client_t *client)
+{
+  char *deferred = client->released ? NULL : client->deferred_text;
+  if (deferred) {
+    client->deferred_text = NULL;
+    client->stopped = FALSE;
+    client->io_pending = TRUE;
+    return deferred;
+  }
+  client->busy = FALSE;
+  apr_thread_cond_broadcast(client->cond);
+  return NULL;
+}
+
+/* The engine's metrics, or NULL for clients outside an engine (tools) */
+static elevenlabs_metrics_t* elevenlabs_http_client_metrics(const elevenlabs_http_client_t *client)
+{
+  return client->http_pool ? client->http_pool->metrics : NULL;
+}
+
+/* Response data of the request's transfer (the original, or a hedge that won) */
+static size_t elevenlabs_http_client_write(elevenlabs_http_client_t *client, void *contents,
+                                           size_t total_size) {
   /* Check stopped flag early to abort transfer quickly */
   if (client->stopped) {
     apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
@@ -80,69 +127,274 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb,
     apr_time_t now = apr_time_now();
     apr_interval_time_t diff_ms = (now - client->start_time) / 1000;
     apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
-            "TTFB (first audio chunk): %ld ms", (long)diff_ms);
+            "TTFB (first audio chunk): %ld ms%s", (long)diff_ms,
+            client->hedge_state == ELEVENLABS_HEDGE_WON ? " (hedged request)" : "");
+    elevenlabs_http_pool_ttfb_record(client->http_pool, client->config, now - client->start_time);
+    elevenlabs_metrics_t *metrics = elevenlabs_http_client_metrics(client);
+    if (metrics) {
+      elevenlabs_histogram_observe(&metrics->ttfb, now - client->start_time);
+    }
   }
+  ELEVENLABS_METRIC_ADD(elevenlabs_http_client_metrics(client), audio_bytes, total_size);
 
-  /* Prepare data for MPF and cache (may convert μ-law -> PCM) */
-  const uint8_t *out_ptr = (const uint8_t *)contents;
+  /* Prepare data for MPF and cache (may convert μ-law/A-law -> PCM) */
   apr_size_t out_len = total_size;
-  if (client->config && client->config->output_format &&
-      strcasecmp(client->config->output_format, "ulaw_8000") == 0 &&
-      client->config->fallback_ulaw_to_pcm) {
-    /* Convert μ-law to PCM 16-bit */
-    int16_t *pcm_buffer = apr_palloc(client->pool, total_size * 2);
-    ulaw_to_s16((uint8_t *)contents, total_size, pcm_buffer);
-    out_ptr = (const uint8_t*)pcm_buffer;
+  g711_decode_fn decode = NULL;
+  if (client->config && client->config->output_format && client->config->fallback_ulaw_to_pcm) {
+    if (strcasecmp(client->config->output_format, "ulaw_8000") == 0) {
+      decode = ulaw_to_s16;
+    } else if (strcasecmp(client->config->output_format, "alaw_8000") == 0) {
+      decode = alaw_to_s16;
+    }
+  }
+  if (decode) {
     out_len = total_size * 2;
   }
 
-  /* Write to audio buffer */
-  if (!audio_buffer_write(client->audio_buffer, out_ptr, out_len)) {
-    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR,
-            "Failed to write data to audio buffer");
+  audio_buffer_span_t span;
+  elevenlabs_flight_t *flight = client->flight;
+  if (flight) {
+    /* Shared download: appended for every subscriber, paused like a lane's transfer
+       once it is high water ahead of the one furthest along */
+    if (elevenlabs_flight_pace(flight, out_len)) {
+      atomic_store(&client->paused, 1);
+      return CURL_WRITEFUNC_PAUSE;
+    }
+    if (!elevenlabs_flight_reserve(flight, out_len, &span)) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR,
+              "Failed to append data to shared download");
+      return 0;
+    }
+  } else {
+    /* Backpressure: once high water is reached, pause the transfer. libcurl keeps this
+       chunk and delivers it again after elevenlabs_http_client_drained() resumes us.
+       An empty ring always accepts, so a chunk larger than high water cannot stall. */
+    apr_size_t queued = audio_buffer_available(client->audio_buffer);
+    if ((queued > 0 && queued + out_len > client->high_water_bytes) ||
+        audio_buffer_space(client->audio_buffer) < out_len) {
+      atomic_store(&client->paused, 1);
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+              "Audio buffer at high water (%zu bytes queued), pausing transfer", queued);
+      return CURL_WRITEFUNC_PAUSE;
+    }
+
+    /* Produce audio directly into the ring: no per-chunk allocation or staging copy */
+    if (!audio_buffer_reserve(client->audio_buffer, out_len, &span)) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR,
+              "Failed to write data to audio buffer");
+      return 0;
+    }
+  }
+  if (decode) {
+    /* Convert G.711 to PCM 16-bit. The ring only ever holds whole samples in this
+       mode and its capacity is even, so both segments are 2-byte aligned. */
+    const uint8_t *in = (const uint8_t *)contents;
+    decode(in, span.len[0] / 2, (int16_t *)span.data[0]);
+    if (span.len[1] > 0) {
+      decode(in + span.len[0] / 2, span.len[1] / 2, (int16_t *)span.data[1]);
+    }
+  } else {
+    memcpy(span.data[0], contents, span.len[0]);
+    if (span.len[1] > 0) {
+      memcpy(span.data[1], (const uint8_t *)contents + span.len[0], span.len[1]);
+    }
+  }
+
+  /* A STOP that came in while this chunk was decoded has already flushed the ring;
+     publishing it now would put stale audio behind the flush */
+  if (client->stopped) {
     return 0;
   }
 
   /* If caching, write the same data that MPF consumes (so future cache hits need no decode) */
   if (client->cache_fp) {
-    apr_size_t to_write = (apr_size_t)out_len;
-    apr_file_write(client->cache_fp, out_ptr, &to_write);
-    client->cache_data_bytes += to_write;
+    for (int i = 0; i < 2; i++) {
+      apr_size_t to_write = span.len[i];
+      if (to_write > 0) {
+        apr_file_write(client->cache_fp, span.data[i], &to_write);
+        client->cache_data_bytes += to_write;
+      }
+    }
   }
 
+  if (flight) {
+    elevenlabs_flight_commit(flight, out_len);
+  } else {
+    audio_buffer_commit(client->audio_buffer, out_len);
+  }
+  client->last_data_time = apr_time_now();
+
   apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
           "Received %zu bytes from ElevenLabs API", total_size);
 
   return total_size;
 }
 
+/* Callback function for libcurl to receive data */
+static size_t write_callback(void *contents, size_t size, size_t nmemb,
+                             void *userp) {
+  elevenlabs_http_client_t *client = (elevenlabs_http_client_t *)userp;
+
+  /* A hedged duplicate that delivered first has taken over: this transfer lost */
+  if (client->hedge_state == ELEVENLABS_HEDGE_WON) {
+    return 0;
+  }
+  if (client->hedge_state == ELEVENLABS_HEDGE_RACING && !client->http_error) {
+    client->hedge_state = ELEVENLABS_HEDGE_LOST;
+  }
+  return elevenlabs_http_client_write(client, contents, size * nmemb);
+}
+
+/* Data of the hedged duplicate: the first audio of either transfer decides the race */
+static size_t hedge_write_callback(void *contents, size_t size, size_t nmemb,
+                                   void *userp) {
+  elevenlabs_http_client_t *client = (elevenlabs_http_client_t *)userp;
+
+  if (client->stopped) {
+    return 0;
+  }
+  if (client->hedge_state == ELEVENLABS_HEDGE_RACING) {
+    if (client->hedge_http_error) {
+      return size * nmemb; /* An error body is no audio; the original runs on */
+    }
+    elevenlabs_http_client_hedge_promote(client);
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+            "Hedged request delivered audio first, dropping the original");
+  } else if (client->hedge_state != ELEVENLABS_HEDGE_WON) {
+    return 0;
+  }
+  return elevenlabs_http_client_write(client, contents, size * nmemb);
+}
+
+/* Progress of the request's transfer: runs on the worker thread. Stops and resumes are
+   normally applied by the worker loop when notified; this catches them between
+   notifications. The read timeout is enforced by the worker's idle sweep. */
+static int elevenlabs_http_client_progress(elevenlabs_http_client_t *client) {
+  if (client->stopped || elevenlabs_flight_abandoned(client->flight)) {
+    return 1; /* Abort transfer */
+  }
+
+  if (atomic_exchange(&client->resume_requested, 0)) {
+    atomic_store(&client->paused, 0);
+    client->last_data_time = apr_time_now();
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+            "Audio buffer below low water, resuming transfer");
+    curl_easy_pause(client->curl, CURLPAUSE_CONT);
+  }
+  return 0;
+}
+
+/* Progress callback of the original transfer */
+static int xferinfo_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                             curl_off_t ultotal, curl_off_t ulnow) {
+  elevenlabs_http_client_t *client = (elevenlabs_http_client_t *)clientp;
+  if (client->hedge_state == ELEVENLABS_HEDGE_WON) {
+    return 1; /* Lost to the hedged duplicate */
+  }
+  return elevenlabs_http_client_progress(client);
+}
+
+/* Progress callback of the hedged duplicate; it only goes on while racing or once won */
+static int hedge_xferinfo_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                                   curl_off_t ultotal, curl_off_t ulnow) {
+  elevenlabs_http_client_t *client = (elevenlabs_http_client_t *)clientp;
+  if (client->hedge_state == ELEVENLABS_HEDGE_WON) {
+    return elevenlabs_http_client_progress(client);
+  }
+  return client->stopped || client->hedge_state != ELEVENLABS_HEDGE_RACING;
+}
+
+/* Called by the media thread after each frame: request a resume of a paused transfer
+   once the queued audio has drained below the low-water mark. Only the first request
+   per pause wakes the worker. */
+void elevenlabs_http_client_drained(elevenlabs_http_client_t *client) {
+  if (!client || !atomic_load_explicit(&client->paused, memory_order_relaxed)) {
+    return;
+  }
+  if (audio_buffer_available(client->audio_buffer) < client->low_water_bytes &&
+      !atomic_exchange(&client->resume_requested, 1)) {
+    elevenlabs_http_worker_notify(client->worker, client);
+  }
+}
+
+/* Status code of a header line that is a status line, else 0 */
+static int elevenlabs_http_status(const char *buffer, size_t len, const char *label) {
+  if (len < 5 || strncmp(buffer, "HTTP/", 5) != 0) {
+    return 0;
+  }
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "ElevenLabs API response%s: %.*s", label, (int)len, buffer);
+  const char *sp = memchr(buffer, ' ', len);
+  return sp ? atoi(sp + 1) : 0;
+}
+
+/* Detect error responses of the request's transfer */
+static void elevenlabs_http_client_status(elevenlabs_http_client_t *client, int http_status) {
+  if (http_status >= 400) {
+    client->http_error = TRUE;
+    client->error_body_len = 0;
+    client->error_body[0] = '\0';
+  } else if (http_status > 0) {
+    client->http_error = FALSE;
+  }
+}
+
 /* Callback function for libcurl to handle headers */
 static size_t header_callback(char *buffer, size_t size, size_t nitems,
                               void *userdata) {
   elevenlabs_http_client_t *client = (elevenlabs_http_client_t *)userdata;
   size_t total_size = size * nitems;
 
+  if (client->hedge_state == ELEVENLABS_HEDGE_WON) {
+    return 0; /* Lost to the hedged duplicate */
+  }
   /* Log status line and detect error responses */
-  if (strncmp(buffer, "HTTP/", 5) == 0) {
-    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
-            "ElevenLabs API response: %.*s", (int)total_size, buffer);
-    /* Parse HTTP status code */
-    int http_status = 0;
-    const char *sp = strchr(buffer, ' ');
-    if (sp) {
-      http_status = atoi(sp + 1);
-    }
-    if (http_status >= 400) {
-      client->http_error = TRUE;
-      client->error_body_len = 0;
-      client->error_body[0] = '\0';
-    } else {
-      client->http_error = FALSE;
+  elevenlabs_http_client_status(client, elevenlabs_http_status(buffer, total_size, ""));
+  return total_size;
+}
+
+/* Headers of the hedged duplicate; its status only counts once it has won */
+static size_t hedge_header_callback(char *buffer, size_t size, size_t nitems,
+                                    void *userdata) {
+  elevenlabs_http_client_t *client = (elevenlabs_http_client_t *)userdata;
+  size_t total_size = size * nitems;
+
+  if (client->hedge_state == ELEVENLABS_HEDGE_RACING) {
+    int http_status = elevenlabs_http_status(buffer, total_size, " (hedged)");
+    if (http_status > 0) {
+      client->hedge_http_error = http_status >= 400;
     }
+  } else if (client->hedge_state == ELEVENLABS_HEDGE_WON) {
+    elevenlabs_http_client_status(client, elevenlabs_http_status(buffer, total_size, ""));
+  } else {
+    return 0;
   }
-
   return total_size;
 }
+
+/* Options every easy handle of a client carries, the original's callbacks included */
+static void elevenlabs_http_client_setup_easy(elevenlabs_http_client_t *client, CURL *curl) {
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, client);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, client);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, client);
+  curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, xferinfo_callback);
+  curl_easy_setopt(curl, CURLOPT_XFERINFODATA, client);
+  curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+}
+
+/* The request's URL. Waiting for a connection that can multiplex only pays where HTTP/2
+   is tried, over TLS; over HTTP/1.1 a lookahead segment or a hedge would queue behind
+   the very request it is meant to overlap. */
+static void elevenlabs_http_client_set_url(elevenlabs_http_client_t *client, CURL *curl) {
+  curl_easy_setopt(curl, CURLOPT_URL, client->url);
+  curl_easy_setopt(curl, CURLOPT_PIPEWAIT, strncasecmp(client->url, "https:", 6) == 0 ? 1L : 0L);
+}
 // static size_t header_callback(char *buffer, size_t size, size_t nitems, void
 // *userdata)
 // {
@@ -178,19 +430,63 @@ elevenlabs_http_client_t *elevenlabs_http_client_create(apr_pool_t *pool) {
   }
 
   client->pool = pool;
-  client->stopped = FALSE;
+  /* Everything a request allocates goes here rather than into the session's pool, so
+     a long session that issues many SPEAKs stays at one request's worth per client */
+  if (apr_pool_create(&client->request_pool, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR,
+            "Failed to create HTTP client request pool");
+    curl_easy_cleanup(client->curl);
+    return NULL;
+  }
+  atomic_init(&client->stopped, 0);
   client->url = NULL;
   client->post_data = NULL;
   client->audio_buffer = NULL;
+  client->http_pool = NULL;
   client->request_voice_id = NULL;
   client->request_language_code = NULL;
-  client->thread = NULL;
+  client->request_legacy_text = NULL;
+  client->worker = NULL;
+  client->io_pool = NULL;
+  client->memory_cache = NULL;
+  client->disk_cache = NULL;
+  client->lane = NULL;
+  client->flights = NULL;
+  client->flight = NULL;
+  client->io_pending = FALSE;
+  client->lookup_gen = 0;
+  client->deferred_text = NULL;
+  client->deferred_voice_id = NULL;
+  client->deferred_legacy_text = NULL;
+  client->deferred_config = NULL;
+  client->deferred_gen = 0;
+  atomic_init(&client->start_deferred, 0);
+  client->released = FALSE;
+  client->api_key_header = NULL;
+  client->busy = FALSE;
+  client->pending_queued = FALSE;
+  client->pending_next = NULL;
+  client->attached = FALSE;
+  client->active_next = NULL;
+  client->reap_next = NULL;
+  client->request_count = 0;
+  client->cache_playback_mode = FALSE;
+  client->cache_fp = NULL;
   client->headers = NULL;
   client->first_chunk_logged = FALSE;
   client->start_time = 0;
   client->http_error = FALSE;
   client->error_body[0] = '\0';
   client->error_body_len = 0;
+  client->high_water_bytes = 0;
+  client->low_water_bytes = 0;
+  atomic_init(&client->paused, 0);
+  atomic_init(&client->resume_requested, 0);
+  client->hedge_curl = NULL;
+  client->hedge_state = ELEVENLABS_HEDGE_NONE;
+  client->hedge_attached = FALSE;
+  client->hedge_http_error = FALSE;
+  client->hedge_deadline = 0;
 
   /* Create mutex and condition variable for thread safety */
   apr_thread_mutex_create(&client->mutex, APR_THREAD_MUTEX_DEFAULT, pool);
@@ -200,14 +496,7 @@ elevenlabs_http_client_t *elevenlabs_http_client_create(apr_pool_t *pool) {
           "HTTP client created [%p] for multi-session use", (void*)client);
 
   /* Set basic curl options */
-  curl_easy_setopt(client->curl, CURLOPT_WRITEFUNCTION, write_callback);
-  curl_easy_setopt(client->curl, CURLOPT_WRITEDATA, client);
-  curl_easy_setopt(client->curl, CURLOPT_HEADERFUNCTION, header_callback);
-  curl_easy_setopt(client->curl, CURLOPT_HEADERDATA, client);
-  curl_easy_setopt(client->curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(client->curl, CURLOPT_SSL_VERIFYPEER, 1L);
-  curl_easy_setopt(client->curl, CURLOPT_SSL_VERIFYHOST, 2L);
-  curl_easy_setopt(client->curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+  elevenlabs_http_client_setup_easy(client, client->curl);
 
   return client;
 }
@@ -220,33 +509,20 @@ void elevenlabs_http_client_destroy(elevenlabs_http_client_t *client) {
     apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
             "Destroying HTTP client [%p]", (void*)client);
     
-    /* Ensure stopped flag is set before attempting thread join */
+    /* The workers must let go of the client before it is cleaned up */
     if (client->mutex) {
-      apr_thread_mutex_lock(client->mutex);
-      client->stopped = TRUE;
-      apr_thread_mutex_unlock(client->mutex);
-    }
-    
-    if (client->thread) {
-      apr_status_t rv = APR_SUCCESS;
-      /* Try to join thread with timeout-like behavior by checking if curl is still running */
-      if (client->curl) {
-        /* Force abort any ongoing curl operation before thread join */
-        curl_easy_setopt(client->curl, CURLOPT_TIMEOUT_MS, 1);
-        curl_easy_pause(client->curl, CURLPAUSE_ALL);
-      }
-      
-      apr_thread_join(&rv, client->thread);
-      client->thread = NULL;
-      
-      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
-              "HTTP client thread joined with status: %d", rv);
+      elevenlabs_http_client_stop(client);
+      elevenlabs_http_client_wait_idle(client);
     }
     
     if (client->curl) {
       curl_easy_cleanup(client->curl);
       client->curl = NULL;
     }
+    if (client->hedge_curl) {
+      curl_easy_cleanup(client->hedge_curl);
+      client->hedge_curl = NULL;
+    }
     if (client->headers) {
       curl_slist_free_all(client->headers);
       client->headers = NULL;
@@ -257,6 +533,7 @@ void elevenlabs_http_client_destroy(elevenlabs_http_client_t *client) {
       apr_file_close(client->cache_fp);
       client->cache_fp = NULL;
     }
+    elevenlabs_http_client_deferred_free(client);
 
     if (client->mutex) {
       apr_thread_mutex_destroy(client->mutex);
@@ -277,25 +554,14 @@ void elevenlabs_http_client_destroy(elevenlabs_http_client_t *client) {
  * Start text-to-speech synthesis via ElevenLabs API
  */
 
-/* Background thread function to run curl perform */
-static void* APR_THREAD_FUNC elevenlabs_http_thread(apr_thread_t *thd, void *data)
+/* Called by the worker loop when a request ends: completed, failed, timed out, or
+   detached by a stop. Finalizes the cache file and wakes anyone waiting in stop. */
+void elevenlabs_http_client_complete(elevenlabs_http_client_t *client, CURLcode res)
 {
-  elevenlabs_http_client_t *client = (elevenlabs_http_client_t*)data;
-  
-  /* Check if already stopped before starting */
-  apr_thread_mutex_lock(client->mutex);
-  apt_bool_t already_stopped = client->stopped;
-  apr_thread_mutex_unlock(client->mutex);
-  
-  if (already_stopped) {
-    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
-            "HTTP thread exiting early - stopped before start");
-    return NULL;
-  }
-  
-  CURLcode res = curl_easy_perform(client->curl);
   long http_code = 0;
   curl_easy_getinfo(client->curl, CURLINFO_RESPONSE_CODE, &http_code);
+  elevenlabs_metrics_request_done(elevenlabs_http_client_metrics(client), res, http_code,
+                                  apr_time_now() - client->start_time);
 
   if (res != CURLE_OK) {
     if (res == CURLE_OPERATION_TIMEDOUT) {
@@ -377,107 +643,606 @@ static void* APR_THREAD_FUNC elevenlabs_http_thread(apr_thread_t *thd, void *dat
       client->cache_fp = NULL;
       /* Atomically move .part to final */
       if (client->cache_path_tmp && client->cache_path_final) {
-        apr_file_remove(client->cache_path_final, client->pool); /* ignore errors */
-        apr_file_rename(client->cache_path_tmp, client->cache_path_final, client->pool);
-        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "Cached audio saved: %s", client->cache_path_final);
+        apr_file_remove(client->cache_path_final, client->request_pool); /* ignore errors */
+        if (apr_file_rename(client->cache_path_tmp, client->cache_path_final, client->request_pool) == APR_SUCCESS) {
+          apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "Cached audio saved: %s", client->cache_path_final);
+          const char *name = strrchr(client->cache_path_final, '/');
+          apr_off_t size = (apr_off_t)client->cache_data_bytes +
+                           (strstr(client->cache_path_final, ".wav") ? 44 : 0);
+          elevenlabs_cache_disk_insert(client->disk_cache, client->cache_key,
+                                       name ? name + 1 : client->cache_path_final, size);
+          /* Still in the page cache; map it into the memory tier off this loop */
+          elevenlabs_cache_memory_fill(client->memory_cache, client->io_pool,
+                                       client->cache_path_final, client->cache_key);
+        }
       }
     } else {
       /* Failure or aborted; do not keep partial cache */
       apr_file_close(client->cache_fp);
       client->cache_fp = NULL;
       if (client->cache_path_tmp) {
-        apr_file_remove(client->cache_path_tmp, client->pool);
+        apr_file_remove(client->cache_path_tmp, client->request_pool);
         apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "Discarded partial cache: %s", client->cache_path_tmp);
       }
     }
   }
 
   /* Mark stopped to allow stream_read to complete when buffer drains */
+  elevenlabs_flight_t *flight = client->flight;
   apr_thread_mutex_lock(client->mutex);
   client->stopped = TRUE;
+  char *deferred = elevenlabs_http_client_idle(client);
   apr_thread_mutex_unlock(client->mutex);
-  
-  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
-          "HTTP thread exiting normally");
+
+  /* A shared download hands its client back to the registry */
+  if (flight) {
+    elevenlabs_flight_finish(flight);
+  }
+  if (deferred) {
+    elevenlabs_http_client_begin(client, deferred, NULL, NULL, NULL, 0, deferred);
+  }
+}
+
+/* Prepare the easy handle for the request built by start_synthesis. Called with
+   client->mutex held, before elevenlabs_http_client_dispatch(). */
+static void elevenlabs_http_client_submit(elevenlabs_http_client_t *client)
+{
+  const elevenlabs_config_t *config = client->config;
+
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "Starting synthesis with URL: %s", client->url);
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG, "POST data: %s",
+          client->post_data);
+
+  /* Set curl options for this request. After a hedge won, client->curl is the
+     duplicate's handle, so the original's callbacks are set again. */
+  curl_easy_setopt(client->curl, CURLOPT_WRITEFUNCTION, write_callback);
+  curl_easy_setopt(client->curl, CURLOPT_HEADERFUNCTION, header_callback);
+  curl_easy_setopt(client->curl, CURLOPT_XFERINFOFUNCTION, xferinfo_callback);
+  elevenlabs_http_client_set_url(client, client->curl);
+  curl_easy_setopt(client->curl, CURLOPT_POST, 1L);
+  curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, client->post_data);
+  curl_easy_setopt(client->curl, CURLOPT_POSTFIELDSIZE,
+                   strlen(client->post_data));
+
+  /* Set headers */
+  if (client->headers) {
+    curl_slist_free_all(client->headers);
+    client->headers = NULL;
+  }
+  client->headers = curl_slist_append(client->headers, "Content-Type: application/json");
+  /* Some ElevenLabs setups prefer explicit Accept for binary */
+  client->headers = curl_slist_append(client->headers, "Accept: */*");
+  client->headers = curl_slist_append(client->headers, client->api_key_header);
+  /* Disable Expect: 100-continue to avoid extra RTT */
+  client->headers = curl_slist_append(client->headers, "Expect:");
+  curl_easy_setopt(client->curl, CURLOPT_HTTPHEADER, client->headers);
+
+  /* Set timeouts */
+  curl_easy_setopt(client->curl, CURLOPT_CONNECTTIMEOUT_MS,
+                   config->connect_timeout_ms);
+  /* No overall timeout: with backpressure the transfer lasts about as long as playback.
+     read_timeout_ms is enforced as an idle timeout by the worker loop instead. */
+  curl_easy_setopt(client->curl, CURLOPT_TIMEOUT_MS, 0L);
+  curl_easy_setopt(client->curl, CURLOPT_NOSIGNAL, 1L);
+
+  /* Set buffer size for better streaming performance */
+  curl_easy_setopt(client->curl, CURLOPT_BUFFERSIZE, 1024);
+
+  /* mark start for latency metrics */
+  elevenlabs_metrics_t *metrics = elevenlabs_http_client_metrics(client);
+  ELEVENLABS_METRIC_ADD(metrics, requests, 1);
+  ELEVENLABS_METRIC_ADD(metrics, requests_active, 1);
+  client->start_time = apr_time_now();
+  client->last_data_time = client->start_time;
+  client->first_chunk_logged = FALSE;
+
+  /* The worker sends a duplicate if the first audio is late (and the budget allows) */
+  client->hedge_state = ELEVENLABS_HEDGE_NONE;
+  client->hedge_http_error = FALSE;
+  apr_interval_time_t hedge_delay = elevenlabs_http_pool_hedge_delay(client->http_pool, config);
+  client->hedge_deadline = hedge_delay ? client->start_time + hedge_delay : 0;
+}
+
+/* Create the write-through cache file of the request (I/O worker). NULL if it cannot be
+   created; the request then streams without filling the cache. */
+static apr_file_t* elevenlabs_cache_part_open(elevenlabs_http_client_t *client)
+{
+  apr_file_t *fp = NULL;
+  if (apr_file_open(&fp, client->cache_path_tmp,
+                    APR_FOPEN_CREATE | APR_FOPEN_WRITE | APR_FOPEN_TRUNCATE | APR_FOPEN_BUFFERED,
+                    APR_OS_DEFAULT, client->request_pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Failed to open cache temp file: %s", client->cache_path_tmp);
+    return NULL;
+  }
+  /* Reserve space for WAV header if we will wrap PCM into WAV */
+  if (client->cache_path_final && strstr(client->cache_path_final, ".wav")) {
+    /* We'll write header at finalize; for streaming write data immediately after header position */
+    apr_off_t pos = 44; /* standard PCM WAV header size */
+    apr_file_seek(fp, APR_SET, &pos);
+  }
+  return fp;
+}
+
+/* .part creation on an I/O worker, then the request goes to its HTTP worker. One stopped
+   meanwhile gets no file; the worker finishes it as aborted, which runs a start queued
+   behind it. */
+static void* APR_THREAD_FUNC elevenlabs_cache_part_task(apr_thread_t *thd, void *data)
+{
+  elevenlabs_http_client_t *client = (elevenlabs_http_client_t *)data;
+  apr_file_t *fp = client->stopped ? NULL : elevenlabs_cache_part_open(client);
+
+  apr_thread_mutex_lock(client->mutex);
+  client->io_pending = FALSE;
+  client->cache_fp = fp;
+  if (!fp && client->flight) {
+    /* Nothing to fill: the download goes with its last subscriber, or now if that one
+       has left already */
+    atomic_store(&client->flight->cacheable, 0);
+    unsigned none = 0;
+    atomic_compare_exchange_strong(&client->flight->subscribers, &none, ELEVENLABS_FLIGHT_ABANDONED);
+  }
+  apr_thread_mutex_unlock(client->mutex);
+  elevenlabs_http_worker_notify(client->worker, client);
+  return NULL;
+}
+
+/* Hand a submitted request on; called with client->mutex held, which is released. Its
+   .part file is created first, off the consumer task and the HTTP worker: on a slow or
+   remote cache dir that takes as long as a lookup. on_io_worker creates it inline. */
+static void elevenlabs_http_client_dispatch(elevenlabs_http_client_t *client, apt_bool_t on_io_worker)
+{
+  if (!client->config->cache_enabled || !client->cache_path_tmp || client->stopped) {
+    apr_thread_mutex_unlock(client->mutex);
+    elevenlabs_http_worker_notify(client->worker, client);
+    return;
+  }
+  /* Keeps the worker off the client until the file is there */
+  client->io_pending = TRUE;
+  apr_thread_mutex_unlock(client->mutex);
+  if (on_io_worker) {
+    elevenlabs_cache_part_task(NULL, client);
+  } else if (!client->io_pool ||
+             apr_thread_pool_push(client->io_pool, elevenlabs_cache_part_task, client,
+                                  APR_THREAD_TASK_PRIORITY_NORMAL, client) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+            "No cache I/O worker available, creating cache file inline");
+    elevenlabs_cache_part_task(NULL, client);
+  }
+}
+
+/* Prepare the duplicate of the running request (worker thread). It sends the same
+   request on the same loop, sharing its connections: over HTTP/2 it is another stream,
+   and libcurl opens a new connection if the current one is unusable. */
+CURL* elevenlabs_http_client_hedge_prepare(elevenlabs_http_client_t *client)
+{
+  if (!client->hedge_curl) {
+    client->hedge_curl = curl_easy_init();
+    if (!client->hedge_curl) {
+      return NULL;
+    }
+    elevenlabs_http_client_setup_easy(client, client->hedge_curl);
+    elevenlabs_http_pool_setup_easy(client->http_pool, client->hedge_curl);
+  }
+  CURL *curl = client->hedge_curl;
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, hedge_write_callback);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, hedge_header_callback);
+  curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, hedge_xferinfo_callback);
+  elevenlabs_http_client_set_url(client, curl);
+  curl_easy_setopt(curl, CURLOPT_POST, 1L);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, client->post_data);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, strlen(client->post_data));
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, client->headers);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, client->config->connect_timeout_ms);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, 0L);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 1024);
+  client->hedge_http_error = FALSE;
+  return curl;
+}
+
+/* The duplicate takes over the request: it becomes client->curl, and the original
+   becomes the loser the worker drops. Worker thread, before any audio was accepted. */
+void elevenlabs_http_client_hedge_promote(elevenlabs_http_client_t *client)
+{
+  CURL *winner = client->hedge_curl;
+  client->hedge_curl = client->curl;
+  client->curl = winner;
+  client->hedge_state = ELEVENLABS_HEDGE_WON;
+  client->http_error = client->hedge_http_error;
+  client->error_body_len = 0;
+  client->error_body[0] = '\0';
+  if (client->http_pool) {
+    atomic_fetch_add(&client->http_pool->hedges_won, 1);
+  }
+}
+
+/* Run the request a lane client has prepared as a shared download on this (registry)
+   client. The request may be reused for the lane's next segment meanwhile, so what the
+   download needs is copied into the flight's pool, which lives as long as it runs. */
+apt_bool_t elevenlabs_http_client_start_flight(elevenlabs_http_client_t *client,
+                                               const elevenlabs_http_client_t *request,
+                                               elevenlabs_flight_t *flight)
+{
+  elevenlabs_http_client_wait_idle(client);
+  apr_pool_clear(client->request_pool);
+  if (apr_pool_create(&flight->pool, client->pool) != APR_SUCCESS) {
+    flight->pool = NULL;
+    return FALSE;
+  }
+  apr_pool_t *pool = flight->pool;
+
+  apr_thread_mutex_lock(client->mutex);
+  client->pool = pool;
+  client->flight = flight;
+  client->stopped = FALSE;
+  atomic_store(&client->paused, 0);
+  atomic_store(&client->resume_requested, 0);
+  client->http_error = FALSE;
+  client->error_body[0] = '\0';
+  client->error_body_len = 0;
+  client->config = request->config;
+  client->url = apr_pstrdup(pool, request->url);
+  client->post_data = apr_pstrdup(pool, request->post_data);
+  client->api_key_header = apr_pstrdup(pool, request->api_key_header);
+  client->cache_playback_mode = FALSE;
+  client->cache_fp = NULL;
+  client->cache_data_bytes = 0;
+  client->cache_key = apr_pstrdup(pool, request->cache_key);
+  client->cache_key_legacy = NULL;
+  client->cache_path_legacy = NULL;
+  client->cache_path_tmp = apr_pstrdup(pool, request->cache_path_tmp);
+  client->cache_path_final = apr_pstrdup(pool, request->cache_path_final);
+  client->busy = TRUE;
+  /* Until its .part file turns out not to open */
+  atomic_store(&flight->cacheable, client->config->cache_enabled && client->cache_path_tmp);
+  elevenlabs_http_client_submit(client);
+  elevenlabs_http_client_dispatch(client, FALSE);
+  return TRUE;
+}
+
+/* A miss joins the download of the same key already running, or starts one that later
+   identical SPEAKs can join; the lane plays the flight and this client is done, to be
+   made idle by the caller. Called with client->mutex held. FALSE means the client
+   downloads on its own. */
+static apt_bool_t elevenlabs_http_client_share(elevenlabs_http_client_t *client, unsigned gen)
+{
+  if (!client->flights || !client->lane || !client->cache_key) {
+    return FALSE;
+  }
+  elevenlabs_flight_t *flight = elevenlabs_flight_join(client->flights, client);
+  if (!flight) {
+    return FALSE;
+  }
+  elevenlabs_channel_playback_publish_flight(client->lane, flight, gen);
+  client->stopped = TRUE;
+  return TRUE;
+}
+
+/* Move a file cached under its pre-canonical key to the canonical name, then map it.
+   Runs on the I/O worker; the client is busy, so its paths are stable. */
+static elevenlabs_cache_blob_t* elevenlabs_cache_migrate_legacy(elevenlabs_http_client_t *client)
+{
+  const char *path = client->cache_path_final;
+  if (apr_file_rename(client->cache_path_legacy, path, client->request_pool) != APR_SUCCESS) {
+    /* Gone meanwhile; forget it */
+    elevenlabs_cache_disk_remove(client->disk_cache, client->cache_key_legacy);
+    return NULL;
+  }
+  elevenlabs_cache_disk_remove(client->disk_cache, client->cache_key_legacy);
+  elevenlabs_cache_blob_t *blob = elevenlabs_cache_blob_open(path, strstr(path, ".wav") ? 44 : 0,
+                                                             client->cache_key, client->memory_cache != NULL);
+  if (blob) {
+    const char *name = strrchr(path, '/');
+    elevenlabs_cache_disk_insert(client->disk_cache, client->cache_key, name ? name + 1 : path,
+                                 (apr_off_t)blob->size);
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "Migrated legacy cache file %s to %s",
+            client->cache_path_legacy, path);
+  }
+  return blob;
+}
+
+/* Cache lookup on an I/O worker: map the file on a hit (and pre-fault it so the media
+   thread never waits on the disk), otherwise submit the HTTP request. Only this
+   channel's pool is touched, and its consumer-side requests wait on busy meanwhile. */
+static void* APR_THREAD_FUNC elevenlabs_cache_lookup_task(apr_thread_t *thd, void *data)
+{
+  elevenlabs_http_client_t *client = (elevenlabs_http_client_t *)data;
+  const char *path = client->cache_path_final;
+  apr_time_t started = apr_time_now();
+  elevenlabs_cache_blob_t *blob = elevenlabs_cache_blob_open(path, strstr(path, ".wav") ? 44 : 0,
+                                                             client->cache_key, client->memory_cache != NULL);
+  if (!blob && client->cache_path_legacy) {
+    blob = elevenlabs_cache_migrate_legacy(client);
+  }
+
+  apr_thread_mutex_lock(client->mutex);
+  client->io_pending = FALSE;
+
+  if (client->stopped) {
+    /* Once idle, a released client may be freed by its worker at any moment */
+    elevenlabs_cache_memory_t *memory_cache = client->memory_cache;
+    char *deferred = elevenlabs_http_client_idle(client);
+    apr_thread_mutex_unlock(client->mutex);
+    if (blob) {
+      /* Nobody plays it now, but the disk read was paid for */
+      elevenlabs_cache_memory_put(memory_cache, blob);
+      elevenlabs_cache_blob_prefault(blob);
+      elevenlabs_cache_blob_unref(blob);
+    }
+    if (deferred) {
+      /* The SPEAK that cancelled this lookup starts here, on this I/O worker */
+      elevenlabs_http_client_begin(client, deferred, NULL, NULL, NULL, 0, deferred);
+    }
+    return NULL;
+  }
+
+  if (blob) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "Cache hit: %s (lookup %ld ms)",
+            path, (long)apr_time_as_msec(apr_time_now() - started));
+    ELEVENLABS_METRIC_ADD(elevenlabs_http_client_metrics(client), cache_hits_disk, 1);
+    /* The blob carries the audio; nothing is produced into the ring */
+    client->cache_playback_mode = TRUE;
+    elevenlabs_cache_memory_put(client->memory_cache, blob);
+    elevenlabs_synth_lane_t *lane = client->lane;
+    if (lane) {
+      elevenlabs_channel_playback_publish(lane, blob, client->lookup_gen);
+    }
+    client->stopped = TRUE;
+    char *deferred = elevenlabs_http_client_idle(client);
+    apr_thread_mutex_unlock(client->mutex);
+
+    /* The channel may go away from here on; the blob is refcounted and stands alone.
+       A client without a lane only fills the cache, so nobody reads the pages. */
+    if (lane) {
+      elevenlabs_cache_blob_prefault(blob);
+    }
+    elevenlabs_cache_blob_unref(blob);
+    if (deferred) {
+      elevenlabs_http_client_begin(client, deferred, NULL, NULL, NULL, 0, deferred);
+    }
+    return NULL;
+  }
+
+  /* Indexed but gone (removed by hand, or evicted meanwhile) */
+  elevenlabs_cache_disk_remove(client->disk_cache, client->cache_key);
+  ELEVENLABS_METRIC_ADD(elevenlabs_http_client_metrics(client), cache_misses, 1);
+
+  /* Ensure cache directory exists */
+  apr_status_t rv = apr_dir_make_recursive(client->config->cache_dir, APR_FPROT_OS_DEFAULT, client->request_pool);
+  if (rv != APR_SUCCESS && !APR_STATUS_IS_EEXIST(rv)) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Failed to create cache dir: %s", client->config->cache_dir);
+  }
+  if (elevenlabs_http_client_share(client, client->lookup_gen)) {
+    char *deferred = elevenlabs_http_client_idle(client);
+    apr_thread_mutex_unlock(client->mutex);
+    if (deferred) {
+      elevenlabs_http_client_begin(client, deferred, NULL, NULL, NULL, 0, deferred);
+    }
+    return NULL;
+  }
+  elevenlabs_http_client_submit(client);
+  elevenlabs_http_client_dispatch(client, TRUE);
   return NULL;
 }
 
+/* Split an optional language suffix off a voice id: "VOICEID_lang" e.g.
+   "NNl6r8mD7vthiJatiJt1_eng". The suffix is separated by the last '_' and must be 2-3
+   alphabetic characters (ISO 639); otherwise the id is used as is, without language. */
+void elevenlabs_voice_split(apr_pool_t *pool, const char *raw_voice_id,
+                            const char **voice_id, const char **language_code)
+{
+  *voice_id = raw_voice_id;
+  *language_code = NULL;
+  if (!raw_voice_id) {
+    return;
+  }
+  const char *last_us = strrchr(raw_voice_id, '_');
+  if (last_us) {
+    const char *suffix = last_us + 1;
+    size_t slen = strlen(suffix);
+    if (slen >= 2 && slen <= 3) {
+      /* Verify suffix is all alphabetic */
+      apt_bool_t all_alpha = TRUE;
+      for (size_t i = 0; i < slen; i++) {
+        if (suffix[i] < 'A' || (suffix[i] > 'Z' && suffix[i] < 'a') || suffix[i] > 'z') {
+          all_alpha = FALSE;
+          break;
+        }
+      }
+      if (all_alpha) {
+        /* Split: bare voice_id is everything before last '_' */
+        *voice_id = apr_pstrndup(pool, raw_voice_id, (apr_size_t)(last_us - raw_voice_id));
+        *language_code = apr_pstrdup(pool, suffix);
+      }
+    }
+  }
+}
+
+/* Strip [audio tags] from text for models that do not support them (all except eleven_v3).
+   eleven_v3 natively supports audio event tags like [laughs], [sighs], etc. */
+const char* elevenlabs_text_strip_tags(apr_pool_t *pool, const char *model_id, const char *text)
+{
+  if (!model_id || strcasecmp(model_id, "eleven_v3") == 0) {
+    return text;
+  }
+  char *stripped = apr_palloc(pool, strlen(text) + 1);
+  char *dst = stripped;
+  const char *src = text;
+  while (*src) {
+    if (*src == '[') {
+      /* Skip until closing ']' or end of string */
+      while (*src && *src != ']') src++;
+      if (*src == ']') src++;
+    } else {
+      *dst++ = *src++;
+    }
+  }
+  *dst = '\0';
+  return stripped;
+}
+
+/* Extension of the cache file for an output format */
+const char* elevenlabs_cache_file_ext(const char *output_format)
+{
+  /* Store as WAV when pcm_*, otherwise use mp3 extension if output_format starts with mp3 */
+  if (output_format && strncasecmp(output_format, "pcm_", 4) == 0)
+    return ".wav";
+  if (output_format && strncasecmp(output_format, "mp3", 3) == 0)
+    return ".mp3";
+  if (output_format && (strncasecmp(output_format, "ulaw_", 5) == 0 || strncasecmp(output_format, "alaw_", 5) == 0))
+    return ".wav"; /* wrap as WAV if later needed */
+  return ".bin";
+}
+
+/* Cache key of what start_synthesis would request for this voice and text under the
+   given config; for callers that look the cache up without synthesizing */
+apt_bool_t elevenlabs_cache_request_key(apr_pool_t *pool, const elevenlabs_config_t *config,
+                                        const char *raw_voice_id, const char *text, char **out_key)
+{
+  const char *voice_id;
+  const char *language_code;
+  elevenlabs_voice_split(pool, raw_voice_id ? raw_voice_id : config->voice_id, &voice_id, &language_code);
+  text = elevenlabs_text_normalize(pool, elevenlabs_text_strip_tags(pool, config->model_id, text));
+  return elevenlabs_cache_compute_key(pool, voice_id, config->model_id, config->output_format,
+                                      language_code, text, out_key);
+}
+
 apt_bool_t
 elevenlabs_http_client_start_synthesis(elevenlabs_http_client_t *client,
                                        const char *text,
+                                       const char *voice_id,
+                                       const char *legacy_text,
                                        elevenlabs_synth_channel_t *channel) {
-  if (!client || !text || !channel) {
+  if (!client || !text || (!channel && !client->config)) {
+    return FALSE;
+  }
+  if (!client->worker) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "HTTP client has no worker loop");
     return FALSE;
   }
 
+  /* Store config reference; a client without a channel (cache warm-up) brings its own */
+  const elevenlabs_config_t *config = channel ? &channel->elevenlabs_engine->config : client->config;
+  unsigned gen = channel ? channel->speak_gen : 0;
+
+  /* A previous request still on a worker or a cache lookup is cancelled, and this one
+     queued behind it: whichever thread sees it let go starts this one. Waiting here
+     would hold up every channel on the consumer task behind a slow disk or transfer. */
+  apr_thread_mutex_lock(client->mutex);
+  if (client->busy) {
+    char *deferred = strdup(text);
+    char *deferred_voice_id = voice_id ? strdup(voice_id) : NULL;
+    char *deferred_legacy_text = legacy_text ? strdup(legacy_text) : NULL;
+    if (!deferred || (voice_id && !deferred_voice_id) || (legacy_text && !deferred_legacy_text)) {
+      apr_thread_mutex_unlock(client->mutex);
+      free(deferred);
+      free(deferred_voice_id);
+      free(deferred_legacy_text);
+      return FALSE;
+    }
+    elevenlabs_http_client_deferred_free(client);
+    client->deferred_text = deferred;
+    client->deferred_voice_id = deferred_voice_id;
+    client->deferred_legacy_text = deferred_legacy_text;
+    client->deferred_config = config;
+    client->deferred_gen = gen;
+    atomic_store(&client->start_deferred, 1);
+    client->stopped = TRUE;
+    apt_bool_t io_pending = client->io_pending;
+    apr_thread_mutex_unlock(client->mutex);
+    if (!io_pending) {
+      elevenlabs_http_worker_notify(client->worker, client);
+    }
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+            "Previous request still running, synthesis starts once it lets go");
+    return TRUE;
+  }
+  apr_thread_mutex_unlock(client->mutex);
+  return elevenlabs_http_client_begin(client, text, voice_id, legacy_text, config, gen, NULL);
+}
+
+/* Build and hand off the request. deferred is the malloc'd text of a start queued by
+   start_synthesis, taken over from the request before it; voice, legacy text, config
+   and gen are then read with it, and the start is dropped if it was cancelled or
+   superseded meanwhile. */
+static apt_bool_t elevenlabs_http_client_begin(elevenlabs_http_client_t *client, const char *text,
+                                               const char *request_voice_id, const char *request_legacy_text,
+                                               const elevenlabs_config_t *config, unsigned gen,
+                                               char *deferred)
+{
+  /* Idle, or taken over: nothing refers to the previous request's memory any more */
+  apr_pool_clear(client->request_pool);
+  apr_pool_t *pool = client->request_pool;
+
   apr_thread_mutex_lock(client->mutex);
 
+  if (deferred) {
+    client->io_pending = FALSE;
+    if (client->deferred_text) {
+      /* A newer SPEAK cancelled this start before it got going */
+      free(deferred);
+      deferred = client->deferred_text;
+      client->deferred_text = NULL;
+      client->stopped = FALSE;
+    }
+    if (client->stopped || client->released) {
+      free(deferred);
+      elevenlabs_http_client_deferred_free(client);
+      atomic_store(&client->start_deferred, 0);
+      elevenlabs_http_client_idle(client);
+      apr_thread_mutex_unlock(client->mutex);
+      return FALSE;
+    }
+    text = apr_pstrdup(pool, deferred);
+    free(deferred);
+    request_voice_id = client->deferred_voice_id;
+    request_legacy_text = client->deferred_legacy_text;
+    config = client->deferred_config;
+    gen = client->deferred_gen;
+    /* Whatever the cancelled request got into the ring before it let go is stale */
+    audio_buffer_clear(client->audio_buffer);
+  }
+
   /* Reset stopped flag */
   client->stopped = FALSE;
+  atomic_store(&client->paused, 0);
+  atomic_store(&client->resume_requested, 0);
   /* Reset error state */
   client->http_error = FALSE;
   client->error_body[0] = '\0';
   client->error_body_len = 0;
 
-  /* Store config reference */
-  const elevenlabs_config_t *config = &channel->elevenlabs_engine->config;
   client->config = config;
+  client->request_voice_id = apr_pstrdup(pool, request_voice_id);
+  client->request_legacy_text = apr_pstrdup(pool, request_legacy_text);
+  if (deferred) {
+    elevenlabs_http_client_deferred_free(client);
+  }
+  /* The media thread reads the ring again only now that stopped is this request's */
+  atomic_store(&client->start_deferred, 0);
 
-  /* Parse voice_id for optional language suffix: "VOICEID_lang" e.g. "NNl6r8mD7vthiJatiJt1_eng"
-     The suffix is separated by the last '_' and must be 2-3 alphabetic characters (ISO 639).
-     If the suffix matches, use the bare voice_id and set request_language_code. */
   const char *raw_voice_id = client->request_voice_id ? client->request_voice_id : config->voice_id;
-  const char *voice_id = raw_voice_id;
-  client->request_language_code = NULL;
-  if (raw_voice_id) {
-    const char *last_us = strrchr(raw_voice_id, '_');
-    if (last_us) {
-      const char *suffix = last_us + 1;
-      size_t slen = strlen(suffix);
-      if (slen >= 2 && slen <= 3) {
-        /* Verify suffix is all alphabetic */
-        apt_bool_t all_alpha = TRUE;
-        for (size_t i = 0; i < slen; i++) {
-          if (suffix[i] < 'A' || (suffix[i] > 'Z' && suffix[i] < 'a') || suffix[i] > 'z') {
-            all_alpha = FALSE;
-            break;
-          }
-        }
-        if (all_alpha) {
-          /* Split: bare voice_id is everything before last '_' */
-          voice_id = apr_pstrndup(client->pool, raw_voice_id, (apr_size_t)(last_us - raw_voice_id));
-          client->request_language_code = apr_pstrdup(client->pool, suffix);
-          apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
-                  "Parsed voice_id='%s', language_code='%s' from '%s'",
-                  voice_id, client->request_language_code, raw_voice_id);
-        }
-      }
-    }
+  const char *voice_id;
+  elevenlabs_voice_split(pool, raw_voice_id, &voice_id, &client->request_language_code);
+  if (client->request_language_code) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+            "Parsed voice_id='%s', language_code='%s' from '%s'",
+            voice_id, client->request_language_code, raw_voice_id);
   }
 
-  /* Strip [audio tags] from text for models that do not support them (all except eleven_v3).
-     eleven_v3 natively supports audio event tags like [laughs], [sighs], etc. */
-  const char *processed_text = text;
-  if (config->model_id && strcasecmp(config->model_id, "eleven_v3") != 0) {
-    char *stripped = apr_palloc(client->pool, strlen(text) + 1);
-    char *dst = stripped;
-    const char *src = text;
-    while (*src) {
-      if (*src == '[') {
-        /* Skip until closing ']' or end of string */
-        while (*src && *src != ']') src++;
-        if (*src == ']') src++;
-      } else {
-        *dst++ = *src++;
-      }
-    }
-    *dst = '\0';
-    processed_text = stripped;
-    if (strcmp(processed_text, text) != 0) {
-      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
-              "Stripped audio tags from text before synthesis");
-    }
+  const char *processed_text = elevenlabs_text_strip_tags(pool, config->model_id, text);
+  if (processed_text != text && strcmp(processed_text, text) != 0) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+            "Stripped audio tags from text before synthesis");
   }
+  /* Text a pre-canonical cache file of this request would be keyed on. The SSML extractor
+     changed with the keys, so for SSML that is the old reading the channel passes on. */
+  const char *legacy_text = client->request_legacy_text ?
+      elevenlabs_text_strip_tags(pool, config->model_id, client->request_legacy_text) : processed_text;
+  /* Canonical text: what is sent to the API and what the cache key covers */
+  processed_text = elevenlabs_text_normalize(pool, processed_text);
+
   /* Build deterministic cache key and paths when caching enabled */
   client->cache_playback_mode = FALSE;
   client->cache_fp = NULL;
@@ -485,157 +1250,176 @@ elevenlabs_http_client_start_synthesis(elevenlabs_http_client_t *client,
   client->cache_path_tmp = NULL;
   client->cache_path_final = NULL;
   client->cache_key = NULL;
+  client->cache_key_legacy = NULL;
+  client->cache_path_legacy = NULL;
+  const char *ext = NULL;
 
   if (config->cache_enabled && config->cache_dir) {
     char *key_hex = NULL;
-    if (elevenlabs_cache_compute_key(client->pool, voice_id, config->model_id, config->output_format, processed_text, &key_hex)) {
+    if (elevenlabs_cache_compute_key(pool, voice_id, config->model_id, config->output_format,
+                                     client->request_language_code, processed_text, &key_hex)) {
       client->cache_key = key_hex;
-      const char *ext = NULL;
-      /* Store as WAV when pcm_*, otherwise use mp3 extension if output_format starts with mp3 */
-      if (config->output_format && strncasecmp(config->output_format, "pcm_", 4) == 0)
-        ext = ".wav";
-      else if (config->output_format && strncasecmp(config->output_format, "mp3", 3) == 0)
-        ext = ".mp3";
-      else if (config->output_format && (strncasecmp(config->output_format, "ulaw_", 5) == 0 || strncasecmp(config->output_format, "alaw_", 5) == 0))
-        ext = ".wav"; /* wrap as WAV if later needed */
-      else
-        ext = ".bin";
-
-      client->cache_path_final = apr_psprintf(client->pool, "%s/%s%s", config->cache_dir, key_hex, ext);
-      client->cache_path_tmp   = apr_psprintf(client->pool, "%s/%s%s.part", config->cache_dir, key_hex, ext);
-
-      /* If file exists, switch to cache playback mode by loading into buffer and skipping HTTP entirely */
-      apr_finfo_t finfo; memset(&finfo, 0, sizeof(finfo));
-    if (apr_stat(&finfo, client->cache_path_final, APR_FINFO_SIZE, client->pool) == APR_SUCCESS && finfo.size > 0) {
-        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "Cache hit: %s", client->cache_path_final);
-        /* Read file and push to buffer in chunks to avoid huge allocations */
-        apr_file_t *fp = NULL;
-        if (apr_file_open(&fp, client->cache_path_final, APR_FOPEN_READ | APR_FOPEN_BUFFERED, APR_OS_DEFAULT, client->pool) == APR_SUCCESS) {
-          /* If WAV, skip 44-byte header */
-          apr_off_t offset = 0;
-          if (strstr(client->cache_path_final, ".wav")) {
-            offset = 44;
-            apr_file_seek(fp, APR_SET, &offset);
-          }
-          uint8_t chunk[4096];
-          apr_size_t rd = sizeof(chunk);
-          while (apr_file_read(fp, chunk, &rd) == APR_SUCCESS && rd > 0) {
-            audio_buffer_write(client->audio_buffer, chunk, rd);
-            rd = sizeof(chunk);
-          }
-          apr_file_close(fp);
-          /* Mark stopped to indicate EOF, and skip HTTP */
-          client->stopped = TRUE;
-      /* Release mutex before returning from cache-playback path */
-      apr_thread_mutex_unlock(client->mutex);
-      return TRUE;
-        }
-      } else {
-        /* Ensure cache directory exists */
-        apr_status_t rv = apr_dir_make_recursive(config->cache_dir, APR_FPROT_OS_DEFAULT, client->pool);
-        if (rv != APR_SUCCESS && !APR_STATUS_IS_EEXIST(rv)) {
-          apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Failed to create cache dir: %s", config->cache_dir);
-        }
-      }
+      ext = elevenlabs_cache_file_ext(config->output_format);
+
+      client->cache_path_final = apr_psprintf(pool, "%s/%s%s", config->cache_dir, key_hex, ext);
+      client->cache_path_tmp   = apr_psprintf(pool, "%s/%s%s.part", config->cache_dir, key_hex, ext);
     }
   }
 
   /* Build URL */
   /* Note: optimize_streaming_latency is deprecated and omitted — it causes HTTP 400
      on newer models (e.g. eleven_v3) and was optional for all others. */
-  client->url = apr_psprintf(client->pool,
+  client->url = apr_psprintf(pool,
                              "%s/%s/stream?output_format=%s",
                              config->base_url, voice_id,
                              config->output_format);
 
   /* Build POST data: text + model_id + optional language_code.
      Escape text to prevent JSON injection from quotes/backslashes in input. */
-  const char *escaped_text = json_escape_string(client->pool, processed_text);
+  const char *escaped_text = elevenlabs_json_escape(pool, processed_text);
   if (client->request_language_code) {
-    client->post_data = apr_psprintf(client->pool,
+    client->post_data = apr_psprintf(pool,
         "{\"text\":\"%s\",\"model_id\":\"%s\",\"language_code\":\"%s\"}",
         escaped_text, config->model_id, client->request_language_code);
   } else {
-    client->post_data = apr_psprintf(client->pool,
+    client->post_data = apr_psprintf(pool,
         "{\"text\":\"%s\",\"model_id\":\"%s\"}",
         escaped_text, config->model_id);
   }
-
-  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
-          "Starting synthesis with URL: %s", client->url);
-  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG, "POST data: %s",
-          client->post_data);
-
-  /* Set curl options for this request */
-  curl_easy_setopt(client->curl, CURLOPT_URL, client->url);
-  curl_easy_setopt(client->curl, CURLOPT_POST, 1L);
-  curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, client->post_data);
-  curl_easy_setopt(client->curl, CURLOPT_POSTFIELDSIZE,
-                   strlen(client->post_data));
-
-  /* Set headers */
-  if (client->headers) {
-    curl_slist_free_all(client->headers);
-    client->headers = NULL;
+  client->api_key_header = apr_psprintf(pool, "%s: %s",
+                                        ELEVENLABS_API_KEY_HEADER, config->api_key);
+
+  client->busy = TRUE;
+
+  /* Frequent prompts are served from memory without touching the disk at all */
+  if (client->cache_key && client->memory_cache) {
+    elevenlabs_cache_blob_t *blob = elevenlabs_cache_memory_get(client->memory_cache, client->cache_key);
+    if (blob) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "Memory cache hit: %s", client->cache_key);
+      ELEVENLABS_METRIC_ADD(elevenlabs_http_client_metrics(client), cache_hits_memory, 1);
+      /* Keep the file hot on disk too, or disk eviction would pick the busiest prompts */
+      elevenlabs_cache_disk_lookup(client->disk_cache, client->cache_key);
+      client->cache_playback_mode = TRUE;
+      if (client->lane) {
+        elevenlabs_channel_playback_publish(client->lane, blob, gen);
+      }
+      elevenlabs_cache_blob_unref(blob);
+      client->stopped = TRUE;
+      /* Nothing is deferred behind this start: the mutex was held since it began */
+      elevenlabs_http_client_idle(client);
+      apr_thread_mutex_unlock(client->mutex);
+      return TRUE;
+    }
   }
-  client->headers = curl_slist_append(client->headers, "Content-Type: application/json");
-  /* Some ElevenLabs setups prefer explicit Accept for binary */
-  client->headers = curl_slist_append(client->headers, "Accept: */*");
-  client->headers = curl_slist_append(client->headers, apr_psprintf(client->pool, "%s: %s",
-                                                    ELEVENLABS_API_KEY_HEADER,
-                                                    config->api_key));
-  curl_easy_setopt(client->curl, CURLOPT_HTTPHEADER, client->headers);
-  /* Disable Expect: 100-continue to avoid extra RTT */
-  client->headers = curl_slist_append(client->headers, "Expect:");
-  curl_easy_setopt(client->curl, CURLOPT_HTTPHEADER, client->headers);
 
-  /* Set timeouts */
-  curl_easy_setopt(client->curl, CURLOPT_CONNECTTIMEOUT_MS,
-                   config->connect_timeout_ms);
-  curl_easy_setopt(client->curl, CURLOPT_TIMEOUT_MS, config->read_timeout_ms);
-  curl_easy_setopt(client->curl, CURLOPT_NOSIGNAL, 1L);
-
-  /* Set buffer size for better streaming performance */
-  curl_easy_setopt(client->curl, CURLOPT_BUFFERSIZE, 1024);
-
-  /* Prepare cache file for write-through if enabled and no hit occurred */
-  if (config->cache_enabled && client->cache_path_tmp && !client->stopped) {
-    if (apr_file_open(&client->cache_fp, client->cache_path_tmp,
-                      APR_FOPEN_CREATE | APR_FOPEN_WRITE | APR_FOPEN_TRUNCATE | APR_FOPEN_BUFFERED,
-                      APR_OS_DEFAULT, client->pool) == APR_SUCCESS) {
-      /* Reserve space for WAV header if we will wrap PCM into WAV */
-      if (client->cache_path_final && strstr(client->cache_path_final, ".wav")) {
-        /* We'll write header at finalize; for streaming write data immediately after header position */
-        apr_off_t pos = 44; /* standard PCM WAV header size */
-        apr_file_seek(client->cache_fp, APR_SET, &pos);
-      }
-    } else {
-      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Failed to open cache temp file: %s", client->cache_path_tmp);
+  /* The disk index answers misses without a syscall; only a likely hit (or no index)
+     needs the file. That touches the disk, which may be slow or remote, so it runs on
+     an I/O worker and this (shared consumer) task only answers SPEAK. */
+  apt_bool_t on_disk = FALSE;
+  if (client->cache_path_final) {
+    on_disk = !client->disk_cache || elevenlabs_cache_disk_lookup(client->disk_cache, client->cache_key);
+    /* Legacy files of the G.711 fallback hold what the old decoder made of the audio
+       (μ-law through a wrong table, A-law not decoded at all): misses, not migrated */
+    apt_bool_t legacy_usable = !(config->fallback_ulaw_to_pcm && config->output_format &&
+                                 (strcasecmp(config->output_format, "ulaw_8000") == 0 ||
+                                  strcasecmp(config->output_format, "alaw_8000") == 0));
+    char *legacy_key = NULL;
+    if ((!on_disk || !client->disk_cache) && legacy_usable &&
+        elevenlabs_cache_compute_legacy_key(pool, voice_id, config->model_id, config->output_format,
+                                            legacy_text, &legacy_key) &&
+        (!client->disk_cache || elevenlabs_cache_disk_lookup(client->disk_cache, legacy_key))) {
+      /* Written under the pre-canonical key; the lookup renames it to the new key */
+      client->cache_key_legacy = legacy_key;
+      client->cache_path_legacy = apr_psprintf(pool, "%s/%s%s", config->cache_dir, legacy_key, ext);
+      on_disk = TRUE;
+    }
+  }
+  if (on_disk) {
+    client->io_pending = TRUE;
+    client->lookup_gen = gen;
+    apr_thread_mutex_unlock(client->mutex);
+    if (!client->io_pool ||
+        apr_thread_pool_push(client->io_pool, elevenlabs_cache_lookup_task, client,
+                             APR_THREAD_TASK_PRIORITY_NORMAL, client) != APR_SUCCESS) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+              "No cache I/O worker available, looking up cache inline");
+      elevenlabs_cache_lookup_task(NULL, client);
     }
+    return TRUE;
   }
 
-  /* mark start for latency metrics */
-  client->start_time = apr_time_now();
-  client->first_chunk_logged = FALSE;
+  if (client->cache_key) {
+    ELEVENLABS_METRIC_ADD(elevenlabs_http_client_metrics(client), cache_misses, 1);
+  }
+  if (elevenlabs_http_client_share(client, gen)) {
+    elevenlabs_http_client_idle(client);
+    apr_thread_mutex_unlock(client->mutex);
+    return TRUE;
+  }
+  elevenlabs_http_client_submit(client);
+  elevenlabs_http_client_dispatch(client, FALSE);
+  return TRUE;
+}
 
-  /* Launch background thread to perform the request */
-  apr_status_t rv = apr_thread_create(&client->thread, NULL, elevenlabs_http_thread, client, client->pool);
-  apr_thread_mutex_unlock(client->mutex);
+static char* elevenlabs_cache_digest_hex(apr_pool_t *pool, apr_sha1_ctx_t *ctx, const char *prefix)
+{
+  unsigned char digest[APR_SHA1_DIGESTSIZE];
+  apr_sha1_final(digest, ctx);
+  static const char *hex = "0123456789abcdef";
+  apr_size_t prefix_len = prefix ? strlen(prefix) : 0;
+  char *hexstr = apr_palloc(pool, prefix_len + APR_SHA1_DIGESTSIZE*2 + 1);
+  memcpy(hexstr, prefix, prefix_len);
+  char *out = hexstr + prefix_len;
+  for (int i=0;i<APR_SHA1_DIGESTSIZE;i++){ out[i*2]=hex[(digest[i]>>4)&0xF]; out[i*2+1]=hex[digest[i]&0xF]; }
+  out[APR_SHA1_DIGESTSIZE*2] = '\0';
+  return hexstr;
+}
 
-  if (rv != APR_SUCCESS) {
-    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "Failed to create HTTP thread");
-    return FALSE;
+/* One key field as a netstring ("<len>:<bytes>,"), so field boundaries are part of
+   what is hashed and "ab"+"c" never meets "a"+"bc" */
+static void elevenlabs_cache_key_field(apr_sha1_ctx_t *ctx, const char *value)
+{
+  char len_prefix[24];
+  apr_size_t len = value ? strlen(value) : 0;
+  int n = snprintf(len_prefix, sizeof(len_prefix), "%lu:", (unsigned long)len);
+  apr_sha1_update(ctx, len_prefix, (unsigned int)n);
+  if (len) {
+    apr_sha1_update(ctx, value, (unsigned int)len);
   }
-  return TRUE;
+  apr_sha1_update(ctx, ",", 1);
 }
 
-/* Compute a deterministic cache key (SHA1 hex) over inputs that affect audio */
+/* Compute the canonical cache key over everything that affects the audio: the key
+   version, voice, model, format, language (empty when none) and the normalized text.
+   The result is "v2-<sha1 hex>"; bump the version whenever what goes in changes. */
 apt_bool_t elevenlabs_cache_compute_key(apr_pool_t *pool,
                                         const char *voice_id,
                                         const char *model_id,
                                         const char *output_format,
+                                        const char *language_code,
                                         const char *text,
-                                        char **out_key_hex)
+                                        char **out_key)
+{
+  if (!pool || !voice_id || !model_id || !output_format || !text || !out_key) return FALSE;
+  apr_sha1_ctx_t ctx; apr_sha1_init(&ctx);
+  elevenlabs_cache_key_field(&ctx, ELEVENLABS_CACHE_KEY_VERSION);
+  elevenlabs_cache_key_field(&ctx, voice_id);
+  elevenlabs_cache_key_field(&ctx, model_id);
+  elevenlabs_cache_key_field(&ctx, output_format);
+  elevenlabs_cache_key_field(&ctx, language_code);
+  elevenlabs_cache_key_field(&ctx, text);
+  *out_key = elevenlabs_cache_digest_hex(pool, &ctx, ELEVENLABS_CACHE_KEY_VERSION "-");
+  return TRUE;
+}
+
+/* Key of cache files written before keys were canonical: plain concatenation of the
+   fields, text exactly as sent. Only used to find and migrate those files. */
+apt_bool_t elevenlabs_cache_compute_legacy_key(apr_pool_t *pool,
+                                               const char *voice_id,
+                                               const char *model_id,
+                                               const char *output_format,
+                                               const char *text,
+                                               char **out_key_hex)
 {
   if (!pool || !voice_id || !model_id || !output_format || !text || !out_key_hex) return FALSE;
   apr_sha1_ctx_t ctx; apr_sha1_init(&ctx);
@@ -643,16 +1427,33 @@ apt_bool_t elevenlabs_cache_compute_key(apr_pool_t *pool,
   apr_sha1_update(&ctx, model_id, (unsigned int)strlen(model_id));
   apr_sha1_update(&ctx, output_format, (unsigned int)strlen(output_format));
   apr_sha1_update(&ctx, text, (unsigned int)strlen(text));
-  unsigned char digest[APR_SHA1_DIGESTSIZE];
-  apr_sha1_final(digest, &ctx);
-  static const char *hex = "0123456789abcdef";
-  char *hexstr = apr_palloc(pool, APR_SHA1_DIGESTSIZE*2 + 1);
-  for (int i=0;i<APR_SHA1_DIGESTSIZE;i++){ hexstr[i*2]=hex[(digest[i]>>4)&0xF]; hexstr[i*2+1]=hex[digest[i]&0xF]; }
-  hexstr[APR_SHA1_DIGESTSIZE*2] = '\0';
-  *out_key_hex = hexstr;
+  *out_key_hex = elevenlabs_cache_digest_hex(pool, &ctx, "");
   return TRUE;
 }
 
+/* Fold every run of whitespace into one space and trim both ends, so prompts that
+   differ only in layout synthesize (and cache) as the same text */
+char* elevenlabs_text_normalize(apr_pool_t *pool, const char *text)
+{
+  if (!text) return NULL;
+  char *normalized = apr_palloc(pool, strlen(text) + 1);
+  char *dst = normalized;
+  apt_bool_t pending_space = FALSE;
+  for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+    if (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\v' || *p == '\f') {
+      pending_space = (dst != normalized);
+      continue;
+    }
+    if (pending_space) {
+      *dst++ = ' ';
+      pending_space = FALSE;
+    }
+    *dst++ = (char)*p;
+  }
+  *dst = '\0';
+  return normalized;
+}
+
 apt_bool_t elevenlabs_cache_ensure_dir(apr_pool_t *pool, const char *dir)
 {
   if (!dir) return FALSE;
@@ -769,45 +1570,91 @@ apt_bool_t elevenlabs_http_client_stop(elevenlabs_http_client_t *client) {
 
   apr_thread_mutex_lock(client->mutex);
 
-  /* Set stopped flag FIRST to prevent write_callback from blocking */
+  /* Set stopped flag FIRST so callbacks abort if the worker is mid-transfer */
   client->stopped = TRUE;
-
-  if (client->curl) {
-    /* Force immediate timeout to abort any ongoing transfer */
-    curl_easy_setopt(client->curl, CURLOPT_TIMEOUT_MS, 1);
-    curl_easy_setopt(client->curl, CURLOPT_CONNECTTIMEOUT_MS, 1);
-
-    /* Pause both upload and download to force callback returns */
-    curl_easy_pause(client->curl, CURLPAUSE_ALL);
-    
-    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
-            "Curl operation aborted, waiting for thread...");
-  }
-  
-  /* DO NOT free headers here - thread may still be using them */
-  /* DO NOT join thread here - may cause deadlock if we hold mutex */
-  
+  apt_bool_t busy = client->busy;
+  apt_bool_t io_pending = client->io_pending;
   apr_thread_mutex_unlock(client->mutex);
 
-  /* Join thread OUTSIDE of mutex to avoid deadlock */
-  if (client->thread) {
-    apr_status_t rv = APR_SUCCESS;
+  if (io_pending) {
+    /* A cache lookup or .part creation still on an I/O worker sees the flag and winds
+       down by itself; waiting for a slow disk here would stall every channel on the
+       consumer task */
     apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
-            "Joining HTTP thread...");
-    apr_thread_join(&rv, client->thread);
-    client->thread = NULL;
+            "Cache I/O in flight, it will finish on its own");
+  } else if (busy && client->worker) {
+    /* The easy handle belongs to the worker loop: ask it to remove the handle and wait
+       for that, which takes one loop iteration rather than a thread join */
+    elevenlabs_http_worker_notify(client->worker, client);
+    elevenlabs_http_client_wait_idle(client);
     apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
-            "HTTP thread joined successfully (status=%d)", rv);
+            "Request removed from HTTP worker %u", client->worker->index);
   }
   
-  /* Now safe to free headers after thread has terminated */
-  if (client->headers) {
-    curl_slist_free_all(client->headers);
-    client->headers = NULL;
-  }
+  /* Headers stay until the next request or destroy: a lookup may still be submitting */
 
   apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
           "ElevenLabs HTTP client stopped");
 
   return TRUE;
 }
+
+/**
+ * Ask the worker to drop the request without waiting for it, for callers that must not
+ * block (STOP on the consumer task, the media thread letting go of a shared download).
+ * The transfer's progress callback aborts it on the flag even before the worker wakes.
+ */
+void elevenlabs_http_client_cancel(elevenlabs_http_client_t *client) {
+  if (!client) {
+    return;
+  }
+  apr_thread_mutex_lock(client->mutex);
+  client->stopped = TRUE;
+  /* A start queued behind the request goes too; one already taken over sees the flag */
+  if (client->deferred_text) {
+    elevenlabs_http_client_deferred_free(client);
+    atomic_store(&client->start_deferred, 0);
+  }
+  apt_bool_t busy = client->busy;
+  apr_thread_mutex_unlock(client->mutex);
+  if (busy && client->worker) {
+    elevenlabs_http_worker_notify(client->worker, client);
+  }
+}
+
+/**
+ * Let go of a lane client for good without waiting for its request (channel destroy).
+ * The client is stopped and handed to its worker loop, which frees it together with its
+ * ring and pool once no thread holds it. The client must own its pool.
+ */
+void elevenlabs_http_client_release(elevenlabs_http_client_t *client) {
+  if (!client) {
+    return;
+  }
+  apr_thread_mutex_lock(client->mutex);
+  client->stopped = TRUE;
+  client->released = TRUE;
+  /* The channel goes away now; a lookup that is still running must not publish to it,
+     and a start queued behind it must not run */
+  client->lane = NULL;
+  elevenlabs_http_client_deferred_free(client);
+  apr_thread_mutex_unlock(client->mutex);
+
+  if (client->worker) {
+    elevenlabs_http_worker_reap(client->worker, client);
+  } else {
+    /* Never ran a request */
+    elevenlabs_http_client_free(client);
+  }
+}
+
+/**
+ * Destroy an idle client that owns its pool, with the ring it produces into
+ */
+void elevenlabs_http_client_free(elevenlabs_http_client_t *client) {
+  audio_buffer_t *audio_buffer = client->audio_buffer;
+  apr_pool_t *pool = client->pool;
+  elevenlabs_http_client_destroy(client);
+  audio_buffer_destroy(audio_buffer);
+  apr_pool_destroy(pool);
+}
@@ -0,0 +1,295 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_http_pool.c
+ * @brief Engine-wide shared HTTP state (DNS, TLS sessions, worker loops) for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+#include "elevenlabs_synth.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+/* CURLSH lock callbacks: one APR mutex per shared data class */
+static void elevenlabs_http_pool_lock(CURL *handle, curl_lock_data data,
+                                      curl_lock_access access, void *userptr)
+{
+  elevenlabs_http_pool_t *http_pool = (elevenlabs_http_pool_t *)userptr;
+  if (data < CURL_LOCK_DATA_LAST && http_pool->locks[data]) {
+    apr_thread_mutex_lock(http_pool->locks[data]);
+  }
+}
+
+static void elevenlabs_http_pool_unlock(CURL *handle, curl_lock_data data, void *userptr)
+{
+  elevenlabs_http_pool_t *http_pool = (elevenlabs_http_pool_t *)userptr;
+  if (data < CURL_LOCK_DATA_LAST && http_pool->locks[data]) {
+    apr_thread_mutex_unlock(http_pool->locks[data]);
+  }
+}
+
+/* Resolve http_worker_threads: 0 means one loop per online CPU */
+static unsigned elevenlabs_http_pool_worker_count(const elevenlabs_config_t *config)
+{
+  long count = config ? (long)config->http_worker_threads : 0;
+  if (count <= 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (count <= 0) {
+      count = 1;
+    }
+  }
+  if (count > MAX_HTTP_WORKER_THREADS) {
+    count = MAX_HTTP_WORKER_THREADS;
+  }
+  return (unsigned)count;
+}
+
+/**
+ * Create the shared HTTP pool and start its worker loops. Requires curl_global_init().
+ */
+elevenlabs_http_pool_t *elevenlabs_http_pool_create(apr_pool_t *pool, const elevenlabs_config_t *config)
+{
+  elevenlabs_http_pool_t *http_pool = apr_pcalloc(pool, sizeof(elevenlabs_http_pool_t));
+  if (!http_pool) {
+    return NULL;
+  }
+  http_pool->pool = pool;
+  atomic_init(&http_pool->connections_new, 0);
+  atomic_init(&http_pool->connections_reused, 0);
+  for (unsigned i = 0; i < ELEVENLABS_TTFB_WINDOW; i++) {
+    atomic_init(&http_pool->ttfb_ms[i], 0);
+  }
+  atomic_init(&http_pool->ttfb_count, 0);
+  atomic_init(&http_pool->ttfb_percentile_ms, 0);
+  atomic_init(&http_pool->hedge_tokens, 0);
+  atomic_init(&http_pool->hedges_fired, 0);
+  atomic_init(&http_pool->hedges_won, 0);
+  atomic_init(&http_pool->ws_sessions, 0);
+
+  http_pool->share = curl_share_init();
+  if (!http_pool->share) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "Failed to create curl share handle");
+    return NULL;
+  }
+
+  /* Every channel shares resolved addresses and TLS session tickets, so a new session
+     skips DNS and resumes TLS instead of a full handshake. The connection cache is not
+     shared here: libcurl does not support sharing live connections between handles
+     driven by different threads, so each worker loop keeps its own (multiplexed) cache. */
+  static const curl_lock_data shared[] = { CURL_LOCK_DATA_DNS, CURL_LOCK_DATA_SSL_SESSION };
+  for (size_t i = 0; i < sizeof(shared) / sizeof(shared[0]); i++) {
+    apr_thread_mutex_create(&http_pool->locks[shared[i]], APR_THREAD_MUTEX_DEFAULT, pool);
+    curl_share_setopt(http_pool->share, CURLSHOPT_SHARE, shared[i]);
+  }
+  /* libcurl also locks its own share bookkeeping */
+  apr_thread_mutex_create(&http_pool->locks[CURL_LOCK_DATA_SHARE], APR_THREAD_MUTEX_DEFAULT, pool);
+
+  curl_share_setopt(http_pool->share, CURLSHOPT_LOCKFUNC, elevenlabs_http_pool_lock);
+  curl_share_setopt(http_pool->share, CURLSHOPT_UNLOCKFUNC, elevenlabs_http_pool_unlock);
+  curl_share_setopt(http_pool->share, CURLSHOPT_USERDATA, http_pool);
+
+  unsigned count = elevenlabs_http_pool_worker_count(config);
+  http_pool->workers = apr_pcalloc(pool, count * sizeof(elevenlabs_http_worker_t *));
+  for (unsigned i = 0; i < count; i++) {
+    http_pool->workers[i] = elevenlabs_http_worker_create(i, http_pool, config, pool);
+    if (!http_pool->workers[i]) {
+      break;
+    }
+    http_pool->worker_count++;
+  }
+  if (config && config->http_warm_connections) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+            "Pre-warming %u connection(s) per worker to %s, keep-alive every %u ms",
+            config->http_warm_connections, config->base_url, config->http_keepalive_interval_ms);
+  }
+  if (http_pool->worker_count == 0) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "No HTTP worker could be started");
+    elevenlabs_http_pool_destroy(http_pool);
+    return NULL;
+  }
+  atomic_init(&http_pool->next_worker, 0);
+
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "Shared HTTP pool created (DNS cache, TLS sessions, %u worker loops)", http_pool->worker_count);
+  return http_pool;
+}
+
+/**
+ * Destroy the shared HTTP pool; all easy handles using it must be gone
+ */
+void elevenlabs_http_pool_destroy(elevenlabs_http_pool_t *http_pool)
+{
+  if (!http_pool) {
+    return;
+  }
+
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "Shared HTTP pool stats: connections reused=%lu new=%lu, hedges fired=%lu won=%lu",
+          (unsigned long)atomic_load(&http_pool->connections_reused),
+          (unsigned long)atomic_load(&http_pool->connections_new),
+          (unsigned long)atomic_load(&http_pool->hedges_fired),
+          (unsigned long)atomic_load(&http_pool->hedges_won));
+
+  /* WebSocket threads free their sessions on their own once the channel is gone, and
+     their handles use the share; a connect gives up within a second of being told to */
+  if (atomic_load(&http_pool->ws_sessions)) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "Waiting for %u WebSocket sessions to close",
+            atomic_load(&http_pool->ws_sessions));
+    while (atomic_load(&http_pool->ws_sessions)) {
+      apr_sleep(apr_time_from_msec(10));
+    }
+  }
+
+  /* Workers first: their multi handles hold connections that use the share */
+  for (unsigned i = 0; i < http_pool->worker_count; i++) {
+    elevenlabs_http_worker_destroy(http_pool->workers[i]);
+    http_pool->workers[i] = NULL;
+  }
+  http_pool->worker_count = 0;
+
+  if (http_pool->share) {
+    CURLSHcode rc = curl_share_cleanup(http_pool->share);
+    if (rc != CURLSHE_OK) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+              "curl share cleanup failed: %s", curl_share_strerror(rc));
+    }
+    http_pool->share = NULL;
+  }
+
+  for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+    if (http_pool->locks[i]) {
+      apr_thread_mutex_destroy(http_pool->locks[i]);
+      http_pool->locks[i] = NULL;
+    }
+  }
+}
+
+/**
+ * Attach a client to the shared state and pin it to a worker loop
+ */
+void elevenlabs_http_pool_attach(elevenlabs_http_pool_t *http_pool, elevenlabs_http_client_t *client)
+{
+  if (!http_pool || !http_pool->share || !client || !client->curl) {
+    return;
+  }
+  unsigned slot = atomic_fetch_add(&http_pool->next_worker, 1) % http_pool->worker_count;
+  client->http_pool = http_pool;
+  client->worker = http_pool->workers[slot];
+  elevenlabs_http_pool_setup_easy(http_pool, client->curl);
+}
+
+/**
+ * Apply the shared-state and connection options every easy handle uses
+ */
+void elevenlabs_http_pool_setup_easy(elevenlabs_http_pool_t *http_pool, CURL *curl)
+{
+  if (!http_pool || !http_pool->share || !curl) {
+    return;
+  }
+  curl_easy_setopt(curl, CURLOPT_SHARE, http_pool->share);
+  /* Keep idle connections alive between SPEAKs */
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+}
+
+/**
+ * Account for the connection used by a finished transfer
+ */
+void elevenlabs_http_pool_record(elevenlabs_http_pool_t *http_pool, CURL *curl)
+{
+  if (!http_pool || !curl) {
+    return;
+  }
+  long new_connects = 0;
+  curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connects);
+  if (new_connects > 0) {
+    atomic_fetch_add(&http_pool->connections_new, (unsigned long)new_connects);
+  } else {
+    atomic_fetch_add(&http_pool->connections_reused, 1);
+  }
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "HTTP connection %s (pool totals: reused=%lu new=%lu)",
+          new_connects > 0 ? "opened" : "reused",
+          (unsigned long)atomic_load(&http_pool->connections_reused),
+          (unsigned long)atomic_load(&http_pool->connections_new));
+}
+
+/* Hedged requests. Every request earns hedge_budget_percent hundredths of a hedge, and
+   a hedge spends a whole one, so duplicates stay within that share of the request rate.
+   The savings are capped at ELEVENLABS_HEDGE_BURST: when the API is slow for everyone,
+   hedging everything would only double the load on it. */
+
+/**
+ * Account for a request being started; returns how long to wait for its first audio
+ * before sending a duplicate, 0 for never
+ */
+apr_interval_time_t elevenlabs_http_pool_hedge_delay(elevenlabs_http_pool_t *http_pool,
+                                                     const elevenlabs_config_t *config)
+{
+  if (!http_pool || !config || config->hedge_budget_percent == 0) {
+    return 0;
+  }
+  unsigned tokens = atomic_load(&http_pool->hedge_tokens);
+  unsigned credited;
+  do {
+    credited = tokens + config->hedge_budget_percent;
+    if (credited > ELEVENLABS_HEDGE_BURST * 100) {
+      credited = ELEVENLABS_HEDGE_BURST * 100;
+    }
+  } while (credited != tokens &&
+           !atomic_compare_exchange_weak(&http_pool->hedge_tokens, &tokens, credited));
+
+  uint32_t delay_ms = config->hedge_after_ms ? config->hedge_after_ms :
+                      atomic_load(&http_pool->ttfb_percentile_ms);
+  return apr_time_from_msec(delay_ms);
+}
+
+/**
+ * Spend budget on one hedge (worker thread); FALSE when there is none left
+ */
+apt_bool_t elevenlabs_http_pool_hedge_take(elevenlabs_http_pool_t *http_pool)
+{
+  unsigned tokens = atomic_load(&http_pool->hedge_tokens);
+  do {
+    if (tokens < 100) {
+      return FALSE;
+    }
+  } while (!atomic_compare_exchange_weak(&http_pool->hedge_tokens, &tokens, tokens - 100));
+  atomic_fetch_add(&http_pool->hedges_fired, 1);
+  return TRUE;
+}
+
+static int elevenlabs_http_pool_ms_cmp(const void *a, const void *b)
+{
+  unsigned x = *(const unsigned *)a;
+  unsigned y = *(const unsigned *)b;
+  return x < y ? -1 : x > y;
+}
+
+/**
+ * Record a request's time to first audio; the adaptive hedge delay is recomputed from
+ * the recent window every few samples
+ */
+void elevenlabs_http_pool_ttfb_record(elevenlabs_http_pool_t *http_pool, const elevenlabs_config_t *config,
+                                      apr_interval_time_t ttfb)
+{
+  if (!http_pool || !config || config->hedge_budget_percent == 0 || config->hedge_after_ms) {
+    return;
+  }
+  unsigned n = atomic_fetch_add(&http_pool->ttfb_count, 1) + 1;
+  atomic_store(&http_pool->ttfb_ms[(n - 1) % ELEVENLABS_TTFB_WINDOW], (unsigned)apr_time_as_msec(ttfb));
+  if (n < ELEVENLABS_HEDGE_MIN_SAMPLES || n % 8 != 0) {
+    return;
+  }
+  unsigned samples[ELEVENLABS_TTFB_WINDOW];
+  unsigned count = n < ELEVENLABS_TTFB_WINDOW ? n : ELEVENLABS_TTFB_WINDOW;
+  for (unsigned i = 0; i < count; i++) {
+    samples[i] = atomic_load(&http_pool->ttfb_ms[i]);
+  }
+  qsort(samples, count, sizeof(samples[0]), elevenlabs_http_pool_ms_cmp);
+  unsigned rank = (count * config->hedge_percentile + 99) / 100;
+  atomic_store(&http_pool->ttfb_percentile_ms, samples[rank > 0 ? rank - 1 : 0]);
+}
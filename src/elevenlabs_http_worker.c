@@ -0,0 +1,616 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_http_worker.c
+ * @brief curl_multi event loop threads for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+#include "elevenlabs_synth.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define WORKER_MAX_EVENTS     64
+#define WORKER_SWEEP_MS       250   /* Max epoll wait; also the idle-timeout check period */
+#define WARM_RETRY_MS         1000  /* Back-off before re-warming after a failure */
+
+/* Warm-up requests: a HEAD on base_url opens (or refreshes) the connection that
+   real requests on this loop will multiplex over. Runs on the worker thread only. */
+static void worker_warm_start(elevenlabs_http_worker_t *worker)
+{
+  const elevenlabs_config_t *config = worker->config;
+  if (!config || config->http_warm_connections == 0 || !config->base_url) {
+    return;
+  }
+  worker->warm_count = config->http_warm_connections;
+  worker->warm = apr_pcalloc(worker->pool, worker->warm_count * sizeof(elevenlabs_http_warm_t));
+  worker->warm_started = apr_time_now();
+  for (unsigned i = 0; i < worker->warm_count; i++) {
+    elevenlabs_http_warm_t *warm = &worker->warm[i];
+    warm->curl = curl_easy_init();
+    if (!warm->curl) {
+      continue;
+    }
+    elevenlabs_http_pool_setup_easy(worker->http_pool, warm->curl);
+    curl_easy_setopt(warm->curl, CURLOPT_URL, config->base_url);
+    curl_easy_setopt(warm->curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(warm->curl, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(warm->curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    curl_easy_setopt(warm->curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(warm->curl, CURLOPT_CONNECTTIMEOUT_MS, (long)config->connect_timeout_ms);
+    curl_easy_setopt(warm->curl, CURLOPT_TIMEOUT_MS, (long)config->connect_timeout_ms * 2);
+    curl_easy_setopt(warm->curl, CURLOPT_NOSIGNAL, 1L);
+    /* Extra warm handles only matter if each gets its own connection (HTTP/1.1 or
+       more streams than one HTTP/2 connection allows) */
+    if (i > 0) {
+      curl_easy_setopt(warm->curl, CURLOPT_FRESH_CONNECT, 1L);
+    }
+    warm->next_due = worker->warm_started;
+  }
+}
+
+/* Issue warm-up / keep-alive requests that are due */
+static void worker_warm_tick(elevenlabs_http_worker_t *worker, apr_time_t now)
+{
+  for (unsigned i = 0; i < worker->warm_count; i++) {
+    elevenlabs_http_warm_t *warm = &worker->warm[i];
+    if (!warm->curl || warm->in_flight || !warm->next_due || now < warm->next_due) {
+      continue;
+    }
+    if (curl_multi_add_handle(worker->multi, warm->curl) == CURLM_OK) {
+      warm->in_flight = TRUE;
+    } else {
+      warm->next_due = now + apr_time_from_msec(WARM_RETRY_MS);
+    }
+  }
+}
+
+static elevenlabs_http_warm_t *worker_warm_find(elevenlabs_http_worker_t *worker, CURL *easy)
+{
+  for (unsigned i = 0; i < worker->warm_count; i++) {
+    if (worker->warm[i].curl == easy) {
+      return &worker->warm[i];
+    }
+  }
+  return NULL;
+}
+
+/* A warm-up request finished: schedule the next keep-alive or a retry */
+static void worker_warm_done(elevenlabs_http_worker_t *worker, elevenlabs_http_warm_t *warm, CURLcode res)
+{
+  const elevenlabs_config_t *config = worker->config;
+  apr_time_t now = apr_time_now();
+  long new_connects = 0;
+  curl_easy_getinfo(warm->curl, CURLINFO_NUM_CONNECTS, &new_connects);
+  curl_multi_remove_handle(worker->multi, warm->curl);
+  warm->in_flight = FALSE;
+  /* Later requests on this handle should reuse whatever connection is alive */
+  curl_easy_setopt(warm->curl, CURLOPT_FRESH_CONNECT, 0L);
+
+  if (res == CURLE_OK) {
+    if (warm->failed || (warm->completed && new_connects > 0)) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+              "HTTP worker %u: connection re-warmed", worker->index);
+    }
+    warm->failed = FALSE;
+    warm->next_due = config->http_keepalive_interval_ms ?
+                     now + apr_time_from_msec(config->http_keepalive_interval_ms) : 0;
+  } else {
+    if (!warm->failed) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+              "HTTP worker %u: warm-up request failed: %s", worker->index, curl_easy_strerror(res));
+    }
+    warm->failed = TRUE;
+    warm->next_due = now + apr_time_from_msec(WARM_RETRY_MS);
+  }
+
+  if (!warm->completed) {
+    warm->completed = TRUE;
+    if (res == CURLE_OK) {
+      worker->warm_ready++;
+    }
+    if (++worker->warm_finished == worker->warm_count) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+              "HTTP worker %u: warm-up took %ld ms (%u/%u connections ready)",
+              worker->index, (long)apr_time_as_msec(now - worker->warm_started),
+              worker->warm_ready, worker->warm_count);
+    }
+  }
+}
+
+static void worker_warm_cleanup(elevenlabs_http_worker_t *worker)
+{
+  for (unsigned i = 0; i < worker->warm_count; i++) {
+    elevenlabs_http_warm_t *warm = &worker->warm[i];
+    if (!warm->curl) {
+      continue;
+    }
+    if (warm->in_flight) {
+      curl_multi_remove_handle(worker->multi, warm->curl);
+    }
+    curl_easy_cleanup(warm->curl);
+    warm->curl = NULL;
+  }
+  worker->warm_count = 0;
+}
+
+/* libcurl socket callback: mirror the sockets libcurl wants watched into epoll */
+static int worker_socket_cb(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp)
+{
+  elevenlabs_http_worker_t *worker = (elevenlabs_http_worker_t *)userp;
+
+  if (what == CURL_POLL_REMOVE) {
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, s, NULL);
+    return 0;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.data.fd = s;
+  if (what & CURL_POLL_IN) ev.events |= EPOLLIN;
+  if (what & CURL_POLL_OUT) ev.events |= EPOLLOUT;
+
+  if (socketp) {
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, s, &ev);
+  } else {
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, s, &ev) != 0) {
+      epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, s, &ev);
+    }
+    curl_multi_assign(worker->multi, s, worker);
+  }
+  return 0;
+}
+
+/* libcurl timer callback: remember when curl wants CURL_SOCKET_TIMEOUT driven */
+static int worker_timer_cb(CURLM *multi, long timeout_ms, void *userp)
+{
+  elevenlabs_http_worker_t *worker = (elevenlabs_http_worker_t *)userp;
+  if (timeout_ms < 0) {
+    worker->timer_armed = FALSE;
+  } else {
+    worker->timer_armed = TRUE;
+    worker->timer_deadline = apr_time_now() + apr_time_from_msec(timeout_ms);
+  }
+  return 0;
+}
+
+static void worker_link(elevenlabs_http_client_t **list, elevenlabs_http_client_t *client)
+{
+  client->active_next = *list;
+  *list = client;
+}
+
+static void worker_unlink(elevenlabs_http_client_t **list, elevenlabs_http_client_t *client)
+{
+  for (elevenlabs_http_client_t **pp = list; *pp; pp = &(*pp)->active_next) {
+    if (*pp == client) {
+      *pp = client->active_next;
+      client->active_next = NULL;
+      return;
+    }
+  }
+}
+
+/* Take the client's hedged duplicate out of the multi handle */
+static void worker_hedge_drop(elevenlabs_http_worker_t *worker, elevenlabs_http_client_t *client)
+{
+  if (client->hedge_attached) {
+    curl_multi_remove_handle(worker->multi, client->hedge_curl);
+    client->hedge_attached = FALSE;
+  }
+}
+
+/* Detach the client from this loop and hand the result back to the HTTP client */
+static void worker_finish(elevenlabs_http_worker_t *worker, elevenlabs_http_client_t *client, CURLcode res)
+{
+  if (client->attached && client->hedge_state == ELEVENLABS_HEDGE_RACING && client->hedge_attached &&
+      !client->hedge_http_error && !client->stopped && res != CURLE_OPERATION_TIMEDOUT &&
+      (res != CURLE_OK || client->http_error)) {
+    /* The original failed before any audio: its duplicate carries on as the request */
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+            "Request failed (%s), continuing with its hedged duplicate",
+            res != CURLE_OK ? curl_easy_strerror(res) : "HTTP error");
+    curl_multi_remove_handle(worker->multi, client->curl);
+    elevenlabs_http_client_hedge_promote(client);
+    client->hedge_attached = FALSE;
+    return;
+  }
+  worker_hedge_drop(worker, client);
+  if (client->attached) {
+    long new_connects = 0;
+    curl_easy_getinfo(client->curl, CURLINFO_NUM_CONNECTS, &new_connects);
+    if (client->request_count++ == 0) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+              "First request of session %s (HTTP worker %u, %u warm)",
+              new_connects > 0 ? "opened a new connection" : "reused a warm connection",
+              worker->index, worker->warm_ready);
+    }
+    elevenlabs_http_pool_record(client->http_pool, client->curl);
+    curl_multi_remove_handle(worker->multi, client->curl);
+    worker_unlink(&worker->transfers, client);
+    client->attached = FALSE;
+  }
+  elevenlabs_http_client_complete(client, res);
+}
+
+/* Apply submissions, stops and resumes queued by other threads */
+static void worker_apply_pending(elevenlabs_http_worker_t *worker)
+{
+  apr_thread_mutex_lock(worker->mutex);
+  elevenlabs_http_client_t *client = worker->pending;
+  worker->pending = NULL;
+  apr_thread_mutex_unlock(worker->mutex);
+
+  while (client) {
+    /* Read the link before clearing the flag: once cleared, the client may be queued again */
+    apr_thread_mutex_lock(worker->mutex);
+    elevenlabs_http_client_t *next = client->pending_next;
+    client->pending_queued = FALSE;
+    apr_thread_mutex_unlock(worker->mutex);
+
+    apr_thread_mutex_lock(client->mutex);
+    if (elevenlabs_flight_abandoned(client->flight)) {
+      /* Every subscriber left a shared download that fills no cache file */
+      client->stopped = TRUE;
+    }
+    apt_bool_t busy = client->busy;
+    apt_bool_t stopped = client->stopped;
+    apt_bool_t io_pending = client->io_pending;
+    apr_thread_mutex_unlock(client->mutex);
+
+    if (!busy || io_pending) {
+      /* Nothing in flight (already completed), or still owned by a cache lookup */
+    } else if (stopped) {
+      worker_finish(worker, client, CURLE_ABORTED_BY_CALLBACK);
+    } else if (!client->attached) {
+      CURLMcode mc = curl_multi_add_handle(worker->multi, client->curl);
+      if (mc != CURLM_OK) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR,
+                "HTTP worker %u: failed to add transfer: %s", worker->index, curl_multi_strerror(mc));
+        elevenlabs_http_client_complete(client, CURLE_FAILED_INIT);
+      } else {
+        worker_link(&worker->transfers, client);
+        client->attached = TRUE;
+      }
+    } else if (atomic_exchange(&client->resume_requested, 0)) {
+      atomic_store(&client->paused, 0);
+      client->last_data_time = apr_time_now();
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+              "Audio buffer below low water, resuming transfer");
+      curl_easy_pause(client->curl, CURLPAUSE_CONT);
+    }
+    client = next;
+  }
+}
+
+/* Finish transfers libcurl reports as done */
+static void worker_collect_done(elevenlabs_http_worker_t *worker)
+{
+  CURLMsg *msg;
+  int msgs_left = 0;
+  while ((msg = curl_multi_info_read(worker->multi, &msgs_left))) {
+    if (msg->msg != CURLMSG_DONE) {
+      continue;
+    }
+    CURL *easy = msg->easy_handle;
+    CURLcode res = msg->data.result;
+    elevenlabs_http_client_t *client = NULL;
+    curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **)&client);
+    elevenlabs_http_warm_t *warm = NULL;
+    if (client && easy == client->hedge_curl) {
+      /* The duplicate ended first: it failed, or was cut off after losing */
+      worker_hedge_drop(worker, client);
+      if (client->hedge_state == ELEVENLABS_HEDGE_RACING) {
+        client->hedge_state = ELEVENLABS_HEDGE_LOST;
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+                "Hedged request ended without audio (%s), keeping the original", curl_easy_strerror(res));
+      }
+    } else if (client) {
+      worker_finish(worker, client, res);
+    } else if ((warm = worker_warm_find(worker, easy))) {
+      worker_warm_done(worker, warm, res);
+    } else {
+      curl_multi_remove_handle(worker->multi, easy);
+    }
+  }
+}
+
+/* Send the duplicate of each request whose first audio is overdue, if the budget allows,
+   and drop the transfer that lost a race. Notes the next deadline for epoll_wait. */
+static void worker_hedge_tick(elevenlabs_http_worker_t *worker, apr_time_t now)
+{
+  worker->hedge_next = 0;
+  for (elevenlabs_http_client_t *client = worker->transfers; client; client = client->active_next) {
+    if (client->hedge_state == ELEVENLABS_HEDGE_LOST || client->hedge_state == ELEVENLABS_HEDGE_WON) {
+      worker_hedge_drop(worker, client);
+    }
+    if (!client->hedge_deadline) {
+      continue;
+    }
+    if (client->first_chunk_logged || client->stopped || client->http_error) {
+      client->hedge_deadline = 0;
+      continue;
+    }
+    if (now < client->hedge_deadline) {
+      if (!worker->hedge_next || client->hedge_deadline < worker->hedge_next) {
+        worker->hedge_next = client->hedge_deadline;
+      }
+      continue;
+    }
+    client->hedge_deadline = 0;
+    if (!elevenlabs_http_pool_hedge_take(worker->http_pool)) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG, "Hedge budget exhausted, not duplicating request");
+      continue;
+    }
+    CURL *hedge = elevenlabs_http_client_hedge_prepare(client);
+    if (hedge && curl_multi_add_handle(worker->multi, hedge) == CURLM_OK) {
+      client->hedge_attached = TRUE;
+      client->hedge_state = ELEVENLABS_HEDGE_RACING;
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+              "No audio %ld ms after request start, sending hedged duplicate",
+              (long)apr_time_as_msec(now - client->start_time));
+    }
+  }
+}
+
+/* Free released clients nothing holds any more: no request on this loop or on an I/O
+   worker, and no notification still queued here. Nothing queues a released client once
+   it is idle, so busy is read first. When the loop exits, its requests are cut off. */
+static void worker_reap(elevenlabs_http_worker_t *worker, apt_bool_t exiting)
+{
+  apr_thread_mutex_lock(worker->mutex);
+  elevenlabs_http_client_t *client = worker->reaping;
+  worker->reaping = NULL;
+  apr_thread_mutex_unlock(worker->mutex);
+
+  elevenlabs_http_client_t *keep = NULL;
+  while (client) {
+    elevenlabs_http_client_t *next = client->reap_next;
+    if (exiting && client->attached) {
+      worker_finish(worker, client, CURLE_ABORTED_BY_CALLBACK);
+    }
+    apr_thread_mutex_lock(client->mutex);
+    apt_bool_t busy = client->busy;
+    apr_thread_mutex_unlock(client->mutex);
+    apr_thread_mutex_lock(worker->mutex);
+    apt_bool_t queued = client->pending_queued;
+    apr_thread_mutex_unlock(worker->mutex);
+
+    if (busy || queued) {
+      client->reap_next = keep;
+      keep = client;
+    } else {
+      elevenlabs_http_client_free(client);
+    }
+    client = next;
+  }
+
+  if (keep) {
+    /* Looked at again next iteration, at the latest after a sweep period */
+    apr_thread_mutex_lock(worker->mutex);
+    elevenlabs_http_client_t *tail = keep;
+    while (tail->reap_next) {
+      tail = tail->reap_next;
+    }
+    tail->reap_next = worker->reaping;
+    worker->reaping = keep;
+    apr_thread_mutex_unlock(worker->mutex);
+  }
+}
+
+/* read_timeout_ms is an idle timeout; a paused transfer is never idle */
+static void worker_sweep_idle(elevenlabs_http_worker_t *worker, apr_time_t now)
+{
+  elevenlabs_http_client_t *client = worker->transfers;
+  while (client) {
+    elevenlabs_http_client_t *next = client->active_next;
+    if (!atomic_load(&client->paused) && client->config &&
+        now - client->last_data_time > apr_time_from_msec(client->config->read_timeout_ms)) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR,
+              "No audio received for %u ms, aborting transfer", client->config->read_timeout_ms);
+      worker_finish(worker, client, CURLE_OPERATION_TIMEDOUT);
+    }
+    client = next;
+  }
+}
+
+static void* APR_THREAD_FUNC elevenlabs_http_worker_run(apr_thread_t *thd, void *data)
+{
+  elevenlabs_http_worker_t *worker = (elevenlabs_http_worker_t *)data;
+  struct epoll_event events[WORKER_MAX_EVENTS];
+  apr_time_t last_sweep = apr_time_now();
+  int running_handles = 0;
+
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG, "HTTP worker %u started", worker->index);
+  worker_warm_start(worker);
+
+  while (atomic_load(&worker->running)) {
+    apr_time_t now = apr_time_now();
+    long wait_ms = WORKER_SWEEP_MS;
+    if (worker->timer_armed) {
+      long timer_ms = worker->timer_deadline > now ? (long)apr_time_as_msec(worker->timer_deadline - now) : 0;
+      if (timer_ms < wait_ms) {
+        wait_ms = timer_ms;
+      }
+    }
+    if (worker->hedge_next) {
+      long hedge_ms = worker->hedge_next > now ? (long)apr_time_as_msec(worker->hedge_next - now) + 1 : 0;
+      if (hedge_ms < wait_ms) {
+        wait_ms = hedge_ms;
+      }
+    }
+
+    int n = epoll_wait(worker->epoll_fd, events, WORKER_MAX_EVENTS, (int)wait_ms);
+    for (int i = 0; i < n; i++) {
+      int fd = events[i].data.fd;
+      if (fd == worker->wake_fd) {
+        uint64_t count;
+        if (read(worker->wake_fd, &count, sizeof(count)) < 0) {
+          /* Nothing to drain */
+        }
+        continue;
+      }
+      int flags = 0;
+      if (events[i].events & EPOLLIN) flags |= CURL_CSELECT_IN;
+      if (events[i].events & EPOLLOUT) flags |= CURL_CSELECT_OUT;
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) flags |= CURL_CSELECT_ERR;
+      curl_multi_socket_action(worker->multi, fd, flags, &running_handles);
+    }
+
+    now = apr_time_now();
+    if (worker->timer_armed && now >= worker->timer_deadline) {
+      /* The callback may re-arm the timer during the action */
+      worker->timer_armed = FALSE;
+      curl_multi_socket_action(worker->multi, CURL_SOCKET_TIMEOUT, 0, &running_handles);
+    }
+
+    worker_apply_pending(worker);
+    worker_warm_tick(worker, now);
+    worker_collect_done(worker);
+    worker_hedge_tick(worker, apr_time_now());
+    worker_reap(worker, FALSE);
+
+    if (now - last_sweep >= apr_time_from_msec(WORKER_SWEEP_MS)) {
+      last_sweep = now;
+      worker_sweep_idle(worker, now);
+    }
+  }
+
+  /* Channels are gone: stops still queued are applied, then their clients freed */
+  worker_apply_pending(worker);
+  worker_reap(worker, TRUE);
+  worker_warm_cleanup(worker);
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG, "HTTP worker %u exiting", worker->index);
+  return NULL;
+}
+
+/**
+ * Create and start one HTTP worker thread with its own curl_multi handle
+ */
+elevenlabs_http_worker_t *elevenlabs_http_worker_create(unsigned index,
+                                                        elevenlabs_http_pool_t *http_pool,
+                                                        const elevenlabs_config_t *config,
+                                                        apr_pool_t *pool)
+{
+  elevenlabs_http_worker_t *worker = apr_pcalloc(pool, sizeof(elevenlabs_http_worker_t));
+  if (!worker) {
+    return NULL;
+  }
+  worker->index = index;
+  worker->http_pool = http_pool;
+  worker->config = config;
+  worker->pool = pool;
+  worker->epoll_fd = -1;
+  worker->wake_fd = -1;
+  atomic_init(&worker->running, 1);
+
+  worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  worker->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  worker->multi = curl_multi_init();
+  if (worker->epoll_fd < 0 || worker->wake_fd < 0 || !worker->multi) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "HTTP worker %u: failed to create event loop", index);
+    atomic_store(&worker->running, 0);
+    elevenlabs_http_worker_destroy(worker);
+    return NULL;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = worker->wake_fd;
+  epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->wake_fd, &ev);
+
+  curl_multi_setopt(worker->multi, CURLMOPT_SOCKETFUNCTION, worker_socket_cb);
+  curl_multi_setopt(worker->multi, CURLMOPT_SOCKETDATA, worker);
+  curl_multi_setopt(worker->multi, CURLMOPT_TIMERFUNCTION, worker_timer_cb);
+  curl_multi_setopt(worker->multi, CURLMOPT_TIMERDATA, worker);
+  /* Transfers on this loop share its connection cache and multiplex over HTTP/2 */
+  curl_multi_setopt(worker->multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+
+  apr_thread_mutex_create(&worker->mutex, APR_THREAD_MUTEX_DEFAULT, pool);
+
+  if (apr_thread_create(&worker->thread, NULL, elevenlabs_http_worker_run, worker, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "HTTP worker %u: failed to create thread", index);
+    worker->thread = NULL;
+    atomic_store(&worker->running, 0);
+    elevenlabs_http_worker_destroy(worker);
+    return NULL;
+  }
+  return worker;
+}
+
+/**
+ * Stop the worker thread and release its event loop. Clients must be detached.
+ */
+void elevenlabs_http_worker_destroy(elevenlabs_http_worker_t *worker)
+{
+  if (!worker) {
+    return;
+  }
+  if (worker->thread) {
+    apr_status_t rv = APR_SUCCESS;
+    atomic_store(&worker->running, 0);
+    uint64_t one = 1;
+    if (write(worker->wake_fd, &one, sizeof(one)) < 0) {
+      /* Loop still exits on its next sweep */
+    }
+    apr_thread_join(&rv, worker->thread);
+    worker->thread = NULL;
+  }
+  if (worker->multi) {
+    curl_multi_cleanup(worker->multi);
+    worker->multi = NULL;
+  }
+  if (worker->wake_fd >= 0) {
+    close(worker->wake_fd);
+    worker->wake_fd = -1;
+  }
+  if (worker->epoll_fd >= 0) {
+    close(worker->epoll_fd);
+    worker->epoll_fd = -1;
+  }
+  if (worker->mutex) {
+    apr_thread_mutex_destroy(worker->mutex);
+    worker->mutex = NULL;
+  }
+}
+
+/**
+ * Queue a client for the worker to look at (submit, stop or resume) and wake the loop
+ */
+void elevenlabs_http_worker_notify(elevenlabs_http_worker_t *worker, elevenlabs_http_client_t *client)
+{
+  if (!worker || !client) {
+    return;
+  }
+  apr_thread_mutex_lock(worker->mutex);
+  if (!client->pending_queued) {
+    client->pending_queued = TRUE;
+    client->pending_next = worker->pending;
+    worker->pending = client;
+  }
+  apr_thread_mutex_unlock(worker->mutex);
+
+  uint64_t one = 1;
+  if (write(worker->wake_fd, &one, sizeof(one)) < 0) {
+    /* Counter saturated: the loop is already due to wake */
+  }
+}
+
+/**
+ * Hand a released client to the worker, which frees it once it is idle
+ */
+void elevenlabs_http_worker_reap(elevenlabs_http_worker_t *worker, elevenlabs_http_client_t *client)
+{
+  apr_thread_mutex_lock(worker->mutex);
+  client->reap_next = worker->reaping;
+  worker->reaping = client;
+  apr_thread_mutex_unlock(worker->mutex);
+
+  /* Also drops a request still attached to the loop */
+  elevenlabs_http_worker_notify(worker, client);
+}
@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_manifest.c
+ * @brief Prompt manifests and cache preload for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+#include "elevenlabs_synth.h"
+#include "apr_strings.h"
+#include "apr_file_io.h"
+#include <string.h>
+
+/* One manifest field: empty or "-" means "as configured" */
+static const char* elevenlabs_manifest_field(apr_pool_t *pool, const char *start, const char *end)
+{
+  if (end == start || (end - start == 1 && *start == '-')) {
+    return NULL;
+  }
+  return apr_pstrndup(pool, start, (apr_size_t)(end - start));
+}
+
+/* Load a prompt manifest: one prompt per line, either just the text or
+     voice_id <TAB> model_id <TAB> output_format <TAB> text
+   with empty or "-" fields meaning the configured value. A leading '*' marks a hot
+   prompt; '#' starts a comment line. Returns NULL if the file cannot be read. */
+apr_array_header_t* elevenlabs_manifest_load(apr_pool_t *pool, const char *path)
+{
+  apr_file_t *file;
+  if (!path || apr_file_open(&file, path, APR_FOPEN_READ | APR_FOPEN_BUFFERED, APR_OS_DEFAULT, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Cannot open prompt manifest: %s", path ? path : "(null)");
+    return NULL;
+  }
+
+  apr_array_header_t *entries = apr_array_make(pool, 64, sizeof(elevenlabs_manifest_entry_t));
+  char line[8192];
+  unsigned line_no = 0;
+  while (apr_file_gets(line, sizeof(line), file) == APR_SUCCESS) {
+    line_no++;
+    apr_size_t len = strlen(line);
+    if (len == sizeof(line) - 1 && line[len - 1] != '\n') {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "%s:%u: line too long, skipped", path, line_no);
+      while (apr_file_gets(line, sizeof(line), file) == APR_SUCCESS && line[strlen(line) - 1] != '\n') {
+        /* Skip the rest of it */
+      }
+      continue;
+    }
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+      line[--len] = '\0';
+    }
+    const char *p = line;
+    if (*p == '#' || *p == '\0') {
+      continue;
+    }
+
+    elevenlabs_manifest_entry_t entry = { NULL, NULL, NULL, NULL, FALSE };
+    if (*p == '*') {
+      entry.hot = TRUE;
+      p++;
+    }
+    const char *tab1 = strchr(p, '\t');
+    const char *tab2 = tab1 ? strchr(tab1 + 1, '\t') : NULL;
+    const char *tab3 = tab2 ? strchr(tab2 + 1, '\t') : NULL;
+    if (tab3) {
+      entry.voice_id = elevenlabs_manifest_field(pool, p, tab1);
+      entry.model_id = elevenlabs_manifest_field(pool, tab1 + 1, tab2);
+      entry.output_format = elevenlabs_manifest_field(pool, tab2 + 1, tab3);
+      p = tab3 + 1;
+    } else if (tab1) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+              "%s:%u: expected voice, model, format and text separated by tabs, skipped", path, line_no);
+      continue;
+    }
+    if (*p == '\0') {
+      continue;
+    }
+    entry.text = apr_pstrdup(pool, p);
+    APR_ARRAY_PUSH(entries, elevenlabs_manifest_entry_t) = entry;
+  }
+  apr_file_close(file);
+
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "Loaded %d prompts from manifest %s", entries->nelts, path);
+  return entries;
+}
+
+/* The configuration an entry is synthesized with: config with the entry's model and
+   format, which are part of the cache key */
+const elevenlabs_config_t* elevenlabs_manifest_config(apr_pool_t *pool, const elevenlabs_config_t *config,
+                                                      const elevenlabs_manifest_entry_t *entry)
+{
+  if (!entry->model_id && !entry->output_format) {
+    return config;
+  }
+  elevenlabs_config_t *entry_config = apr_palloc(pool, sizeof(elevenlabs_config_t));
+  *entry_config = *config;
+  if (entry->model_id) {
+    entry_config->model_id = (char *)entry->model_id;
+  }
+  if (entry->output_format) {
+    entry_config->output_format = (char *)entry->output_format;
+  }
+  return entry_config;
+}
+
+/* Map the cached files of the hot prompts into the memory tier. Runs at engine open on
+   the I/O workers; prompts not on disk yet are skipped (see the warm-up tool). With
+   segmentation on, prompts are cached per segment, so each segment is loaded. */
+void elevenlabs_cache_preload(apr_pool_t *pool, const elevenlabs_config_t *config,
+                              const apr_array_header_t *entries, elevenlabs_cache_disk_t *disk_cache,
+                              elevenlabs_cache_memory_t *memory_cache, apr_thread_pool_t *io_pool)
+{
+  if (!entries || !memory_cache || !io_pool) {
+    return;
+  }
+  unsigned hot = 0;
+  unsigned loaded = 0;
+  for (int i = 0; i < entries->nelts; i++) {
+    const elevenlabs_manifest_entry_t *entry = &APR_ARRAY_IDX(entries, i, elevenlabs_manifest_entry_t);
+    if (!entry->hot) {
+      continue;
+    }
+    hot++;
+    const elevenlabs_config_t *entry_config = elevenlabs_manifest_config(pool, config, entry);
+    unsigned count = 0;
+    char **segments = elevenlabs_text_segment(pool, entry->text, entry_config, &count);
+    for (unsigned j = 0; j < count; j++) {
+      char *key = NULL;
+      if (!elevenlabs_cache_request_key(pool, entry_config, entry->voice_id, segments[j], &key) ||
+          (disk_cache && !elevenlabs_cache_disk_lookup(disk_cache, key))) {
+        continue;
+      }
+      const char *path = apr_psprintf(pool, "%s/%s%s", config->cache_dir, key,
+                                      elevenlabs_cache_file_ext(entry_config->output_format));
+      elevenlabs_cache_memory_fill(memory_cache, io_pool, path, key);
+      loaded++;
+    }
+  }
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+          "Preloading %u cached files of %u hot prompts into memory", loaded, hot);
+}
@@ -0,0 +1,349 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_metrics.c
+ * @brief Engine-wide metrics and their Prometheus text export for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* Counters are plain atomics bumped with relaxed ordering, and histograms have fixed
+   buckets, so recording from the media thread costs a few uncontended increments and
+   never a lock. Most counters already live in the modules that own them (HTTP pool,
+   memory cache, single-flight registry, engine synthesis stats); this file holds the
+   rest and renders all of them.
+
+   The export is a Prometheus text file rewritten every metrics_interval_ms under a
+   temporary name and renamed into place, for node_exporter's textfile collector or
+   anything else that can read a file. */
+
+#include "elevenlabs_synth.h"
+#include "apr_strings.h"
+#include "apr_file_io.h"
+#include <string.h>
+
+/* Request-to-first-audio and SPEAK-to-first-audio: API latency, tens of ms to seconds */
+static const unsigned elevenlabs_latency_bounds[ELEVENLABS_HISTOGRAM_BUCKETS] = {
+  50, 100, 150, 200, 300, 400, 500, 750, 1000, 1500, 2500, 5000
+};
+
+/* STOP to its response: a handful of ms at most, well under a 20 ms frame */
+static const unsigned elevenlabs_control_bounds[ELEVENLABS_HISTOGRAM_BUCKETS] = {
+  1, 2, 3, 5, 10, 20, 40, 100, 250, 500, 1000, 2500
+};
+
+/* Whole transfers: with backpressure they last about as long as the utterance plays */
+static const unsigned elevenlabs_duration_bounds[ELEVENLABS_HISTOGRAM_BUCKETS] = {
+  250, 500, 1000, 2000, 3000, 5000, 7500, 10000, 15000, 20000, 30000, 60000
+};
+
+/* Statuses the API answers with, counted under their own label */
+static const long elevenlabs_metrics_http_codes[ELEVENLABS_METRICS_HTTP_CODES] = {
+  400, 401, 402, 403, 404, 409, 422, 429, 500, 502, 503, 504
+};
+
+/**
+ * Create zeroed metrics; the writer is started separately once the engine is open
+ */
+elevenlabs_metrics_t* elevenlabs_metrics_create(apr_pool_t *pool)
+{
+  elevenlabs_metrics_t *metrics = apr_pcalloc(pool, sizeof(elevenlabs_metrics_t));
+  metrics->pool = pool;
+  metrics->ttfb.bounds = elevenlabs_latency_bounds;
+  metrics->synthesis.bounds = elevenlabs_duration_bounds;
+  metrics->first_audio.bounds = elevenlabs_latency_bounds;
+  metrics->stop.bounds = elevenlabs_control_bounds;
+  metrics->barge_in.bounds = elevenlabs_control_bounds;
+  /* Every counter starts at zero from apr_pcalloc */
+  return metrics;
+}
+
+/* Count a value in its bucket; safe from any thread */
+void elevenlabs_histogram_observe(elevenlabs_histogram_t *histogram, apr_interval_time_t value)
+{
+  unsigned long ms = value > 0 ? (unsigned long)apr_time_as_msec(value) : 0;
+  unsigned i = 0;
+  while (i < ELEVENLABS_HISTOGRAM_BUCKETS && ms > histogram->bounds[i]) {
+    i++;
+  }
+  atomic_fetch_add_explicit(&histogram->counts[i], 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&histogram->sum_ms, ms, memory_order_relaxed);
+}
+
+/* Outcome of an HTTP synthesis request, from elevenlabs_http_client_complete() */
+void elevenlabs_metrics_request_done(elevenlabs_metrics_t *metrics, CURLcode res, long http_code,
+                                     apr_interval_time_t elapsed)
+{
+  if (!metrics) {
+    return;
+  }
+  atomic_fetch_sub_explicit(&metrics->requests_active, 1, memory_order_relaxed);
+  if (res == CURLE_ABORTED_BY_CALLBACK) {
+    ELEVENLABS_METRIC_ADD(metrics, requests_stopped, 1);
+  } else if (res == CURLE_OPERATION_TIMEDOUT) {
+    ELEVENLABS_METRIC_ADD(metrics, requests_timeout, 1);
+  } else if (res != CURLE_OK) {
+    ELEVENLABS_METRIC_ADD(metrics, requests_failed, 1);
+  } else if (http_code != 200) {
+    unsigned i = 0;
+    while (i < ELEVENLABS_METRICS_HTTP_CODES && elevenlabs_metrics_http_codes[i] != http_code) {
+      i++;
+    }
+    ELEVENLABS_METRIC_ADD(metrics, http_errors[i], 1);
+  } else {
+    ELEVENLABS_METRIC_ADD(metrics, requests_ok, 1);
+    elevenlabs_histogram_observe(&metrics->synthesis, elapsed);
+  }
+}
+
+static void metrics_family(apr_array_header_t *out, const char *name, const char *type, const char *help)
+{
+  APR_ARRAY_PUSH(out, const char *) = apr_psprintf(out->pool, "# HELP %s %s\n# TYPE %s %s\n",
+                                                   name, help, name, type);
+}
+
+static void metrics_sample(apr_array_header_t *out, const char *name, const char *labels, unsigned long value)
+{
+  APR_ARRAY_PUSH(out, const char *) = apr_psprintf(out->pool, "%s%s %lu\n", name, labels ? labels : "", value);
+}
+
+static void metrics_counter(apr_array_header_t *out, const char *name, const char *help, unsigned long value)
+{
+  metrics_family(out, name, "counter", help);
+  metrics_sample(out, name, NULL, value);
+}
+
+static void metrics_gauge(apr_array_header_t *out, const char *name, const char *help, long value)
+{
+  metrics_family(out, name, "gauge", help);
+  APR_ARRAY_PUSH(out, const char *) = apr_psprintf(out->pool, "%s %ld\n", name, value);
+}
+
+/* Buckets are kept per range; Prometheus wants them cumulative, in seconds */
+static void metrics_histogram(apr_array_header_t *out, const char *name, const char *help,
+                              const elevenlabs_histogram_t *histogram)
+{
+  metrics_family(out, name, "histogram", help);
+  unsigned long count = 0;
+  for (unsigned i = 0; i <= ELEVENLABS_HISTOGRAM_BUCKETS; i++) {
+    count += atomic_load_explicit(&histogram->counts[i], memory_order_relaxed);
+    const char *le = i < ELEVENLABS_HISTOGRAM_BUCKETS ?
+                     apr_psprintf(out->pool, "%g", histogram->bounds[i] / 1000.0) : "+Inf";
+    APR_ARRAY_PUSH(out, const char *) = apr_psprintf(out->pool, "%s_bucket{le=\"%s\"} %lu\n", name, le, count);
+  }
+  APR_ARRAY_PUSH(out, const char *) = apr_psprintf(out->pool, "%s_sum %.3f\n%s_count %lu\n", name,
+      atomic_load_explicit(&histogram->sum_ms, memory_order_relaxed) / 1000.0, name, count);
+}
+
+/**
+ * Snapshot of every engine metric in Prometheus text format
+ */
+char* elevenlabs_metrics_render(apr_pool_t *pool, const elevenlabs_synth_engine_t *engine)
+{
+  const elevenlabs_metrics_t *metrics = engine->metrics;
+  apr_array_header_t *out = apr_array_make(pool, 128, sizeof(const char *));
+
+  metrics_histogram(out, "elevenlabs_http_ttfb_seconds",
+                    "Time from sending a synthesis request to its first audio byte.", &metrics->ttfb);
+  metrics_histogram(out, "elevenlabs_http_synthesis_seconds",
+                    "Time from sending a synthesis request to the end of its successful transfer.",
+                    &metrics->synthesis);
+  metrics_histogram(out, "elevenlabs_speak_first_audio_seconds",
+                    "Time from SPEAK to the first audio frame played.", &metrics->first_audio);
+  metrics_histogram(out, "elevenlabs_stop_response_seconds",
+                    "Time from a STOP reaching the engine to its response.", &metrics->stop);
+  metrics_histogram(out, "elevenlabs_barge_in_silence_seconds",
+                    "Time from a BARGE-IN-OCCURRED reaching the engine to the first silent frame.",
+                    &metrics->barge_in);
+
+  metrics_counter(out, "elevenlabs_http_requests_total", "HTTP synthesis requests sent.",
+                  atomic_load(&metrics->requests));
+  metrics_family(out, "elevenlabs_http_responses_total", "counter",
+                 "Ended HTTP synthesis requests by outcome, except HTTP errors (see elevenlabs_http_errors_total).");
+  metrics_sample(out, "elevenlabs_http_responses_total", "{result=\"ok\"}", atomic_load(&metrics->requests_ok));
+  metrics_sample(out, "elevenlabs_http_responses_total", "{result=\"stopped\"}",
+                 atomic_load(&metrics->requests_stopped));
+  metrics_sample(out, "elevenlabs_http_responses_total", "{result=\"timeout\"}",
+                 atomic_load(&metrics->requests_timeout));
+  metrics_sample(out, "elevenlabs_http_responses_total", "{result=\"error\"}",
+                 atomic_load(&metrics->requests_failed));
+  metrics_family(out, "elevenlabs_http_errors_total", "counter", "Synthesis requests answered with an HTTP error.");
+  for (unsigned i = 0; i <= ELEVENLABS_METRICS_HTTP_CODES; i++) {
+    const char *labels = i < ELEVENLABS_METRICS_HTTP_CODES ?
+                         apr_psprintf(pool, "{code=\"%ld\"}", elevenlabs_metrics_http_codes[i]) : "{code=\"other\"}";
+    metrics_sample(out, "elevenlabs_http_errors_total", labels, atomic_load(&metrics->http_errors[i]));
+  }
+  metrics_gauge(out, "elevenlabs_http_requests_active", "HTTP synthesis requests in flight.",
+                atomic_load(&metrics->requests_active));
+  metrics_counter(out, "elevenlabs_http_audio_bytes_total",
+                  "Audio bytes received from the API, as encoded on the wire.", atomic_load(&metrics->audio_bytes));
+
+  const elevenlabs_http_pool_t *http_pool = engine->http_pool;
+  if (http_pool) {
+    metrics_counter(out, "elevenlabs_http_hedges_total",
+                    "Duplicates sent for requests whose first audio was late.", atomic_load(&http_pool->hedges_fired));
+    metrics_counter(out, "elevenlabs_http_hedges_won_total",
+                    "Hedged duplicates that delivered audio first.", atomic_load(&http_pool->hedges_won));
+    metrics_family(out, "elevenlabs_http_connections_total", "counter", "Transfers by connection used.");
+    metrics_sample(out, "elevenlabs_http_connections_total", "{kind=\"new\"}",
+                   atomic_load(&http_pool->connections_new));
+    metrics_sample(out, "elevenlabs_http_connections_total", "{kind=\"reused\"}",
+                   atomic_load(&http_pool->connections_reused));
+  }
+
+  metrics_family(out, "elevenlabs_cache_lookups_total", "counter", "Synthesis requests by where the audio came from.");
+  metrics_sample(out, "elevenlabs_cache_lookups_total", "{result=\"memory_hit\"}",
+                 atomic_load(&metrics->cache_hits_memory));
+  metrics_sample(out, "elevenlabs_cache_lookups_total", "{result=\"disk_hit\"}",
+                 atomic_load(&metrics->cache_hits_disk));
+  metrics_sample(out, "elevenlabs_cache_lookups_total", "{result=\"miss\"}", atomic_load(&metrics->cache_misses));
+  if (engine->memory_cache) {
+    metrics_counter(out, "elevenlabs_cache_memory_evictions_total", "Blobs evicted from the memory tier.",
+                    atomic_load(&engine->memory_cache->evictions));
+  }
+  if (engine->flights) {
+    metrics_counter(out, "elevenlabs_cache_flights_total", "Shared downloads started for uncached prompts.",
+                    atomic_load(&engine->flights->started));
+    metrics_counter(out, "elevenlabs_cache_flights_joined_total",
+                    "Misses served by a shared download already running.", atomic_load(&engine->flights->joined));
+  }
+
+  const elevenlabs_slab_t *slab = engine->audio_slab;
+  if (slab) {
+    unsigned long in_use = atomic_load(&slab->in_use);
+    unsigned long spare = atomic_load(&slab->spare);
+    metrics_family(out, "elevenlabs_audio_pool_bytes", "gauge",
+                   "Audio ring storage taken from the heap, by whether a ring holds it.");
+    metrics_sample(out, "elevenlabs_audio_pool_bytes", "{state=\"in_use\"}", in_use * ELEVENLABS_AUDIO_BLOCK_SIZE);
+    metrics_sample(out, "elevenlabs_audio_pool_bytes", "{state=\"spare\"}", spare * ELEVENLABS_AUDIO_BLOCK_SIZE);
+    metrics_gauge(out, "elevenlabs_audio_pool_peak_bytes", "Most audio ring storage in use at once.",
+                  (long)(atomic_load(&slab->peak) * ELEVENLABS_AUDIO_BLOCK_SIZE));
+  }
+
+  metrics_gauge(out, "elevenlabs_channels_active", "Synthesizer channels open.",
+                atomic_load(&metrics->channels_active));
+
+  /* Per consumer task: a shard whose wait grows while others idle is unevenly loaded */
+  metrics_family(out, "elevenlabs_task_queue_depth", "gauge", "Channel messages waiting for their consumer task.");
+  for (unsigned i = 0; i < engine->shard_count; i++) {
+    long queued = atomic_load_explicit(&engine->shards[i].queued, memory_order_relaxed);
+    metrics_sample(out, "elevenlabs_task_queue_depth", apr_psprintf(pool, "{task=\"%u\"}", i),
+                   queued > 0 ? (unsigned long)queued : 0);
+  }
+  metrics_family(out, "elevenlabs_task_messages_total", "counter", "Channel messages processed by each consumer task.");
+  for (unsigned i = 0; i < engine->shard_count; i++) {
+    metrics_sample(out, "elevenlabs_task_messages_total", apr_psprintf(pool, "{task=\"%u\"}", i),
+                   atomic_load_explicit(&engine->shards[i].processed, memory_order_relaxed));
+  }
+  metrics_family(out, "elevenlabs_task_wait_seconds_total", "counter",
+                 "Time channel messages spent queued before their consumer task took them.");
+  for (unsigned i = 0; i < engine->shard_count; i++) {
+    APR_ARRAY_PUSH(out, const char *) = apr_psprintf(pool, "elevenlabs_task_wait_seconds_total{task=\"%u\"} %.6f\n", i,
+        atomic_load_explicit(&engine->shards[i].wait_us, memory_order_relaxed) / 1e6);
+  }
+  metrics_family(out, "elevenlabs_task_busy_seconds_total", "counter", "Time each consumer task spent processing messages.");
+  for (unsigned i = 0; i < engine->shard_count; i++) {
+    APR_ARRAY_PUSH(out, const char *) = apr_psprintf(pool, "elevenlabs_task_busy_seconds_total{task=\"%u\"} %.6f\n", i,
+        atomic_load_explicit(&engine->shards[i].busy_us, memory_order_relaxed) / 1e6);
+  }
+  metrics_counter(out, "elevenlabs_speaks_total", "SPEAKs that produced audio.", atomic_load(&engine->stats_speaks));
+  metrics_counter(out, "elevenlabs_segments_total", "Segments played.", atomic_load(&engine->stats_segments));
+  metrics_counter(out, "elevenlabs_segments_cached_total", "Segments played from the memory or disk cache.",
+                  atomic_load(&engine->stats_segments_cached));
+  metrics_counter(out, "elevenlabs_underruns_total", "Segments that ran dry midway, once per gap.",
+                  atomic_load(&engine->stats_underruns));
+  metrics_counter(out, "elevenlabs_prebuffer_holds_total", "Segments whose playback was held back by the prebuffer.",
+                  atomic_load(&engine->stats_prebuffered));
+  metrics_counter(out, "elevenlabs_prebuffer_hold_seconds_total", "Playback time held back by the prebuffer.",
+                  atomic_load(&engine->stats_prebuffer_ms) / 1000);
+
+  return apr_array_pstrcat(pool, out, 0);
+}
+
+/* Write the snapshot next to the target and rename it over, so readers never see half */
+static void elevenlabs_metrics_write(const elevenlabs_synth_engine_t *engine, apr_pool_t *pool)
+{
+  const char *path = engine->config.metrics_file;
+  const char *tmp_path = apr_pstrcat(pool, path, ".tmp", NULL);
+  const char *text = elevenlabs_metrics_render(pool, engine);
+  apr_file_t *file;
+  if (apr_file_open(&file, tmp_path, APR_FOPEN_CREATE | APR_FOPEN_WRITE | APR_FOPEN_TRUNCATE,
+                    APR_FPROT_OS_DEFAULT, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Failed to open metrics file %s", tmp_path);
+    return;
+  }
+  apr_size_t len = strlen(text);
+  apr_status_t rv = apr_file_write_full(file, text, len, NULL);
+  apr_file_close(file);
+  if (rv != APR_SUCCESS || apr_file_rename(tmp_path, path, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Failed to write metrics file %s", path);
+    apr_file_remove(tmp_path, pool);
+  }
+}
+
+static void* APR_THREAD_FUNC elevenlabs_metrics_run(apr_thread_t *thread, void *data)
+{
+  elevenlabs_synth_engine_t *engine = (elevenlabs_synth_engine_t *)data;
+  elevenlabs_metrics_t *metrics = engine->metrics;
+  apr_interval_time_t interval = apr_time_from_msec(engine->config.metrics_interval_ms);
+
+  apr_thread_mutex_lock(metrics->mutex);
+  while (metrics->running) {
+    apr_thread_mutex_unlock(metrics->mutex);
+    elevenlabs_metrics_write(engine, metrics->work_pool);
+    apr_pool_clear(metrics->work_pool);
+    apr_thread_mutex_lock(metrics->mutex);
+    if (metrics->running) {
+      apr_thread_cond_timedwait(metrics->cond, metrics->mutex, interval);
+    }
+  }
+  apr_thread_mutex_unlock(metrics->mutex);
+  return NULL;
+}
+
+/**
+ * Start rewriting metrics_file periodically, if one is configured
+ */
+void elevenlabs_metrics_writer_start(elevenlabs_synth_engine_t *engine)
+{
+  elevenlabs_metrics_t *metrics = engine->metrics;
+  if (!metrics || !engine->config.metrics_file) {
+    return;
+  }
+  if (apr_thread_mutex_create(&metrics->mutex, APR_THREAD_MUTEX_DEFAULT, metrics->pool) != APR_SUCCESS ||
+      apr_thread_cond_create(&metrics->cond, metrics->pool) != APR_SUCCESS ||
+      apr_pool_create(&metrics->work_pool, metrics->pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Failed to create metrics writer, no metrics file");
+    return;
+  }
+  metrics->running = TRUE;
+  if (apr_thread_create(&metrics->thread, NULL, elevenlabs_metrics_run, engine, metrics->pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Failed to start metrics writer, no metrics file");
+    metrics->running = FALSE;
+    metrics->thread = NULL;
+    return;
+  }
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "Metrics written to %s every %u ms",
+          engine->config.metrics_file, engine->config.metrics_interval_ms);
+}
+
+/**
+ * Stop the writer; the file is written a last time first, while every module is still up
+ */
+void elevenlabs_metrics_writer_stop(elevenlabs_synth_engine_t *engine)
+{
+  elevenlabs_metrics_t *metrics = engine->metrics;
+  if (!metrics || !metrics->thread) {
+    return;
+  }
+  apr_status_t rv = APR_SUCCESS;
+  apr_thread_mutex_lock(metrics->mutex);
+  metrics->running = FALSE;
+  apr_thread_cond_signal(metrics->cond);
+  apr_thread_mutex_unlock(metrics->mutex);
+  apr_thread_join(&rv, metrics->thread);
+  metrics->thread = NULL;
+  elevenlabs_metrics_write(engine, metrics->work_pool);
+  apr_pool_clear(metrics->work_pool);
+}
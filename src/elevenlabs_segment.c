@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_segment.c
+ * @brief Sentence/clause segmentation of SPEAK text for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+#include "elevenlabs_synth.h"
+#include "apr_strings.h"
+#include "apr_tables.h"
+#include <string.h>
+
+/* Whether the period at p closes an abbreviation or an initial ("Dr.", "e.g.", "J.")
+   rather than a sentence */
+static apt_bool_t elevenlabs_segment_abbreviation(const char *text, const char *p)
+{
+  static const char *abbreviations[] = { "Mr", "Mrs", "Ms", "Dr", "Prof", "St", "Jr", "Sr", "vs", "e.g", "i.e" };
+  const char *word = p;
+  while (word > text && ((word[-1] >= 'a' && word[-1] <= 'z') || (word[-1] >= 'A' && word[-1] <= 'Z') ||
+                          word[-1] == '.')) word--;
+  apr_size_t len = (apr_size_t)(p - word);
+  if (len == 1 && *word >= 'A' && *word <= 'Z') {
+    return TRUE;
+  }
+  for (apr_size_t i = 0; i < sizeof(abbreviations) / sizeof(abbreviations[0]); i++) {
+    if (strlen(abbreviations[i]) == len && strncmp(word, abbreviations[i], len) == 0) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/* Length of a sentence terminator at p, 0 if none. Full-width CJK punctuation ends a
+   sentence on its own; ASCII punctuation only when followed by a space or the end,
+   so "3.14" and "e.g.x" stay whole, and a lone period not after an abbreviation. */
+static apr_size_t elevenlabs_segment_terminator(const char *text, const char *p, apt_bool_t clauses)
+{
+  static const char *wide_sentence[] = { "\xE3\x80\x82", "\xEF\xBC\x81", "\xEF\xBC\x9F" };  /* 。！？ */
+  static const char *wide_clause[] = { "\xEF\xBC\x8C", "\xEF\xBC\x9B", "\xE3\x80\x81" };    /* ，；、 */
+  for (apr_size_t i = 0; i < sizeof(wide_sentence) / sizeof(wide_sentence[0]); i++) {
+    if (strncmp(p, wide_sentence[i], 3) == 0) return 3;
+  }
+  if (clauses) {
+    for (apr_size_t i = 0; i < sizeof(wide_clause) / sizeof(wide_clause[0]); i++) {
+      if (strncmp(p, wide_clause[i], 3) == 0) return 3;
+    }
+  }
+
+  apr_size_t len = 0;
+  if (*p == '.' || *p == '!' || *p == '?') {
+    len = 1;
+  } else if (strncmp(p, "\xE2\x80\xA6", 3) == 0) {  /* … */
+    len = 3;
+  } else if (clauses && (*p == ',' || *p == ';' || *p == ':')) {
+    len = 1;
+  } else {
+    return 0;
+  }
+  /* Runs like "?!" or "..." and closing quotes/brackets belong to the sentence */
+  while (p[len] == '.' || p[len] == '!' || p[len] == '?' || p[len] == '"' || p[len] == '\'' ||
+         p[len] == ')' || p[len] == ']') {
+    len++;
+  }
+  if (p[len] != '\0' && p[len] != ' ' && p[len] != '\t' && p[len] != '\n' && p[len] != '\r') {
+    return 0;
+  }
+  if (len == 1 && *p == '.' && elevenlabs_segment_abbreviation(text, p)) {
+    return 0;
+  }
+  return len;
+}
+
+static void elevenlabs_segment_push(apr_array_header_t *segments, apr_pool_t *pool,
+                                    const char *start, const char *end)
+{
+  while (start < end && (*start == ' ' || *start == '\t' || *start == '\n' || *start == '\r')) start++;
+  while (end > start && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) end--;
+  if (end > start) {
+    APR_ARRAY_PUSH(segments, char *) = apr_pstrndup(pool, start, (apr_size_t)(end - start));
+  }
+}
+
+/* Split text at sentence (or also clause) boundaries. Pieces shorter than
+   segment_min_chars run on into the next one, so abbreviations and short interjections
+   do not become requests of their own; a piece reaching segment_max_chars with no
+   boundary is cut after its last clause (",", ";", ":"), or failing that at its last
+   space. Lengths are in bytes. With segment_mode "none"
+   the text comes back as one segment. */
+char** elevenlabs_text_segment(apr_pool_t *pool, const char *text,
+                               const elevenlabs_config_t *config, unsigned *count)
+{
+  apr_array_header_t *segments = apr_array_make(pool, 8, sizeof(char *));
+  apt_bool_t enabled = config && config->segment_mode && strcasecmp(config->segment_mode, "none") != 0;
+  apt_bool_t clauses = enabled && strcasecmp(config->segment_mode, "clause") == 0;
+
+  if (!enabled) {
+    APR_ARRAY_PUSH(segments, char *) = apr_pstrdup(pool, text);
+    *count = 1;
+    return (char **)segments->elts;
+  }
+
+  apr_size_t min_chars = config->segment_min_chars;
+  apr_size_t max_chars = config->segment_max_chars > min_chars ? config->segment_max_chars : 0;
+  const char *start = text;
+  const char *last_space = NULL;
+  const char *last_clause = NULL;
+  const char *p = text;
+
+  while (*p) {
+    apr_size_t term = elevenlabs_segment_terminator(text, p, clauses);
+    if (term && (apr_size_t)(p + term - start) >= min_chars) {
+      elevenlabs_segment_push(segments, pool, start, p + term);
+      p += term;
+      start = p;
+      last_space = NULL;
+      last_clause = NULL;
+      continue;
+    }
+    if (*p == ' ') {
+      last_space = p;
+    }
+    if (!term && !clauses && max_chars) {
+      apr_size_t clause = elevenlabs_segment_terminator(text, p, TRUE);
+      if (clause && (apr_size_t)(p + clause - start) >= min_chars) {
+        last_clause = p + clause;
+      }
+    }
+    if (max_chars && (apr_size_t)(p - start) >= max_chars) {
+      const char *cut = last_clause && last_clause > start ? last_clause :
+                        last_space && last_space > start ? last_space : p;
+      /* Never split a UTF-8 sequence */
+      while (cut > start && ((unsigned char)*cut & 0xC0) == 0x80) cut--;
+      if (cut > start) {
+        elevenlabs_segment_push(segments, pool, start, cut);
+        start = cut;
+        last_space = NULL;
+        last_clause = NULL;
+      }
+    }
+    p += term ? term : 1;
+  }
+
+  /* A short tail joins the previous segment if that stays within bounds */
+  apr_size_t tail = strlen(start);
+  if (segments->nelts > 0 && tail < min_chars) {
+    char **prev = &APR_ARRAY_IDX(segments, segments->nelts - 1, char *);
+    if (!max_chars || strlen(*prev) + 1 + tail <= max_chars) {
+      const char *joined_start = start;
+      while (*joined_start == ' ' || *joined_start == '\t' || *joined_start == '\n' || *joined_start == '\r') joined_start++;
+      if (*joined_start) {
+        *prev = apr_pstrcat(pool, *prev, " ", joined_start, NULL);
+      }
+      start += tail;
+    }
+  }
+  elevenlabs_segment_push(segments, pool, start, start + strlen(start));
+
+  if (segments->nelts == 0) {
+    APR_ARRAY_PUSH(segments, char *) = apr_pstrdup(pool, text);
+  }
+  *count = (unsigned)segments->nelts;
+  return (char **)segments->elts;
+}
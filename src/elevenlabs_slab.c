@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_slab.c
+ * @brief Engine-wide pool of fixed-size audio blocks for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+#include "elevenlabs_defs.h"
+#include "elevenlabs_audio_buffer.h"
+#include <stdlib.h>
+
+/* A spare block holds the link to the next one in its own first bytes */
+struct elevenlabs_slab_free_t {
+  elevenlabs_slab_free_t *next;
+};
+
+/**
+ * Create an empty slab; blocks come from the heap as rings first need them
+ */
+elevenlabs_slab_t* elevenlabs_slab_create(apr_pool_t *pool)
+{
+  elevenlabs_slab_t *slab = apr_pcalloc(pool, sizeof(elevenlabs_slab_t));
+  if (apr_thread_mutex_create(&slab->mutex, APR_THREAD_MUTEX_DEFAULT, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "Failed to create audio slab mutex");
+    return NULL;
+  }
+  atomic_init(&slab->free_list, NULL);
+  atomic_init(&slab->blocks, 0);
+  atomic_init(&slab->spare, 0);
+  atomic_init(&slab->in_use, 0);
+  atomic_init(&slab->peak, 0);
+  return slab;
+}
+
+/**
+ * Take a block, reusing a spare one when there is any. Producer side (HTTP and
+ * WebSocket threads). Returns NULL only when the heap is exhausted.
+ */
+uint8_t* elevenlabs_slab_borrow(elevenlabs_slab_t *slab)
+{
+  /* Pops are serialized, so the head cannot be popped and pushed back between the
+     load and the exchange (no ABA); pushes stay lock-free for the media thread */
+  apr_thread_mutex_lock(slab->mutex);
+  elevenlabs_slab_free_t *node = atomic_load_explicit(&slab->free_list, memory_order_acquire);
+  while (node && !atomic_compare_exchange_weak_explicit(&slab->free_list, &node, node->next,
+                                                        memory_order_acquire, memory_order_acquire)) {
+  }
+  apr_thread_mutex_unlock(slab->mutex);
+
+  if (node) {
+    atomic_fetch_sub_explicit(&slab->spare, 1, memory_order_relaxed);
+  } else {
+    node = malloc(ELEVENLABS_AUDIO_BLOCK_SIZE);
+    if (!node) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "Failed to allocate audio block");
+      return NULL;
+    }
+    atomic_fetch_add_explicit(&slab->blocks, 1, memory_order_relaxed);
+  }
+
+  unsigned long in_use = atomic_fetch_add_explicit(&slab->in_use, 1, memory_order_relaxed) + 1;
+  unsigned long peak = atomic_load_explicit(&slab->peak, memory_order_relaxed);
+  while (in_use > peak &&
+         !atomic_compare_exchange_weak_explicit(&slab->peak, &peak, in_use,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+  }
+  return (uint8_t *)node;
+}
+
+/**
+ * Hand a block back. Consumer side (media thread), so it never blocks: the block
+ * joins the spares, or goes back to the heap once enough are spare.
+ */
+void elevenlabs_slab_return(elevenlabs_slab_t *slab, uint8_t *block)
+{
+  atomic_fetch_sub_explicit(&slab->in_use, 1, memory_order_relaxed);
+  if (atomic_load_explicit(&slab->spare, memory_order_relaxed) >= ELEVENLABS_SLAB_SPARE_BLOCKS) {
+    free(block);
+    atomic_fetch_sub_explicit(&slab->blocks, 1, memory_order_relaxed);
+    return;
+  }
+
+  elevenlabs_slab_free_t *node = (elevenlabs_slab_free_t *)block;
+  node->next = atomic_load_explicit(&slab->free_list, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&slab->free_list, &node->next, node,
+                                                memory_order_release, memory_order_relaxed)) {
+  }
+  atomic_fetch_add_explicit(&slab->spare, 1, memory_order_relaxed);
+}
+
+/**
+ * Free the spare blocks. Every ring has returned its blocks by now.
+ */
+void elevenlabs_slab_destroy(elevenlabs_slab_t *slab)
+{
+  if (!slab) {
+    return;
+  }
+
+  unsigned long in_use = atomic_load(&slab->in_use);
+  if (in_use > 0) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Audio slab destroyed with %lu blocks in use", in_use);
+  }
+  elevenlabs_slab_free_t *node = atomic_exchange(&slab->free_list, NULL);
+  while (node) {
+    elevenlabs_slab_free_t *next = node->next;
+    free(node);
+    node = next;
+  }
+  atomic_store(&slab->spare, 0);
+}
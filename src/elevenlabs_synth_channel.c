@@ -9,8 +9,9 @@
  */ 
 
 #include "elevenlabs_synth.h"
-#include "ulaw_decode.h"
+#include "g711_decode.h"
 #include <string.h>
+#include <stdlib.h>
 #include <apr_thread_proc.h>
 
 /* Forward declarations for static functions */
@@ -23,126 +24,300 @@ static apt_bool_t elevenlabs_channel_stop(mrcp_engine_channel_t *channel,
 static apt_bool_t elevenlabs_channel_request_dispatch(mrcp_engine_channel_t *channel, 
                                                      mrcp_message_t *request);
 static char* elevenlabs_extract_text_from_ssml(const char *ssml, apr_pool_t *pool);
+static char* elevenlabs_extract_text_from_ssml_legacy(const char *ssml, apr_pool_t *pool);
 static void elevenlabs_send_speak_complete(mrcp_engine_channel_t *channel, 
                                           mrcp_message_t *request, 
                                           mrcp_synth_completion_cause_e cause);
+static void elevenlabs_channel_segment_advance(elevenlabs_synth_channel_t *synth_channel);
+static char* elevenlabs_request_text(mrcp_message_t *request);
+static char* elevenlabs_request_legacy_text(mrcp_message_t *request);
+static apt_bool_t elevenlabs_vendor_param_flag(mrcp_message_t *request, const char *name);
 
-/* Audio buffer functions */
-audio_buffer_t* audio_buffer_create(apr_pool_t *pool, apr_size_t initial_capacity)
+/* Cache hit playback from a shared blob, or from a shared download as it arrives. The
+   lookup hands a playback over; the media thread adopts it, copies frames out of it and
+   drops it. Cancellation is a generation number, and blobs and flights are refcounted,
+   so no side ever frees what another might still be reading. */
+static void elevenlabs_cache_playback_drop(elevenlabs_cache_playback_t *playback)
 {
-    /* ElevenLabs API может вернуть большой объем данных, увеличим начальный размер буфера */
-    initial_capacity = initial_capacity > (1024 * 1024) ? initial_capacity : (1024 * 1024);
-    
-    audio_buffer_t *buffer = apr_palloc(pool, sizeof(audio_buffer_t));
-    if (!buffer) {
-        return NULL;
+    if (playback) {
+        if (playback->blob) {
+            elevenlabs_cache_blob_unref(playback->blob);
+        }
+        /* Leaving may cancel the download: a notify, never a wait */
+        elevenlabs_flight_leave(playback->flight);
+        free(playback);
     }
-    
-    buffer->buffer = apr_palloc(pool, initial_capacity);
-    if (!buffer->buffer) {
-        return NULL;
+}
+
+static void elevenlabs_channel_playback_hand_over(elevenlabs_synth_lane_t *lane,
+                                                  elevenlabs_cache_playback_t *playback)
+{
+    unsigned gen = playback->gen;
+    atomic_store(&lane->playback_gen, gen);
+    if (atomic_load(&lane->channel->cancel_gen) >= gen) {
+        /* Stopped while the lookup ran */
+        atomic_compare_exchange_strong(&lane->playback_gen, &gen, 0);
+        elevenlabs_cache_playback_drop(playback);
+        return;
     }
-    
-    buffer->size = 0;
-    buffer->capacity = initial_capacity;
-    buffer->pool = pool;  /* Store pool for future allocations */
-    
-    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, 
-           "Created audio buffer with initial capacity: %zu bytes", initial_capacity);
-    
-    apr_thread_mutex_create(&buffer->mutex, APR_THREAD_MUTEX_DEFAULT, pool);
-    
-    return buffer;
+    elevenlabs_cache_playback_t *stale = atomic_exchange(&lane->playback_pending, playback);
+    /* Never adopted by the media thread, so it is ours to drop */
+    elevenlabs_cache_playback_drop(stale);
 }
 
-void audio_buffer_destroy(audio_buffer_t *buffer)
+/* Hand a blob for segment generation gen to the lane's media-thread side */
+void elevenlabs_channel_playback_publish(elevenlabs_synth_lane_t *lane,
+                                         elevenlabs_cache_blob_t *blob, unsigned gen)
 {
-    if (buffer && buffer->mutex) {
-        apr_thread_mutex_destroy(buffer->mutex);
+    /* Not pool memory: dropped on whichever thread lets go of it last */
+    elevenlabs_cache_playback_t *playback = calloc(1, sizeof(elevenlabs_cache_playback_t));
+    if (!playback) {
+        return;
     }
+    elevenlabs_cache_blob_ref(blob);
+    playback->blob = blob;
+    playback->gen = gen;
+    elevenlabs_channel_playback_hand_over(lane, playback);
 }
 
-apt_bool_t audio_buffer_write(audio_buffer_t *buffer, const uint8_t *data, apr_size_t size)
+/* Same for a shared download; takes over the subscriber reference from the join */
+void elevenlabs_channel_playback_publish_flight(elevenlabs_synth_lane_t *lane,
+                                                elevenlabs_flight_t *flight, unsigned gen)
 {
-    if (!buffer || !data || size == 0) {
-        return FALSE;
+    elevenlabs_cache_playback_t *playback = calloc(1, sizeof(elevenlabs_cache_playback_t));
+    if (!playback) {
+        elevenlabs_flight_leave(flight);
+        return;
     }
-    
-    apr_thread_mutex_lock(buffer->mutex);
-    
-    /* Check if we need to expand buffer */
-    if (buffer->size + size > buffer->capacity) {
-        /* Calculate new capacity (double current or what we need, whichever is larger) */
-        apr_size_t min_needed = buffer->size + size;
-        apr_size_t new_capacity = buffer->capacity * 2;
-        if (new_capacity < min_needed) {
-            new_capacity = min_needed * 2;
-        }
+    playback->flight = flight;
+    playback->chunk = flight->head;
+    playback->gen = gen;
+    elevenlabs_channel_playback_hand_over(lane, playback);
+}
+
+/* Consumer task: drop any playback of the current or an earlier SPEAK */
+void elevenlabs_channel_playback_cancel(elevenlabs_synth_channel_t *synth_channel)
+{
+    if (!synth_channel) {
+        return;
+    }
+    atomic_store(&synth_channel->cancel_gen, synth_channel->speak_gen);
+    for (unsigned i = 0; i < synth_channel->lane_count; i++) {
+        elevenlabs_synth_lane_t *lane = &synth_channel->lanes[i];
+        atomic_store(&lane->playback_gen, 0);
+        elevenlabs_cache_playback_drop(atomic_exchange(&lane->playback_pending, NULL));
+    }
+}
 
-        /* Allocate new buffer */
-        uint8_t *new_buffer = apr_palloc(buffer->pool, new_capacity);
-        if (!new_buffer) {
-            apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, 
-                   "Failed to allocate memory for expanded audio buffer");
-            apr_thread_mutex_unlock(buffer->mutex);
-            return FALSE;
+/* Media thread: adopt a newly handed-over playback and release cancelled ones */
+static void elevenlabs_channel_playback_sync(elevenlabs_synth_lane_t *lane)
+{
+    elevenlabs_cache_playback_t *pending = atomic_exchange(&lane->playback_pending, NULL);
+    if (pending) {
+        elevenlabs_cache_playback_drop(lane->playback);
+        lane->playback = pending;
+        lane->from_cache = pending->blob != NULL;
+    }
+    elevenlabs_cache_playback_t *playback = lane->playback;
+    if (playback && playback->gen <= atomic_load(&lane->channel->cancel_gen)) {
+        unsigned gen = playback->gen;
+        atomic_compare_exchange_strong(&lane->playback_gen, &gen, 0);
+        elevenlabs_cache_playback_drop(playback);
+        lane->playback = NULL;
+    }
+}
+
+/* Media thread: copy up to frame_size bytes of what has arrived of a shared download,
+   walking its chunks. Done once the download has ended and all of it is played. */
+static apr_size_t elevenlabs_channel_flight_read_frame(elevenlabs_cache_playback_t *playback,
+                                                       uint8_t *frame, apr_size_t frame_size,
+                                                       apt_bool_t *finished)
+{
+    elevenlabs_flight_t *flight = playback->flight;
+    /* done before ready: once ended, the ready read after it is final */
+    int done = atomic_load_explicit(&flight->done, memory_order_acquire);
+    apr_size_t ready = atomic_load_explicit(&flight->ready, memory_order_acquire);
+    apr_size_t bytes_to_read = ready - playback->pos;
+    if (bytes_to_read > frame_size) {
+        bytes_to_read = frame_size;
+    }
+    apr_size_t copied = 0;
+    while (copied < bytes_to_read) {
+        if (playback->chunk_pos == ELEVENLABS_FLIGHT_CHUNK_SIZE) {
+            playback->chunk = atomic_load_explicit(&playback->chunk->next, memory_order_acquire);
+            playback->chunk_pos = 0;
+        }
+        apr_size_t n = ELEVENLABS_FLIGHT_CHUNK_SIZE - playback->chunk_pos;
+        if (n > bytes_to_read - copied) {
+            n = bytes_to_read - copied;
         }
+        memcpy(frame + copied, playback->chunk->data + playback->chunk_pos, n);
+        playback->chunk_pos += n;
+        copied += n;
+    }
+    playback->pos += bytes_to_read;
+    *finished = done && playback->pos >= ready;
+    if (!done) {
+        elevenlabs_flight_played(flight, playback->pos);
+    }
+    return bytes_to_read;
+}
 
-        /* Copy existing data */
-        if (buffer->size > 0) {
-            memcpy(new_buffer, buffer->buffer, buffer->size);
+/* Media thread: copy up to frame_size bytes of what the I/O worker has faulted in so
+   far; drop the playback once the blob is fully played */
+static apr_size_t elevenlabs_channel_playback_read_frame(elevenlabs_synth_lane_t *lane,
+                                                        uint8_t *frame, apr_size_t frame_size)
+{
+    elevenlabs_cache_playback_t *playback = lane->playback;
+    apr_size_t bytes_to_read;
+    apt_bool_t finished;
+    if (playback->flight) {
+        bytes_to_read = elevenlabs_channel_flight_read_frame(playback, frame, frame_size, &finished);
+    } else {
+        const elevenlabs_cache_blob_t *blob = playback->blob;
+        apr_size_t ready = atomic_load_explicit(&blob->ready, memory_order_acquire);
+        bytes_to_read = ready - playback->pos;
+        if (bytes_to_read > frame_size) {
+            bytes_to_read = frame_size;
         }
-        
-        /* Update buffer */
-        buffer->buffer = new_buffer;
-        buffer->capacity = new_capacity;
-        
-        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG, 
-               "Audio buffer expanded from %zu to %zu bytes", 
-               buffer->capacity/2, new_capacity);
+        memcpy(frame, blob->data + playback->pos, bytes_to_read);
+        playback->pos += bytes_to_read;
+        finished = playback->pos >= blob->len;
     }
     
-    /* Copy new data */
-    memcpy(buffer->buffer + buffer->size, data, size);
-    buffer->size += size;
-    
-    apr_thread_mutex_unlock(buffer->mutex);
-    return TRUE;
+    if (finished) {
+        unsigned gen = playback->gen;
+        atomic_compare_exchange_strong(&lane->playback_gen, &gen, 0);
+        elevenlabs_cache_playback_drop(playback);
+        lane->playback = NULL;
+    }
+    return bytes_to_read;
 }
 
-static apr_size_t audio_buffer_read_frame(audio_buffer_t *buffer, uint8_t *frame, apr_size_t frame_size)
+/* Media thread: read from whichever source feeds the lane right now */
+static apr_size_t elevenlabs_lane_read(elevenlabs_synth_lane_t *lane, uint8_t *frame, apr_size_t frame_size)
 {
-    if (!buffer || !frame || frame_size == 0) {
+    elevenlabs_channel_playback_sync(lane);
+    if (lane->playback) {
+        /* Cache hit or shared download: frames come straight from its memory */
+        return elevenlabs_channel_playback_read_frame(lane, frame, frame_size);
+    }
+    if (!lane->streaming && lane->http_client && atomic_load(&lane->http_client->start_deferred)) {
+        /* The segment waits for the lane's previous request to let go; what that one
+           left in the ring is cleared when this one starts */
         return 0;
     }
+    return audio_buffer_read_frame(lane->audio_buffer, frame, frame_size);
+}
+
+/* Media thread: the producer of the given segment is done writing the lane's ring. A
+   streamed SPEAK is done once its WebSocket utterance is all in the ring. A start still
+   queued behind the previous request is read first: stopped is that request's until
+   the flag drops. */
+static apt_bool_t elevenlabs_lane_produced(elevenlabs_synth_lane_t *lane, unsigned segment)
+{
+    apt_bool_t produced = lane->streaming ?
+        elevenlabs_ws_session_finished(lane->channel->ws, lane->channel->ws_context) :
+        !atomic_load(&lane->http_client->start_deferred) && lane->http_client->stopped;
+    return atomic_load(&lane->segment) == segment && produced;
+}
+
+/* Media thread: the lane has delivered all of the given segment. The producer may have
+   pushed its last chunk right before stopping, so the ring is checked after the flag;
+   a cache hit whose playback has not been adopted yet is still pending too. */
+static apt_bool_t elevenlabs_lane_finished(elevenlabs_synth_lane_t *lane, unsigned segment)
+{
+    return elevenlabs_lane_produced(lane, segment) &&
+           audio_buffer_available(lane->audio_buffer) == 0 &&
+           atomic_load(&lane->playback_gen) == 0;
+}
+
+/* Forget the prebuffer state of the lane's last segment */
+static void elevenlabs_lane_prebuffer_reset(elevenlabs_synth_lane_t *lane)
+{
+    lane->primed = FALSE;
+    lane->played = FALSE;
+    lane->arrival_start = 0;
+    lane->held = 0;
+}
+
+/* Media thread: whether the segment on this lane may start playing. A segment streamed
+   from the API is held back while its audio arrives slower than real time and what is
+   queued would not last until the rest has arrived: arriving at r against playback at
+   p, the R bytes still to come take R / r, while playback drains (p - r) * R / r more
+   than arrives. R is estimated from the segment's text. Cache hits and finished
+   downloads play at once, and a SPEAK is never held longer than prebuffer_max_ms.
+   Arrival is timed against now; a pause is taken out of it by elevenlabs_channel_prebuffer_resume(). */
+apt_bool_t elevenlabs_lane_prebuffer(elevenlabs_synth_channel_t *synth_channel,
+                                     elevenlabs_synth_lane_t *lane, unsigned segment,
+                                     apr_size_t frame_size, apr_time_t now)
+{
+    elevenlabs_synth_engine_t *engine = synth_channel->elevenlabs_engine;
+    if (lane->primed) {
+        return TRUE;
+    }
     
-    apr_thread_mutex_lock(buffer->mutex);
+    apt_bool_t start = lane->playback != NULL ||
+                       elevenlabs_lane_produced(lane, segment) ||
+                       synth_channel->prebuffer_held >= apr_time_from_msec(engine->config.prebuffer_max_ms);
+    apr_size_t queued = audio_buffer_available(lane->audio_buffer);
+    if (!start && queued == 0) {
+        /* Nothing to hold back yet */
+        return TRUE;
+    }
     
-    apr_size_t bytes_to_read = (buffer->size >= frame_size) ? frame_size : buffer->size;
+    if (!start) {
+        apr_size_t head = atomic_load_explicit(&lane->audio_buffer->head, memory_order_acquire);
+        if (!lane->arrival_start) {
+            lane->arrival_start = now;
+            lane->arrival_head = head;
+            lane->arrival_queued = queued;
+        }
+        apr_interval_time_t elapsed = now - lane->arrival_start;
+        if (elapsed >= apr_time_from_msec(ELEVENLABS_PREBUFFER_MEASURE_MS)) {
+            /* Rates in bytes per microsecond */
+            double p = (double)(SAMPLE_RATE * ELEVENLABS_BYTES_PER_SAMPLE) / APR_USEC_PER_SEC;
+            double r = (double)(head - lane->arrival_head) / elapsed;
+            double remaining = (double)ELEVENLABS_PREBUFFER_HORIZON_MS * 1000 * p;
+            if (synth_channel->segments) {
+                remaining = (double)strlen(synth_channel->segments[segment]) *
+                            ELEVENLABS_PREBUFFER_MS_PER_CHAR * 1000 * p -
+                            (double)(lane->arrival_queued + (head - lane->arrival_head));
+            }
+            start = r >= p || remaining <= 0 || (r > 0 && queued >= (p - r) * remaining / r);
+        }
+    }
     
-    if (bytes_to_read > 0) {
-        memcpy(frame, buffer->buffer, bytes_to_read);
-        
-        /* Move remaining data to beginning of buffer */
-        if (bytes_to_read < buffer->size) {
-            memmove(buffer->buffer, buffer->buffer + bytes_to_read, buffer->size - bytes_to_read);
+    if (start) {
+        lane->primed = TRUE;
+        if (lane->held) {
+            atomic_fetch_add(&engine->stats_prebuffered, 1);
+            atomic_fetch_add(&engine->stats_prebuffer_ms, (unsigned long)apr_time_as_msec(lane->held));
+            apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+                   "Segment %u held back %ld ms, %zu bytes queued [channel=%p]",
+                   segment, (long)apr_time_as_msec(lane->held), queued, (void*)synth_channel);
         }
-        buffer->size -= bytes_to_read;
+        return TRUE;
     }
     
-    apr_thread_mutex_unlock(buffer->mutex);
-    return bytes_to_read;
+    /* Hold for this frame */
+    apr_interval_time_t frame_time = (apr_interval_time_t)frame_size * APR_USEC_PER_SEC /
+                                     (SAMPLE_RATE * ELEVENLABS_BYTES_PER_SAMPLE);
+    lane->held += frame_time;
+    synth_channel->prebuffer_held += frame_time;
+    return FALSE;
 }
 
-static void audio_buffer_clear(audio_buffer_t *buffer)
+/* Media thread: playback resumes after a pause of this long. The prebuffer measures
+   arrival rates against playing time, so the pause is taken out of every measurement
+   in progress. */
+void elevenlabs_channel_prebuffer_resume(elevenlabs_synth_channel_t *synth_channel, apr_interval_time_t pause)
 {
-    if (!buffer) {
-        return;
+    for (unsigned i = 0; i < synth_channel->lane_count; i++) {
+        if (synth_channel->lanes[i].arrival_start) {
+            synth_channel->lanes[i].arrival_start += pause;
+        }
     }
-    
-    apr_thread_mutex_lock(buffer->mutex);
-    buffer->size = 0;
-    apr_thread_mutex_unlock(buffer->mutex);
 }
 
 /* Message processing functions */
@@ -152,8 +327,8 @@ static apt_bool_t elevenlabs_synth_msg_signal(elevenlabs_synth_msg_type_e type,
 {
     apt_bool_t status = FALSE;
     elevenlabs_synth_channel_t *elevenlabs_channel = channel->method_obj;
-    elevenlabs_synth_engine_t *elevenlabs_engine = elevenlabs_channel->elevenlabs_engine;
-    apt_task_t *task = apt_consumer_task_base_get(elevenlabs_engine->task);
+    elevenlabs_synth_shard_t *shard = elevenlabs_channel->shard;
+    apt_task_t *task = apt_consumer_task_base_get(shard->task);
     apt_task_msg_t *msg = apt_task_msg_get(task);
     
     if (msg) {
@@ -164,7 +339,12 @@ static apt_bool_t elevenlabs_synth_msg_signal(elevenlabs_synth_msg_type_e type,
         elevenlabs_msg->type = type;
         elevenlabs_msg->channel = channel;
         elevenlabs_msg->request = request;
+        elevenlabs_msg->queued = apr_time_now();
+        atomic_fetch_add_explicit(&shard->queued, 1, memory_order_relaxed);
         status = apt_task_msg_signal(task, msg);
+        if (!status) {
+            atomic_fetch_sub_explicit(&shard->queued, 1, memory_order_relaxed);
+        }
     }
     
     return status;
@@ -173,6 +353,13 @@ static apt_bool_t elevenlabs_synth_msg_signal(elevenlabs_synth_msg_type_e type,
 apt_bool_t elevenlabs_synth_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 {
     elevenlabs_synth_msg_t *elevenlabs_msg = (elevenlabs_synth_msg_t*)msg->data;
+    apt_consumer_task_t *consumer_task = apt_task_object_get(task);
+    elevenlabs_synth_shard_t *shard = apt_consumer_task_object_get(consumer_task);
+    apr_time_t start = apr_time_now();
+    
+    atomic_fetch_sub_explicit(&shard->queued, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->wait_us, (unsigned long)(start - elevenlabs_msg->queued),
+                              memory_order_relaxed);
     
     switch (elevenlabs_msg->type) {
         case ELEVENLABS_SYNTH_MSG_OPEN_CHANNEL:
@@ -186,16 +373,74 @@ apt_bool_t elevenlabs_synth_msg_process(apt_task_t *task, apt_task_msg_t *msg)
             break;
             
         case ELEVENLABS_SYNTH_MSG_REQUEST_PROCESS:
+            ((elevenlabs_synth_channel_t*)elevenlabs_msg->channel->method_obj)->request_time = elevenlabs_msg->queued;
             elevenlabs_channel_request_dispatch(elevenlabs_msg->channel, elevenlabs_msg->request);
             break;
             
+        case ELEVENLABS_SYNTH_MSG_SEGMENT_NEXT:
+            elevenlabs_channel_segment_advance(elevenlabs_msg->channel->method_obj);
+            break;
+            
         default:
             break;
     }
     
+    atomic_fetch_add_explicit(&shard->busy_us, (unsigned long)(apr_time_now() - start),
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->processed, 1, memory_order_relaxed);
     return TRUE;
 }
 
+/* Segment pipeline (consumer task). Segment i downloads on lane i % lane_count, so up
+   to lane_count - 1 segments are fetched ahead of the one playing; a lane is reused
+   only once the media thread has played its previous segment. Stopping never waits:
+   a hung transfer would hold up every channel's requests behind this one. */
+static void elevenlabs_channel_lanes_stop(elevenlabs_synth_channel_t *synth_channel)
+{
+    for (unsigned i = 0; i < synth_channel->lane_count; i++) {
+        if (synth_channel->lanes[i].http_client) {
+            elevenlabs_http_client_cancel(synth_channel->lanes[i].http_client);
+        }
+    }
+}
+
+static apt_bool_t elevenlabs_channel_segment_start(elevenlabs_synth_channel_t *synth_channel, unsigned segment)
+{
+    elevenlabs_synth_lane_t *lane = &synth_channel->lanes[segment % synth_channel->lane_count];
+    if (!lane->http_client) {
+        return FALSE;
+    }
+    /* Each segment is its own cache-hit generation */
+    synth_channel->speak_gen++;
+    apt_bool_t success = elevenlabs_http_client_start_synthesis(
+        lane->http_client, synth_channel->segments[segment], synth_channel->voice_id,
+        synth_channel->legacy_text, synth_channel);
+    /* Published only now: until then the media thread must not mistake the
+       stopped client of the lane's previous segment for this one being done */
+    if (success) {
+        atomic_store(&lane->segment, segment);
+    }
+    return success;
+}
+
+static void elevenlabs_channel_segment_advance(elevenlabs_synth_channel_t *synth_channel)
+{
+    if (!synth_channel || !synth_channel->synthesizing) {
+        return;
+    }
+    while (synth_channel->segment_next < synth_channel->segment_count &&
+           synth_channel->segment_next < atomic_load(&synth_channel->segment_playing) + synth_channel->lane_count) {
+        if (!elevenlabs_channel_segment_start(synth_channel, synth_channel->segment_next)) {
+            apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR,
+                   "Failed to start synthesis of segment %u", synth_channel->segment_next);
+            /* End the SPEAK after what has been started rather than wait on it forever */
+            synth_channel->segment_count = synth_channel->segment_next;
+            break;
+        }
+        synth_channel->segment_next++;
+    }
+}
+
 /* Channel method implementations */
 apt_bool_t elevenlabs_synth_channel_destroy(mrcp_engine_channel_t *channel)
 {
@@ -205,23 +450,31 @@ apt_bool_t elevenlabs_synth_channel_destroy(mrcp_engine_channel_t *channel)
            "Destroying synth channel [%p]", (void*)synth_channel);
     
     if (synth_channel) {
-        if (synth_channel->http_client) {
-            elevenlabs_http_client_stop(synth_channel->http_client);
-            /* CRITICAL: Destroy HTTP client to cleanup background thread */
-            elevenlabs_http_client_destroy(synth_channel->http_client);
-            synth_channel->http_client = NULL;
-        }
-        
-        if (synth_channel->audio_buffer) {
-            audio_buffer_clear(synth_channel->audio_buffer);
-            audio_buffer_destroy(synth_channel->audio_buffer);
-            synth_channel->audio_buffer = NULL;
+        /* Not waited for either, but it stops writing into the first lane's ring before
+           returning, so it goes before the rings */
+        elevenlabs_ws_session_destroy(synth_channel->ws);
+        synth_channel->ws = NULL;
+        /* Cache hits are dropped first: a lookup still running may hold the generation */
+        elevenlabs_channel_playback_cancel(synth_channel);
+        for (unsigned i = 0; i < synth_channel->lane_count; i++) {
+            elevenlabs_synth_lane_t *lane = &synth_channel->lanes[i];
+            if (lane->http_client) {
+                /* Not waited for: the worker loop frees the client and the ring it writes
+                   into once its request has let go, however long a hung transfer takes */
+                elevenlabs_http_client_release(lane->http_client);
+                lane->http_client = NULL;
+                lane->audio_buffer = NULL;
+            }
+            /* The stream is closed by now, so the media-thread mappings are safe to drop too */
+            elevenlabs_cache_playback_drop(lane->playback);
+            lane->playback = NULL;
         }
         
         if (synth_channel->mutex) {
             apr_thread_mutex_destroy(synth_channel->mutex);
             synth_channel->mutex = NULL;
         }
+        ELEVENLABS_METRIC_ADD(synth_channel->elevenlabs_engine->metrics, channels_active, -1);
     }
     
     return TRUE;
@@ -237,10 +490,13 @@ apt_bool_t elevenlabs_channel_close(mrcp_engine_channel_t *channel)
     elevenlabs_synth_channel_t *synth_channel = channel->method_obj;
     
     /* Stop any ongoing synthesis */
-    if (synth_channel->synthesizing && synth_channel->http_client) {
-        elevenlabs_http_client_stop(synth_channel->http_client);
+    if (synth_channel->synthesizing) {
+        elevenlabs_channel_lanes_stop(synth_channel);
         synth_channel->synthesizing = FALSE;
     }
+    elevenlabs_ws_session_cancel(synth_channel->ws, synth_channel->ws_context);
+    synth_channel->ws_context = 0;
+    elevenlabs_channel_playback_cancel(synth_channel);
     
     return elevenlabs_synth_msg_signal(ELEVENLABS_SYNTH_MSG_CLOSE_CHANNEL, channel, NULL);
 }
@@ -251,6 +507,100 @@ apt_bool_t elevenlabs_channel_request_process(mrcp_engine_channel_t *channel, mr
 }
 
 /* Request processing implementations */
+
+/* Text of a SPEAK or CONTROL body, SSML reduced to its text; NULL without a body */
+static char* elevenlabs_request_text(mrcp_message_t *request)
+{
+    char *text = NULL;
+    if (mrcp_generic_header_property_check(request, GENERIC_HEADER_CONTENT_LENGTH) == TRUE) {
+        mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+        if (generic_header && generic_header->content_type.buf && request->body.buf) {
+            /* Check if it's SSML or plain text */
+            if (strstr(generic_header->content_type.buf, "application/ssml+xml")) {
+                text = elevenlabs_extract_text_from_ssml(request->body.buf, request->pool);
+            } else {
+                text = apr_pstrdup(request->pool, request->body.buf);
+            }
+        }
+    }
+    return text;
+}
+
+/* SSML body of a SPEAK as read before v2 cache keys, to find files cached under it;
+   NULL for plain text, which reads the same either way */
+static char* elevenlabs_request_legacy_text(mrcp_message_t *request)
+{
+    mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+    if (!generic_header || !generic_header->content_type.buf || !request->body.buf ||
+        !strstr(generic_header->content_type.buf, "application/ssml+xml")) {
+        return NULL;
+    }
+    return elevenlabs_extract_text_from_ssml_legacy(request->body.buf, request->pool);
+}
+
+/* Vendor-Specific-Parameters entry name set to true (or 1) */
+static apt_bool_t elevenlabs_vendor_param_flag(mrcp_message_t *request, const char *name)
+{
+    if (mrcp_generic_header_property_check(request, GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) != TRUE) {
+        return FALSE;
+    }
+    mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+    if (!generic_header || !generic_header->vendor_specific_params) {
+        return FALSE;
+    }
+    int count = apt_pair_array_size_get(generic_header->vendor_specific_params);
+    for (int i = 0; i < count; i++) {
+        const apt_pair_t *pair = apt_pair_array_get(generic_header->vendor_specific_params, i);
+        if (pair && pair->name.buf && strcasecmp(pair->name.buf, name) == 0) {
+            return pair->value.buf &&
+                   (strcasecmp(pair->value.buf, "true") == 0 || strcmp(pair->value.buf, "1") == 0);
+        }
+    }
+    return FALSE;
+}
+
+/* Streamed SPEAK: one segment on the first lane, fed by the channel's WebSocket for as
+   long as CONTROL requests bring text. State is already reset by the caller. */
+static apt_bool_t elevenlabs_channel_speak_stream(mrcp_engine_channel_t *channel,
+                                                 mrcp_message_t *request,
+                                                 mrcp_message_t *response,
+                                                 const char *voice_id,
+                                                 const char *text)
+{
+    elevenlabs_synth_channel_t *synth_channel = channel->method_obj;
+    elevenlabs_synth_engine_t *engine = synth_channel->elevenlabs_engine;
+    elevenlabs_synth_lane_t *lane = &synth_channel->lanes[0];
+    
+    if (!synth_channel->ws && lane->http_client) {
+        synth_channel->ws = elevenlabs_ws_session_create(&engine->config, engine->http_pool,
+                                                         lane->audio_buffer, lane->http_client->high_water_bytes);
+    }
+    if (synth_channel->ws) {
+        synth_channel->ws_context = elevenlabs_ws_session_begin(
+            synth_channel->ws, request->pool, voice_id, text,
+            elevenlabs_vendor_param_flag(request, ELEVENLABS_VSP_STREAM_END));
+    }
+    if (!synth_channel->ws_context) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR,
+               "Failed to start streamed synthesis");
+        synth_channel->speak_request = NULL;
+        response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
+        mrcp_engine_channel_message_send(channel, response);
+        return TRUE;
+    }
+    
+    synth_channel->segments = NULL;
+    synth_channel->segment_count = 1;
+    synth_channel->segment_next = 1;
+    lane->streaming = TRUE;
+    atomic_store(&lane->segment, 0);
+    synth_channel->synthesizing = TRUE;
+    
+    response->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
+    mrcp_engine_channel_message_send(channel, response);
+    return TRUE;
+}
+
 static apt_bool_t elevenlabs_channel_speak(mrcp_engine_channel_t *channel, 
                                           mrcp_message_t *request, 
                                           mrcp_message_t *response)
@@ -274,26 +624,11 @@ static apt_bool_t elevenlabs_channel_speak(mrcp_engine_channel_t *channel,
                "Using default voice_id from config: %s", voice_id);
     }
     
-    /* Set voice_id in HTTP client for this request */
-    if (synth_channel->http_client) {
-        synth_channel->http_client->request_voice_id = voice_id;
-    }
-    
-    /* Extract text from request body */
-    char *text = NULL;
-    if (mrcp_generic_header_property_check(request, GENERIC_HEADER_CONTENT_LENGTH) == TRUE) {
-        mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
-        if (generic_header && generic_header->content_type.buf) {
-            /* Check if it's SSML or plain text */
-            if (strstr(generic_header->content_type.buf, "application/ssml+xml")) {
-                text = elevenlabs_extract_text_from_ssml(request->body.buf, request->pool);
-            } else {
-                text = apr_pstrdup(request->pool, request->body.buf);
-            }
-        }
-    }
+    /* Extract text from request body; a streamed SPEAK may start without any */
+    char *text = elevenlabs_request_text(request);
+    apt_bool_t stream_input = elevenlabs_vendor_param_flag(request, ELEVENLABS_VSP_STREAM_INPUT);
     
-    if (!text || strlen(text) == 0) {
+    if ((!text || strlen(text) == 0) && !stream_input) {
         apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, 
                "No text content found in SPEAK request");
         response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
@@ -301,30 +636,62 @@ static apt_bool_t elevenlabs_channel_speak(mrcp_engine_channel_t *channel,
     }
     
     apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, 
-           "Processing SPEAK request [channel=%p, http_client=%p] with text: %s",
-           (void*)synth_channel, (void*)synth_channel->http_client, text);
+           "Processing %sSPEAK request [channel=%p, lanes=%u] with text: %s",
+           stream_input ? "streamed " : "", (void*)synth_channel, synth_channel->lane_count,
+           text ? text : "");
+    
+    /* An utterance left open by an earlier streamed SPEAK ends here */
+    elevenlabs_ws_session_cancel(synth_channel->ws, synth_channel->ws_context);
+    synth_channel->ws_context = 0;
     
-    /* Clear audio buffer and reset state */
-    audio_buffer_clear(synth_channel->audio_buffer);
+    /* Clear audio buffers, drop any previous cache-hit mapping and reset state */
+    elevenlabs_channel_playback_cancel(synth_channel);
+    for (unsigned i = 0; i < synth_channel->lane_count; i++) {
+        elevenlabs_synth_lane_t *lane = &synth_channel->lanes[i];
+        audio_buffer_clear(lane->audio_buffer);
+        atomic_store(&lane->segment, ELEVENLABS_SEGMENT_NONE);
+        lane->streaming = FALSE;
+        elevenlabs_lane_prebuffer_reset(lane);
+    }
+    atomic_store(&synth_channel->segment_playing, 0);
+    synth_channel->speak_time = apr_time_now();
+    synth_channel->first_audio_sent = FALSE;
+    synth_channel->prebuffer_held = 0;
+    synth_channel->underruns = 0;
+    synth_channel->underrun = FALSE;
+    atomic_store(&synth_channel->paused, 0);
     synth_channel->speak_request = request;
     synth_channel->stop_response = NULL;
 	synth_channel->progress_counter = 0;
+    
+    if (stream_input) {
+        return elevenlabs_channel_speak_stream(channel, request, response, voice_id, text);
+    }
+    
+    synth_channel->segments = elevenlabs_text_segment(request->pool, text, config,
+                                                      &synth_channel->segment_count);
+    synth_channel->segment_next = 0;
+    /* The lane clients take these with each start, under their own lock */
+    synth_channel->voice_id = voice_id;
+    /* Files were cached per whole prompt before v2 keys, never per segment */
+    synth_channel->legacy_text = synth_channel->segment_count == 1 ? elevenlabs_request_legacy_text(request) : NULL;
+    if (synth_channel->segment_count > 1) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+               "SPEAK split into %u segments", synth_channel->segment_count);
+    }
 
-    /* Start synthesis via HTTP client (async thread) */
-    if (synth_channel->http_client) {
-        apt_bool_t success = elevenlabs_http_client_start_synthesis(
-            synth_channel->http_client, text, synth_channel);
-
-        if (!success) {
-            apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR,
-                   "Failed to start synthesis");
-            response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
-            mrcp_engine_channel_message_send(channel, response);
-            return TRUE;
-        }
-
-        /* Set synthesizing flag */
-        synth_channel->synthesizing = TRUE;
+    /* Start the first segment, and as many more as there are lanes to download them
+       (runs on the HTTP worker loops) */
+    synth_channel->synthesizing = TRUE;
+    elevenlabs_channel_segment_advance(synth_channel);
+    if (synth_channel->segment_next == 0) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR,
+               "Failed to start synthesis");
+        synth_channel->synthesizing = FALSE;
+        synth_channel->speak_request = NULL;
+        response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
+        mrcp_engine_channel_message_send(channel, response);
+        return TRUE;
     }
 
     /* Send IN-PROGRESS immediately */
@@ -333,6 +700,29 @@ static apt_bool_t elevenlabs_channel_speak(mrcp_engine_channel_t *channel,
     return TRUE;
 }
 
+/* Silence the channel from its next frame on and cut off whatever is still downloading.
+   Shared by STOP and a killing barge-in; never waits on the network. */
+static void elevenlabs_channel_halt(elevenlabs_synth_channel_t *synth_channel)
+{
+    atomic_store(&synth_channel->paused, 0);
+    /* Clear audio buffers immediately; the media thread unmaps a cache hit on its next read */
+    for (unsigned i = 0; i < synth_channel->lane_count; i++) {
+        audio_buffer_clear(synth_channel->lanes[i].audio_buffer);
+    }
+    elevenlabs_channel_playback_cancel(synth_channel);
+    elevenlabs_ws_session_cancel(synth_channel->ws, synth_channel->ws_context);
+    synth_channel->ws_context = 0;
+    
+    /* Stop ongoing synthesis; the transfers are cut off and detached in the background */
+    if (synth_channel->synthesizing) {
+        elevenlabs_channel_lanes_stop(synth_channel);
+        synth_channel->synthesizing = FALSE;
+        
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, 
+               "Synthesis stopped, HTTP transfers cancelled");
+    }
+}
+
 static apt_bool_t elevenlabs_channel_stop(mrcp_engine_channel_t *channel, 
                                          mrcp_message_t *request, 
                                          mrcp_message_t *response)
@@ -340,26 +730,20 @@ static apt_bool_t elevenlabs_channel_stop(mrcp_engine_channel_t *channel,
     elevenlabs_synth_channel_t *synth_channel = channel->method_obj;
     
     apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, 
-           "Processing STOP request [channel=%p, http_client=%p]",
-           (void*)synth_channel, (void*)synth_channel->http_client);
+           "Processing STOP request [channel=%p]", (void*)synth_channel);
     
-    /* Clear audio buffer immediately */
-    if (synth_channel->audio_buffer) {
-        audio_buffer_clear(synth_channel->audio_buffer);
-    }
-    
-    /* Stop ongoing synthesis */
-    if (synth_channel->synthesizing && synth_channel->http_client) {
-        elevenlabs_http_client_stop(synth_channel->http_client);
-        synth_channel->synthesizing = FALSE;
-        
-        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, 
-               "Synthesis stopped, HTTP client terminated");
-    }
+    elevenlabs_channel_halt(synth_channel);
     
     /* Send STOP response immediately, don't wait for stream_read */
     response->start_line.request_state = MRCP_REQUEST_STATE_COMPLETE;
     mrcp_engine_channel_message_send(channel, response);
+    elevenlabs_metrics_t *metrics = synth_channel->elevenlabs_engine->metrics;
+    if (metrics && synth_channel->request_time) {
+        apr_interval_time_t latency = apr_time_now() - synth_channel->request_time;
+        elevenlabs_histogram_observe(&metrics->stop, latency);
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+               "STOP answered %ld us after it arrived [channel=%p]", (long)latency, (void*)synth_channel);
+    }
     
     /* If there was an active SPEAK request, send SPEAK-COMPLETE with error cause */
     if (synth_channel->speak_request) {
@@ -374,6 +758,97 @@ static apt_bool_t elevenlabs_channel_stop(mrcp_engine_channel_t *channel,
     return TRUE;
 }
 
+/* PAUSE: the media thread stops sending frames but keeps the queued audio. Downloads
+   go on until their ring reaches high water and then stay paused by the backpressure,
+   so a pause of any length holds at most that much audio and no bandwidth. */
+static apt_bool_t elevenlabs_channel_pause(mrcp_engine_channel_t *channel, 
+                                          mrcp_message_t *request, 
+                                          mrcp_message_t *response)
+{
+    elevenlabs_synth_channel_t *synth_channel = channel->method_obj;
+    
+    if (synth_channel->speak_request && synth_channel->synthesizing &&
+        !atomic_exchange(&synth_channel->paused, 1)) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, 
+               "Playback paused [channel=%p]", (void*)synth_channel);
+    }
+    response->start_line.request_state = MRCP_REQUEST_STATE_COMPLETE;
+    mrcp_engine_channel_message_send(channel, response);
+    return TRUE;
+}
+
+/* RESUME: playback continues from the next queued byte; the first drained frame
+   lets paused downloads go on */
+static apt_bool_t elevenlabs_channel_resume(mrcp_engine_channel_t *channel, 
+                                           mrcp_message_t *request, 
+                                           mrcp_message_t *response)
+{
+    elevenlabs_synth_channel_t *synth_channel = channel->method_obj;
+    
+    if (atomic_exchange(&synth_channel->paused, 0)) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, 
+               "Playback resumed [channel=%p]", (void*)synth_channel);
+    }
+    response->start_line.request_state = MRCP_REQUEST_STATE_COMPLETE;
+    mrcp_engine_channel_message_send(channel, response);
+    return TRUE;
+}
+
+/* BARGE-IN-OCCURRED: the caller spoke over the prompt. Unless the SPEAK was sent with
+   Kill-On-Barge-In: false it ends here, like a STOP, but completes with the barge-in
+   cause; the media thread reports how long the caller still heard it. */
+static apt_bool_t elevenlabs_channel_barge_in(mrcp_engine_channel_t *channel, 
+                                             mrcp_message_t *request, 
+                                             mrcp_message_t *response)
+{
+    elevenlabs_synth_channel_t *synth_channel = channel->method_obj;
+    mrcp_message_t *speak_request = synth_channel->speak_request;
+    
+    /* Kill-On-Barge-In defaults to true */
+    apt_bool_t kill = speak_request != NULL;
+    if (kill && mrcp_resource_header_property_check(speak_request, SYNTHESIZER_HEADER_KILL_ON_BARGE_IN) == TRUE) {
+        mrcp_synth_header_t *synth_header = mrcp_resource_header_get(speak_request);
+        kill = !synth_header || synth_header->kill_on_barge_in;
+    }
+    
+    if (kill) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, 
+               "Processing BARGE-IN-OCCURRED, killing SPEAK [channel=%p]", (void*)synth_channel);
+        elevenlabs_channel_halt(synth_channel);
+        synth_channel->speak_request = NULL;
+        /* After the halt: the frame that takes it is already silent */
+        if (synth_channel->request_time) {
+            atomic_store(&synth_channel->barge_in_time, synth_channel->request_time);
+        }
+    }
+    
+    response->start_line.request_state = MRCP_REQUEST_STATE_COMPLETE;
+    mrcp_engine_channel_message_send(channel, response);
+    if (kill) {
+        elevenlabs_send_speak_complete(channel, speak_request, SYNTHESIZER_COMPLETION_CAUSE_BARGE_IN);
+    }
+    return TRUE;
+}
+
+/* CONTROL during a streamed SPEAK carries its next text, and/or its end */
+static apt_bool_t elevenlabs_channel_control(mrcp_engine_channel_t *channel, 
+                                            mrcp_message_t *request, 
+                                            mrcp_message_t *response)
+{
+    elevenlabs_synth_channel_t *synth_channel = channel->method_obj;
+    
+    if (synth_channel->speak_request && synth_channel->ws_context) {
+        char *text = elevenlabs_request_text(request);
+        apt_bool_t end = elevenlabs_vendor_param_flag(request, ELEVENLABS_VSP_STREAM_END);
+        if (((text && *text) || end) &&
+            !elevenlabs_ws_session_append(synth_channel->ws, request->pool, synth_channel->ws_context, text, end)) {
+            response->start_line.status_code = MRCP_STATUS_CODE_METHOD_NOT_VALID;
+        }
+    }
+    mrcp_engine_channel_message_send(channel, response);
+    return TRUE;
+}
+
 static apt_bool_t elevenlabs_channel_request_dispatch(mrcp_engine_channel_t *channel, 
                                                      mrcp_message_t *request)
 {
@@ -389,12 +864,24 @@ static apt_bool_t elevenlabs_channel_request_dispatch(mrcp_engine_channel_t *cha
             processed = elevenlabs_channel_stop(channel, request, response);
             break;
             
-        case SYNTHESIZER_SET_PARAMS:
-        case SYNTHESIZER_GET_PARAMS:
+        case SYNTHESIZER_CONTROL:
+            processed = elevenlabs_channel_control(channel, request, response);
+            break;
+            
         case SYNTHESIZER_PAUSE:
+            processed = elevenlabs_channel_pause(channel, request, response);
+            break;
+            
         case SYNTHESIZER_RESUME:
+            processed = elevenlabs_channel_resume(channel, request, response);
+            break;
+            
         case SYNTHESIZER_BARGE_IN_OCCURRED:
-        case SYNTHESIZER_CONTROL:
+            processed = elevenlabs_channel_barge_in(channel, request, response);
+            break;
+            
+        case SYNTHESIZER_SET_PARAMS:
+        case SYNTHESIZER_GET_PARAMS:
         case SYNTHESIZER_DEFINE_LEXICON:
             /* Send async response for unhandled requests */
             mrcp_engine_channel_message_send(channel, response);
@@ -435,66 +922,253 @@ apt_bool_t elevenlabs_synth_stream_read(mpf_audio_stream_t *stream, mpf_frame_t
 {
     elevenlabs_synth_channel_t *synth_channel = stream->obj;
     
+    /* Release cancelled mappings and cleared audio even while idle */
+    for (unsigned i = 0; i < synth_channel->lane_count; i++) {
+        elevenlabs_channel_playback_sync(&synth_channel->lanes[i]);
+        audio_buffer_collect(synth_channel->lanes[i].audio_buffer);
+    }
+    
+    /* First frame after a killing barge-in: the caller no longer hears the prompt */
+    apr_time_t barge_in_time = atomic_exchange(&synth_channel->barge_in_time, 0);
+    if (barge_in_time) {
+        apr_interval_time_t latency = apr_time_now() - barge_in_time;
+        elevenlabs_metrics_t *metrics = synth_channel->elevenlabs_engine->metrics;
+        if (metrics) {
+            elevenlabs_histogram_observe(&metrics->barge_in, latency);
+        }
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+               "Barge-in silenced playback %ld us after it arrived [channel=%p]", (long)latency, (void*)synth_channel);
+    }
+    
+    /* Paused: no frames at all. Nothing is read, so the rings keep their audio and
+       their transfers stay paused at high water. */
+    if (atomic_load(&synth_channel->paused)) {
+        if (!synth_channel->paused_since) {
+            synth_channel->paused_since = apr_time_now();
+        }
+        return TRUE;
+    }
+    if (synth_channel->paused_since) {
+        elevenlabs_channel_prebuffer_resume(synth_channel, apr_time_now() - synth_channel->paused_since);
+        synth_channel->paused_since = 0;
+    }
+    
     /* Check if there is active SPEAK request and synthesis is in progress */
     if (synth_channel->speak_request && synth_channel->synthesizing) {
-        apr_size_t bytes_read = audio_buffer_read_frame(
-            synth_channel->audio_buffer, 
-            frame->codec_frame.buffer, 
-            frame->codec_frame.size);
+        elevenlabs_synth_engine_t *engine = synth_channel->elevenlabs_engine;
+        uint8_t *buffer = frame->codec_frame.buffer;
+        apr_size_t frame_size = frame->codec_frame.size;
+        apr_size_t bytes_read = 0;
+        unsigned playing = atomic_load(&synth_channel->segment_playing);
+        elevenlabs_synth_lane_t *lane = NULL;
+        apr_time_t now = apr_time_now();
+        
+        /* Fill the frame from the playing segment and carry on into the next one at a
+           boundary, so the stitched stream has no gap */
+        while (playing < synth_channel->segment_count) {
+            lane = &synth_channel->lanes[playing % synth_channel->lane_count];
+            if (!elevenlabs_lane_prebuffer(synth_channel, lane, playing, frame_size, now)) {
+                break;
+            }
+            apr_size_t n = elevenlabs_lane_read(lane, buffer + bytes_read, frame_size - bytes_read);
+            if (n > 0) {
+                lane->played = TRUE;
+                bytes_read += n;
+            }
+            if (bytes_read == frame_size || !elevenlabs_lane_finished(lane, playing)) {
+                break;
+            }
+            atomic_fetch_add(&engine->stats_segments, 1);
+            if (lane->from_cache) {
+                atomic_fetch_add(&engine->stats_segments_cached, 1);
+                lane->from_cache = FALSE;
+            }
+            atomic_store(&lane->segment, ELEVENLABS_SEGMENT_NONE);
+            elevenlabs_lane_prebuffer_reset(lane);
+            playing++;
+            atomic_store(&synth_channel->segment_playing, playing);
+            if (synth_channel->segment_next < synth_channel->segment_count) {
+                /* The lane is free: let the consumer task start the next download on it */
+                elevenlabs_synth_msg_signal(ELEVENLABS_SYNTH_MSG_SEGMENT_NEXT, synth_channel->channel, NULL);
+            }
+        }
+        
+        /* Underrun: the segment playing ran dry midway; counted once per gap */
+        apt_bool_t underrun = lane && lane->played && bytes_read < frame_size &&
+                              playing < synth_channel->segment_count;
+        if (underrun && !synth_channel->underrun) {
+            synth_channel->underruns++;
+            atomic_fetch_add(&engine->stats_underruns, 1);
+            apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG,
+                   "Underrun in segment %u [channel=%p]", playing, (void*)synth_channel);
+        }
+        synth_channel->underrun = underrun;
+        
+        /* Let a paused transfer continue once playback drained below low water */
+        if (lane && lane->http_client) {
+            elevenlabs_http_client_drained(lane->http_client);
+        }
         
         if (bytes_read > 0) {
+            if (bytes_read < frame_size) {
+                memset(buffer + bytes_read, 0, frame_size - bytes_read);
+            }
             frame->type |= MEDIA_FRAME_TYPE_AUDIO;
             apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG, 
                    "Sent audio frame: %zu bytes", bytes_read);
 			synth_channel->progress_counter = 0; /* Reset counter after sending data */
-        } else {
-            /* No audio data available, check if synthesis is still in progress */
-            if (!synth_channel->http_client->stopped) {
-                /* Still synthesizing, return silence and send progress updates */
-                memset(frame->codec_frame.buffer, 0, frame->codec_frame.size);
-                frame->type |= MEDIA_FRAME_TYPE_AUDIO;
-                
-                /* Send IN-PROGRESS every ~500ms to keep the session alive */
-                synth_channel->progress_counter++;
-                if (synth_channel->progress_counter >= 25) { /* 25 frames * 20ms = 500ms */
-                    mrcp_message_t *in_progress = mrcp_response_create(synth_channel->speak_request, synth_channel->speak_request->pool);
-                    in_progress->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
-                    mrcp_engine_channel_message_send(synth_channel->channel, in_progress);
-                    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG, 
-                               "Sent IN-PROGRESS while waiting for audio data");
-                    synth_channel->progress_counter = 0;
+            if (!synth_channel->first_audio_sent) {
+                apr_time_t latency = apr_time_now() - synth_channel->speak_time;
+                synth_channel->first_audio_sent = TRUE;
+                atomic_fetch_add(&engine->stats_speaks, 1);
+                atomic_fetch_add(&engine->stats_first_audio_ms, (unsigned long)apr_time_as_msec(latency));
+                if (engine->metrics) {
+                    elevenlabs_histogram_observe(&engine->metrics->first_audio, latency);
                 }
-            } else {
-                /* Synthesis complete (http client stopped and buffer is empty) */
                 apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
-                       "Synthesis complete.");
-                
-                elevenlabs_send_speak_complete(synth_channel->channel, 
-                                             synth_channel->speak_request, 
-                                             SYNTHESIZER_COMPLETION_CAUSE_NORMAL);
-                synth_channel->speak_request = NULL;
-                synth_channel->synthesizing = FALSE;
+                       "First audio %ld ms after SPEAK [channel=%p]",
+                       (long)apr_time_as_msec(latency), (void*)synth_channel);
+            }
+        } else if (playing < synth_channel->segment_count) {
+            /* Still synthesizing, return silence and send progress updates */
+            memset(buffer, 0, frame_size);
+            frame->type |= MEDIA_FRAME_TYPE_AUDIO;
+            
+            /* Send IN-PROGRESS every ~500ms to keep the session alive */
+            synth_channel->progress_counter++;
+            if (synth_channel->progress_counter >= 25) { /* 25 frames * 20ms = 500ms */
+                mrcp_message_t *in_progress = mrcp_response_create(synth_channel->speak_request, synth_channel->speak_request->pool);
+                in_progress->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
+                mrcp_engine_channel_message_send(synth_channel->channel, in_progress);
+                apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG, 
+                           "Sent IN-PROGRESS while waiting for audio data");
+                synth_channel->progress_counter = 0;
             }
         }
+        
+        if (playing >= synth_channel->segment_count) {
+            /* Synthesis complete (every segment's client stopped and its buffer played) */
+            apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+                   "Synthesis complete (held back %ld ms, %u underruns).",
+                   (long)apr_time_as_msec(synth_channel->prebuffer_held), synth_channel->underruns);
+            
+            elevenlabs_send_speak_complete(synth_channel->channel, 
+                                         synth_channel->speak_request, 
+                                         SYNTHESIZER_COMPLETION_CAUSE_NORMAL);
+            synth_channel->speak_request = NULL;
+            synth_channel->synthesizing = FALSE;
+        }
     }
     
     return TRUE;
 }
 
 /* Utility functions */
+
+/* Append code point cp as UTF-8; there is room since a reference is longer than its encoding */
+static char* elevenlabs_put_utf8(char *dst, unsigned long cp)
+{
+    if (cp < 0x80) {
+        *dst++ = (char)cp;
+    } else if (cp < 0x800) {
+        *dst++ = (char)(0xC0 | (cp >> 6));
+        *dst++ = (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *dst++ = (char)(0xE0 | (cp >> 12));
+        *dst++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *dst++ = (char)(0x80 | (cp & 0x3F));
+    } else {
+        *dst++ = (char)(0xF0 | (cp >> 18));
+        *dst++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+        *dst++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *dst++ = (char)(0x80 | (cp & 0x3F));
+    }
+    return dst;
+}
+
+/* Decode the character reference at src ("&amp;", "&#233;", "&#xE9;"); returns the
+   number of input bytes consumed, or 0 to keep the '&' literally */
+static apr_size_t elevenlabs_decode_entity(const char *src, char **dst)
+{
+    static const struct { const char *name; char ch; } named[] = {
+        { "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' }, { "&quot;", '"' }, { "&apos;", '\'' }
+    };
+    for (apr_size_t i = 0; i < sizeof(named) / sizeof(named[0]); i++) {
+        apr_size_t len = strlen(named[i].name);
+        if (strncmp(src, named[i].name, len) == 0) {
+            *(*dst)++ = named[i].ch;
+            return len;
+        }
+    }
+    if (src[1] == '#') {
+        char *end = NULL;
+        apt_bool_t is_hex = (src[2] == 'x' || src[2] == 'X');
+        const char *digits = src + (is_hex ? 3 : 2);
+        unsigned long cp = strtoul(digits, &end, is_hex ? 16 : 10);
+        if (end && end > digits && *end == ';' && cp > 0 && cp <= 0x10FFFF) {
+            *dst = elevenlabs_put_utf8(*dst, cp);
+            return (apr_size_t)(end - src) + 1;
+        }
+    }
+    return 0;
+}
+
+/* Reduce SSML to the text it speaks: tags dropped with each one read as a word break
+   (so "<s>one</s><s>two</s>" is not "onetwo"), comments skipped, CDATA kept verbatim
+   and character references decoded. Whitespace is folded later, together with
+   plain-text prompts. */
 static char* elevenlabs_extract_text_from_ssml(const char *ssml, apr_pool_t *pool)
 {
     if (!ssml || !pool) {
         return NULL;
     }
     
-    /* Simple SSML tag removal - in production, use proper XML parser */
     char *text = apr_palloc(pool, strlen(ssml) + 1);
     char *dst = text;
     const char *src = ssml;
-    int in_tag = 0;
     
     while (*src) {
+        if (strncmp(src, "<!--", 4) == 0) {
+            const char *end = strstr(src + 4, "-->");
+            src = end ? end + 3 : src + strlen(src);
+            *dst++ = ' ';
+        } else if (strncmp(src, "<![CDATA[", 9) == 0) {
+            const char *start = src + 9;
+            const char *end = strstr(start, "]]>");
+            apr_size_t len = end ? (apr_size_t)(end - start) : strlen(start);
+            memcpy(dst, start, len);
+            dst += len;
+            src = end ? end + 3 : start + len;
+        } else if (*src == '<') {
+            /* Declarations, processing instructions and elements alike */
+            const char *end = strchr(src, '>');
+            src = end ? end + 1 : src + strlen(src);
+            *dst++ = ' ';
+        } else if (*src == '&') {
+            apr_size_t used = elevenlabs_decode_entity(src, &dst);
+            if (used) {
+                src += used;
+            } else {
+                *dst++ = *src++;
+            }
+        } else {
+            *dst++ = *src++;
+        }
+    }
+    *dst = '\0';
+    
+    return text;
+}
+
+/* The extraction cache keys were computed on before v2: tags deleted outright, entities
+   left as written. Only used to find and migrate files cached then. */
+static char* elevenlabs_extract_text_from_ssml_legacy(const char *ssml, apr_pool_t *pool)
+{
+    char *text = apr_palloc(pool, strlen(ssml) + 1);
+    char *dst = text;
+    int in_tag = 0;
+    
+    for (const char *src = ssml; *src; src++) {
         if (*src == '<') {
             in_tag = 1;
         } else if (*src == '>') {
@@ -502,7 +1176,6 @@ static char* elevenlabs_extract_text_from_ssml(const char *ssml, apr_pool_t *poo
         } else if (!in_tag) {
             *dst++ = *src;
         }
-        src++;
     }
     *dst = '\0';
     
@@ -9,8 +9,9 @@
  */
 
 #include "elevenlabs_synth.h"
-#include "ulaw_decode.h"
+#include "g711_decode.h"
 #include "apr_xml.h"
+#include "apr_strings.h"
 #include "apr_file_io.h"
 #include "curl/curl.h"
 #include <string.h>
@@ -67,6 +68,38 @@ static void elevenlabs_config_set_defaults(elevenlabs_config_t *config)
     /* Caching defaults */
     config->cache_enabled = DEFAULT_CACHE_ENABLED;
     config->cache_dir = (char*)DEFAULT_CACHE_DIR;
+    config->cache_io_threads = DEFAULT_CACHE_IO_THREADS;
+    config->cache_memory_max_bytes = DEFAULT_CACHE_MEMORY_MAX_BYTES;
+    config->cache_max_bytes = DEFAULT_CACHE_MAX_BYTES;
+    config->cache_max_entries = DEFAULT_CACHE_MAX_ENTRIES;
+    config->cache_eviction_policy = DEFAULT_CACHE_EVICTION_POLICY;
+    config->cache_preload_manifest = NULL;
+    config->cache_single_flight = DEFAULT_CACHE_SINGLE_FLIGHT;
+    /* Segmentation defaults */
+    config->segment_mode = DEFAULT_SEGMENT_MODE;
+    config->segment_lookahead = DEFAULT_SEGMENT_LOOKAHEAD;
+    config->segment_min_chars = DEFAULT_SEGMENT_MIN_CHARS;
+    config->segment_max_chars = DEFAULT_SEGMENT_MAX_CHARS;
+    /* Buffering defaults */
+    config->buffer_high_water_ms = DEFAULT_BUFFER_HIGH_WATER_MS;
+    config->buffer_low_water_ms = DEFAULT_BUFFER_LOW_WATER_MS;
+    /* HTTP event loops */
+    config->consumer_tasks = DEFAULT_CONSUMER_TASKS;
+    config->http_worker_threads = DEFAULT_HTTP_WORKER_THREADS;
+    config->http_warm_connections = DEFAULT_HTTP_WARM_CONNECTIONS;
+    config->http_keepalive_interval_ms = DEFAULT_HTTP_KEEPALIVE_INTERVAL_MS;
+    /* Hedged requests */
+    config->hedge_budget_percent = DEFAULT_HEDGE_BUDGET_PERCENT;
+    config->hedge_after_ms = DEFAULT_HEDGE_AFTER_MS;
+    config->hedge_percentile = DEFAULT_HEDGE_PERCENTILE;
+    /* Metrics */
+    config->metrics_file = NULL;
+    config->metrics_interval_ms = DEFAULT_METRICS_INTERVAL_MS;
+    /* Playback */
+    config->prebuffer_max_ms = DEFAULT_PREBUFFER_MAX_MS;
+    /* WebSocket stream input */
+    config->ws_base_url = DEFAULT_WS_BASE_URL;
+    config->ws_inactivity_timeout = DEFAULT_WS_INACTIVITY_TIMEOUT;
 }
 
 /**
@@ -75,15 +108,14 @@ static void elevenlabs_config_set_defaults(elevenlabs_config_t *config)
 /**
  * Parse configuration from XML
  */
-static apt_bool_t elevenlabs_config_parse(elevenlabs_config_t *config, apr_pool_t *pool)
+apt_bool_t elevenlabs_config_load(elevenlabs_config_t *config, const char *config_file, apr_pool_t *pool)
 {
-    if (!config || !pool) return FALSE;
+    if (!config || !config_file || !pool) return FALSE;
     
     /* Set defaults first */
     elevenlabs_config_set_defaults(config);
     
     /* Try to read configuration from mrcpengine.xml */
-    const char *config_file = "conf/mrcpengine.xml";
     apr_file_t *file;
     apr_status_t status = apr_file_open(&file, config_file, APR_READ, APR_OS_DEFAULT, pool);
     
@@ -209,6 +241,83 @@ static apt_bool_t elevenlabs_config_parse(elevenlabs_config_t *config, apr_pool_
                                 else if (strcmp(name, "cache_dir") == 0 || strcmp(name, "cache-dir") == 0) {
                                     config->cache_dir = apr_pstrdup(pool, value);
                                 }
+                                else if (strcmp(name, "cache_io_threads") == 0) {
+                                    config->cache_io_threads = atoi(value);
+                                }
+                                else if (strcmp(name, "cache_memory_max_bytes") == 0) {
+                                    apr_int64_t bytes = apr_strtoi64(value, NULL, 10);
+                                    config->cache_memory_max_bytes = bytes > 0 ? (apr_size_t)bytes : 0;
+                                }
+                                else if (strcmp(name, "cache_max_bytes") == 0) {
+                                    apr_int64_t bytes = apr_strtoi64(value, NULL, 10);
+                                    config->cache_max_bytes = bytes > 0 ? (apr_size_t)bytes : 0;
+                                }
+                                else if (strcmp(name, "cache_max_entries") == 0) {
+                                    config->cache_max_entries = atoi(value);
+                                }
+                                else if (strcmp(name, "cache_eviction_policy") == 0) {
+                                    config->cache_eviction_policy = apr_pstrdup(pool, value);
+                                }
+                                else if (strcmp(name, "cache_preload_manifest") == 0) {
+                                    config->cache_preload_manifest = apr_pstrdup(pool, value);
+                                }
+                                else if (strcmp(name, "cache_single_flight") == 0) {
+                                    config->cache_single_flight = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+                                }
+                                else if (strcmp(name, "segment_mode") == 0) {
+                                    config->segment_mode = apr_pstrdup(pool, value);
+                                }
+                                else if (strcmp(name, "segment_lookahead") == 0) {
+                                    config->segment_lookahead = atoi(value);
+                                }
+                                else if (strcmp(name, "segment_min_chars") == 0) {
+                                    config->segment_min_chars = atoi(value);
+                                }
+                                else if (strcmp(name, "segment_max_chars") == 0) {
+                                    config->segment_max_chars = atoi(value);
+                                }
+                                else if (strcmp(name, "buffer_high_water_ms") == 0) {
+                                    config->buffer_high_water_ms = atoi(value);
+                                }
+                                else if (strcmp(name, "buffer_low_water_ms") == 0) {
+                                    config->buffer_low_water_ms = atoi(value);
+                                }
+                                else if (strcmp(name, "consumer_tasks") == 0) {
+                                    config->consumer_tasks = atoi(value);
+                                }
+                                else if (strcmp(name, "http_worker_threads") == 0) {
+                                    config->http_worker_threads = atoi(value);
+                                }
+                                else if (strcmp(name, "http_warm_connections") == 0) {
+                                    config->http_warm_connections = atoi(value);
+                                }
+                                else if (strcmp(name, "http_keepalive_interval_ms") == 0) {
+                                    config->http_keepalive_interval_ms = atoi(value);
+                                }
+                                else if (strcmp(name, "hedge_budget_percent") == 0) {
+                                    config->hedge_budget_percent = atoi(value);
+                                }
+                                else if (strcmp(name, "hedge_after_ms") == 0) {
+                                    config->hedge_after_ms = atoi(value);
+                                }
+                                else if (strcmp(name, "hedge_percentile") == 0) {
+                                    config->hedge_percentile = atoi(value);
+                                }
+                                else if (strcmp(name, "metrics_file") == 0) {
+                                    config->metrics_file = *value ? apr_pstrdup(pool, value) : NULL;
+                                }
+                                else if (strcmp(name, "metrics_interval_ms") == 0) {
+                                    config->metrics_interval_ms = atoi(value);
+                                }
+                                else if (strcmp(name, "prebuffer_max_ms") == 0) {
+                                    config->prebuffer_max_ms = atoi(value);
+                                }
+                                else if (strcmp(name, "ws_base_url") == 0) {
+                                    config->ws_base_url = apr_pstrdup(pool, value);
+                                }
+                                else if (strcmp(name, "ws_inactivity_timeout") == 0) {
+                                    config->ws_inactivity_timeout = atoi(value);
+                                }
                             }
                         }
                     }
@@ -228,9 +337,118 @@ static apt_bool_t elevenlabs_config_parse(elevenlabs_config_t *config, apr_pool_
         return FALSE;
     }
 
+    /* Keep the high-water mark above a couple of frames and the low-water mark below it */
+    if (config->buffer_high_water_ms < 2 * config->chunk_ms) {
+        config->buffer_high_water_ms = DEFAULT_BUFFER_HIGH_WATER_MS;
+    }
+    if (config->buffer_low_water_ms >= config->buffer_high_water_ms) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                "buffer_low_water_ms=%u must be below buffer_high_water_ms=%u, using %u",
+                config->buffer_low_water_ms, config->buffer_high_water_ms, config->buffer_high_water_ms / 2);
+        config->buffer_low_water_ms = config->buffer_high_water_ms / 2;
+    }
+
     apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, 
            "Configuration loaded: voice_id=%s, model_id=%s, output_format=%s, chunk_ms=%u, base_url=%s, cache_enabled=%d, cache_dir=%s",
            config->voice_id, config->model_id, config->output_format, config->chunk_ms, config->base_url, config->cache_enabled, config->cache_dir);
+    if (strcasecmp(config->cache_eviction_policy, "lru") != 0 &&
+        strcasecmp(config->cache_eviction_policy, "lfu") != 0) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                "Unknown cache_eviction_policy=%s, using %s",
+                config->cache_eviction_policy, DEFAULT_CACHE_EVICTION_POLICY);
+        config->cache_eviction_policy = DEFAULT_CACHE_EVICTION_POLICY;
+    }
+    if (strcasecmp(config->segment_mode, "none") != 0 &&
+        strcasecmp(config->segment_mode, "sentence") != 0 &&
+        strcasecmp(config->segment_mode, "clause") != 0) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                "Unknown segment_mode=%s, using %s",
+                config->segment_mode, DEFAULT_SEGMENT_MODE);
+        config->segment_mode = DEFAULT_SEGMENT_MODE;
+    }
+    if (config->hedge_budget_percent > 100) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                "hedge_budget_percent=%u is above 100, using 100", config->hedge_budget_percent);
+        config->hedge_budget_percent = 100;
+    }
+    if (config->hedge_percentile < 50 || config->hedge_percentile > 99) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                "hedge_percentile=%u is out of range 50..99, using %u",
+                config->hedge_percentile, DEFAULT_HEDGE_PERCENTILE);
+        config->hedge_percentile = DEFAULT_HEDGE_PERCENTILE;
+    }
+    if (config->hedge_budget_percent) {
+        if (config->hedge_after_ms) {
+            apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+                   "Hedging: duplicate requests without audio after %u ms, budget %u%% of requests",
+                   config->hedge_after_ms, config->hedge_budget_percent);
+        } else {
+            apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+                   "Hedging: duplicate requests without audio after p%u of recent TTFB, budget %u%% of requests",
+                   config->hedge_percentile, config->hedge_budget_percent);
+        }
+    }
+    if (config->metrics_interval_ms < MIN_METRICS_INTERVAL_MS) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                "metrics_interval_ms=%u is below %u, using %u",
+                config->metrics_interval_ms, MIN_METRICS_INTERVAL_MS, MIN_METRICS_INTERVAL_MS);
+        config->metrics_interval_ms = MIN_METRICS_INTERVAL_MS;
+    }
+    /* A hold longer than the ring can queue would only stall the transfer */
+    uint32_t prebuffer_limit = config->buffer_high_water_ms < MAX_PREBUFFER_MAX_MS ?
+                               config->buffer_high_water_ms : MAX_PREBUFFER_MAX_MS;
+    if (config->prebuffer_max_ms > prebuffer_limit) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                "prebuffer_max_ms=%u is above %u, using %u",
+                config->prebuffer_max_ms, prebuffer_limit, prebuffer_limit);
+        config->prebuffer_max_ms = prebuffer_limit;
+    }
+    if (config->ws_inactivity_timeout == 0 || config->ws_inactivity_timeout > DEFAULT_WS_INACTIVITY_TIMEOUT) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                "ws_inactivity_timeout=%u is out of range 1..%u, using %u",
+                config->ws_inactivity_timeout, DEFAULT_WS_INACTIVITY_TIMEOUT, DEFAULT_WS_INACTIVITY_TIMEOUT);
+        config->ws_inactivity_timeout = DEFAULT_WS_INACTIVITY_TIMEOUT;
+    }
+    if (config->segment_lookahead > MAX_SEGMENT_LOOKAHEAD) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                "segment_lookahead=%u is above the maximum, using %u",
+                config->segment_lookahead, MAX_SEGMENT_LOOKAHEAD);
+        config->segment_lookahead = MAX_SEGMENT_LOOKAHEAD;
+    }
+    if (strcasecmp(config->segment_mode, "none") != 0) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+               "Segmentation: mode=%s, lookahead=%u, min_chars=%u, max_chars=%u",
+               config->segment_mode, config->segment_lookahead,
+               config->segment_min_chars, config->segment_max_chars);
+    }
+    if (config->cache_enabled) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+               "Cache: io_threads=%u, memory_max_bytes=%lu%s, single_flight=%d",
+               config->cache_io_threads, (unsigned long)config->cache_memory_max_bytes,
+               config->cache_memory_max_bytes ? "" : " (memory tier disabled)",
+               config->cache_single_flight);
+    }
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+           "Buffering: high_water=%u ms, low_water=%u ms",
+           config->buffer_high_water_ms, config->buffer_low_water_ms);
+    if (config->consumer_tasks == 0 || config->consumer_tasks > MAX_CONSUMER_TASKS) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                "consumer_tasks=%u is out of range 1..%u, using %u",
+                config->consumer_tasks, MAX_CONSUMER_TASKS,
+                config->consumer_tasks ? MAX_CONSUMER_TASKS : DEFAULT_CONSUMER_TASKS);
+        config->consumer_tasks = config->consumer_tasks ? MAX_CONSUMER_TASKS : DEFAULT_CONSUMER_TASKS;
+    }
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+           "Consumer tasks: %u", config->consumer_tasks);
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+           "HTTP worker threads: %u%s",
+           config->http_worker_threads, config->http_worker_threads ? "" : " (one per CPU)");
+    if (config->http_warm_connections > MAX_HTTP_WARM_CONNECTIONS) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                "http_warm_connections=%u is above the maximum, using %u",
+                config->http_warm_connections, MAX_HTTP_WARM_CONNECTIONS);
+        config->http_warm_connections = MAX_HTTP_WARM_CONNECTIONS;
+    }
 
     return TRUE;
 }
@@ -388,33 +606,66 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
     }
     
     elevenlabs_engine->pool = pool;
-    
-    /* Parse configuration */
-    if (!elevenlabs_config_parse(&elevenlabs_engine->config, pool)) {
-                apt_log(APT_LOG_MARK, APT_PRIO_ERROR,
-               "Failed to parse configuration");
+    elevenlabs_engine->http_pool = NULL;
+    elevenlabs_engine->io_pool = NULL;
+    elevenlabs_engine->memory_cache = NULL;
+    elevenlabs_engine->disk_cache = NULL;
+    elevenlabs_engine->flights = NULL;
+    elevenlabs_engine->metrics = elevenlabs_metrics_create(pool);
+    elevenlabs_engine->audio_slab = elevenlabs_slab_create(pool);
+    if (!elevenlabs_engine->audio_slab) {
         return NULL;
     }
+    atomic_init(&elevenlabs_engine->stats_speaks, 0);
+    atomic_init(&elevenlabs_engine->stats_first_audio_ms, 0);
+    atomic_init(&elevenlabs_engine->stats_segments, 0);
+    atomic_init(&elevenlabs_engine->stats_segments_cached, 0);
+    atomic_init(&elevenlabs_engine->stats_prebuffered, 0);
+    atomic_init(&elevenlabs_engine->stats_prebuffer_ms, 0);
+    atomic_init(&elevenlabs_engine->stats_underruns, 0);
     
-    /* Create task/thread to run engine */
-    apt_task_msg_pool_t *msg_pool = apt_task_msg_pool_create_dynamic(sizeof(elevenlabs_synth_msg_t), pool);
-    elevenlabs_engine->task = apt_consumer_task_create(elevenlabs_engine, msg_pool, pool);
-    if (!elevenlabs_engine->task) {
+    /* Parse configuration */
+    if (!elevenlabs_config_load(&elevenlabs_engine->config, ELEVENLABS_CONFIG_FILE, pool)) {
                 apt_log(APT_LOG_MARK, APT_PRIO_ERROR,
-               "Failed to create consumer task");
+               "Failed to parse configuration");
         return NULL;
     }
     
-    apt_task_t *task = apt_consumer_task_base_get(elevenlabs_engine->task);
-    apt_task_name_set(task, ELEVENLABS_SYNTH_ENGINE_TASK_NAME);
-    
-    apt_task_vtable_t *vtable = apt_task_vtable_get(task);
-    if (vtable) {
-        vtable->process_msg = elevenlabs_synth_msg_process;
+    /* Create the tasks/threads to run engine; channels are spread over them at creation */
+    elevenlabs_engine->shard_count = elevenlabs_engine->config.consumer_tasks;
+    elevenlabs_engine->shards = apr_pcalloc(pool, elevenlabs_engine->shard_count * sizeof(elevenlabs_synth_shard_t));
+    for (unsigned i = 0; i < elevenlabs_engine->shard_count; i++) {
+        elevenlabs_synth_shard_t *shard = &elevenlabs_engine->shards[i];
+        shard->engine = elevenlabs_engine;
+        shard->index = i;
+        atomic_init(&shard->queued, 0);
+        atomic_init(&shard->processed, 0);
+        atomic_init(&shard->wait_us, 0);
+        atomic_init(&shard->busy_us, 0);
+        
+        apt_task_msg_pool_t *msg_pool = apt_task_msg_pool_create_dynamic(sizeof(elevenlabs_synth_msg_t), pool);
+        shard->task = apt_consumer_task_create(shard, msg_pool, pool);
+        if (!shard->task) {
+                    apt_log(APT_LOG_MARK, APT_PRIO_ERROR,
+                   "Failed to create consumer task %u", i);
+            return NULL;
+        }
+        
+        apt_task_t *task = apt_consumer_task_base_get(shard->task);
+        apt_task_name_set(task, elevenlabs_engine->shard_count > 1 ?
+                          apr_psprintf(pool, "%s %u", ELEVENLABS_SYNTH_ENGINE_TASK_NAME, i) :
+                          ELEVENLABS_SYNTH_ENGINE_TASK_NAME);
+        
+        apt_task_vtable_t *vtable = apt_task_vtable_get(task);
+        if (vtable) {
+            vtable->process_msg = elevenlabs_synth_msg_process;
+        }
     }
     
-    /* Initialize μ-law decoder */
-    ulaw_decode_init();
+    /* Select the G.711 decode kernel for this CPU */
+    g711_decode_init();
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+           "G.711 decoder kernel: %s", g711_decode_kernel_name());
     
     /* Create engine base */
     return mrcp_engine_create(
@@ -431,10 +682,13 @@ apt_bool_t elevenlabs_synth_engine_destroy(mrcp_engine_t *engine)
 {
     elevenlabs_synth_engine_t *elevenlabs_engine = engine->obj;
     
-    if (elevenlabs_engine->task) {
-        apt_task_t *task = apt_consumer_task_base_get(elevenlabs_engine->task);
-        apt_task_destroy(task);
-        elevenlabs_engine->task = NULL;
+    for (unsigned i = 0; i < elevenlabs_engine->shard_count; i++) {
+        elevenlabs_synth_shard_t *shard = &elevenlabs_engine->shards[i];
+        if (shard->task) {
+            apt_task_t *task = apt_consumer_task_base_get(shard->task);
+            apt_task_destroy(task);
+            shard->task = NULL;
+        }
     }
     
         apt_log(APT_LOG_MARK, APT_PRIO_INFO,
@@ -462,9 +716,22 @@ apt_bool_t elevenlabs_synth_engine_open(mrcp_engine_t *engine)
     apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
            "libcurl initialized globally for multi-session support");
     
-    if (elevenlabs_engine->task) {
-        apt_task_t *task = apt_consumer_task_base_get(elevenlabs_engine->task);
-        apt_task_start(task);
+    /* Shared DNS cache, TLS sessions and the worker loops that run every request */
+    elevenlabs_engine->http_pool = elevenlabs_http_pool_create(elevenlabs_engine->pool,
+                                                               &elevenlabs_engine->config);
+    if (!elevenlabs_engine->http_pool) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR,
+               "Failed to create HTTP pool");
+        curl_global_cleanup();
+        return mrcp_engine_open_respond(engine, FALSE);
+    }
+    elevenlabs_engine->http_pool->metrics = elevenlabs_engine->metrics;
+    
+    for (unsigned i = 0; i < elevenlabs_engine->shard_count; i++) {
+        if (elevenlabs_engine->shards[i].task) {
+            apt_task_t *task = apt_consumer_task_base_get(elevenlabs_engine->shards[i].task);
+            apt_task_start(task);
+        }
     }
 
     /* Prepare cache directory if enabled */
@@ -477,8 +744,52 @@ apt_bool_t elevenlabs_synth_engine_open(mrcp_engine_t *engine)
             apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
                    "Cache directory ready: %s", elevenlabs_engine->config.cache_dir);
         }
+        
+        /* Index of what is on disk; lookups and misses are answered from it */
+        elevenlabs_engine->disk_cache = elevenlabs_cache_disk_open(elevenlabs_engine->pool,
+                                                                   &elevenlabs_engine->config);
+        
+        /* Cache lookups run here, never on the consumer task */
+        apr_size_t io_threads = elevenlabs_engine->config.cache_io_threads ? elevenlabs_engine->config.cache_io_threads : 1;
+        if (apr_thread_pool_create(&elevenlabs_engine->io_pool, io_threads, io_threads, elevenlabs_engine->pool) != APR_SUCCESS) {
+            apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING,
+                   "Failed to create cache I/O workers, lookups will run on the consumer task");
+            elevenlabs_engine->io_pool = NULL;
+        } else {
+            apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+                   "Cache I/O workers: %lu", (unsigned long)io_threads);
+        }
+        
+        /* Shared in-memory tier for the most frequent prompts */
+        if (elevenlabs_engine->config.cache_memory_max_bytes) {
+            elevenlabs_engine->memory_cache = elevenlabs_cache_memory_create(
+                elevenlabs_engine->pool, elevenlabs_engine->config.cache_memory_max_bytes);
+        }
+        
+        /* Hot prompts are in memory before the first call; the I/O workers map them */
+        if (elevenlabs_engine->config.cache_preload_manifest && elevenlabs_engine->memory_cache) {
+            apr_pool_t *preload_pool;
+            if (apr_pool_create(&preload_pool, elevenlabs_engine->pool) == APR_SUCCESS) {
+                apr_array_header_t *entries = elevenlabs_manifest_load(
+                    preload_pool, elevenlabs_engine->config.cache_preload_manifest);
+                elevenlabs_cache_preload(preload_pool, &elevenlabs_engine->config, entries,
+                                         elevenlabs_engine->disk_cache, elevenlabs_engine->memory_cache,
+                                         elevenlabs_engine->io_pool);
+                apr_pool_destroy(preload_pool);
+            }
+        }
+        
+        /* Identical misses in flight at the same time share one download */
+        if (elevenlabs_engine->config.cache_single_flight) {
+            elevenlabs_engine->flights = elevenlabs_flight_registry_create(
+                elevenlabs_engine->pool, elevenlabs_engine->http_pool, elevenlabs_engine->io_pool,
+                elevenlabs_engine->memory_cache, elevenlabs_engine->disk_cache);
+        }
     }
 
+    /* Last: the writer reads the modules set up above */
+    elevenlabs_metrics_writer_start(elevenlabs_engine);
+    
         apt_log(APT_LOG_MARK, APT_PRIO_INFO,
            "ElevenLabs synthesizer engine opened");
     
@@ -492,20 +803,98 @@ apt_bool_t elevenlabs_synth_engine_close(mrcp_engine_t *engine)
 {
     elevenlabs_synth_engine_t *elevenlabs_engine = engine->obj;
     
-    if (elevenlabs_engine->task) {
-        apt_task_t *task = apt_consumer_task_base_get(elevenlabs_engine->task);
-        apt_task_terminate(task, TRUE);
+    for (unsigned i = 0; i < elevenlabs_engine->shard_count; i++) {
+        elevenlabs_synth_shard_t *shard = &elevenlabs_engine->shards[i];
+        if (shard->task) {
+            apt_task_t *task = apt_consumer_task_base_get(shard->task);
+            apt_task_terminate(task, TRUE);
+        }
+        /* An even spread shows in processed; a hot shard in wait time */
+        unsigned long processed = atomic_load(&shard->processed);
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+               "Consumer task %u stats: messages=%lu, avg wait=%lu us, avg processing=%lu us",
+               shard->index, processed,
+               processed ? atomic_load(&shard->wait_us) / processed : 0,
+               processed ? atomic_load(&shard->busy_us) / processed : 0);
+    }
+    
+    /* First: the last snapshot still sees every module */
+    elevenlabs_metrics_writer_stop(elevenlabs_engine);
+    
+    /* Before the I/O workers and HTTP workers its downloads use */
+    if (elevenlabs_engine->flights) {
+        elevenlabs_flight_registry_destroy(elevenlabs_engine->flights);
+        elevenlabs_engine->flights = NULL;
+    }
+    
+    if (elevenlabs_engine->io_pool) {
+        apr_thread_pool_destroy(elevenlabs_engine->io_pool);
+        elevenlabs_engine->io_pool = NULL;
+    }
+    
+    /* After the I/O workers, which fill it */
+    if (elevenlabs_engine->memory_cache) {
+        elevenlabs_cache_memory_destroy(elevenlabs_engine->memory_cache);
+        elevenlabs_engine->memory_cache = NULL;
+    }
+    
+    /* Channels are gone by now, so no easy handle references the share */
+    if (elevenlabs_engine->http_pool) {
+        elevenlabs_http_pool_destroy(elevenlabs_engine->http_pool);
+        elevenlabs_engine->http_pool = NULL;
+    }
+    
+    /* Channels have returned their blocks */
+    elevenlabs_slab_t *slab = elevenlabs_engine->audio_slab;
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+           "Audio slab stats (%u KB blocks): peak in use=%lu blocks, allocated=%lu, spare=%lu",
+           ELEVENLABS_AUDIO_BLOCK_SIZE / 1024, atomic_load(&slab->peak),
+           atomic_load(&slab->blocks), atomic_load(&slab->spare));
+    elevenlabs_slab_destroy(slab);
+    
+    /* Last: finished downloads and lookups update the index until here */
+    if (elevenlabs_engine->disk_cache) {
+        elevenlabs_cache_disk_close(elevenlabs_engine->disk_cache);
+        elevenlabs_engine->disk_cache = NULL;
     }
     
     /* Cleanup libcurl global resources */
     curl_global_cleanup();
     
+    /* Compare runs with segment_mode none and sentence on the same prompts */
+    unsigned long speaks = atomic_load(&elevenlabs_engine->stats_speaks);
+    unsigned long segments = atomic_load(&elevenlabs_engine->stats_segments);
+    unsigned long cached = atomic_load(&elevenlabs_engine->stats_segments_cached);
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+           "Synthesis stats (segment_mode=%s): speaks=%lu, avg first audio=%lu ms, segments=%lu, cached=%lu (%lu%%)",
+           elevenlabs_engine->config.segment_mode, speaks,
+           speaks ? atomic_load(&elevenlabs_engine->stats_first_audio_ms) / speaks : 0,
+           segments, cached, segments ? cached * 100 / segments : 0);
+    unsigned long prebuffered = atomic_load(&elevenlabs_engine->stats_prebuffered);
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO,
+           "Playback stats (prebuffer_max_ms=%u): held back=%lu segments, avg hold=%lu ms, underruns=%lu",
+           elevenlabs_engine->config.prebuffer_max_ms, prebuffered,
+           prebuffered ? atomic_load(&elevenlabs_engine->stats_prebuffer_ms) / prebuffered : 0,
+           atomic_load(&elevenlabs_engine->stats_underruns));
+    
     apt_log(APT_LOG_MARK, APT_PRIO_INFO,
            "ElevenLabs synthesizer engine closed (libcurl cleanup completed)");
     
     return mrcp_engine_close_respond(engine);
 }
 
+/* Consumer task of a new channel. Hashed from the channel's address, which is spread
+   by the server's per-session pools; a channel never moves, so its requests stay ordered. */
+static elevenlabs_synth_shard_t *elevenlabs_synth_shard_pick(elevenlabs_synth_engine_t *elevenlabs_engine,
+                                                            const void *channel)
+{
+    apr_uint64_t hash = (apr_uint64_t)(apr_uintptr_t)channel;
+    hash ^= hash >> 33;
+    hash *= APR_UINT64_C(0xff51afd7ed558ccd);
+    hash ^= hash >> 33;
+    return &elevenlabs_engine->shards[hash % elevenlabs_engine->shard_count];
+}
+
 /**
  * Create synthesizer channel
  */
@@ -521,11 +910,27 @@ mrcp_engine_channel_t* elevenlabs_synth_engine_channel_create(mrcp_engine_t *eng
     }
     
     synth_channel->elevenlabs_engine = engine->obj;
+    synth_channel->shard = elevenlabs_synth_shard_pick(synth_channel->elevenlabs_engine, synth_channel);
     synth_channel->speak_request = NULL;
     synth_channel->stop_response = NULL;
-    synth_channel->http_client = NULL;
-    synth_channel->audio_buffer = NULL;
+    synth_channel->request_time = 0;
+    atomic_init(&synth_channel->barge_in_time, 0);
+    atomic_init(&synth_channel->paused, 0);
+    synth_channel->paused_since = 0;
     synth_channel->synthesizing = FALSE;
+    synth_channel->progress_counter = 0;
+    synth_channel->segments = NULL;
+    synth_channel->voice_id = NULL;
+    synth_channel->legacy_text = NULL;
+    synth_channel->segment_count = 0;
+    synth_channel->segment_next = 0;
+    atomic_init(&synth_channel->segment_playing, 0);
+    synth_channel->speak_time = 0;
+    synth_channel->first_audio_sent = FALSE;
+    synth_channel->speak_gen = 0;
+    atomic_init(&synth_channel->cancel_gen, 0);
+    synth_channel->ws = NULL;
+    synth_channel->ws_context = 0;
     
     /* Calculate frame size based on configuration */
     elevenlabs_config_t *config = &synth_channel->elevenlabs_engine->config;
@@ -539,15 +944,54 @@ mrcp_engine_channel_t* elevenlabs_synth_engine_channel_create(mrcp_engine_t *eng
            "Created synth channel [%p] with mutex [%p] for multi-session isolation",
            (void*)synth_channel, (void*)synth_channel->mutex);
     
-    /* Create audio buffer */
-    /* Create audio buffer with larger initial capacity */
-    synth_channel->audio_buffer = audio_buffer_create(pool, synth_channel->frame_size * 100);
+    /* Create audio buffers: sized for the high-water mark plus one (decoded) curl chunk,
+       since the transfer is paused before the queued audio exceeds high water */
+    apr_size_t bytes_per_ms = synth_channel->frame_size / config->chunk_ms;
+    apr_size_t high_water_bytes = (apr_size_t)config->buffer_high_water_ms * bytes_per_ms;
+    apr_size_t low_water_bytes = (apr_size_t)config->buffer_low_water_ms * bytes_per_ms;
     
-    /* Create HTTP client */
-    synth_channel->http_client = elevenlabs_http_client_create(pool);
-    if (synth_channel->http_client) {
-        synth_channel->http_client->audio_buffer = synth_channel->audio_buffer;
-        synth_channel->http_client->config = &synth_channel->elevenlabs_engine->config;
+    /* One lane for the playing segment plus one per segment fetched ahead */
+    synth_channel->lane_count = strcasecmp(config->segment_mode, "none") != 0 ? config->segment_lookahead + 1 : 1;
+    synth_channel->lanes = apr_pcalloc(pool, synth_channel->lane_count * sizeof(elevenlabs_synth_lane_t));
+    for (unsigned i = 0; i < synth_channel->lane_count; i++) {
+        elevenlabs_synth_lane_t *lane = &synth_channel->lanes[i];
+        lane->channel = synth_channel;
+        
+        /* The lane's client and ring get a pool of their own: at channel destroy they are
+           handed to the client's worker loop, which frees them once the request lets go */
+        apr_pool_t *lane_pool;
+        if (apr_pool_create_unmanaged_ex(&lane_pool, NULL, NULL) != APR_SUCCESS) {
+            apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "Failed to create pool of lane %u", i);
+            lane_pool = NULL;
+        }
+        lane->audio_buffer = lane_pool ?
+            audio_buffer_create(lane_pool, synth_channel->elevenlabs_engine->audio_slab,
+                                high_water_bytes + 2 * CURL_MAX_WRITE_SIZE) : NULL;
+        lane->playback = NULL;
+        atomic_init(&lane->playback_pending, NULL);
+        atomic_init(&lane->playback_gen, 0);
+        atomic_init(&lane->segment, ELEVENLABS_SEGMENT_NONE);
+        lane->from_cache = FALSE;
+        
+        /* Create HTTP client */
+        lane->http_client = lane_pool ? elevenlabs_http_client_create(lane_pool) : NULL;
+        if (!lane->http_client && lane_pool) {
+            /* Nothing ever borrowed into the ring */
+            lane->audio_buffer = NULL;
+            apr_pool_destroy(lane_pool);
+        }
+        if (lane->http_client) {
+            lane->http_client->audio_buffer = lane->audio_buffer;
+            lane->http_client->lane = lane;
+            lane->http_client->config = &synth_channel->elevenlabs_engine->config;
+            elevenlabs_http_pool_attach(synth_channel->elevenlabs_engine->http_pool, lane->http_client);
+            lane->http_client->io_pool = synth_channel->elevenlabs_engine->io_pool;
+            lane->http_client->memory_cache = synth_channel->elevenlabs_engine->memory_cache;
+            lane->http_client->disk_cache = synth_channel->elevenlabs_engine->disk_cache;
+            lane->http_client->flights = synth_channel->elevenlabs_engine->flights;
+            lane->http_client->high_water_bytes = high_water_bytes;
+            lane->http_client->low_water_bytes = low_water_bytes;
+        }
     }
     
     /* Set stream capabilities */
@@ -571,10 +1015,13 @@ mrcp_engine_channel_t* elevenlabs_synth_engine_channel_create(mrcp_engine_t *eng
         synth_channel,           /* object to associate */
         termination,             /* associated media termination */
         pool);                   /* pool to allocate memory from */
+    if (synth_channel->channel) {
+        ELEVENLABS_METRIC_ADD(synth_channel->elevenlabs_engine->metrics, channels_active, 1);
+    }
     
         apt_log(APT_LOG_MARK, APT_PRIO_INFO,
-           "ElevenLabs synthesizer channel created with frame size %zu bytes",
-           synth_channel->frame_size);
+           "ElevenLabs synthesizer channel created with frame size %zu bytes, %u lane(s)",
+           synth_channel->frame_size, synth_channel->lane_count);
     
     return synth_channel->channel;
 }
@@ -0,0 +1,911 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_ws.c
+ * @brief WebSocket stream-input transport (incremental text) for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* For replies an LLM writes token by token, a SPEAK carrying
+   Vendor-Specific-Parameters: elevenlabs.stream-input=true opens an utterance on the
+   channel's WebSocket; CONTROL requests add text to it, and elevenlabs.stream-end=true
+   (on either) ends it. Audio starts as soon as the API has enough text.
+
+   The socket goes to the multi-context endpoint
+   (<ws_base_url>/<voice>/multi-stream-input), so one connection serves every utterance
+   of the session, each in its own context. It is opened by the first streamed SPEAK,
+   reopened on demand if the API closed it (ws_inactivity_timeout) or the voice, model or
+   format changed, and closed with the channel.
+
+   libcurl only carries the connection here (CONNECT_ONLY, TLS and proxies included);
+   the upgrade and the framing (RFC 6455) are done below, so any libcurl works, not just
+   builds with its WebSocket API enabled. A ws:// base_url talks to a local stand-in.
+
+   Streamed utterances are not cached: their text is only known once they are over. */
+
+#include "elevenlabs_synth.h"
+#include "g711_decode.h"
+#include "apr_strings.h"
+#include "apr_base64.h"
+#include "apr_sha1.h"
+#include "apr_general.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#define ELEVENLABS_WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define ELEVENLABS_WS_OP_CONT 0x0
+#define ELEVENLABS_WS_OP_TEXT 0x1
+#define ELEVENLABS_WS_OP_CLOSE 0x8
+#define ELEVENLABS_WS_OP_PING 0x9
+#define ELEVENLABS_WS_MAX_MESSAGE (16 * 1024 * 1024)
+#define ELEVENLABS_WS_THROTTLE_MS 20       /* Ring at high water: look again after a frame */
+#define ELEVENLABS_WS_IDLE_MS 1000
+#define ELEVENLABS_WS_RECV_CHUNK 16384
+
+static void* elevenlabs_ws_grow(void *buf, apr_size_t *cap, apr_size_t need)
+{
+  if (need <= *cap) {
+    return buf;
+  }
+  apr_size_t new_cap = *cap ? *cap : 4096;
+  while (new_cap < need) {
+    new_cap *= 2;
+  }
+  void *grown = realloc(buf, new_cap);
+  if (grown) {
+    *cap = new_cap;
+  }
+  return grown;
+}
+
+/* Wait for the socket; FALSE on timeout, or as soon as the session is torn down. A wake-up
+   for queued text is noted so the main loop does not sleep on it. */
+static apt_bool_t elevenlabs_ws_wait(elevenlabs_ws_session_t *ws, short events, uint32_t timeout_ms)
+{
+  apr_time_t deadline = apr_time_now() + apr_time_from_msec(timeout_ms);
+  while (atomic_load(&ws->running)) {
+    apr_interval_time_t left = deadline - apr_time_now();
+    if (left <= 0) {
+      return FALSE;
+    }
+    struct pollfd fds[2] = { { ws->sock, events, 0 }, { ws->wake_fd, POLLIN, 0 } };
+    if (poll(fds, 2, (int)((left + 999) / 1000)) > 0 && fds[0].revents) {
+      return TRUE;
+    }
+    if (fds[1].revents & POLLIN) {
+      uint64_t count;
+      if (read(ws->wake_fd, &count, sizeof(count)) > 0) {
+        ws->woken = TRUE;
+      }
+    }
+  }
+  return FALSE;
+}
+
+static apt_bool_t elevenlabs_ws_send_raw(elevenlabs_ws_session_t *ws, const uint8_t *data, apr_size_t len)
+{
+  while (len > 0) {
+    size_t sent = 0;
+    CURLcode rc = curl_easy_send(ws->curl, data, len, &sent);
+    if (rc == CURLE_AGAIN) {
+      if (!elevenlabs_ws_wait(ws, POLLOUT, ws->config->read_timeout_ms)) {
+        if (atomic_load(&ws->running)) {
+          apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "WebSocket send timed out");
+        }
+        return FALSE;
+      }
+      continue;
+    }
+    if (rc != CURLE_OK) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "WebSocket send failed: %s", curl_easy_strerror(rc));
+      return FALSE;
+    }
+    data += sent;
+    len -= sent;
+  }
+  return TRUE;
+}
+
+/* Client frames are always masked */
+static apt_bool_t elevenlabs_ws_send_frame(elevenlabs_ws_session_t *ws, int opcode,
+                                           const uint8_t *payload, apr_size_t len)
+{
+  uint8_t *frame = malloc(14 + len);
+  if (!frame) {
+    return FALSE;
+  }
+  apr_size_t n = 0;
+  frame[n++] = (uint8_t)(0x80 | opcode);
+  if (len < 126) {
+    frame[n++] = (uint8_t)(0x80 | len);
+  } else if (len <= 0xFFFF) {
+    frame[n++] = 0x80 | 126;
+    frame[n++] = (uint8_t)(len >> 8);
+    frame[n++] = (uint8_t)len;
+  } else {
+    frame[n++] = 0x80 | 127;
+    for (int i = 7; i >= 0; i--) {
+      frame[n++] = (uint8_t)((uint64_t)len >> (8 * i));
+    }
+  }
+  uint8_t *mask = frame + n;
+  apr_generate_random_bytes(mask, 4);
+  n += 4;
+  for (apr_size_t i = 0; i < len; i++) {
+    frame[n + i] = payload[i] ^ mask[i & 3];
+  }
+  apt_bool_t ok = elevenlabs_ws_send_raw(ws, frame, n + len);
+  free(frame);
+  return ok;
+}
+
+static void elevenlabs_ws_disconnect(elevenlabs_ws_session_t *ws)
+{
+  if (ws->sock != CURL_SOCKET_BAD) {
+    static const uint8_t normal_closure[2] = { 0x03, 0xE8 };  /* 1000 */
+    elevenlabs_ws_send_frame(ws, ELEVENLABS_WS_OP_CLOSE, normal_closure, sizeof(normal_closure));
+  }
+  /* A reset handle would keep the connection cached; a fresh one drops it */
+  curl_easy_cleanup(ws->curl);
+  ws->curl = curl_easy_init();
+  ws->sock = CURL_SOCKET_BAD;
+  free(ws->url);
+  ws->url = NULL;
+  ws->rx_len = 0;
+  ws->message_len = 0;
+}
+
+/* The connection is gone: whatever utterance it was producing has all it will get */
+static void elevenlabs_ws_lost(elevenlabs_ws_session_t *ws)
+{
+  elevenlabs_ws_disconnect(ws);
+  apr_thread_mutex_lock(ws->mutex);
+  unsigned context = ws->context;
+  apr_thread_mutex_unlock(ws->mutex);
+  if (context > ws->context_final) {
+    ws->context_final = context;
+  }
+}
+
+/* Gives up a connect still in progress once the session is torn down; libcurl asks at
+   least once a second */
+static int elevenlabs_ws_progress(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                                  curl_off_t ultotal, curl_off_t ulnow)
+{
+  elevenlabs_ws_session_t *ws = clientp;
+  (void)dltotal; (void)dlnow; (void)ultotal; (void)ulnow;
+  return atomic_load(&ws->running) ? 0 : 1;
+}
+
+/* Value of header name in an HTTP response head, NULL if absent */
+static const char* elevenlabs_ws_header(apr_pool_t *pool, const char *head, const char *name)
+{
+  apr_size_t name_len = strlen(name);
+  for (const char *line = strstr(head, "\r\n"); line; line = strstr(line, "\r\n")) {
+    line += 2;
+    if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+      const char *value = line + name_len + 1;
+      while (*value == ' ' || *value == '\t') value++;
+      const char *end = strstr(value, "\r\n");
+      return apr_pstrndup(pool, value, end ? (apr_size_t)(end - value) : strlen(value));
+    }
+  }
+  return NULL;
+}
+
+/* Connect and upgrade. url is ws://host[:port]/path or wss://...; libcurl connects to
+   the http(s) equivalent and hands the socket over. */
+static apt_bool_t elevenlabs_ws_connect(elevenlabs_ws_session_t *ws, apr_pool_t *pool, const char *url)
+{
+  const elevenlabs_config_t *config = ws->config;
+  const char *scheme;
+  const char *rest;
+  if (strncasecmp(url, "wss://", 6) == 0) {
+    scheme = "https://";
+    rest = url + 6;
+  } else if (strncasecmp(url, "ws://", 5) == 0) {
+    scheme = "http://";
+    rest = url + 5;
+  } else {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "ws_base_url must start with ws:// or wss://: %s", url);
+    return FALSE;
+  }
+  const char *slash = strchr(rest, '/');
+  const char *host = slash ? apr_pstrndup(pool, rest, (apr_size_t)(slash - rest)) : rest;
+  const char *path = slash ? slash : "/";
+
+  curl_easy_setopt(ws->curl, CURLOPT_URL, apr_pstrcat(pool, scheme, rest, NULL));
+  curl_easy_setopt(ws->curl, CURLOPT_CONNECT_ONLY, 1L);
+  curl_easy_setopt(ws->curl, CURLOPT_CONNECTTIMEOUT_MS, (long)config->connect_timeout_ms);
+  curl_easy_setopt(ws->curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(ws->curl, CURLOPT_XFERINFOFUNCTION, elevenlabs_ws_progress);
+  curl_easy_setopt(ws->curl, CURLOPT_XFERINFODATA, ws);
+  curl_easy_setopt(ws->curl, CURLOPT_NOPROGRESS, 0L);
+  /* The upgrade is an HTTP/1.1 request; ALPN must not pick h2 */
+  curl_easy_setopt(ws->curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt(ws->curl, CURLOPT_SSL_VERIFYPEER, 1L);
+  curl_easy_setopt(ws->curl, CURLOPT_SSL_VERIFYHOST, 2L);
+  elevenlabs_http_pool_setup_easy(ws->http_pool, ws->curl);
+
+  apr_time_t started = apr_time_now();
+  CURLcode rc = curl_easy_perform(ws->curl);
+  if (rc == CURLE_ABORTED_BY_CALLBACK) {
+    return FALSE;
+  }
+  if (rc != CURLE_OK) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "WebSocket connect to %s failed: %s", host,
+            curl_easy_strerror(rc));
+    return FALSE;
+  }
+  curl_socket_t sock = CURL_SOCKET_BAD;
+  if (curl_easy_getinfo(ws->curl, CURLINFO_ACTIVESOCKET, &sock) != CURLE_OK || sock == CURL_SOCKET_BAD) {
+    return FALSE;
+  }
+  ws->sock = sock;
+
+  unsigned char nonce[16];
+  apr_generate_random_bytes(nonce, sizeof(nonce));
+  char key[32];
+  apr_base64_encode_binary(key, nonce, sizeof(nonce));
+  const char *request = apr_psprintf(pool,
+      "GET %s HTTP/1.1\r\n"
+      "Host: %s\r\n"
+      "Upgrade: websocket\r\n"
+      "Connection: Upgrade\r\n"
+      "Sec-WebSocket-Key: %s\r\n"
+      "Sec-WebSocket-Version: 13\r\n"
+      "%s: %s\r\n"
+      "\r\n",
+      path, host, key, ELEVENLABS_API_KEY_HEADER, config->api_key ? config->api_key : "");
+  if (!elevenlabs_ws_send_raw(ws, (const uint8_t *)request, strlen(request))) {
+    return FALSE;
+  }
+
+  /* Response head; anything after it is already frames */
+  char *head_end = NULL;
+  while (!head_end) {
+    ws->rx = elevenlabs_ws_grow(ws->rx, &ws->rx_cap, ws->rx_len + ELEVENLABS_WS_RECV_CHUNK + 1);
+    if (!ws->rx) {
+      ws->rx_cap = 0;
+      return FALSE;
+    }
+    size_t got = 0;
+    rc = curl_easy_recv(ws->curl, ws->rx + ws->rx_len, ELEVENLABS_WS_RECV_CHUNK, &got);
+    if (rc == CURLE_AGAIN) {
+      if (!elevenlabs_ws_wait(ws, POLLIN, config->read_timeout_ms)) {
+        if (atomic_load(&ws->running)) {
+          apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "WebSocket upgrade timed out");
+        }
+        return FALSE;
+      }
+      continue;
+    }
+    if (rc != CURLE_OK || got == 0) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "WebSocket upgrade failed: connection closed");
+      return FALSE;
+    }
+    ws->rx_len += got;
+    ws->rx[ws->rx_len] = '\0';
+    head_end = strstr((char *)ws->rx, "\r\n\r\n");
+  }
+  *head_end = '\0';
+  const char *head = apr_pstrdup(pool, (const char *)ws->rx);
+  apr_size_t head_len = (apr_size_t)(head_end - (char *)ws->rx) + 4;
+  memmove(ws->rx, ws->rx + head_len, ws->rx_len - head_len);
+  ws->rx_len -= head_len;
+
+  const char *sp = strchr(head, ' ');
+  if (!sp || atoi(sp + 1) != 101) {
+    const char *eol = strstr(head, "\r\n");
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "WebSocket upgrade refused: %.*s",
+            eol ? (int)(eol - head) : (int)strlen(head), head);
+    return FALSE;
+  }
+  apr_sha1_ctx_t sha;
+  unsigned char digest[APR_SHA1_DIGESTSIZE];
+  char expected[32];
+  apr_sha1_init(&sha);
+  apr_sha1_update(&sha, key, (unsigned int)strlen(key));
+  apr_sha1_update(&sha, ELEVENLABS_WS_GUID, (unsigned int)strlen(ELEVENLABS_WS_GUID));
+  apr_sha1_final(digest, &sha);
+  apr_base64_encode_binary(expected, digest, APR_SHA1_DIGESTSIZE);
+  const char *accept = elevenlabs_ws_header(pool, head, "Sec-WebSocket-Accept");
+  if (!accept || strcmp(accept, expected) != 0) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "WebSocket upgrade failed: bad Sec-WebSocket-Accept");
+    return FALSE;
+  }
+
+  ws->url = strdup(url);
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "WebSocket connected to %s in %ld ms", host,
+          (long)apr_time_as_msec(apr_time_now() - started));
+  return TRUE;
+}
+
+/* Read the string value of "key" in a flat JSON object, NULL if absent or null.
+   The API's messages are small and flat; this is not a general JSON parser. */
+static char* elevenlabs_ws_json_string(apr_pool_t *pool, const char *json, const char *key)
+{
+  const char *p = strstr(json, apr_pstrcat(pool, "\"", key, "\"", NULL));
+  if (!p) {
+    return NULL;
+  }
+  p += strlen(key) + 2;
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+  if (*p++ != ':') {
+    return NULL;
+  }
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+  if (*p++ != '"') {
+    return NULL;
+  }
+  const char *end = p;
+  while (*end && *end != '"') {
+    end += (*end == '\\' && end[1]) ? 2 : 1;
+  }
+  char *value = apr_palloc(pool, (apr_size_t)(end - p) + 1);
+  char *out = value;
+  while (p < end) {
+    if (*p == '\\') {
+      p++;
+      switch (*p) {
+        case 'n': *out++ = '\n'; break;
+        case 't': *out++ = '\t'; break;
+        case 'r': *out++ = '\r'; break;
+        default: *out++ = *p; break;   /* \" \\ \/; \u escapes are kept as is */
+      }
+      p++;
+    } else {
+      *out++ = *p++;
+    }
+  }
+  *out = '\0';
+  return value;
+}
+
+static apt_bool_t elevenlabs_ws_json_true(apr_pool_t *pool, const char *json, const char *key)
+{
+  const char *p = strstr(json, apr_pstrcat(pool, "\"", key, "\"", NULL));
+  if (!p) {
+    return FALSE;
+  }
+  p += strlen(key) + 2;
+  while (*p == ' ' || *p == ':' || *p == '\t') p++;
+  return strncmp(p, "true", 4) == 0;
+}
+
+/* The ring is read under the mutex: once the session is destroyed it may be freed */
+static apt_bool_t elevenlabs_ws_accepting(elevenlabs_ws_session_t *ws)
+{
+  if (ws->pending_len > 0) {
+    return FALSE;
+  }
+  apr_thread_mutex_lock(ws->mutex);
+  apt_bool_t accepting = ws->audio_buffer &&
+                         audio_buffer_available(ws->audio_buffer) < ws->high_water_bytes;
+  apr_thread_mutex_unlock(ws->mutex);
+  return accepting;
+}
+
+/* Move decoded audio into the ring as far as it fits. Under the mutex, so once a STOP
+   or a new SPEAK has cancelled the utterance nothing more of it lands in the ring. */
+static void elevenlabs_ws_flush(elevenlabs_ws_session_t *ws)
+{
+  if (ws->pending_len == 0) {
+    return;
+  }
+  apr_thread_mutex_lock(ws->mutex);
+  if (ws->cancelled || !ws->audio_buffer || ws->pending_context != ws->context) {
+    ws->pending_off = ws->pending_len;
+  } else {
+    apr_size_t n = audio_buffer_space(ws->audio_buffer);
+    if (n > ws->pending_len - ws->pending_off) {
+      n = ws->pending_len - ws->pending_off;
+    }
+    n &= ~(apr_size_t)1;  /* Whole samples only */
+    if (n > 0 && audio_buffer_write(ws->audio_buffer, ws->pending + ws->pending_off, n)) {
+      ws->pending_off += n;
+    }
+  }
+  apr_thread_mutex_unlock(ws->mutex);
+  if (ws->pending_off >= ws->pending_len) {
+    ws->pending_len = 0;
+    ws->pending_off = 0;
+  }
+}
+
+/* An utterance is done for the media thread once the API finished it and all of its
+   audio is in the ring */
+static void elevenlabs_ws_settle(elevenlabs_ws_session_t *ws)
+{
+  if (ws->pending_len == 0 && ws->context_final > atomic_load(&ws->context_done)) {
+    atomic_store(&ws->context_done, ws->context_final);
+  }
+}
+
+static void elevenlabs_ws_audio(elevenlabs_ws_session_t *ws, unsigned context, const uint8_t *data, apr_size_t len)
+{
+  g711_decode_fn decode = NULL;
+  const elevenlabs_config_t *config = ws->config;
+  if (config->output_format && config->fallback_ulaw_to_pcm) {
+    if (strcasecmp(config->output_format, "ulaw_8000") == 0) {
+      decode = ulaw_to_s16;
+    } else if (strcasecmp(config->output_format, "alaw_8000") == 0) {
+      decode = alaw_to_s16;
+    }
+  }
+  if (ws->pending_len > 0 && ws->pending_context != context) {
+    ws->pending_len = 0;
+    ws->pending_off = 0;
+  }
+  apr_size_t out_len = decode ? len * 2 : len;
+  uint8_t *pending = elevenlabs_ws_grow(ws->pending, &ws->pending_cap, ws->pending_len + out_len);
+  if (!pending) {
+    return;
+  }
+  ws->pending = pending;
+  if (decode) {
+    decode(data, len, (int16_t *)(ws->pending + ws->pending_len));
+  } else {
+    memcpy(ws->pending + ws->pending_len, data, len);
+  }
+  ws->pending_len += out_len;
+  ws->pending_context = context;
+  elevenlabs_ws_flush(ws);
+}
+
+/* One complete text message from the API: audio, the end of a context, or an error */
+static void elevenlabs_ws_message(elevenlabs_ws_session_t *ws, apr_pool_t *pool, const char *json)
+{
+  apr_thread_mutex_lock(ws->mutex);
+  unsigned context = ws->context;
+  apr_thread_mutex_unlock(ws->mutex);
+  const char *context_id = elevenlabs_ws_json_string(pool, json, "contextId");
+  if (!context_id) {
+    context_id = elevenlabs_ws_json_string(pool, json, "context_id");
+  }
+  if (context_id && context_id[0] == 'c') {
+    context = (unsigned)strtoul(context_id + 1, NULL, 10);
+  }
+
+  const char *audio = elevenlabs_ws_json_string(pool, json, "audio");
+  if (audio && *audio) {
+    char *decoded = apr_palloc(pool, (apr_size_t)apr_base64_decode_len(audio));
+    int len = apr_base64_decode_binary((unsigned char *)decoded, audio);
+    if (len > 0) {
+      elevenlabs_ws_audio(ws, context, (const uint8_t *)decoded, (apr_size_t)len);
+    }
+  } else {
+    const char *error = elevenlabs_ws_json_string(pool, json, "error");
+    const char *message = elevenlabs_ws_json_string(pool, json, "message");
+    if (error || message) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "WebSocket API message: %s%s%s",
+              error ? error : "", error && message ? ": " : "", message ? message : "");
+    }
+  }
+  if (elevenlabs_ws_json_true(pool, json, "isFinal") && context > ws->context_final) {
+    ws->context_final = context;
+  }
+}
+
+/* Parse complete frames out of rx. FALSE when the server closed the connection or
+   broke the protocol. */
+static apt_bool_t elevenlabs_ws_parse(elevenlabs_ws_session_t *ws, apr_pool_t *pool)
+{
+  apr_size_t off = 0;
+  apt_bool_t open = TRUE;
+  while (open && ws->rx_len - off >= 2) {
+    uint8_t *p = ws->rx + off;
+    apr_size_t avail = ws->rx_len - off;
+    apt_bool_t fin = (p[0] & 0x80) != 0;
+    int opcode = p[0] & 0x0F;
+    apt_bool_t masked = (p[1] & 0x80) != 0;
+    uint64_t len = p[1] & 0x7F;
+    apr_size_t head = 2;
+    if (len == 126) {
+      if (avail < 4) break;
+      len = ((uint64_t)p[2] << 8) | p[3];
+      head = 4;
+    } else if (len == 127) {
+      if (avail < 10) break;
+      len = 0;
+      for (int i = 0; i < 8; i++) {
+        len = (len << 8) | p[2 + i];
+      }
+      head = 10;
+    }
+    if (masked) {
+      head += 4;
+    }
+    if (len > ELEVENLABS_WS_MAX_MESSAGE) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "WebSocket frame too large: %lu bytes", (unsigned long)len);
+      return FALSE;
+    }
+    if (avail < head + len) {
+      break;
+    }
+    uint8_t *payload = p + head;
+    if (masked) {
+      for (apr_size_t i = 0; i < len; i++) {
+        payload[i] ^= p[head - 4 + (i & 3)];
+      }
+    }
+
+    switch (opcode) {
+      case ELEVENLABS_WS_OP_TEXT:
+      case ELEVENLABS_WS_OP_CONT: {
+        char *message = elevenlabs_ws_grow(ws->message, &ws->message_cap, ws->message_len + len + 1);
+        if (!message) {
+          return FALSE;
+        }
+        ws->message = message;
+        memcpy(ws->message + ws->message_len, payload, len);
+        ws->message_len += len;
+        if (fin) {
+          ws->message[ws->message_len] = '\0';
+          elevenlabs_ws_message(ws, pool, ws->message);
+          ws->message_len = 0;
+        }
+        break;
+      }
+      case ELEVENLABS_WS_OP_PING:
+        elevenlabs_ws_send_frame(ws, 0xA, payload, len);
+        break;
+      case ELEVENLABS_WS_OP_CLOSE:
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "WebSocket closed by server (code %d)",
+                len >= 2 ? (payload[0] << 8) | payload[1] : 0);
+        open = FALSE;
+        break;
+      default:
+        /* Binary frames and pongs carry nothing for us */
+        break;
+    }
+    off += head + len;
+  }
+  memmove(ws->rx, ws->rx + off, ws->rx_len - off);
+  ws->rx_len -= off;
+  return open;
+}
+
+/* Read what the socket has while the ring takes it. libcurl may hold decrypted bytes
+   that poll() does not see, so this is tried whenever there is room, not only when
+   the socket shows readable. */
+static apt_bool_t elevenlabs_ws_receive(elevenlabs_ws_session_t *ws, apr_pool_t *pool)
+{
+  while (elevenlabs_ws_accepting(ws)) {
+    uint8_t *rx = elevenlabs_ws_grow(ws->rx, &ws->rx_cap, ws->rx_len + ELEVENLABS_WS_RECV_CHUNK + 1);
+    if (!rx) {
+      return FALSE;
+    }
+    ws->rx = rx;
+    size_t got = 0;
+    CURLcode rc = curl_easy_recv(ws->curl, ws->rx + ws->rx_len, ELEVENLABS_WS_RECV_CHUNK, &got);
+    if (rc == CURLE_AGAIN) {
+      break;
+    }
+    if (rc != CURLE_OK || got == 0) {
+      apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "WebSocket connection closed%s%s",
+              rc != CURLE_OK ? ": " : "", rc != CURLE_OK ? curl_easy_strerror(rc) : "");
+      return FALSE;
+    }
+    ws->rx_len += got;
+    if (!elevenlabs_ws_parse(ws, pool)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/* Last act of the session's thread: nothing else refers to the session once
+   elevenlabs_ws_session_destroy() has let go of it */
+static void elevenlabs_ws_free(elevenlabs_ws_session_t *ws)
+{
+  elevenlabs_http_pool_t *http_pool = ws->http_pool;
+  /* destroy wakes the thread with the mutex held; past it, wake_fd is no longer written */
+  apr_thread_mutex_lock(ws->mutex);
+  apr_thread_mutex_unlock(ws->mutex);
+
+  curl_easy_cleanup(ws->curl);
+  close(ws->wake_fd);
+  while (ws->outbox) {
+    elevenlabs_ws_msg_t *next = ws->outbox->next;
+    free(ws->outbox);
+    ws->outbox = next;
+  }
+  free(ws->target_url);
+  free(ws->url);
+  free(ws->rx);
+  free(ws->message);
+  free(ws->pending);
+  apr_thread_mutex_destroy(ws->mutex);
+  apr_pool_destroy(ws->pool);
+  atomic_fetch_sub(&http_pool->ws_sessions, 1);
+}
+
+static void* APR_THREAD_FUNC elevenlabs_ws_run(apr_thread_t *thd, void *data)
+{
+  elevenlabs_ws_session_t *ws = data;
+  apr_pool_t *scratch = ws->scratch;
+
+  while (atomic_load(&ws->running)) {
+    apr_thread_mutex_lock(ws->mutex);
+    elevenlabs_ws_msg_t *msg = ws->outbox;
+    ws->outbox = NULL;
+    ws->outbox_tail = NULL;
+    const char *target = ws->target_url ? apr_pstrdup(scratch, ws->target_url) : NULL;
+    apr_thread_mutex_unlock(ws->mutex);
+
+    if (msg && target) {
+      /* Voice, model or format changed: those are fixed per connection */
+      if (ws->sock != CURL_SOCKET_BAD && strcmp(ws->url, target) != 0) {
+        elevenlabs_ws_disconnect(ws);
+      }
+      if (ws->sock == CURL_SOCKET_BAD && !elevenlabs_ws_connect(ws, scratch, target)) {
+        elevenlabs_ws_lost(ws);
+      }
+    }
+    while (msg) {
+      elevenlabs_ws_msg_t *next = msg->next;
+      if (ws->sock != CURL_SOCKET_BAD && atomic_load(&ws->running)) {
+        apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_DEBUG, "WebSocket send: %.*s", (int)msg->len, msg->data);
+        if (!elevenlabs_ws_send_frame(ws, ELEVENLABS_WS_OP_TEXT, (const uint8_t *)msg->data, msg->len)) {
+          elevenlabs_ws_lost(ws);
+        }
+      }
+      free(msg);
+      msg = next;
+    }
+
+    elevenlabs_ws_flush(ws);
+    elevenlabs_ws_settle(ws);
+
+    struct pollfd fds[2];
+    nfds_t nfds = 1;
+    fds[0].fd = ws->wake_fd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    apt_bool_t connected = ws->sock != CURL_SOCKET_BAD;
+    apt_bool_t accepting = elevenlabs_ws_accepting(ws);
+    if (connected) {
+      fds[1].fd = ws->sock;
+      fds[1].events = accepting ? POLLIN : 0;
+      fds[1].revents = 0;
+      nfds = 2;
+    }
+    int timeout = (connected && !accepting) || ws->pending_len ? ELEVENLABS_WS_THROTTLE_MS : ELEVENLABS_WS_IDLE_MS;
+    if (ws->woken) {
+      ws->woken = FALSE;
+      timeout = 0;
+    }
+    poll(fds, nfds, timeout);
+    if (fds[0].revents & POLLIN) {
+      uint64_t count;
+      if (read(ws->wake_fd, &count, sizeof(count)) < 0) {
+        /* Spurious wake-up */
+      }
+    }
+
+    if (ws->sock != CURL_SOCKET_BAD && !elevenlabs_ws_receive(ws, scratch)) {
+      elevenlabs_ws_lost(ws);
+    }
+    elevenlabs_ws_settle(ws);
+    apr_pool_clear(scratch);
+  }
+
+  elevenlabs_ws_disconnect(ws);
+  elevenlabs_ws_free(ws);
+  return NULL;
+}
+
+/* Queue a text frame; called with ws->mutex held */
+static void elevenlabs_ws_queue(elevenlabs_ws_session_t *ws, const char *json)
+{
+  apr_size_t len = strlen(json);
+  elevenlabs_ws_msg_t *msg = malloc(sizeof(elevenlabs_ws_msg_t) + len);
+  if (!msg) {
+    return;
+  }
+  msg->next = NULL;
+  msg->len = len;
+  memcpy(msg->data, json, len);
+  if (ws->outbox_tail) {
+    ws->outbox_tail->next = msg;
+  } else {
+    ws->outbox = msg;
+  }
+  ws->outbox_tail = msg;
+}
+
+static void elevenlabs_ws_wake(elevenlabs_ws_session_t *ws)
+{
+  uint64_t one = 1;
+  if (write(ws->wake_fd, &one, sizeof(one)) < 0) {
+    /* Counter saturated: the thread is already due to wake */
+  }
+}
+
+/* Generate what is buffered and end the context; called with ws->mutex held */
+static void elevenlabs_ws_queue_end(elevenlabs_ws_session_t *ws, apr_pool_t *pool, unsigned context)
+{
+  elevenlabs_ws_queue(ws, apr_psprintf(pool, "{\"context_id\":\"c%u\",\"flush\":true}", context));
+  elevenlabs_ws_queue(ws, apr_psprintf(pool, "{\"context_id\":\"c%u\",\"close_context\":true}", context));
+}
+
+/**
+ * Create a channel's session; nothing is connected until the first utterance
+ */
+elevenlabs_ws_session_t* elevenlabs_ws_session_create(const elevenlabs_config_t *config,
+                                                      elevenlabs_http_pool_t *http_pool,
+                                                      audio_buffer_t *audio_buffer, apr_size_t high_water_bytes)
+{
+  /* Its own pool: the session outlives the channel until its thread has wound down */
+  apr_pool_t *pool;
+  if (apr_pool_create_unmanaged_ex(&pool, NULL, NULL) != APR_SUCCESS) {
+    return NULL;
+  }
+  elevenlabs_ws_session_t *ws = apr_pcalloc(pool, sizeof(elevenlabs_ws_session_t));
+  ws->pool = pool;
+  ws->config = config;
+  ws->http_pool = http_pool;
+  ws->audio_buffer = audio_buffer;
+  ws->high_water_bytes = high_water_bytes;
+  ws->sock = CURL_SOCKET_BAD;
+  atomic_init(&ws->context_done, 0);
+  atomic_init(&ws->running, 1);
+  ws->curl = curl_easy_init();
+  ws->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  apr_threadattr_t *attr = NULL;
+  if (!ws->curl || ws->wake_fd < 0 ||
+      apr_pool_create(&ws->scratch, pool) != APR_SUCCESS ||
+      apr_thread_mutex_create(&ws->mutex, APR_THREAD_MUTEX_DEFAULT, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "Failed to create WebSocket session");
+    if (ws->curl) curl_easy_cleanup(ws->curl);
+    if (ws->wake_fd >= 0) close(ws->wake_fd);
+    apr_pool_destroy(pool);
+    return NULL;
+  }
+  /* Detached and never joined: the thread frees the session once it is destroyed */
+  atomic_fetch_add(&http_pool->ws_sessions, 1);
+  if (apr_threadattr_create(&attr, pool) != APR_SUCCESS ||
+      apr_threadattr_detach_set(attr, 1) != APR_SUCCESS ||
+      apr_thread_create(&ws->thread, attr, elevenlabs_ws_run, ws, pool) != APR_SUCCESS) {
+    apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_ERROR, "Failed to start WebSocket thread");
+    atomic_fetch_sub(&http_pool->ws_sessions, 1);
+    curl_easy_cleanup(ws->curl);
+    close(ws->wake_fd);
+    apr_thread_mutex_destroy(ws->mutex);
+    apr_pool_destroy(pool);
+    return NULL;
+  }
+  return ws;
+}
+
+/**
+ * Let go of the session without waiting for its thread, which may sit in a connect or a
+ * send to a hung server: it stops writing into the ring at once, closes the socket and
+ * frees the session on its own. The caller must not touch ws afterwards.
+ */
+void elevenlabs_ws_session_destroy(elevenlabs_ws_session_t *ws)
+{
+  if (!ws) {
+    return;
+  }
+  apr_thread_mutex_lock(ws->mutex);
+  ws->audio_buffer = NULL;
+  ws->cancelled = TRUE;
+  atomic_store(&ws->running, 0);
+  elevenlabs_ws_wake(ws);
+  apr_thread_mutex_unlock(ws->mutex);
+}
+
+/**
+ * Start an utterance with its first text (may be empty); with end set no more follows.
+ * Returns the utterance's context number, 0 on failure. An utterance still running is
+ * cancelled.
+ */
+unsigned elevenlabs_ws_session_begin(elevenlabs_ws_session_t *ws, apr_pool_t *pool, const char *raw_voice_id,
+                                     const char *text, apt_bool_t end)
+{
+  const elevenlabs_config_t *config = ws->config;
+  const char *voice_id;
+  const char *language_code;
+  elevenlabs_voice_split(pool, raw_voice_id ? raw_voice_id : config->voice_id, &voice_id, &language_code);
+  if (!voice_id || !config->ws_base_url) {
+    return 0;
+  }
+  const char *url = apr_psprintf(pool, "%s/%s/multi-stream-input?model_id=%s&output_format=%s&inactivity_timeout=%u%s%s",
+                                 config->ws_base_url, voice_id, config->model_id, config->output_format,
+                                 config->ws_inactivity_timeout,
+                                 language_code ? "&language_code=" : "", language_code ? language_code : "");
+  text = elevenlabs_text_strip_tags(pool, config->model_id, text ? text : "");
+
+  apr_thread_mutex_lock(ws->mutex);
+  if (ws->context && !ws->cancelled && atomic_load(&ws->context_done) < ws->context) {
+    elevenlabs_ws_queue(ws, apr_psprintf(pool, "{\"context_id\":\"c%u\",\"close_context\":true}", ws->context));
+  }
+  unsigned context = ++ws->context;
+  ws->cancelled = FALSE;
+  char *target_url = strdup(url);
+  if (target_url) {
+    free(ws->target_url);
+    ws->target_url = target_url;
+  }
+  /* The first message opens the context; a lone space is how the API takes "no text yet" */
+  elevenlabs_ws_queue(ws, apr_psprintf(pool, "{\"text\":\"%s\",\"context_id\":\"c%u\"}",
+                                       *text ? elevenlabs_json_escape(pool, text) : " ", context));
+  if (end) {
+    elevenlabs_ws_queue_end(ws, pool, context);
+  }
+  apr_thread_mutex_unlock(ws->mutex);
+  elevenlabs_ws_wake(ws);
+
+  apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_INFO, "WebSocket utterance c%u started (voice %s%s)",
+          context, voice_id, end ? ", complete" : ", more text to follow");
+  return context;
+}
+
+/**
+ * Add text to an utterance, and/or end it. FALSE if it is no longer the current one.
+ */
+apt_bool_t elevenlabs_ws_session_append(elevenlabs_ws_session_t *ws, apr_pool_t *pool, unsigned context,
+                                        const char *text, apt_bool_t end)
+{
+  if (!ws) {
+    return FALSE;
+  }
+  if (text && *text) {
+    text = elevenlabs_text_strip_tags(pool, ws->config->model_id, text);
+  }
+  apr_thread_mutex_lock(ws->mutex);
+  if (context != ws->context || ws->cancelled) {
+    apr_thread_mutex_unlock(ws->mutex);
+    return FALSE;
+  }
+  if (text && *text) {
+    elevenlabs_ws_queue(ws, apr_psprintf(pool, "{\"text\":\"%s\",\"context_id\":\"c%u\"}",
+                                         elevenlabs_json_escape(pool, text), context));
+  }
+  if (end) {
+    elevenlabs_ws_queue_end(ws, pool, context);
+  }
+  apr_thread_mutex_unlock(ws->mutex);
+  elevenlabs_ws_wake(ws);
+  return TRUE;
+}
+
+/**
+ * Stop an utterance: the API drops the context and its audio no longer reaches the ring
+ */
+void elevenlabs_ws_session_cancel(elevenlabs_ws_session_t *ws, unsigned context)
+{
+  if (!ws || !context) {
+    return;
+  }
+  apr_thread_mutex_lock(ws->mutex);
+  apt_bool_t live = context == ws->context && !ws->cancelled;
+  if (live) {
+    ws->cancelled = TRUE;
+    if (atomic_load(&ws->context_done) < context) {
+      char json[64];
+      snprintf(json, sizeof(json), "{\"context_id\":\"c%u\",\"close_context\":true}", context);
+      elevenlabs_ws_queue(ws, json);
+    }
+  }
+  apr_thread_mutex_unlock(ws->mutex);
+  if (live) {
+    elevenlabs_ws_wake(ws);
+  }
+}
+
+/**
+ * Media thread: all audio of the utterance is in the ring
+ */
+apt_bool_t elevenlabs_ws_session_finished(elevenlabs_ws_session_t *ws, unsigned context)
+{
+  return !ws || atomic_load(&ws->context_done) >= context;
+}
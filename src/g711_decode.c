@@ -0,0 +1,396 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file g711_decode.c
+ * @brief G.711 (μ-law / A-law) decoders for the ElevenLabs UniMRCP TTS plugin.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+#include "g711_decode.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define G711_HAVE_SSE2 1
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define G711_HAVE_AVX2 1
+#define G711_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define G711_HAVE_NEON 1
+#endif
+
+/* Reference tables (ITU-T G.711), generated once and kept as constant data so no
+   run-time initialization or "initialized" check is needed on the decode path */
+static const int16_t ulaw_table[256] = {
+    -32124, -31100, -30076, -29052, -28028, -27004, -25980, -24956,
+    -23932, -22908, -21884, -20860, -19836, -18812, -17788, -16764,
+    -15996, -15484, -14972, -14460, -13948, -13436, -12924, -12412,
+    -11900, -11388, -10876, -10364,  -9852,  -9340,  -8828,  -8316,
+     -7932,  -7676,  -7420,  -7164,  -6908,  -6652,  -6396,  -6140,
+     -5884,  -5628,  -5372,  -5116,  -4860,  -4604,  -4348,  -4092,
+     -3900,  -3772,  -3644,  -3516,  -3388,  -3260,  -3132,  -3004,
+     -2876,  -2748,  -2620,  -2492,  -2364,  -2236,  -2108,  -1980,
+     -1884,  -1820,  -1756,  -1692,  -1628,  -1564,  -1500,  -1436,
+     -1372,  -1308,  -1244,  -1180,  -1116,  -1052,   -988,   -924,
+      -876,   -844,   -812,   -780,   -748,   -716,   -684,   -652,
+      -620,   -588,   -556,   -524,   -492,   -460,   -428,   -396,
+      -372,   -356,   -340,   -324,   -308,   -292,   -276,   -260,
+      -244,   -228,   -212,   -196,   -180,   -164,   -148,   -132,
+      -120,   -112,   -104,    -96,    -88,    -80,    -72,    -64,
+       -56,    -48,    -40,    -32,    -24,    -16,     -8,      0,
+     32124,  31100,  30076,  29052,  28028,  27004,  25980,  24956,
+     23932,  22908,  21884,  20860,  19836,  18812,  17788,  16764,
+     15996,  15484,  14972,  14460,  13948,  13436,  12924,  12412,
+     11900,  11388,  10876,  10364,   9852,   9340,   8828,   8316,
+      7932,   7676,   7420,   7164,   6908,   6652,   6396,   6140,
+      5884,   5628,   5372,   5116,   4860,   4604,   4348,   4092,
+      3900,   3772,   3644,   3516,   3388,   3260,   3132,   3004,
+      2876,   2748,   2620,   2492,   2364,   2236,   2108,   1980,
+      1884,   1820,   1756,   1692,   1628,   1564,   1500,   1436,
+      1372,   1308,   1244,   1180,   1116,   1052,    988,    924,
+       876,    844,    812,    780,    748,    716,    684,    652,
+       620,    588,    556,    524,    492,    460,    428,    396,
+       372,    356,    340,    324,    308,    292,    276,    260,
+       244,    228,    212,    196,    180,    164,    148,    132,
+       120,    112,    104,     96,     88,     80,     72,     64,
+        56,     48,     40,     32,     24,     16,      8,      0
+};
+
+static const int16_t alaw_table[256] = {
+     -5504,  -5248,  -6016,  -5760,  -4480,  -4224,  -4992,  -4736,
+     -7552,  -7296,  -8064,  -7808,  -6528,  -6272,  -7040,  -6784,
+     -2752,  -2624,  -3008,  -2880,  -2240,  -2112,  -2496,  -2368,
+     -3776,  -3648,  -4032,  -3904,  -3264,  -3136,  -3520,  -3392,
+    -22016, -20992, -24064, -23040, -17920, -16896, -19968, -18944,
+    -30208, -29184, -32256, -31232, -26112, -25088, -28160, -27136,
+    -11008, -10496, -12032, -11520,  -8960,  -8448,  -9984,  -9472,
+    -15104, -14592, -16128, -15616, -13056, -12544, -14080, -13568,
+      -344,   -328,   -376,   -360,   -280,   -264,   -312,   -296,
+      -472,   -456,   -504,   -488,   -408,   -392,   -440,   -424,
+       -88,    -72,   -120,   -104,    -24,     -8,    -56,    -40,
+      -216,   -200,   -248,   -232,   -152,   -136,   -184,   -168,
+     -1376,  -1312,  -1504,  -1440,  -1120,  -1056,  -1248,  -1184,
+     -1888,  -1824,  -2016,  -1952,  -1632,  -1568,  -1760,  -1696,
+      -688,   -656,   -752,   -720,   -560,   -528,   -624,   -592,
+      -944,   -912,  -1008,   -976,   -816,   -784,   -880,   -848,
+      5504,   5248,   6016,   5760,   4480,   4224,   4992,   4736,
+      7552,   7296,   8064,   7808,   6528,   6272,   7040,   6784,
+      2752,   2624,   3008,   2880,   2240,   2112,   2496,   2368,
+      3776,   3648,   4032,   3904,   3264,   3136,   3520,   3392,
+     22016,  20992,  24064,  23040,  17920,  16896,  19968,  18944,
+     30208,  29184,  32256,  31232,  26112,  25088,  28160,  27136,
+     11008,  10496,  12032,  11520,   8960,   8448,   9984,   9472,
+     15104,  14592,  16128,  15616,  13056,  12544,  14080,  13568,
+       344,    328,    376,    360,    280,    264,    312,    296,
+       472,    456,    504,    488,    408,    392,    440,    424,
+        88,     72,    120,    104,     24,      8,     56,     40,
+       216,    200,    248,    232,    152,    136,    184,    168,
+      1376,   1312,   1504,   1440,   1120,   1056,   1248,   1184,
+      1888,   1824,   2016,   1952,   1632,   1568,   1760,   1696,
+       688,    656,    752,    720,    560,    528,    624,    592,
+       944,    912,   1008,    976,    816,    784,    880,    848
+};
+
+/* SIMD kernels decode 16 samples per step and use the tables for the tail */
+#define G711_BLOCK 16
+
+/* Scalar reference kernels; out may be odd-aligned (a byte offset into a ring block),
+   so each sample is stored through memcpy, which compiles to a plain store */
+static void ulaw_to_s16_scalar(const uint8_t* in, size_t n, int16_t* out)
+{
+    size_t i;
+    for (i = 0; i < n; i++) {
+        memcpy(out + i, &ulaw_table[in[i]], sizeof(int16_t));
+    }
+}
+
+static void alaw_to_s16_scalar(const uint8_t* in, size_t n, int16_t* out)
+{
+    size_t i;
+    for (i = 0; i < n; i++) {
+        memcpy(out + i, &alaw_table[in[i]], sizeof(int16_t));
+    }
+}
+
+/*
+ * The vector kernels compute the tables arithmetically on 16-bit lanes:
+ *   μ-law: x = ~b; t = ((x & 0x0F) << 3 | 0x84) << seg; s = t - 0x84; negative if x & 0x80
+ *   A-law: x = b ^ 0x55; t = (x & 0x0F) << 4 | 8, plus 0x100 and << (seg - 1) for seg > 0;
+ *          positive if x & 0x80
+ * where seg = (x >> 4) & 7. Results are bit-exact with the tables above.
+ */
+
+#ifdef G711_HAVE_SSE2
+/* SSE2 has no per-lane shift, so multiply by 2^seg instead. The power of two is built
+   as a float exponent (seg + 127) << 23 and converted back to an integer. */
+static inline __m128i g711_sse2_shift(__m128i t, __m128i seg)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i exp_bias = _mm_set1_epi32(127);
+    __m128i lo = _mm_slli_epi32(_mm_add_epi32(_mm_unpacklo_epi16(seg, zero), exp_bias), 23);
+    __m128i hi = _mm_slli_epi32(_mm_add_epi32(_mm_unpackhi_epi16(seg, zero), exp_bias), 23);
+    __m128i pow2 = _mm_packs_epi32(_mm_cvttps_epi32(_mm_castsi128_ps(lo)),
+                                   _mm_cvttps_epi32(_mm_castsi128_ps(hi)));
+    return _mm_mullo_epi16(t, pow2);
+}
+
+static inline __m128i g711_sse2_ulaw8(__m128i x)
+{
+    const __m128i bias = _mm_set1_epi16(0x84);
+    const __m128i sign_bit = _mm_set1_epi16(0x80);
+    
+    x = _mm_xor_si128(x, _mm_set1_epi16(0xFF));
+    __m128i seg = _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi16(7));
+    __m128i t = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(x, _mm_set1_epi16(0x0F)), 3), bias);
+    t = _mm_sub_epi16(g711_sse2_shift(t, seg), bias);
+    __m128i neg = _mm_cmpeq_epi16(_mm_and_si128(x, sign_bit), sign_bit);
+    return _mm_sub_epi16(_mm_xor_si128(t, neg), neg);
+}
+
+static inline __m128i g711_sse2_alaw8(__m128i x)
+{
+    const __m128i zero = _mm_setzero_si128();
+    
+    x = _mm_xor_si128(x, _mm_set1_epi16(0x55));
+    __m128i seg = _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi16(7));
+    __m128i t = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(x, _mm_set1_epi16(0x0F)), 4), _mm_set1_epi16(8));
+    __m128i nz = _mm_cmpgt_epi16(seg, zero);
+    t = _mm_add_epi16(t, _mm_and_si128(nz, _mm_set1_epi16(0x100)));
+    seg = _mm_sub_epi16(seg, _mm_and_si128(nz, _mm_set1_epi16(1)));
+    t = g711_sse2_shift(t, seg);
+    __m128i neg = _mm_cmpeq_epi16(_mm_and_si128(x, _mm_set1_epi16(0x80)), zero);
+    return _mm_sub_epi16(_mm_xor_si128(t, neg), neg);
+}
+
+static void ulaw_to_s16_sse2(const uint8_t* in, size_t n, int16_t* out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + G711_BLOCK <= n; i += G711_BLOCK) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        _mm_storeu_si128((__m128i*)(out + i), g711_sse2_ulaw8(_mm_unpacklo_epi8(v, zero)));
+        _mm_storeu_si128((__m128i*)(out + i + 8), g711_sse2_ulaw8(_mm_unpackhi_epi8(v, zero)));
+    }
+    ulaw_to_s16_scalar(in + i, n - i, out + i);
+}
+
+static void alaw_to_s16_sse2(const uint8_t* in, size_t n, int16_t* out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + G711_BLOCK <= n; i += G711_BLOCK) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        _mm_storeu_si128((__m128i*)(out + i), g711_sse2_alaw8(_mm_unpacklo_epi8(v, zero)));
+        _mm_storeu_si128((__m128i*)(out + i + 8), g711_sse2_alaw8(_mm_unpackhi_epi8(v, zero)));
+    }
+    alaw_to_s16_scalar(in + i, n - i, out + i);
+}
+
+static const g711_kernel_t g711_kernel_sse2 = { "sse2", ulaw_to_s16_sse2, alaw_to_s16_sse2 };
+#endif /* G711_HAVE_SSE2 */
+
+#ifdef G711_HAVE_AVX2
+/* AVX2 variant of the same arithmetic on 16 lanes; built with a target attribute so the
+   plugin itself needs no -mavx2 and the kernel is only selected when the CPU has it */
+G711_TARGET_AVX2 static inline __m256i g711_avx2_shift(__m256i t, __m256i seg)
+{
+    /* 2^seg by byte shuffle; the 0x80 high byte makes pshufb zero the upper half */
+    const __m256i pow2_table = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i pow2 = _mm256_shuffle_epi8(pow2_table, _mm256_or_si256(seg, _mm256_set1_epi16((short)0x8000)));
+    return _mm256_mullo_epi16(t, pow2);
+}
+
+G711_TARGET_AVX2 static void ulaw_to_s16_avx2(const uint8_t* in, size_t n, int16_t* out)
+{
+    const __m256i bias = _mm256_set1_epi16(0x84);
+    const __m256i sign_bit = _mm256_set1_epi16(0x80);
+    size_t i = 0;
+    for (; i + G711_BLOCK <= n; i += G711_BLOCK) {
+        __m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(in + i)));
+        x = _mm256_xor_si256(x, _mm256_set1_epi16(0xFF));
+        __m256i seg = _mm256_and_si256(_mm256_srli_epi16(x, 4), _mm256_set1_epi16(7));
+        __m256i t = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(x, _mm256_set1_epi16(0x0F)), 3), bias);
+        t = _mm256_sub_epi16(g711_avx2_shift(t, seg), bias);
+        __m256i neg = _mm256_cmpeq_epi16(_mm256_and_si256(x, sign_bit), sign_bit);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_sub_epi16(_mm256_xor_si256(t, neg), neg));
+    }
+    ulaw_to_s16_scalar(in + i, n - i, out + i);
+}
+
+G711_TARGET_AVX2 static void alaw_to_s16_avx2(const uint8_t* in, size_t n, int16_t* out)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + G711_BLOCK <= n; i += G711_BLOCK) {
+        __m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(in + i)));
+        x = _mm256_xor_si256(x, _mm256_set1_epi16(0x55));
+        __m256i seg = _mm256_and_si256(_mm256_srli_epi16(x, 4), _mm256_set1_epi16(7));
+        __m256i t = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(x, _mm256_set1_epi16(0x0F)), 4), _mm256_set1_epi16(8));
+        __m256i nz = _mm256_cmpgt_epi16(seg, zero);
+        t = _mm256_add_epi16(t, _mm256_and_si256(nz, _mm256_set1_epi16(0x100)));
+        seg = _mm256_sub_epi16(seg, _mm256_and_si256(nz, _mm256_set1_epi16(1)));
+        t = g711_avx2_shift(t, seg);
+        __m256i neg = _mm256_cmpeq_epi16(_mm256_and_si256(x, _mm256_set1_epi16(0x80)), zero);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_sub_epi16(_mm256_xor_si256(t, neg), neg));
+    }
+    alaw_to_s16_scalar(in + i, n - i, out + i);
+}
+
+static const g711_kernel_t g711_kernel_avx2 = { "avx2", ulaw_to_s16_avx2, alaw_to_s16_avx2 };
+#endif /* G711_HAVE_AVX2 */
+
+#ifdef G711_HAVE_NEON
+/* NEON has per-lane shifts (vshlq), so the segment shift is a single instruction */
+static inline int16x8_t g711_neon_ulaw8(uint16x8_t x)
+{
+    const uint16x8_t bias = vdupq_n_u16(0x84);
+    
+    x = veorq_u16(x, vdupq_n_u16(0xFF));
+    int16x8_t seg = vreinterpretq_s16_u16(vandq_u16(vshrq_n_u16(x, 4), vdupq_n_u16(7)));
+    uint16x8_t t = vorrq_u16(vshlq_n_u16(vandq_u16(x, vdupq_n_u16(0x0F)), 3), bias);
+    int16x8_t mag = vreinterpretq_s16_u16(vsubq_u16(vshlq_u16(t, seg), bias));
+    uint16x8_t neg = vtstq_u16(x, vdupq_n_u16(0x80));
+    return vbslq_s16(neg, vnegq_s16(mag), mag);
+}
+
+static inline int16x8_t g711_neon_alaw8(uint16x8_t x)
+{
+    x = veorq_u16(x, vdupq_n_u16(0x55));
+    uint16x8_t seg = vandq_u16(vshrq_n_u16(x, 4), vdupq_n_u16(7));
+    uint16x8_t t = vorrq_u16(vshlq_n_u16(vandq_u16(x, vdupq_n_u16(0x0F)), 4), vdupq_n_u16(8));
+    uint16x8_t nz = vcgtq_u16(seg, vdupq_n_u16(0));
+    t = vaddq_u16(t, vandq_u16(nz, vdupq_n_u16(0x100)));
+    seg = vsubq_u16(seg, vandq_u16(nz, vdupq_n_u16(1)));
+    int16x8_t mag = vreinterpretq_s16_u16(vshlq_u16(t, vreinterpretq_s16_u16(seg)));
+    uint16x8_t pos = vtstq_u16(x, vdupq_n_u16(0x80));
+    return vbslq_s16(pos, mag, vnegq_s16(mag));
+}
+
+static void ulaw_to_s16_neon(const uint8_t* in, size_t n, int16_t* out)
+{
+    size_t i = 0;
+    for (; i + G711_BLOCK <= n; i += G711_BLOCK) {
+        uint8x16_t v = vld1q_u8(in + i);
+        vst1q_s16(out + i, g711_neon_ulaw8(vmovl_u8(vget_low_u8(v))));
+        vst1q_s16(out + i + 8, g711_neon_ulaw8(vmovl_u8(vget_high_u8(v))));
+    }
+    ulaw_to_s16_scalar(in + i, n - i, out + i);
+}
+
+static void alaw_to_s16_neon(const uint8_t* in, size_t n, int16_t* out)
+{
+    size_t i = 0;
+    for (; i + G711_BLOCK <= n; i += G711_BLOCK) {
+        uint8x16_t v = vld1q_u8(in + i);
+        vst1q_s16(out + i, g711_neon_alaw8(vmovl_u8(vget_low_u8(v))));
+        vst1q_s16(out + i + 8, g711_neon_alaw8(vmovl_u8(vget_high_u8(v))));
+    }
+    alaw_to_s16_scalar(in + i, n - i, out + i);
+}
+
+static const g711_kernel_t g711_kernel_neon = { "neon", ulaw_to_s16_neon, alaw_to_s16_neon };
+#endif /* G711_HAVE_NEON */
+
+static const g711_kernel_t g711_kernel_scalar = { "scalar", ulaw_to_s16_scalar, alaw_to_s16_scalar };
+
+/* Active kernel; the scalar one is valid before g711_decode_init() runs */
+static const g711_kernel_t *g711_active = &g711_kernel_scalar;
+
+#ifdef G711_HAVE_AVX2
+static int g711_cpu_has_avx2(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+/**
+ * List kernels usable on this CPU (scalar reference first)
+ */
+const g711_kernel_t* g711_decode_kernels(size_t *count)
+{
+    static g711_kernel_t kernels[4];
+    size_t n = 0;
+    
+    kernels[n++] = g711_kernel_scalar;
+#ifdef G711_HAVE_SSE2
+    kernels[n++] = g711_kernel_sse2;
+#endif
+#ifdef G711_HAVE_AVX2
+    if (g711_cpu_has_avx2()) {
+        kernels[n++] = g711_kernel_avx2;
+    }
+#endif
+#ifdef G711_HAVE_NEON
+    kernels[n++] = g711_kernel_neon;
+#endif
+    
+    if (count) {
+        *count = n;
+    }
+    return kernels;
+}
+
+/**
+ * Pick the widest kernel the CPU supports
+ */
+void g711_decode_init(void)
+{
+#if defined(G711_HAVE_AVX2)
+    if (g711_cpu_has_avx2()) {
+        g711_active = &g711_kernel_avx2;
+        return;
+    }
+#endif
+#if defined(G711_HAVE_SSE2)
+    g711_active = &g711_kernel_sse2;
+#elif defined(G711_HAVE_NEON)
+    g711_active = &g711_kernel_neon;
+#endif
+}
+
+const char* g711_decode_kernel_name(void)
+{
+    return g711_active->name;
+}
+
+/**
+ * Convert single μ-law byte to 16-bit PCM sample
+ */
+int16_t ulaw_byte_to_s16(uint8_t ulaw_byte)
+{
+    return ulaw_table[ulaw_byte];
+}
+
+/**
+ * Convert single A-law byte to 16-bit PCM sample
+ */
+int16_t alaw_byte_to_s16(uint8_t alaw_byte)
+{
+    return alaw_table[alaw_byte];
+}
+
+/**
+ * Convert μ-law encoded audio data to 16-bit PCM
+ */
+void ulaw_to_s16(const uint8_t* in, size_t n, int16_t* out)
+{
+    g711_active->ulaw(in, n, out);
+}
+
+/**
+ * Convert A-law encoded audio data to 16-bit PCM
+ */
+void alaw_to_s16(const uint8_t* in, size_t n, int16_t* out)
+{
+    g711_active->alaw(in, n, out);
+}
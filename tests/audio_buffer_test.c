@@ -0,0 +1,281 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file audio_buffer_test.c
+ * @brief Stress test of the SPSC audio ring and its block slab; meant to run under ThreadSanitizer.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* One producer (reserve/commit and write), one consumer (read_frame/collect) and a
+   third thread clearing the ring at random, as STOP does from the consumer task.
+   The stream is 32-bit words numbering themselves, so the consumer can tell from the
+   ring's tail exactly which word each byte it reads must be. */
+
+#include "elevenlabs_defs.h"
+#include "elevenlabs_audio_buffer.h"
+#include "apr_general.h"
+#include "apr_thread_proc.h"
+#include "apr_time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* No logger is created, so apt_log() returns before looking at the source */
+APR_DECLARE_DATA apt_log_source_t *elevenlabs_synth_log_source = NULL;
+
+#define TEST_STREAM_BYTES (64UL * 1024 * 1024)
+#define TEST_RING_BYTES (3 * ELEVENLABS_AUDIO_BLOCK_SIZE)   /* Four blocks once rounded up */
+#define TEST_MAX_WRITE 8192                                 /* Bytes, a multiple of 4 */
+#define TEST_FRAME 320                                      /* 20 ms of L16/8000 */
+
+#define CHECK(cond) \
+    do { if (!(cond)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); exit(1); } } while (0)
+
+typedef struct {
+    audio_buffer_t *ring;
+    elevenlabs_slab_t *slab;
+    apr_size_t block_count;
+    atomic_int producer_done;
+    atomic_int clearing;        /* Cleared by the producer past 3/4 of the stream */
+    atomic_ulong clears;
+    /* Consumer results, read after the join */
+    unsigned long words_read;
+    unsigned long gaps;
+    uint32_t last_word;
+} ring_test_t;
+
+/* Bytes [pos, pos + size) of the stream; pos and size are multiples of 4 */
+static void stream_fill(uint8_t *dst, apr_size_t pos, apr_size_t size)
+{
+    for (apr_size_t i = 0; i < size; i += 4) {
+        uint32_t word = (uint32_t)((pos + i) / 4);
+        memcpy(dst + i, &word, 4);
+    }
+}
+
+static void* APR_THREAD_FUNC producer_run(apr_thread_t *thread, void *data)
+{
+    ring_test_t *test = data;
+    uint8_t chunk[TEST_MAX_WRITE];
+    unsigned seed = 1;
+    apr_size_t pos = 0;
+
+    while (pos < TEST_STREAM_BYTES) {
+        apr_size_t size = ((apr_size_t)(rand_r(&seed) % (TEST_MAX_WRITE / 4)) + 1) * 4;
+        if (size > TEST_STREAM_BYTES - pos) {
+            size = TEST_STREAM_BYTES - pos;
+        }
+        if (audio_buffer_space(test->ring) < size) {
+            apr_thread_yield();
+            continue;
+        }
+        if (rand_r(&seed) & 1) {
+            /* Zero-copy path, as the G.711 decoder uses it */
+            audio_buffer_span_t span;
+            CHECK(audio_buffer_reserve(test->ring, size, &span));
+            CHECK(span.len[0] + span.len[1] == size);
+            CHECK(span.len[0] % 4 == 0);
+            stream_fill(span.data[0], pos, span.len[0]);
+            if (span.len[1]) {
+                stream_fill(span.data[1], pos + span.len[0], span.len[1]);
+            }
+            audio_buffer_commit(test->ring, size);
+        } else {
+            stream_fill(chunk, pos, size);
+            CHECK(audio_buffer_write(test->ring, chunk, size));
+        }
+        pos += size;
+        if (pos > TEST_STREAM_BYTES / 4 * 3) {
+            atomic_store(&test->clearing, 0);
+        }
+    }
+    atomic_store(&test->producer_done, 1);
+    apr_thread_exit(thread, APR_SUCCESS);
+    return NULL;
+}
+
+static void* APR_THREAD_FUNC consumer_run(apr_thread_t *thread, void *data)
+{
+    ring_test_t *test = data;
+    uint8_t frame[TEST_FRAME];
+    apr_size_t last_end = 0;
+
+    for (;;) {
+        audio_buffer_collect(test->ring);
+        apr_size_t n = audio_buffer_read_frame(test->ring, frame, sizeof(frame));
+        CHECK(atomic_load_explicit(&test->slab->in_use, memory_order_relaxed) <= test->block_count);
+        if (n == 0) {
+            if (atomic_load(&test->producer_done) && audio_buffer_available(test->ring) == 0) {
+                break;
+            }
+            apr_thread_yield();
+            continue;
+        }
+
+        /* The tail is ours: it says where these bytes came from */
+        apr_size_t start = atomic_load_explicit(&test->ring->tail, memory_order_relaxed) - n;
+        CHECK(start % 4 == 0 && n % 4 == 0);
+        CHECK(start >= last_end);
+        if (start != last_end) {
+            test->gaps++;
+        }
+        for (apr_size_t i = 0; i < n; i += 4) {
+            uint32_t word;
+            memcpy(&word, frame + i, 4);
+            CHECK(word == (uint32_t)((start + i) / 4));
+            test->last_word = word;
+        }
+        test->words_read += n / 4;
+        last_end = start + n;
+    }
+    apr_thread_exit(thread, APR_SUCCESS);
+    return NULL;
+}
+
+static void* APR_THREAD_FUNC clearer_run(apr_thread_t *thread, void *data)
+{
+    ring_test_t *test = data;
+    unsigned seed = 2;
+
+    while (atomic_load(&test->clearing)) {
+        apr_sleep(rand_r(&seed) % 500);
+        audio_buffer_clear(test->ring);
+        atomic_fetch_add(&test->clears, 1);
+    }
+    apr_thread_exit(thread, APR_SUCCESS);
+    return NULL;
+}
+
+/* The producer stops at the start of the consumer's block: that block goes back to the
+   slab whole, so not a byte of it may be reused while the consumer is still inside */
+static void test_consumer_block(apr_pool_t *pool)
+{
+    const apr_size_t block = ELEVENLABS_AUDIO_BLOCK_SIZE;
+    elevenlabs_slab_t *slab = elevenlabs_slab_create(pool);
+    CHECK(slab);
+    audio_buffer_t *ring = audio_buffer_create(pool, slab, block);   /* Two blocks */
+    CHECK(ring && ring->capacity == 2 * block);
+
+    uint8_t *chunk = malloc(block);
+    uint8_t frame[TEST_FRAME];
+    audio_buffer_span_t span;
+    CHECK(chunk);
+
+    /* Fill both blocks */
+    stream_fill(chunk, 0, block);
+    CHECK(audio_buffer_write(ring, chunk, block));
+    stream_fill(chunk, block, block);
+    CHECK(audio_buffer_write(ring, chunk, block));
+    CHECK(audio_buffer_space(ring) == 0);
+    CHECK(atomic_load(&slab->in_use) == 2);
+
+    /* One frame read: the consumer is inside block 0, which stays off limits */
+    CHECK(audio_buffer_read_frame(ring, frame, TEST_FRAME) == TEST_FRAME);
+    CHECK(audio_buffer_space(ring) == 0);
+    CHECK(!audio_buffer_reserve(ring, 4, &span));
+    CHECK(!audio_buffer_write(ring, chunk, 4));
+    CHECK(atomic_load(&slab->in_use) == 2);
+
+    /* Up to the last word of block 0: still inside, still full, bytes untouched */
+    CHECK(audio_buffer_read_frame(ring, chunk, block - TEST_FRAME - 4) == block - TEST_FRAME - 4);
+    CHECK(audio_buffer_space(ring) == 0);
+    CHECK(!audio_buffer_reserve(ring, 4, &span));
+    CHECK(audio_buffer_read_frame(ring, frame, 4) == 4);
+    uint32_t word;
+    memcpy(&word, frame, 4);
+    CHECK(word == (uint32_t)(block / 4 - 1));
+
+    /* Across the boundary: block 0 is back in the slab and all of it is writable */
+    CHECK(atomic_load(&slab->in_use) == 1);
+    CHECK(audio_buffer_space(ring) == block);
+    CHECK(!audio_buffer_reserve(ring, block + 4, &span));
+    CHECK(audio_buffer_reserve(ring, block, &span));
+    CHECK(span.len[0] == block && span.len[1] == 0);
+    stream_fill(span.data[0], 2 * block, block);
+    audio_buffer_commit(ring, block);
+    CHECK(atomic_load(&slab->in_use) == 2);
+    CHECK(audio_buffer_space(ring) == 0);
+
+    /* Block 1 then the new block 0 read back in order */
+    for (apr_size_t pos = block; pos < 3 * block; pos += TEST_FRAME) {
+        apr_size_t want = 3 * block - pos < TEST_FRAME ? 3 * block - pos : TEST_FRAME;
+        CHECK(audio_buffer_read_frame(ring, frame, TEST_FRAME) == want);
+        for (apr_size_t i = 0; i < want; i += 4) {
+            memcpy(&word, frame + i, 4);
+            CHECK(word == (uint32_t)((pos + i) / 4));
+        }
+    }
+
+    /* A clear frees nothing until the consumer has collected it */
+    stream_fill(chunk, 3 * block, block);
+    CHECK(audio_buffer_write(ring, chunk, block));
+    CHECK(audio_buffer_read_frame(ring, frame, TEST_FRAME) == TEST_FRAME);
+    CHECK(audio_buffer_write(ring, chunk, block - TEST_FRAME));
+    audio_buffer_clear(ring);
+    CHECK(audio_buffer_space(ring) == TEST_FRAME);
+    audio_buffer_collect(ring);
+    CHECK(audio_buffer_available(ring) == 0);
+    CHECK(atomic_load(&slab->in_use) == 1);
+    CHECK(audio_buffer_space(ring) == 2 * block - (atomic_load(&ring->tail) & (block - 1)));
+
+    audio_buffer_destroy(ring);
+    CHECK(atomic_load(&slab->in_use) == 0);
+    elevenlabs_slab_destroy(slab);
+    free(chunk);
+    printf("consumer block: OK\n");
+}
+
+/* Producer, consumer and clearer at once; byte order holds and no block leaks */
+static void test_concurrent(apr_pool_t *pool)
+{
+    ring_test_t test;
+    memset(&test, 0, sizeof(test));
+    test.slab = elevenlabs_slab_create(pool);
+    CHECK(test.slab);
+    test.ring = audio_buffer_create(pool, test.slab, TEST_RING_BYTES);
+    CHECK(test.ring);
+    test.block_count = test.ring->capacity / ELEVENLABS_AUDIO_BLOCK_SIZE;
+    atomic_init(&test.producer_done, 0);
+    atomic_init(&test.clearing, 1);
+    atomic_init(&test.clears, 0);
+
+    apr_thread_t *producer, *consumer, *clearer;
+    apr_status_t rv;
+    CHECK(apr_thread_create(&consumer, NULL, consumer_run, &test, pool) == APR_SUCCESS);
+    CHECK(apr_thread_create(&clearer, NULL, clearer_run, &test, pool) == APR_SUCCESS);
+    CHECK(apr_thread_create(&producer, NULL, producer_run, &test, pool) == APR_SUCCESS);
+    apr_thread_join(&rv, producer);
+    apr_thread_join(&rv, clearer);
+    apr_thread_join(&rv, consumer);
+
+    /* Nothing was cleared past 3/4, so the end of the stream arrived whole */
+    CHECK(test.words_read > 0);
+    CHECK(test.last_word == (uint32_t)(TEST_STREAM_BYTES / 4 - 1));
+    CHECK(test.gaps <= atomic_load(&test.clears));
+
+    /* Every borrowed block is back: drained ones during the run, the rest on destroy */
+    audio_buffer_collect(test.ring);
+    audio_buffer_destroy(test.ring);
+    CHECK(atomic_load(&test.slab->in_use) == 0);
+    CHECK(atomic_load(&test.slab->blocks) == atomic_load(&test.slab->spare));
+    printf("concurrent: %lu words read, %lu clears, %lu gaps, peak %lu blocks\n",
+           test.words_read, atomic_load(&test.clears), test.gaps, atomic_load(&test.slab->peak));
+    elevenlabs_slab_destroy(test.slab);
+}
+
+int main(void)
+{
+    apr_pool_t *pool;
+    CHECK(apr_initialize() == APR_SUCCESS);
+    CHECK(apr_pool_create(&pool, NULL) == APR_SUCCESS);
+
+    test_consumer_block(pool);
+    test_concurrent(pool);
+
+    apr_pool_destroy(pool);
+    apr_terminate();
+    printf("audio_buffer_test: OK\n");
+    return 0;
+}
@@ -0,0 +1,480 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file cache_test.c
+ * @brief Cache without a server: memory tier LRU and budget, disk index eviction, cache keys.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* Blobs are real files of chosen sizes mapped through elevenlabs_cache_blob_open, so the
+   tier accounts the same mapped sizes it does in the plugin. After every step the LRU
+   list is walked both ways and checked against the index and the byte count. The disk
+   index is seeded through index.txt with chosen access times and hit counts, so which
+   files its background thread evicts does not depend on the clock. Cache keys are
+   checked against digests worked out independently of the plugin: a key that drifts
+   orphans every file already in cache_dir. */
+
+#include "elevenlabs_synth.h"
+#include "apr_general.h"
+#include "apr_strings.h"
+#include "apr_time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_BLOB_BYTES 1000
+#define TEST_BUDGET (3 * TEST_BLOB_BYTES)
+#define TEST_DISK_FILES 10
+#define TEST_DISK_FILE_BYTES 100
+#define TEST_DISK_WAIT apr_time_from_sec(5)
+
+static int failures = 0;
+
+#define CHECK(cond, ...) \
+    do { if (!(cond)) { fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); failures++; } } while (0)
+
+/* A blob of size bytes under dir, keyed key; the caller holds the one reference */
+static elevenlabs_cache_blob_t* test_blob(apr_pool_t *pool, const char *dir, const char *key, apr_size_t size)
+{
+    const char *path = apr_psprintf(pool, "%s/%s.bin", dir, key);
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return NULL;
+    }
+    for (apr_size_t i = 0; i < size; i++) {
+        fputc((int)(i & 0xff), f);
+    }
+    fclose(f);
+    elevenlabs_cache_blob_t *blob = elevenlabs_cache_blob_open(path, 0, key, TRUE);
+    unlink(path);    /* The mapping keeps it */
+    return blob;
+}
+
+/* Keys from most to least recently used, comma-separated; checks the list links, the
+   index and the byte count agree on the way */
+static const char* test_lru_order(apr_pool_t *pool, const char *name, elevenlabs_cache_memory_t *memory_cache)
+{
+    const char *order = "";
+    apr_size_t bytes = 0;
+    unsigned count = 0;
+    elevenlabs_cache_blob_t *prev = NULL;
+    for (elevenlabs_cache_blob_t *blob = memory_cache->lru_head; blob; blob = blob->lru_next) {
+        CHECK(blob->lru_prev == prev, "%s: %s has a stale back link", name, blob->key);
+        CHECK(apr_hash_get(memory_cache->index, blob->key, APR_HASH_KEY_STRING) == blob,
+              "%s: %s is listed but not indexed", name, blob->key);
+        order = apr_pstrcat(pool, order, *order ? "," : "", blob->key, NULL);
+        bytes += blob->size;
+        count++;
+        prev = blob;
+    }
+    CHECK(memory_cache->lru_tail == prev, "%s: tail is not the last entry", name);
+    CHECK(apr_hash_count(memory_cache->index) == count, "%s: %u indexed, %u listed",
+          name, apr_hash_count(memory_cache->index), count);
+    CHECK(memory_cache->bytes == bytes, "%s: %lu bytes counted, %lu listed",
+          name, (unsigned long)memory_cache->bytes, (unsigned long)bytes);
+    CHECK(memory_cache->bytes <= memory_cache->max_bytes, "%s: %lu bytes over the %lu budget",
+          name, (unsigned long)memory_cache->bytes, (unsigned long)memory_cache->max_bytes);
+    return order;
+}
+
+#define CHECK_ORDER(name, memory_cache, want) \
+    do { \
+        const char *order = test_lru_order(pool, name, memory_cache); \
+        CHECK(strcmp(order, want) == 0, "%s: LRU order %s, want %s", name, order, want); \
+    } while (0)
+
+/* Put a blob and drop the caller's reference, as the channel does after a download */
+static void test_put(elevenlabs_cache_memory_t *memory_cache, elevenlabs_cache_blob_t *blob)
+{
+    elevenlabs_cache_memory_put(memory_cache, blob);
+    elevenlabs_cache_blob_unref(blob);
+}
+
+/* Look a key up without disturbing anything but its recency */
+static apt_bool_t test_hit(elevenlabs_cache_memory_t *memory_cache, const char *key)
+{
+    elevenlabs_cache_blob_t *blob = elevenlabs_cache_memory_get(memory_cache, key);
+    if (!blob) {
+        return FALSE;
+    }
+    elevenlabs_cache_blob_unref(blob);
+    return TRUE;
+}
+
+static void test_memory_lru(apr_pool_t *pool, const char *dir)
+{
+    elevenlabs_cache_memory_t *memory_cache = elevenlabs_cache_memory_create(pool, TEST_BUDGET);
+    CHECK(memory_cache != NULL, "memory: tier not created");
+    if (!memory_cache) {
+        return;
+    }
+
+    test_put(memory_cache, test_blob(pool, dir, "a", TEST_BLOB_BYTES));
+    test_put(memory_cache, test_blob(pool, dir, "b", TEST_BLOB_BYTES));
+    test_put(memory_cache, test_blob(pool, dir, "c", TEST_BLOB_BYTES));
+    CHECK_ORDER("fill", memory_cache, "c,b,a");
+    CHECK(memory_cache->bytes == TEST_BUDGET, "fill: %lu bytes", (unsigned long)memory_cache->bytes);
+
+    /* A hit moves the key to the front, so the next victim is the one not played since */
+    CHECK(test_hit(memory_cache, "a"), "get: a missing");
+    CHECK_ORDER("get", memory_cache, "a,c,b");
+    test_put(memory_cache, test_blob(pool, dir, "d", TEST_BLOB_BYTES));
+    CHECK_ORDER("evict one", memory_cache, "d,a,c");
+    CHECK(atomic_load(&memory_cache->evictions) == 1, "evict one: %lu evictions",
+          (unsigned long)atomic_load(&memory_cache->evictions));
+    CHECK(!test_hit(memory_cache, "b"), "evict one: b still cached");
+
+    /* A key already present keeps its blob and its place; the new one is not taken */
+    elevenlabs_cache_blob_t *kept = elevenlabs_cache_memory_get(memory_cache, "c");
+    elevenlabs_cache_blob_t *duplicate = test_blob(pool, dir, "c", 2 * TEST_BLOB_BYTES);
+    elevenlabs_cache_memory_put(memory_cache, duplicate);
+    CHECK(atomic_load(&duplicate->refs) == 1, "duplicate: the tier took a reference");
+    elevenlabs_cache_blob_t *again = elevenlabs_cache_memory_get(memory_cache, "c");
+    CHECK(again == kept, "duplicate: key c now maps another blob");
+    elevenlabs_cache_blob_unref(again);
+    elevenlabs_cache_blob_unref(duplicate);
+    CHECK_ORDER("duplicate", memory_cache, "c,d,a");
+
+    /* Over the whole budget: never cached and nothing evicted for it */
+    elevenlabs_cache_blob_t *oversize = test_blob(pool, dir, "big", TEST_BUDGET + 1);
+    elevenlabs_cache_memory_put(memory_cache, oversize);
+    CHECK(atomic_load(&oversize->refs) == 1, "oversize: the tier took a reference");
+    elevenlabs_cache_blob_unref(oversize);
+    CHECK_ORDER("oversize", memory_cache, "c,d,a");
+
+    /* A blob keyed by nothing has no way back out of the index */
+    test_put(memory_cache, test_blob(pool, dir, "", TEST_BLOB_BYTES));
+    CHECK_ORDER("no key", memory_cache, "c,d,a");
+
+    /* One large entry evicts from the tail until it fits, however many that takes. c is
+       still held by a player: evicted from the tier, its mapping stays readable. */
+    test_put(memory_cache, test_blob(pool, dir, "e", 2 * TEST_BLOB_BYTES + TEST_BLOB_BYTES / 2));
+    CHECK_ORDER("evict several", memory_cache, "e");
+    CHECK(atomic_load(&memory_cache->evictions) == 4, "evict several: %lu evictions",
+          (unsigned long)atomic_load(&memory_cache->evictions));
+    CHECK(atomic_load(&kept->refs) == 1, "evict several: the tier still holds c");
+    CHECK(kept->len == TEST_BLOB_BYTES && kept->data[TEST_BLOB_BYTES - 1] == (TEST_BLOB_BYTES - 1) % 256,
+          "evict several: c unreadable after eviction");
+    elevenlabs_cache_blob_unref(kept);
+
+    /* Exactly at the budget fits alongside nothing else */
+    test_put(memory_cache, test_blob(pool, dir, "f", TEST_BLOB_BYTES / 2));
+    CHECK_ORDER("fits", memory_cache, "f,e");
+    test_put(memory_cache, test_blob(pool, dir, "g", TEST_BUDGET));
+    CHECK_ORDER("whole budget", memory_cache, "g");
+    CHECK(memory_cache->bytes == TEST_BUDGET, "whole budget: %lu bytes", (unsigned long)memory_cache->bytes);
+
+    /* Gets so far: a, c, c (hits) and b (miss) */
+    CHECK(atomic_load(&memory_cache->hits) == 3 && atomic_load(&memory_cache->misses) == 1,
+          "counters: %lu hits, %lu misses", (unsigned long)atomic_load(&memory_cache->hits),
+          (unsigned long)atomic_load(&memory_cache->misses));
+
+    elevenlabs_cache_memory_destroy(memory_cache);
+}
+
+/* Disk cache file name of entry i */
+static const char* test_disk_name(apr_pool_t *pool, unsigned i)
+{
+    return apr_psprintf(pool, "k%02u.wav", i);
+}
+
+static apt_bool_t test_disk_exists(apr_pool_t *pool, const char *dir, unsigned i)
+{
+    return access(apr_psprintf(pool, "%s/%s", dir, test_disk_name(pool, i)), F_OK) == 0;
+}
+
+/* Files k01..k10 of TEST_DISK_FILE_BYTES each and an index listing them as left by a
+   clean shutdown: k01 accessed longest ago, hits[i - 1] plays each */
+static void test_disk_seed(apr_pool_t *pool, const char *dir, const unsigned *hits)
+{
+    FILE *index = fopen(apr_psprintf(pool, "%s/%s", dir, ELEVENLABS_CACHE_INDEX_FILE), "w");
+    if (!index) {
+        CHECK(0, "disk: cannot write the index");
+        return;
+    }
+    fprintf(index, "elevenlabs-cache-index 1 clean\n");
+    for (unsigned i = 1; i <= TEST_DISK_FILES; i++) {
+        FILE *f = fopen(apr_psprintf(pool, "%s/%s", dir, test_disk_name(pool, i)), "wb");
+        if (f) {
+            for (unsigned b = 0; b < TEST_DISK_FILE_BYTES; b++) {
+                fputc(0, f);
+            }
+            fclose(f);
+        }
+        fprintf(index, "%s %u %lld %u\n", test_disk_name(pool, i), TEST_DISK_FILE_BYTES,
+                (long long)apr_time_from_sec(1000 + i), hits[i - 1]);
+    }
+    fclose(index);
+}
+
+/* Remove everything the disk cases leave in dir */
+static void test_disk_clear(apr_pool_t *pool, const char *dir)
+{
+    for (unsigned i = 0; i <= TEST_DISK_FILES + 1; i++) {
+        unlink(apr_psprintf(pool, "%s/%s", dir, test_disk_name(pool, i)));
+    }
+    unlink(apr_psprintf(pool, "%s/%s", dir, ELEVENLABS_CACHE_INDEX_FILE));
+    unlink(apr_psprintf(pool, "%s/%s.tmp", dir, ELEVENLABS_CACHE_INDEX_FILE));
+    unlink(apr_psprintf(pool, "%s/k99.wav.part", dir));
+}
+
+/* The eviction thread runs on its own; wait for it to have evicted count files */
+static apt_bool_t test_disk_wait(elevenlabs_cache_disk_t *disk_cache, unsigned long count)
+{
+    apr_time_t deadline = apr_time_now() + TEST_DISK_WAIT;
+    while (atomic_load(&disk_cache->evictions) < count && apr_time_now() < deadline) {
+        apr_sleep(1000);
+    }
+    return atomic_load(&disk_cache->evictions) == count;
+}
+
+/* Which of k01..k10 are gone, comma-separated; the index and the directory must agree */
+static const char* test_disk_evicted(apr_pool_t *pool, const char *name, elevenlabs_cache_disk_t *disk_cache,
+                                     const char *dir)
+{
+    const char *evicted = "";
+    for (unsigned i = 1; i <= TEST_DISK_FILES; i++) {
+        apt_bool_t indexed;
+        apr_thread_mutex_lock(disk_cache->mutex);
+        indexed = apr_hash_get(disk_cache->index, apr_psprintf(pool, "k%02u", i), APR_HASH_KEY_STRING) != NULL;
+        apr_thread_mutex_unlock(disk_cache->mutex);
+        CHECK(indexed == test_disk_exists(pool, dir, i), "%s: k%02u %s the index but %s on disk", name, i,
+              indexed ? "in" : "not in", indexed ? "not" : "still");
+        if (!indexed) {
+            evicted = apr_pstrcat(pool, evicted, *evicted ? "," : "", apr_psprintf(pool, "k%02u", i), NULL);
+        }
+    }
+    return evicted;
+}
+
+static elevenlabs_cache_disk_t* test_disk_open(apr_pool_t *pool, const char *dir, apr_size_t max_bytes,
+                                               unsigned max_entries, const char *policy)
+{
+    elevenlabs_config_t *config = apr_pcalloc(pool, sizeof(elevenlabs_config_t));
+    config->cache_dir = apr_pstrdup(pool, dir);
+    config->cache_max_bytes = max_bytes;
+    config->cache_max_entries = max_entries;
+    config->cache_eviction_policy = apr_pstrdup(pool, policy);
+    return elevenlabs_cache_disk_open(pool, config);
+}
+
+/* LRU over the byte bound: the index at exactly max_bytes is left alone; one more file
+   evicts the least recently used down to 90% of it. A lookup counts as a use. */
+static void test_disk_lru(apr_pool_t *pool, const char *dir)
+{
+    static const unsigned hits[TEST_DISK_FILES] = { 0 };
+    test_disk_seed(pool, dir, hits);
+    elevenlabs_cache_disk_t *disk_cache = test_disk_open(pool, dir, TEST_DISK_FILES * TEST_DISK_FILE_BYTES, 0, "lru");
+    CHECK(disk_cache != NULL, "disk lru: index not opened");
+    if (!disk_cache) {
+        return;
+    }
+    CHECK(disk_cache->entries == TEST_DISK_FILES && disk_cache->bytes == TEST_DISK_FILES * TEST_DISK_FILE_BYTES,
+          "disk lru: loaded %u files, %lu bytes", disk_cache->entries, (unsigned long)disk_cache->bytes);
+    apr_sleep(apr_time_from_msec(50));
+    CHECK(atomic_load(&disk_cache->evictions) == 0, "disk lru: evicted at the bound");
+
+    CHECK(elevenlabs_cache_disk_lookup(disk_cache, "k01"), "disk lru: k01 missing");
+    CHECK(!elevenlabs_cache_disk_lookup(disk_cache, "k00"), "disk lru: k00 found");
+    FILE *f = fopen(apr_psprintf(pool, "%s/%s", dir, test_disk_name(pool, TEST_DISK_FILES + 1)), "wb");
+    if (f) {
+        fclose(f);
+    }
+    elevenlabs_cache_disk_insert(disk_cache, "k11", test_disk_name(pool, TEST_DISK_FILES + 1), TEST_DISK_FILE_BYTES);
+
+    /* 1100 bytes down to at most 900: the two oldest apart from k01, just looked up */
+    CHECK(test_disk_wait(disk_cache, 2), "disk lru: %lu evictions, want 2",
+          (unsigned long)atomic_load(&disk_cache->evictions));
+    const char *evicted = test_disk_evicted(pool, "disk lru", disk_cache, dir);
+    CHECK(strcmp(evicted, "k02,k03") == 0, "disk lru: evicted %s, want k02,k03", evicted);
+    CHECK(test_disk_exists(pool, dir, TEST_DISK_FILES + 1), "disk lru: the new file was evicted");
+    CHECK(disk_cache->entries == 9 && disk_cache->bytes == 9 * TEST_DISK_FILE_BYTES,
+          "disk lru: %u files, %lu bytes left", disk_cache->entries, (unsigned long)disk_cache->bytes);
+
+    /* A forgotten entry no longer counts against the bounds */
+    elevenlabs_cache_disk_remove(disk_cache, "k11");
+    CHECK(disk_cache->entries == 8 && disk_cache->bytes == 8 * TEST_DISK_FILE_BYTES,
+          "disk lru: %u files, %lu bytes after remove", disk_cache->entries, (unsigned long)disk_cache->bytes);
+    elevenlabs_cache_disk_close(disk_cache);
+    test_disk_clear(pool, dir);
+}
+
+/* LFU over the entry bound: fewest plays go first, ties to the least recently used, and
+   a just-downloaded file (no plays yet, but newest) outlives older unplayed ones */
+static void test_disk_lfu(apr_pool_t *pool, const char *dir)
+{
+    static const unsigned hits[TEST_DISK_FILES] = { 5, 0, 7, 0, 1, 9, 2, 0, 4, 6 };
+    test_disk_seed(pool, dir, hits);
+    elevenlabs_cache_disk_t *disk_cache = test_disk_open(pool, dir, 0, TEST_DISK_FILES, "lfu");
+    CHECK(disk_cache != NULL, "disk lfu: index not opened");
+    if (!disk_cache) {
+        return;
+    }
+    elevenlabs_cache_disk_insert(disk_cache, "k11", test_disk_name(pool, TEST_DISK_FILES + 1), 1);
+
+    /* 11 entries down to 9 */
+    CHECK(test_disk_wait(disk_cache, 2), "disk lfu: %lu evictions, want 2",
+          (unsigned long)atomic_load(&disk_cache->evictions));
+    const char *evicted = test_disk_evicted(pool, "disk lfu", disk_cache, dir);
+    CHECK(strcmp(evicted, "k02,k04") == 0, "disk lfu: evicted %s, want k02,k04", evicted);
+    CHECK(disk_cache->entries == 9, "disk lfu: %u files left", disk_cache->entries);
+
+    /* A clean close writes the survivors back; reopening finds the same index */
+    elevenlabs_cache_disk_close(disk_cache);
+    disk_cache = test_disk_open(pool, dir, 0, TEST_DISK_FILES, "lfu");
+    CHECK(disk_cache && disk_cache->entries == 9, "disk lfu: %u files after reopening",
+          disk_cache ? disk_cache->entries : 0);
+    if (disk_cache) {
+        CHECK(elevenlabs_cache_disk_lookup(disk_cache, "k08") && !elevenlabs_cache_disk_lookup(disk_cache, "k02"),
+              "disk lfu: reopened index lost its survivors");
+        elevenlabs_cache_disk_close(disk_cache);
+    }
+    test_disk_clear(pool, dir);
+}
+
+/* A dirty index (the engine died) is reconciled with the directory before anything is
+   evicted: unknown files adopted, vanished ones dropped, .part orphans deleted */
+static void test_disk_recover(apr_pool_t *pool, const char *dir)
+{
+    static const unsigned hits[TEST_DISK_FILES] = { 0 };
+    test_disk_seed(pool, dir, hits);
+    const char *index_path = apr_psprintf(pool, "%s/%s", dir, ELEVENLABS_CACHE_INDEX_FILE);
+    FILE *index = fopen(index_path, "r+");
+    if (index) {
+        fprintf(index, "elevenlabs-cache-index 1 dirty");
+        fclose(index);
+    }
+    unlink(apr_psprintf(pool, "%s/%s", dir, test_disk_name(pool, 3)));
+    FILE *f = fopen(apr_psprintf(pool, "%s/%s", dir, test_disk_name(pool, 0)), "wb");
+    if (f) {
+        fputs("adopted", f);
+        fclose(f);
+    }
+    f = fopen(apr_psprintf(pool, "%s/k99.wav.part", dir), "wb");
+    if (f) {
+        fclose(f);
+    }
+
+    elevenlabs_cache_disk_t *disk_cache = test_disk_open(pool, dir, 0, 0, "lru");
+    CHECK(disk_cache != NULL, "disk recover: index not opened");
+    if (!disk_cache) {
+        return;
+    }
+    CHECK(disk_cache->entries == TEST_DISK_FILES, "disk recover: %u files", disk_cache->entries);
+    CHECK(disk_cache->bytes == (TEST_DISK_FILES - 1) * TEST_DISK_FILE_BYTES + 7,
+          "disk recover: %lu bytes", (unsigned long)disk_cache->bytes);
+    CHECK(elevenlabs_cache_disk_lookup(disk_cache, "k00"), "disk recover: k00 not adopted");
+    CHECK(!elevenlabs_cache_disk_lookup(disk_cache, "k03"), "disk recover: k03 still indexed");
+    CHECK(access(apr_psprintf(pool, "%s/k99.wav.part", dir), F_OK) != 0, "disk recover: .part left behind");
+    elevenlabs_cache_disk_close(disk_cache);
+    test_disk_clear(pool, dir);
+}
+
+/* Keys of one prompt under fixed fields; the digests are SHA1 over the netstrings
+   "2:v2,10:test-voice,17:eleven_flash_v2_5,8:pcm_8000,0:,22:Thank you for calling.,"
+   (and "2:de," for the language) and, for the legacy key, over the fields run together */
+#define TEST_KEY_VOICE "test-voice"
+#define TEST_KEY_MODEL "eleven_flash_v2_5"
+#define TEST_KEY_FORMAT "pcm_8000"
+#define TEST_KEY_TEXT "Thank you for calling."
+#define TEST_KEY_V2 "v2-6bbd84f2c60dceabf3f5993aea0aefcd3213163c"
+#define TEST_KEY_V2_DE "v2-40c0f1a1510618ec566dae7f032b366e5edc28d5"
+#define TEST_KEY_LEGACY "6c29d70c60a92f0f53afe62071b7e46d4fd9d803"
+
+static const char* test_key(apr_pool_t *pool, const char *voice_id, const char *model_id, const char *output_format,
+                            const char *language_code, const char *text)
+{
+    char *key = NULL;
+    if (!elevenlabs_cache_compute_key(pool, voice_id, model_id, output_format, language_code, text, &key)) {
+        return "";
+    }
+    return key;
+}
+
+static void test_cache_keys(apr_pool_t *pool)
+{
+    /* Stable: the same fields give the same key from one release to the next */
+    const char *key = test_key(pool, TEST_KEY_VOICE, TEST_KEY_MODEL, TEST_KEY_FORMAT, NULL, TEST_KEY_TEXT);
+    CHECK(strcmp(key, TEST_KEY_V2) == 0, "keys: v2 key %s, want %s", key, TEST_KEY_V2);
+    CHECK(strlen(key) + 1 <= sizeof(((elevenlabs_cache_blob_t *)0)->key), "keys: %s does not fit a blob", key);
+    key = test_key(pool, TEST_KEY_VOICE, TEST_KEY_MODEL, TEST_KEY_FORMAT, "de", TEST_KEY_TEXT);
+    CHECK(strcmp(key, TEST_KEY_V2_DE) == 0, "keys: v2 key with language %s, want %s", key, TEST_KEY_V2_DE);
+    /* No language and an empty one are the same request */
+    key = test_key(pool, TEST_KEY_VOICE, TEST_KEY_MODEL, TEST_KEY_FORMAT, "", TEST_KEY_TEXT);
+    CHECK(strcmp(key, TEST_KEY_V2) == 0, "keys: empty language keyed apart from none");
+
+    char *legacy = NULL;
+    CHECK(elevenlabs_cache_compute_legacy_key(pool, TEST_KEY_VOICE, TEST_KEY_MODEL, TEST_KEY_FORMAT, TEST_KEY_TEXT,
+                                              &legacy) && strcmp(legacy, TEST_KEY_LEGACY) == 0,
+          "keys: legacy key %s, want %s", legacy ? legacy : "none", TEST_KEY_LEGACY);
+
+    /* No collisions across field boundaries: each pair runs together to the same bytes,
+       which is exactly how the legacy key collided */
+    static const char *shifted[][5] = {
+        { "ab", "c", "pcm_8000", NULL, "Hello." },
+        { "a", "bc", "pcm_8000", NULL, "Hello." },
+        { "v", "m", "pcm_8000", NULL, "Hello." },
+        { "v", "mpcm_8000", "", NULL, "Hello." },
+        { "v", "m", "pcm_800", NULL, "0Hello." },
+        { "v", "m", "pcm_8000", "en", "Hello." },
+        { "v", "m", "pcm_8000", NULL, "enHello." },
+        { "v", "m", "pcm_8000", "e", "nHello." },
+    };
+    unsigned count = sizeof(shifted) / sizeof(shifted[0]);
+    const char *keys[sizeof(shifted) / sizeof(shifted[0])];
+    for (unsigned i = 0; i < count; i++) {
+        keys[i] = test_key(pool, shifted[i][0], shifted[i][1], shifted[i][2], shifted[i][3], shifted[i][4]);
+        for (unsigned j = 0; j < i; j++) {
+            CHECK(strcmp(keys[i], keys[j]) != 0, "keys: fields %u and %u collide on %s", j, i, keys[i]);
+        }
+    }
+    char *legacy_ab = NULL, *legacy_bc = NULL;
+    CHECK(elevenlabs_cache_compute_legacy_key(pool, "ab", "c", "pcm_8000", "Hello.", &legacy_ab) &&
+          elevenlabs_cache_compute_legacy_key(pool, "a", "bc", "pcm_8000", "Hello.", &legacy_bc) &&
+          strcmp(legacy_ab, legacy_bc) == 0, "keys: legacy keys no longer run the fields together");
+
+    /* Text differing only in layout is one prompt; anything else is not */
+    static const char *layouts[] = { "Thank you for calling.", "  Thank you\tfor\n calling. ",
+                                     "Thank  you for calling.\r\n" };
+    for (unsigned i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        key = test_key(pool, TEST_KEY_VOICE, TEST_KEY_MODEL, TEST_KEY_FORMAT, NULL,
+                       elevenlabs_text_normalize(pool, layouts[i]));
+        CHECK(strcmp(key, TEST_KEY_V2) == 0, "keys: layout %u keyed apart", i);
+    }
+    key = test_key(pool, TEST_KEY_VOICE, TEST_KEY_MODEL, TEST_KEY_FORMAT, NULL,
+                   elevenlabs_text_normalize(pool, "Thank you for calling!"));
+    CHECK(strcmp(key, TEST_KEY_V2) != 0, "keys: different text keyed together");
+}
+
+int main(void)
+{
+    apr_pool_t *pool;
+    if (apr_initialize() != APR_SUCCESS || apr_pool_create(&pool, NULL) != APR_SUCCESS) {
+        fprintf(stderr, "cache_test: APR init failed\n");
+        return 1;
+    }
+    char dir[] = "/tmp/elevenlabs_cache_test_XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "cache_test: no temporary directory\n");
+        return 1;
+    }
+
+    test_memory_lru(pool, dir);
+    test_disk_lru(pool, dir);
+    test_disk_lfu(pool, dir);
+    test_disk_recover(pool, dir);
+    test_cache_keys(pool);
+
+    rmdir(dir);
+    apr_pool_destroy(pool);
+    apr_terminate();
+    if (failures) {
+        fprintf(stderr, "cache_test: %d failures\n", failures);
+        return 1;
+    }
+    printf("cache_test: OK\n");
+    return 0;
+}
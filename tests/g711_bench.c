@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file g711_bench.c
+ * @brief Throughput of every G.711 decode kernel, per 20 ms frame and on large blocks.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* Usage: g711_bench [seconds per case, default 0.5] */
+
+#include "g711_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_FRAME 160            /* 20 ms at 8 kHz */
+#define BENCH_BLOCK (64 * 1024)    /* A large curl write */
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Decode size-byte blocks for about seconds; returns input megabytes per second */
+static double bench(g711_decode_fn fn, const uint8_t *in, int16_t *out, size_t size, double seconds,
+                    double *ns_per_call)
+{
+    unsigned long calls = 0;
+    double start = now_sec(), elapsed;
+    do {
+        for (int i = 0; i < 64; i++) {
+            fn(in, size, out);
+        }
+        calls += 64;
+        elapsed = now_sec() - start;
+    } while (elapsed < seconds);
+    *ns_per_call = elapsed * 1e9 / calls;
+    return (double)calls * size / elapsed / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 0.5;
+    uint8_t *in = malloc(BENCH_BLOCK);
+    int16_t *out = malloc(BENCH_BLOCK * sizeof(int16_t));
+    if (!in || !out || seconds <= 0) {
+        return 1;
+    }
+    srand(1);
+    for (size_t i = 0; i < BENCH_BLOCK; i++) {
+        in[i] = (uint8_t)rand();
+    }
+
+    size_t count = 0;
+    const g711_kernel_t *kernels = g711_decode_kernels(&count);
+    printf("%-8s %-5s %14s %12s %14s %12s\n", "kernel", "law", "frame MB/s", "ns/frame", "64K MB/s", "us/64K");
+    for (size_t k = 0; k < count; k++) {
+        for (int law = 0; law < 2; law++) {
+            g711_decode_fn fn = law ? kernels[k].alaw : kernels[k].ulaw;
+            double frame_ns, block_ns;
+            double frame_rate = bench(fn, in, out, BENCH_FRAME, seconds, &frame_ns);
+            double block_rate = bench(fn, in, out, BENCH_BLOCK, seconds, &block_ns);
+            printf("%-8s %-5s %14.1f %12.1f %14.1f %12.2f\n", kernels[k].name, law ? "alaw" : "ulaw",
+                   frame_rate, frame_ns, block_rate, block_ns / 1000);
+        }
+    }
+    free(in);
+    free(out);
+    return 0;
+}
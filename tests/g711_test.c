@@ -0,0 +1,135 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file g711_test.c
+ * @brief Bit-exactness test of every G.711 decode kernel against the ITU-T G.711 formulas.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* The reference here is computed from the G.711 expansion rules, not copied from the
+   tables in g711_decode.c, so a wrong table fails as well as a wrong kernel. */
+
+#include "g711_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_MAX_LEN 200      /* Covers several 16-sample SIMD steps and every tail */
+#define TEST_MAX_SHIFT 15     /* Input and output misalignment, in bytes */
+#define TEST_CANARY 0x5A
+
+static int failures = 0;
+
+#define CHECK(cond, ...) \
+    do { if (!(cond)) { fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); failures++; } } while (0)
+
+static int16_t ref_ulaw(uint8_t code)
+{
+    uint8_t u = (uint8_t)~code;
+    int t = (((u & 0x0F) << 3) + 0x84) << ((u >> 4) & 0x07);
+    t -= 0x84;
+    return (int16_t)((u & 0x80) ? -t : t);
+}
+
+static int16_t ref_alaw(uint8_t code)
+{
+    uint8_t a = code ^ 0x55;
+    int seg = (a >> 4) & 0x07;
+    int t = (a & 0x0F) << 4;
+    if (seg == 0) {
+        t += 8;
+    } else {
+        t = (t + 0x108) << (seg - 1);
+    }
+    return (int16_t)((a & 0x80) ? t : -t);
+}
+
+/* Decode n codes from in + in_shift into a byte buffer at out_shift, then compare
+   each sample and check nothing past the end was written */
+static void check_block(const char *kernel, const char *law, g711_decode_fn fn,
+                        int16_t (*ref)(uint8_t), size_t n, size_t in_shift, size_t out_shift)
+{
+    uint8_t in[TEST_MAX_LEN + TEST_MAX_SHIFT];
+    uint8_t out[(TEST_MAX_LEN + 1) * 2 + TEST_MAX_SHIFT];
+    for (size_t i = 0; i < n; i++) {
+        in[in_shift + i] = (uint8_t)(i * 37 + n + in_shift);
+    }
+    memset(out, TEST_CANARY, sizeof(out));
+
+    fn(in + in_shift, n, (int16_t *)(void *)(out + out_shift));
+
+    for (size_t i = 0; i < n; i++) {
+        int16_t got;
+        uint8_t code = in[in_shift + i];
+        memcpy(&got, out + out_shift + 2 * i, 2);
+        if (got != ref(code)) {
+            CHECK(0, "%s %s: n=%zu in+%zu out+%zu sample %zu code 0x%02x: got %d, want %d",
+                  kernel, law, n, in_shift, out_shift, i, code, got, ref(code));
+            return;
+        }
+    }
+    for (size_t i = out_shift + 2 * n; i < sizeof(out); i++) {
+        if (out[i] != TEST_CANARY) {
+            CHECK(0, "%s %s: n=%zu in+%zu out+%zu wrote past the end", kernel, law, n, in_shift, out_shift);
+            return;
+        }
+    }
+}
+
+static void check_law(const char *kernel, const char *law, g711_decode_fn fn, int16_t (*ref)(uint8_t))
+{
+    /* All 256 codes in one call */
+    uint8_t codes[256];
+    int16_t out[256];
+    for (int i = 0; i < 256; i++) {
+        codes[i] = (uint8_t)i;
+    }
+    fn(codes, 256, out);
+    for (int i = 0; i < 256; i++) {
+        CHECK(out[i] == ref((uint8_t)i), "%s %s: code 0x%02x: got %d, want %d",
+              kernel, law, i, out[i], ref((uint8_t)i));
+    }
+
+    /* Every length up to a few SIMD steps, at every input and output misalignment */
+    for (size_t n = 0; n <= TEST_MAX_LEN; n++) {
+        for (size_t in_shift = 0; in_shift <= TEST_MAX_SHIFT; in_shift++) {
+            for (size_t out_shift = 0; out_shift <= TEST_MAX_SHIFT; out_shift++) {
+                check_block(kernel, law, fn, ref, n, in_shift, out_shift);
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    size_t count = 0;
+    const g711_kernel_t *kernels = g711_decode_kernels(&count);
+
+    for (size_t k = 0; k < count; k++) {
+        check_law(kernels[k].name, "ulaw", kernels[k].ulaw, ref_ulaw);
+        check_law(kernels[k].name, "alaw", kernels[k].alaw, ref_alaw);
+        printf("%s: checked\n", kernels[k].name);
+    }
+
+    /* The public entry points, before and after kernel selection */
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            g711_decode_init();
+        }
+        for (int i = 0; i < 256; i++) {
+            CHECK(ulaw_byte_to_s16((uint8_t)i) == ref_ulaw((uint8_t)i), "ulaw_byte_to_s16(0x%02x)", i);
+            CHECK(alaw_byte_to_s16((uint8_t)i) == ref_alaw((uint8_t)i), "alaw_byte_to_s16(0x%02x)", i);
+        }
+        check_law(g711_decode_kernel_name(), "ulaw_to_s16", ulaw_to_s16, ref_ulaw);
+        check_law(g711_decode_kernel_name(), "alaw_to_s16", alaw_to_s16, ref_alaw);
+    }
+
+    if (failures) {
+        fprintf(stderr, "g711_test: %d failures\n", failures);
+        return 1;
+    }
+    printf("g711_test: OK (%zu kernels, active %s)\n", count, g711_decode_kernel_name());
+    return 0;
+}
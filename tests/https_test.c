@@ -0,0 +1,407 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file https_test.c
+ * @brief Shared HTTP pool against a local HTTPS stand-in: connections reused versus opened.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* The stand-in speaks TLS with a certificate made at start-up, which the lanes are
+   given as their only trusted CA, so peer and host verification stay on as in
+   production. It answers every request with the same audio over keep-alive HTTP/1.1
+   (it offers no ALPN, so libcurl does not get HTTP/2 from it).
+
+   Several lanes speak at once, round after round, on a pool with two worker loops:
+   after the first round every request must go out on a connection a worker already
+   holds, and the pool's reused/new counters must agree with what the server accepted.
+   Then twice as many lanes speak at once, so the workers open more connections while
+   the first ones are still up; those resume a TLS session kept in the share handle
+   instead of a full handshake. libcurl now and then opens one just as the session it
+   would offer is being replaced by a fresher ticket, so not every one has to. */
+
+#include "elevenlabs_synth.h"
+#include "apr_general.h"
+#include "apr_strings.h"
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <openssl/pem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define TEST_NO_CONFIG "/nonexistent/elevenlabs-synth.xml"   /* Defaults only */
+#define TEST_VOICE "test-voice"
+#define TEST_EXIT_LIMIT_MS 1500         /* A request against a local server */
+#define TEST_MAX_CONNS 64
+#define TEST_FRAME 320                  /* 20 ms of L16/8000 */
+#define TEST_AUDIO_BYTES 3200           /* Answer to every request: 200 ms */
+#define TEST_REQUEST_MAX 16384
+#define TEST_WORKERS 2
+#define TEST_LANES 4                    /* Lanes speaking at once */
+#define TEST_BURST_LANES 8              /* Then this many, for new connections */
+#define TEST_ROUNDS 25
+
+#define CHECK(cond) \
+    do { if (!(cond)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); exit(1); } } while (0)
+
+/* Answers every request with TEST_AUDIO_BYTES, one thread per connection */
+typedef struct {
+    int listen_fd;
+    unsigned short port;
+    SSL_CTX *ctx;
+    apr_pool_t *pool;
+    apr_thread_t *conns[TEST_MAX_CONNS];
+    atomic_int accepted;
+    atomic_int resumed;                 /* Handshakes that resumed a TLS session */
+    atomic_int served;
+    atomic_int running;
+    apr_thread_t *thread;
+} tls_server_t;
+
+typedef struct {
+    tls_server_t *server;
+    int fd;
+} tls_conn_t;
+
+static apr_size_t request_content_length(const char *head)
+{
+    for (const char *line = strstr(head, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            return (apr_size_t)strtoul(line + 15, NULL, 10);
+        }
+    }
+    return 0;
+}
+
+static apt_bool_t ssl_write_all(SSL *ssl, const void *data, apr_size_t len)
+{
+    const char *p = data;
+    while (len > 0) {
+        int n = SSL_write(ssl, p, (int)len);
+        if (n <= 0) {
+            return FALSE;
+        }
+        p += n;
+        len -= (apr_size_t)n;
+    }
+    return TRUE;
+}
+
+/* Answer whatever complete requests the connection has buffered */
+static apt_bool_t tls_conn_answer(tls_server_t *server, SSL *ssl, char *buf, apr_size_t *len)
+{
+    static uint8_t audio[TEST_AUDIO_BYTES];
+    for (;;) {
+        buf[*len] = '\0';
+        char *end = strstr(buf, "\r\n\r\n");
+        if (!end) {
+            return *len < TEST_REQUEST_MAX;
+        }
+        *end = '\0';
+        apr_size_t used = (apr_size_t)(end - buf) + 4 + request_content_length(buf);
+        *end = '\r';
+        if (used > TEST_REQUEST_MAX) {
+            return FALSE;
+        }
+        if (*len < used) {
+            return TRUE;
+        }
+        char head[128];
+        int n = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: audio/basic\r\n"
+                         "Content-Length: %u\r\n\r\n", (unsigned)sizeof(audio));
+        if (!ssl_write_all(ssl, head, (apr_size_t)n) || !ssl_write_all(ssl, audio, sizeof(audio))) {
+            return FALSE;
+        }
+        atomic_fetch_add(&server->served, 1);
+        memmove(buf, buf + used, *len - used);
+        *len -= used;
+    }
+}
+
+static void* APR_THREAD_FUNC tls_conn_run(apr_thread_t *thread, void *data)
+{
+    tls_conn_t *conn = data;
+    tls_server_t *server = conn->server;
+    char buf[TEST_REQUEST_MAX + 1];
+    apr_size_t len = 0;
+
+    SSL *ssl = SSL_new(server->ctx);
+    CHECK(ssl);
+    SSL_set_fd(ssl, conn->fd);
+    if (SSL_accept(ssl) == 1) {
+        if (SSL_session_reused(ssl)) {
+            atomic_fetch_add(&server->resumed, 1);
+        }
+        while (atomic_load(&server->running)) {
+            if (!SSL_pending(ssl)) {
+                struct pollfd pfd = { conn->fd, POLLIN, 0 };
+                if (poll(&pfd, 1, 20) <= 0) {
+                    continue;
+                }
+            }
+            int n = SSL_read(ssl, buf + len, (int)(TEST_REQUEST_MAX - len));
+            if (n <= 0) {
+                break;
+            }
+            len += (apr_size_t)n;
+            if (!tls_conn_answer(server, ssl, buf, &len)) {
+                break;
+            }
+        }
+        SSL_shutdown(ssl);
+    }
+    SSL_free(ssl);
+    close(conn->fd);
+    return NULL;
+}
+
+static void* APR_THREAD_FUNC tls_server_run(apr_thread_t *thread, void *data)
+{
+    tls_server_t *server = data;
+    static tls_conn_t conns[TEST_MAX_CONNS];
+    while (atomic_load(&server->running)) {
+        struct pollfd pfd = { server->listen_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 20) <= 0) {
+            continue;
+        }
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        int n = atomic_load(&server->accepted);
+        if (n >= TEST_MAX_CONNS) {
+            close(fd);
+            continue;
+        }
+        conns[n].server = server;
+        conns[n].fd = fd;
+        CHECK(apr_thread_create(&server->conns[n], NULL, tls_conn_run, &conns[n], server->pool) == APR_SUCCESS);
+        atomic_store(&server->accepted, n + 1);
+    }
+    return NULL;
+}
+
+/* Self-signed certificate for 127.0.0.1; returns it as PEM for the lanes to trust */
+static const char* tls_server_certify(tls_server_t *server, apr_pool_t *pool)
+{
+    EVP_PKEY *key = NULL;
+    EVP_PKEY_CTX *key_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+    CHECK(key_ctx && EVP_PKEY_keygen_init(key_ctx) > 0);
+    CHECK(EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_ctx, NID_X9_62_prime256v1) > 0);
+    CHECK(EVP_PKEY_keygen(key_ctx, &key) > 0);
+    EVP_PKEY_CTX_free(key_ctx);
+
+    X509 *cert = X509_new();
+    CHECK(cert);
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"127.0.0.1", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509V3_CTX ext_ctx;
+    X509V3_set_ctx_nodb(&ext_ctx);
+    X509V3_set_ctx(&ext_ctx, cert, cert, NULL, NULL, 0);
+    X509_EXTENSION *ext = X509V3_EXT_conf_nid(NULL, &ext_ctx, NID_subject_alt_name, "IP:127.0.0.1");
+    CHECK(ext && X509_add_ext(cert, ext, -1));
+    X509_EXTENSION_free(ext);
+    CHECK(X509_sign(cert, key, EVP_sha256()) > 0);
+
+    CHECK(SSL_CTX_use_certificate(server->ctx, cert) == 1);
+    CHECK(SSL_CTX_use_PrivateKey(server->ctx, key) == 1);
+
+    BIO *bio = BIO_new(BIO_s_mem());
+    CHECK(bio && PEM_write_bio_X509(bio, cert));
+    char *data;
+    long len = BIO_get_mem_data(bio, &data);
+    const char *pem = apr_pstrmemdup(pool, data, (apr_size_t)len);
+    BIO_free(bio);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return pem;
+}
+
+static const char* tls_server_start(tls_server_t *server, apr_pool_t *pool)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(server->listen_fd >= 0);
+    CHECK(bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    CHECK(listen(server->listen_fd, TEST_MAX_CONNS) == 0);
+    CHECK(getsockname(server->listen_fd, (struct sockaddr *)&addr, &len) == 0);
+    server->port = ntohs(addr.sin_port);
+
+    server->ctx = SSL_CTX_new(TLS_server_method());
+    CHECK(server->ctx);
+    static const unsigned char session_context[] = "https_test";
+    SSL_CTX_set_session_id_context(server->ctx, session_context, sizeof(session_context) - 1);
+    const char *pem = tls_server_certify(server, pool);
+
+    server->pool = pool;
+    atomic_init(&server->accepted, 0);
+    atomic_init(&server->resumed, 0);
+    atomic_init(&server->served, 0);
+    atomic_init(&server->running, 1);
+    CHECK(apr_thread_create(&server->thread, NULL, tls_server_run, server, pool) == APR_SUCCESS);
+    return pem;
+}
+
+static void tls_server_stop(tls_server_t *server)
+{
+    apr_status_t rv;
+    atomic_store(&server->running, 0);
+    apr_thread_join(&rv, server->thread);
+    for (int i = 0; i < atomic_load(&server->accepted); i++) {
+        apr_thread_join(&rv, server->conns[i]);
+    }
+    close(server->listen_fd);
+    SSL_CTX_free(server->ctx);
+}
+
+static long elapsed_ms(apr_time_t since)
+{
+    return (long)apr_time_as_msec(apr_time_now() - since);
+}
+
+static apt_bool_t client_busy(elevenlabs_http_client_t *client)
+{
+    apr_thread_mutex_lock(client->mutex);
+    apt_bool_t busy = client->busy;
+    apr_thread_mutex_unlock(client->mutex);
+    return busy;
+}
+
+/* A lane's client and ring, trusting only the stand-in's certificate */
+static elevenlabs_http_client_t* lane_client_create(elevenlabs_config_t *config, elevenlabs_http_pool_t *http_pool,
+                                                    elevenlabs_slab_t *slab, apr_size_t high_water_bytes,
+                                                    const char *ca_pem)
+{
+    apr_pool_t *lane_pool;
+    CHECK(apr_pool_create_unmanaged_ex(&lane_pool, NULL, NULL) == APR_SUCCESS);
+    audio_buffer_t *ring = audio_buffer_create(lane_pool, slab, high_water_bytes + 2 * CURL_MAX_WRITE_SIZE);
+    elevenlabs_http_client_t *client = elevenlabs_http_client_create(lane_pool);
+    CHECK(ring && client);
+    client->audio_buffer = ring;
+    client->config = config;
+    client->high_water_bytes = high_water_bytes;
+    client->low_water_bytes = high_water_bytes / 2;
+    elevenlabs_http_pool_attach(http_pool, client);
+    struct curl_blob ca = { (void *)ca_pem, strlen(ca_pem), CURL_BLOB_COPY };
+    CHECK(curl_easy_setopt(client->curl, CURLOPT_CAINFO_BLOB, &ca) == CURLE_OK);
+    return client;
+}
+
+/* Every lane speaks once, all at the same time, and is read out as the media thread
+   would; every request must bring back the whole answer */
+static void lanes_speak(elevenlabs_http_client_t **clients, unsigned count)
+{
+    apr_size_t got[TEST_BURST_LANES] = { 0 };
+    uint8_t frame[TEST_FRAME];
+    for (unsigned i = 0; i < count; i++) {
+        CHECK(elevenlabs_http_client_start_synthesis(clients[i], "Please hold.", TEST_VOICE, NULL, NULL));
+    }
+    apr_time_t start = apr_time_now();
+    for (apt_bool_t busy = TRUE; busy; ) {
+        busy = FALSE;
+        for (unsigned i = 0; i < count; i++) {
+            /* Taken before reading, so all audio is in the ring once it turns idle */
+            busy |= client_busy(clients[i]);
+            apr_size_t n;
+            while ((n = audio_buffer_read_frame(clients[i]->audio_buffer, frame, sizeof(frame))) > 0) {
+                got[i] += n;
+            }
+            elevenlabs_http_client_drained(clients[i]);
+        }
+        CHECK(elapsed_ms(start) < TEST_EXIT_LIMIT_MS);
+        apr_sleep(500);
+    }
+    for (unsigned i = 0; i < count; i++) {
+        CHECK(!clients[i]->http_error);
+        CHECK(got[i] == TEST_AUDIO_BYTES);
+    }
+}
+
+int main(void)
+{
+    apr_pool_t *pool;
+    CHECK(apr_initialize() == APR_SUCCESS);
+    CHECK(apr_pool_create(&pool, NULL) == APR_SUCCESS);
+    CHECK(curl_global_init(CURL_GLOBAL_DEFAULT) == CURLE_OK);
+
+    tls_server_t server;
+    const char *ca_pem = tls_server_start(&server, pool);
+
+    elevenlabs_config_t config;
+    CHECK(elevenlabs_config_load(&config, TEST_NO_CONFIG, pool));
+    config.base_url = apr_psprintf(pool, "https://127.0.0.1:%u/v1/text-to-speech", server.port);
+    config.api_key = "test";
+    config.output_format = "pcm_8000";
+    config.cache_enabled = FALSE;
+    config.http_worker_threads = TEST_WORKERS;
+    config.http_warm_connections = 0;
+    config.http_keepalive_interval_ms = 0;
+    config.hedge_budget_percent = 0;
+
+    elevenlabs_http_pool_t *http_pool = elevenlabs_http_pool_create(pool, &config);
+    elevenlabs_slab_t *slab = elevenlabs_slab_create(pool);
+    CHECK(http_pool && slab);
+    /* Same sizing as a channel's ring, see elevenlabs_synth_engine_channel_create() */
+    apr_size_t high_water_bytes = (apr_size_t)config.buffer_high_water_ms * 8000 * ELEVENLABS_BYTES_PER_SAMPLE / 1000;
+
+    elevenlabs_http_client_t *clients[TEST_BURST_LANES];
+    for (unsigned i = 0; i < TEST_BURST_LANES; i++) {
+        clients[i] = lane_client_create(&config, http_pool, slab, high_water_bytes, ca_pem);
+    }
+
+    /* Round after round: connections open in the first, then are only reused */
+    for (unsigned round = 0; round < TEST_ROUNDS; round++) {
+        lanes_speak(clients, TEST_LANES);
+    }
+    int served = atomic_load(&server.served);
+    int accepted = atomic_load(&server.accepted);
+    unsigned long opened = atomic_load(&http_pool->connections_new);
+    unsigned long reused = atomic_load(&http_pool->connections_reused);
+    CHECK(served == TEST_LANES * TEST_ROUNDS);
+    CHECK(opened == (unsigned long)accepted);
+    CHECK(opened + reused == (unsigned long)served);
+    CHECK(accepted <= TEST_LANES);
+    printf("https: %d requests over %d connections (%lu reused, %lu newly opened)\n",
+           served, accepted, reused, opened);
+
+    /* More lanes than connections: the new ones resume TLS from the share */
+    int resumed = atomic_load(&server.resumed);
+    lanes_speak(clients, TEST_BURST_LANES);
+    int reopened = atomic_load(&server.accepted) - accepted;
+    int reresumed = atomic_load(&server.resumed) - resumed;
+    CHECK(atomic_load(&server.served) == served + TEST_BURST_LANES);
+    CHECK(atomic_load(&http_pool->connections_new) - opened == (unsigned long)reopened);
+    CHECK(reopened > 0 && reresumed > 0);
+    printf("https: %d lanes at once, %d new connections, %d of them resumed TLS\n",
+           TEST_BURST_LANES, reopened, reresumed);
+
+    for (unsigned i = 0; i < TEST_BURST_LANES; i++) {
+        elevenlabs_http_client_release(clients[i]);
+    }
+    elevenlabs_http_pool_destroy(http_pool);
+    elevenlabs_slab_destroy(slab);
+    tls_server_stop(&server);
+    curl_global_cleanup();
+    apr_pool_destroy(pool);
+    apr_terminate();
+    printf("https_test: OK\n");
+    return 0;
+}
@@ -0,0 +1,231 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file prebuffer_test.c
+ * @brief Hold maths of the adaptive prebuffer, on a simulated clock.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* A lane's ring is fed a fixed number of bytes per 20 ms frame and the prebuffer is
+   asked, frame by frame, whether the segment may start. Time is whatever the test says
+   it is, so every hold below is worked out by hand from the rates and the text:
+   playback drains 16 bytes per ms (L16/8000), a character of text is taken as 70 ms of
+   speech, and the ring must hold enough that the rest arrives before it runs dry. */
+
+#include "elevenlabs_synth.h"
+#include "apr_general.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_FRAME 320                          /* 20 ms of L16/8000 */
+#define TEST_FRAME_TIME apr_time_from_msec(20)
+#define TEST_RING_BYTES (128 * 1024)
+#define TEST_MAX_FRAMES 500
+
+static int failures = 0;
+
+#define CHECK(cond, ...) \
+    do { if (!(cond)) { fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); failures++; } } while (0)
+
+/* One channel with one lane streaming from the API */
+typedef struct {
+    elevenlabs_synth_engine_t *engine;
+    elevenlabs_synth_channel_t *channel;
+    elevenlabs_synth_lane_t *lane;
+    apr_time_t now;
+    apr_size_t written;
+} prebuffer_sim_t;
+
+static void sim_create(prebuffer_sim_t *sim, apr_pool_t *pool, elevenlabs_slab_t *slab,
+                       const char *const *segments, unsigned max_ms)
+{
+    sim->engine = apr_pcalloc(pool, sizeof(elevenlabs_synth_engine_t));
+    sim->engine->config.prebuffer_max_ms = max_ms;
+    sim->channel = apr_pcalloc(pool, sizeof(elevenlabs_synth_channel_t));
+    sim->channel->elevenlabs_engine = sim->engine;
+    sim->channel->segments = (char **)segments;
+    sim->lane = apr_pcalloc(pool, sizeof(elevenlabs_synth_lane_t));
+    sim->lane->channel = sim->channel;
+    sim->lane->http_client = apr_pcalloc(pool, sizeof(elevenlabs_http_client_t));
+    sim->lane->audio_buffer = audio_buffer_create(pool, slab, TEST_RING_BYTES);
+    atomic_store(&sim->lane->segment, 0);
+    sim->channel->lanes = sim->lane;
+    sim->channel->lane_count = 1;
+    sim->now = apr_time_from_sec(1000);
+    sim->written = 0;
+}
+
+static void sim_destroy(prebuffer_sim_t *sim)
+{
+    audio_buffer_destroy(sim->lane->audio_buffer);
+}
+
+static void sim_arrive(prebuffer_sim_t *sim, apr_size_t bytes)
+{
+    static const uint8_t audio[TEST_RING_BYTES];
+    if (bytes) {
+        CHECK(audio_buffer_write(sim->lane->audio_buffer, audio, bytes), "ring full");
+        sim->written += bytes;
+    }
+}
+
+/* Frames held before segment 0 starts, rate bytes arriving ahead of each; a pause of
+   pause_ms (nothing arriving) comes before frame pause_at. -1 if it never starts. */
+static int sim_hold(prebuffer_sim_t *sim, apr_size_t rate, int pause_at, unsigned pause_ms)
+{
+    for (int frame = 0; frame < TEST_MAX_FRAMES; frame++) {
+        if (frame == pause_at) {
+            sim->now += apr_time_from_msec(pause_ms);
+            elevenlabs_channel_prebuffer_resume(sim->channel, apr_time_from_msec(pause_ms));
+        }
+        sim_arrive(sim, rate);
+        if (elevenlabs_lane_prebuffer(sim->channel, sim->lane, 0, TEST_FRAME, sim->now)) {
+            return frame;
+        }
+        sim->now += TEST_FRAME_TIME;
+    }
+    return -1;
+}
+
+static long held_ms(const prebuffer_sim_t *sim)
+{
+    return (long)apr_time_as_msec(sim->lane->held);
+}
+
+/* Faster than real time: played once the 40 ms measurement shows it */
+static void test_fast(apr_pool_t *pool, elevenlabs_slab_t *slab)
+{
+    static const char *const segments[] = { "Hello there, how are you doing today?" };
+    prebuffer_sim_t sim;
+    sim_create(&sim, pool, slab, segments, 2000);
+    int frame = sim_hold(&sim, 2 * TEST_FRAME, -1, 0);
+    CHECK(frame == 2 && held_ms(&sim) == 40, "fast: started at frame %d after %ld ms, want 2 after 40",
+          frame, held_ms(&sim));
+    sim_destroy(&sim);
+}
+
+/* Half real time, 11 characters: 12320 bytes expected. The R bytes still to come take
+   twice their playing time to arrive, so what is queued must play for as long as R
+   does: half the segment, 6160 bytes, first reached after 39 frames of 160 */
+static void test_slow_text(apr_pool_t *pool, elevenlabs_slab_t *slab)
+{
+    static const char *const segments[] = { "Please hold" };
+    const apr_size_t expected = 11 * ELEVENLABS_PREBUFFER_MS_PER_CHAR * 16;
+    prebuffer_sim_t sim;
+    sim_create(&sim, pool, slab, segments, 2000);
+    int frame = sim_hold(&sim, TEST_FRAME / 2, -1, 0);
+    CHECK(frame == 38 && held_ms(&sim) == 760, "slow: started at frame %d after %ld ms, want 38 after 760",
+          frame, held_ms(&sim));
+    CHECK(atomic_load(&sim.engine->stats_prebuffered) == 1 && atomic_load(&sim.engine->stats_prebuffer_ms) == 760,
+          "slow: %lu holds, %lu ms counted", (unsigned long)atomic_load(&sim.engine->stats_prebuffered),
+          (unsigned long)atomic_load(&sim.engine->stats_prebuffer_ms));
+    CHECK(apr_time_as_msec(sim.channel->prebuffer_held) == 760, "slow: SPEAK held %ld ms",
+          (long)apr_time_as_msec(sim.channel->prebuffer_held));
+
+    /* Played from here in real time while the rest arrives at half that: the ring does
+       not run dry before the last of the segment is in */
+    uint8_t audio[TEST_FRAME];
+    unsigned short_frames = 0;
+    for (;;) {
+        apr_size_t n = audio_buffer_read_frame(sim.lane->audio_buffer, audio, TEST_FRAME);
+        if (sim.written >= expected) {
+            break;
+        }
+        short_frames += n < TEST_FRAME;
+        sim_arrive(&sim, expected - sim.written < TEST_FRAME / 2 ? expected - sim.written : TEST_FRAME / 2);
+        sim.now += TEST_FRAME_TIME;
+        CHECK(elevenlabs_lane_prebuffer(sim.channel, sim.lane, 0, TEST_FRAME, sim.now), "slow: held again once started");
+    }
+    CHECK(short_frames == 0, "slow: %u frames ran dry before the segment had arrived", short_frames);
+    sim_destroy(&sim);
+}
+
+/* No text to go by: 3 s of audio assumed still to come. At 0.8 of real time a quarter
+   of it must be queued, 12000 bytes, 47 frames of 256 */
+static void test_no_text(apr_pool_t *pool, elevenlabs_slab_t *slab)
+{
+    prebuffer_sim_t sim;
+    sim_create(&sim, pool, slab, NULL, 2000);
+    int frame = sim_hold(&sim, TEST_FRAME * 4 / 5, -1, 0);
+    CHECK(frame == 46 && held_ms(&sim) == 920, "no text: started at frame %d after %ld ms, want 46 after 920",
+          frame, held_ms(&sim));
+    sim_destroy(&sim);
+}
+
+/* 40 characters at half real time would need 2.8 s; prebuffer_max_ms cuts it short and
+   is a budget for the whole SPEAK, so the next segment is not held at all */
+static void test_cap(apr_pool_t *pool, elevenlabs_slab_t *slab)
+{
+    static const char *const segments[] = { "Your call is important to us, thank you.", "Next." };
+    prebuffer_sim_t sim;
+    sim_create(&sim, pool, slab, segments, 200);
+    int frame = sim_hold(&sim, TEST_FRAME / 2, -1, 0);
+    CHECK(frame == 10 && held_ms(&sim) == 200, "cap: started at frame %d after %ld ms, want 10 after 200",
+          frame, held_ms(&sim));
+
+    elevenlabs_synth_lane_t *lane = sim.lane;
+    lane->primed = FALSE;
+    lane->arrival_start = 0;
+    lane->held = 0;
+    atomic_store(&lane->segment, 1);
+    audio_buffer_write(lane->audio_buffer, (const uint8_t *)"\0\0", 2);
+    CHECK(elevenlabs_lane_prebuffer(sim.channel, lane, 1, TEST_FRAME, sim.now + TEST_FRAME_TIME),
+          "cap: next segment held after the SPEAK's budget was spent");
+    sim_destroy(&sim);
+}
+
+/* A pause is not arrival time: the same stream paused for a second starts after the
+   same 38 playing frames, not later for a rate diluted by the pause */
+static void test_pause(apr_pool_t *pool, elevenlabs_slab_t *slab)
+{
+    static const char *const segments[] = { "Please hold" };
+    prebuffer_sim_t sim;
+    sim_create(&sim, pool, slab, segments, 2000);
+    int frame = sim_hold(&sim, TEST_FRAME / 2, 10, 1000);
+    CHECK(frame == 38 && held_ms(&sim) == 760, "pause: started at frame %d after %ld ms, want 38 after 760",
+          frame, held_ms(&sim));
+    sim_destroy(&sim);
+}
+
+/* Finished downloads and cache hits play at once, however slowly they came in */
+static void test_finished(apr_pool_t *pool, elevenlabs_slab_t *slab)
+{
+    static const char *const segments[] = { "Your call is important to us, thank you." };
+    prebuffer_sim_t sim;
+    sim_create(&sim, pool, slab, segments, 2000);
+    atomic_store(&sim.lane->http_client->stopped, 1);
+    int frame = sim_hold(&sim, TEST_FRAME / 2, -1, 0);
+    CHECK(frame == 0 && held_ms(&sim) == 0, "finished: started at frame %d after %ld ms", frame, held_ms(&sim));
+    CHECK(atomic_load(&sim.engine->stats_prebuffered) == 0, "finished: counted as held");
+    sim_destroy(&sim);
+}
+
+int main(void)
+{
+    apr_pool_t *pool;
+    if (apr_initialize() != APR_SUCCESS || apr_pool_create(&pool, NULL) != APR_SUCCESS) {
+        fprintf(stderr, "prebuffer_test: APR init failed\n");
+        return 1;
+    }
+    elevenlabs_slab_t *slab = elevenlabs_slab_create(pool);
+
+    test_fast(pool, slab);
+    test_slow_text(pool, slab);
+    test_no_text(pool, slab);
+    test_cap(pool, slab);
+    test_pause(pool, slab);
+    test_finished(pool, slab);
+
+    elevenlabs_slab_destroy(slab);
+    apr_pool_destroy(pool);
+    apr_terminate();
+    if (failures) {
+        fprintf(stderr, "prebuffer_test: %d failures\n", failures);
+        return 1;
+    }
+    printf("prebuffer_test: OK\n");
+    return 0;
+}
@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file segment_test.c
+ * @brief Sentence and clause boundaries of the SPEAK text splitter.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* Each case gives the text, the mode and bounds, and every segment expected back. A
+   segment is a request and a cache entry of its own, so a split in the wrong place
+   costs a prosody break and a key no other prompt shares. */
+
+#include "elevenlabs_synth.h"
+#include "apr_general.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_MAX_SEGMENTS 8
+
+static int failures = 0;
+
+#define CHECK(cond, ...) \
+    do { if (!(cond)) { fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); failures++; } } while (0)
+
+typedef struct {
+    const char *name;
+    const char *mode;
+    unsigned min_chars;
+    unsigned max_chars;
+    const char *text;
+    const char *segments[TEST_MAX_SEGMENTS];    /* NULL-terminated */
+} segment_case_t;
+
+static const segment_case_t cases[] = {
+    { "none", "none", 10, 60,
+      "Hello there. This stays one request. However long it is.",
+      { "Hello there. This stays one request. However long it is.", NULL } },
+    { "sentences", "sentence", 10, 400,
+      "Thank you for calling.  Your call is important to us!\nPlease hold?",
+      { "Thank you for calling.", "Your call is important to us!", "Please hold?", NULL } },
+    { "terminator runs and quotes", "sentence", 10, 400,
+      "He said \"wait here.\" Then he left?! Nobody knew why...",
+      { "He said \"wait here.\"", "Then he left?!", "Nobody knew why...", NULL } },
+    { "abbreviations", "sentence", 10, 400,
+      "Please call Dr. Smith at the office today. Mr. J. Jones joins too, e.g. by phone. Thanks.",
+      { "Please call Dr. Smith at the office today.", "Mr. J. Jones joins too, e.g. by phone. Thanks.", NULL } },
+    { "decimals", "sentence", 10, 400,
+      "The rate is 3.14 percent today. It was 2.5 before. Version 1.2.3 is out.",
+      { "The rate is 3.14 percent today.", "It was 2.5 before.", "Version 1.2.3 is out.", NULL } },
+    { "short pieces run on", "sentence", 20, 400,
+      "Yes. I will hold for the next agent. OK.",
+      { "Yes. I will hold for the next agent. OK.", NULL } },
+    { "clauses", "clause", 5, 400,
+      "First part, second part; third part: the end.",
+      { "First part,", "second part;", "third part:", "the end.", NULL } },
+    { "clause fallback", "sentence", 10, 60,
+      "We are open from nine to five on weekdays, from ten to four on Saturdays, "
+      "and closed on Sundays. Goodbye for now.",
+      { "We are open from nine to five on weekdays,", "from ten to four on Saturdays, and closed on Sundays.",
+        "Goodbye for now.", NULL } },
+    { "max length at a space", "sentence", 10, 30,
+      "one two three four five six seven eight nine ten eleven twelve",
+      { "one two three four five six", "seven eight nine ten eleven", "twelve", NULL } },
+    { "full-width", "sentence", 0, 400,
+      "\xE4\xBB\x8A\xE6\x97\xA5\xE3\x80\x82\xE6\x98\x8E\xE6\x97\xA5\xEF\xBC\x81",   /* 今日。明日！ */
+      { "\xE4\xBB\x8A\xE6\x97\xA5\xE3\x80\x82", "\xE6\x98\x8E\xE6\x97\xA5\xEF\xBC\x81", NULL } },
+};
+
+/* Bounds the splitter must keep whatever the text: no piece over max_chars, none
+   starting inside a UTF-8 sequence, and nothing but whitespace lost between them */
+static void check_invariants(const char *name, const char *text, const elevenlabs_config_t *config,
+                             char **segments, unsigned count)
+{
+    const char *p = text;
+    for (unsigned i = 0; i < count; i++) {
+        size_t len = strlen(segments[i]);
+        CHECK(len > 0, "%s: segment %u empty", name, i);
+        CHECK(!config->segment_max_chars || len <= config->segment_max_chars,
+              "%s: segment %u is %zu bytes, over %u", name, i, len, config->segment_max_chars);
+        CHECK(((unsigned char)segments[i][0] & 0xC0) != 0x80, "%s: segment %u starts mid-character", name, i);
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+        CHECK(strncmp(p, segments[i], len) == 0, "%s: segment %u \"%s\" is not the next text", name, i, segments[i]);
+        p += len;
+    }
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+    CHECK(*p == '\0', "%s: text left over: \"%s\"", name, p);
+}
+
+static void check_case(apr_pool_t *pool, const segment_case_t *c)
+{
+    elevenlabs_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.segment_mode = (char *)c->mode;
+    config.segment_min_chars = c->min_chars;
+    config.segment_max_chars = c->max_chars;
+
+    unsigned count = 0;
+    char **segments = elevenlabs_text_segment(pool, c->text, &config, &count);
+    unsigned want = 0;
+    while (c->segments[want]) want++;
+    CHECK(count == want, "%s: %u segments, want %u", c->name, count, want);
+    for (unsigned i = 0; i < count && i < want; i++) {
+        CHECK(strcmp(segments[i], c->segments[i]) == 0, "%s: segment %u is \"%s\", want \"%s\"",
+              c->name, i, segments[i], c->segments[i]);
+    }
+    if (strcmp(c->mode, "none") != 0) {
+        check_invariants(c->name, c->text, &config, segments, count);
+    }
+}
+
+/* A long run of text with no space or punctuation is still cut at max_chars, between
+   characters rather than inside one */
+static void check_unbroken(apr_pool_t *pool)
+{
+    static const char *syllable = "\xE3\x81\x82";    /* あ, 3 bytes */
+    char text[3 * 100 + 1];
+    for (unsigned i = 0; i < 100; i++) {
+        memcpy(text + 3 * i, syllable, 3);
+    }
+    text[sizeof(text) - 1] = '\0';
+
+    elevenlabs_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.segment_mode = "sentence";
+    config.segment_min_chars = 10;
+    config.segment_max_chars = 64;
+    unsigned count = 0;
+    char **segments = elevenlabs_text_segment(pool, text, &config, &count);
+    CHECK(count == 5, "unbroken: %u segments, want 5", count);
+    check_invariants("unbroken", text, &config, segments, count);
+    for (unsigned i = 0; i < count; i++) {
+        CHECK(strlen(segments[i]) % 3 == 0, "unbroken: segment %u ends mid-character", i);
+    }
+}
+
+int main(void)
+{
+    apr_pool_t *pool;
+    if (apr_initialize() != APR_SUCCESS || apr_pool_create(&pool, NULL) != APR_SUCCESS) {
+        fprintf(stderr, "segment_test: APR init failed\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        check_case(pool, &cases[i]);
+    }
+    check_unbroken(pool);
+
+    apr_pool_destroy(pool);
+    apr_terminate();
+    if (failures) {
+        fprintf(stderr, "segment_test: %d failures\n", failures);
+        return 1;
+    }
+    printf("segment_test: OK (%zu cases)\n", sizeof(cases) / sizeof(cases[0]) + 1);
+    return 0;
+}
@@ -0,0 +1,2108 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file session_test.c
+ * @brief Channel-side HTTP and WebSocket sessions against local stand-in servers.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* The stand-in accepts connections and never answers, as a hung upstream does. STOP,
+   a SPEAK queued behind a running request and channel teardown all run on the consumer
+   task, so each must return at once however long the transfer would hang, and the
+   threads behind them must wind down well before read_timeout_ms.
+
+   A second stand-in answers every request with the same audio, for a long run of
+   SPEAKs on one lane: what a request allocates must go with the next one, so the
+   process does not grow with the number of requests a session makes.
+
+   The same server runs other lanes while one lane's cache file is stuck: its .part is a
+   FIFO nobody reads, so creating it blocks the way a slow or remote cache dir does. That
+   lane's SPEAK and every other lane's must still answer at once.
+
+   Shared downloads are joined and left as channels do: leaving must not wait for the
+   registry, the last subscriber cancels a download that fills no cache file, and the
+   transfer is held at high water ahead of the subscriber furthest along.
+
+   Last, the plugin is loaded as the server loads it, from conf/mrcpengine.xml, and its
+   channels are driven through their vtables: MRCP requests go through the consumer
+   task, responses and events are collected as the server would send them, and frames
+   are read as the media thread reads them. A streamed SPEAK goes through the same
+   channel to a WebSocket stand-in, its text arriving with the SPEAK and later CONTROLs
+   and its audio in fragmented messages, all of which must reach the lane in order. A
+   burst of SPEAKs on many channels is answered faster the more consumer tasks share it,
+   and long prompts split per sentence play sooner and find more of themselves cached.
+   A cache file under a pre-canonical key is played and migrated to its v2 name, unless
+   the G.711 fallback wrote it.
+
+   Given the path of elevenlabs-cache-warmup, the test runs that tool instead, against the
+   audio stand-in with a small manifest: each prompt must land in cache_dir under the key
+   a SPEAK looks up, and the engine must preload the hot ones into its memory tier. */
+
+#include "elevenlabs_synth.h"
+#include "apr_general.h"
+#include "apr_strings.h"
+#include "apr_base64.h"
+#include "apr_sha1.h"
+#include "mrcp_default_factory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define TEST_NO_CONFIG "/nonexistent/elevenlabs-synth.xml"   /* Defaults only */
+#define TEST_VOICE "test-voice"
+#define TEST_READ_TIMEOUT_MS 30000      /* What a hang would cost if a call waited on it */
+#define TEST_CALL_LIMIT_MS 20           /* A consumer-task call, or STOP to its response: under a frame */
+#define TEST_EXIT_LIMIT_MS 1500         /* A thread winding down; libcurl polls once a second */
+#define TEST_SETTLE_MS 100              /* Lets a request reach the point where it blocks */
+#define TEST_MAX_CONNS 64
+#define TEST_FRAME 320                  /* 20 ms of L16/8000 */
+#define TEST_SOAK_AUDIO_BYTES 3200      /* Answer to every request: 200 ms */
+#define TEST_FLIGHT_AUDIO_BYTES (512 * 1024)  /* Shared download: 16 s, well past high water */
+#define TEST_SOAK_WARMUP 100            /* Requests before the baseline is taken */
+#define TEST_SOAK_REQUESTS 2000
+#define TEST_SOAK_RSS_SLACK (4 * 1024 * 1024)
+#define TEST_REQUEST_MAX 16384
+#define TEST_SLOW_LANES 4               /* Other lanes speaking while one cache file is stuck */
+#define TEST_SLOW_IO_THREADS 2
+#define TEST_MAX_MESSAGES 64            /* Responses and events a test channel keeps */
+#define TEST_LOAD_CHANNELS 32            /* Channels sending one SPEAK each at once */
+#define TEST_LOAD_TASKS 4               /* consumer_tasks compared with a single task */
+#define TEST_LOAD_COST_US 5000          /* Blocking work per SPEAK on its consumer task */
+#define TEST_LOAD_RUNS 3
+#define TEST_SEGMENT_DELAY_US 1000      /* Stand-in time to first audio per byte of request text */
+#define TEST_WS_MESSAGE_BYTES 51200     /* Audio per WebSocket message: 3.2 s, sent as 64 KB+ of JSON */
+
+#define CHECK(cond) \
+    do { if (!(cond)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); exit(1); } } while (0)
+
+typedef struct {
+    int listen_fd;
+    unsigned short port;
+    int conns[TEST_MAX_CONNS];
+    atomic_int accepted;
+    atomic_int running;
+    apr_thread_t *thread;
+} hung_server_t;
+
+/* Accepts and holds every connection; never reads or writes */
+static void* APR_THREAD_FUNC hung_server_run(apr_thread_t *thread, void *data)
+{
+    hung_server_t *server = data;
+    while (atomic_load(&server->running)) {
+        struct pollfd pfd = { server->listen_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 20) <= 0) {
+            continue;
+        }
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        int n = atomic_load(&server->accepted);
+        if (n < TEST_MAX_CONNS) {
+            server->conns[n] = fd;
+            atomic_store(&server->accepted, n + 1);
+        } else {
+            close(fd);
+        }
+    }
+    return NULL;
+}
+
+static void hung_server_start(hung_server_t *server, apr_pool_t *pool)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(server->listen_fd >= 0);
+    CHECK(bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    CHECK(listen(server->listen_fd, TEST_MAX_CONNS) == 0);
+    CHECK(getsockname(server->listen_fd, (struct sockaddr *)&addr, &len) == 0);
+    server->port = ntohs(addr.sin_port);
+    atomic_init(&server->accepted, 0);
+    atomic_init(&server->running, 1);
+    CHECK(apr_thread_create(&server->thread, NULL, hung_server_run, server, pool) == APR_SUCCESS);
+}
+
+static void hung_server_stop(hung_server_t *server)
+{
+    apr_status_t rv;
+    atomic_store(&server->running, 0);
+    apr_thread_join(&rv, server->thread);
+    for (int i = 0; i < atomic_load(&server->accepted); i++) {
+        close(server->conns[i]);
+    }
+    close(server->listen_fd);
+}
+
+static apt_bool_t hung_server_wait(hung_server_t *server, int count)
+{
+    apr_time_t deadline = apr_time_now() + apr_time_from_msec(TEST_EXIT_LIMIT_MS);
+    while (atomic_load(&server->accepted) < count) {
+        if (apr_time_now() > deadline) {
+            return FALSE;
+        }
+        apr_sleep(apr_time_from_msec(1));
+    }
+    /* Connected; give the request time to go out and block on the reply */
+    apr_sleep(apr_time_from_msec(TEST_SETTLE_MS));
+    return TRUE;
+}
+
+/* Answers every request with audio_bytes (TEST_SOAK_AUDIO_BYTES), keeping connections alive */
+typedef struct {
+    int listen_fd;
+    unsigned short port;
+    atomic_size_t audio_bytes;
+    atomic_int text_delay_us;           /* Per byte of the request's text, before answering */
+    apr_thread_mutex_t *mutex;          /* Guards path */
+    char path[256];                     /* Of the last request */
+    atomic_int served;
+    atomic_int running;
+    apr_thread_t *thread;
+} audio_server_t;
+
+typedef struct {
+    int fd;
+    apr_size_t len;
+    apr_time_t due;                     /* When the buffered request is answered, 0 = not timed yet */
+    char buf[TEST_REQUEST_MAX + 1];
+} audio_conn_t;
+
+static apt_bool_t send_all(int fd, const void *data, apr_size_t len)
+{
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return FALSE;
+        }
+        p += n;
+        len -= (apr_size_t)n;
+    }
+    return TRUE;
+}
+
+static apr_size_t request_content_length(const char *head)
+{
+    for (const char *line = strstr(head, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            return (apr_size_t)strtoul(line + 15, NULL, 10);
+        }
+    }
+    return 0;
+}
+
+/* Length of the "text" value in a request body, as sent (escapes included) */
+static apr_size_t request_text_length(const char *body)
+{
+    const char *text = strstr(body, "\"text\":\"");
+    if (!text) {
+        return 0;
+    }
+    const char *p = text += 8;
+    while (*p && *p != '"') {
+        p += (*p == '\\' && p[1]) ? 2 : 1;
+    }
+    return (apr_size_t)(p - text);
+}
+
+/* Answer whatever complete requests the connection has buffered, each once its
+   text_delay_us per text byte has passed, as the API's time to first audio grows with
+   the text it is given */
+static apt_bool_t audio_conn_answer(audio_server_t *server, audio_conn_t *conn, const uint8_t *audio)
+{
+    for (;;) {
+        conn->buf[conn->len] = '\0';
+        char *end = strstr(conn->buf, "\r\n\r\n");
+        if (!end) {
+            return conn->len < TEST_REQUEST_MAX;
+        }
+        *end = '\0';
+        apr_size_t used = (apr_size_t)(end - conn->buf) + 4 + request_content_length(conn->buf);
+        *end = '\r';
+        if (used > TEST_REQUEST_MAX) {
+            return FALSE;
+        }
+        if (conn->len < used) {
+            return TRUE;
+        }
+        if (!conn->due) {
+            char next = conn->buf[used];
+            conn->buf[used] = '\0';
+            conn->due = apr_time_now() + (apr_time_t)request_text_length(end + 4) *
+                                         atomic_load(&server->text_delay_us);
+            conn->buf[used] = next;
+        }
+        if (apr_time_now() < conn->due) {
+            return TRUE;
+        }
+        conn->due = 0;
+        char head[128];
+        apr_size_t audio_bytes = atomic_load(&server->audio_bytes);
+        int n = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: audio/basic\r\n"
+                         "Content-Length: %u\r\n\r\n", (unsigned)audio_bytes);
+        if (!send_all(conn->fd, head, (apr_size_t)n) || !send_all(conn->fd, audio, audio_bytes)) {
+            return FALSE;
+        }
+        apr_size_t path_len = strcspn(conn->buf, "\r\n");
+        if (path_len >= sizeof(server->path)) {
+            path_len = sizeof(server->path) - 1;
+        }
+        apr_thread_mutex_lock(server->mutex);
+        memcpy(server->path, conn->buf, path_len);
+        server->path[path_len] = '\0';
+        apr_thread_mutex_unlock(server->mutex);
+        atomic_fetch_add(&server->served, 1);
+        memmove(conn->buf, conn->buf + used, conn->len - used);
+        conn->len -= used;
+    }
+}
+
+static void* APR_THREAD_FUNC audio_server_run(apr_thread_t *thread, void *data)
+{
+    audio_server_t *server = data;
+    static audio_conn_t conns[TEST_MAX_CONNS];
+    static uint8_t audio[TEST_FLIGHT_AUDIO_BYTES];
+    for (apr_size_t i = 0; i < sizeof(audio); i++) {
+        audio[i] = (uint8_t)i;
+    }
+    unsigned count = 0;
+    while (atomic_load(&server->running)) {
+        struct pollfd fds[TEST_MAX_CONNS + 1];
+        fds[0].fd = server->listen_fd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        apt_bool_t timed = FALSE;
+        for (unsigned i = 0; i < count; i++) {
+            fds[i + 1].fd = conns[i].fd;
+            fds[i + 1].events = POLLIN;
+            fds[i + 1].revents = 0;
+            timed = timed || conns[i].due;
+        }
+        if (poll(fds, count + 1, timed ? 1 : 20) < 0) {
+            continue;
+        }
+        for (unsigned i = count; i-- > 0; ) {
+            audio_conn_t *conn = &conns[i];
+            apt_bool_t open = TRUE;
+            if (fds[i + 1].revents) {
+                ssize_t n = recv(conn->fd, conn->buf + conn->len, TEST_REQUEST_MAX - conn->len, 0);
+                open = n > 0 && (conn->len += (apr_size_t)n, audio_conn_answer(server, conn, audio));
+            } else if (conn->due) {
+                open = audio_conn_answer(server, conn, audio);
+            }
+            if (!open) {
+                close(conn->fd);
+                conns[i] = conns[--count];
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(server->listen_fd, NULL, NULL);
+            if (fd >= 0 && count < TEST_MAX_CONNS) {
+                /* Head and body go out in two sends; without this the body waits for
+                   the client's delayed ACK of the head on a reused connection */
+                int nodelay = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+                conns[count].fd = fd;
+                conns[count].len = 0;
+                conns[count].due = 0;
+                count++;
+            } else if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+    for (unsigned i = 0; i < count; i++) {
+        close(conns[i].fd);
+    }
+    return NULL;
+}
+
+static void audio_server_start(audio_server_t *server, apr_pool_t *pool)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(server->listen_fd >= 0);
+    CHECK(bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    CHECK(listen(server->listen_fd, TEST_MAX_CONNS) == 0);
+    CHECK(getsockname(server->listen_fd, (struct sockaddr *)&addr, &len) == 0);
+    server->port = ntohs(addr.sin_port);
+    atomic_init(&server->audio_bytes, TEST_SOAK_AUDIO_BYTES);
+    atomic_init(&server->text_delay_us, 0);
+    CHECK(apr_thread_mutex_create(&server->mutex, APR_THREAD_MUTEX_DEFAULT, pool) == APR_SUCCESS);
+    server->path[0] = '\0';
+    atomic_init(&server->served, 0);
+    atomic_init(&server->running, 1);
+    CHECK(apr_thread_create(&server->thread, NULL, audio_server_run, server, pool) == APR_SUCCESS);
+}
+
+static void audio_server_stop(audio_server_t *server)
+{
+    apr_status_t rv;
+    atomic_store(&server->running, 0);
+    apr_thread_join(&rv, server->thread);
+    close(server->listen_fd);
+}
+
+/* Resident set of the process */
+static apr_size_t rss_bytes(void)
+{
+    long pages = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    CHECK(f);
+    CHECK(fscanf(f, "%*s %ld", &pages) == 1);
+    fclose(f);
+    return (apr_size_t)pages * (apr_size_t)sysconf(_SC_PAGESIZE);
+}
+
+MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool);
+
+static long elapsed_ms(apr_time_t since)
+{
+    return (long)apr_time_as_msec(apr_time_now() - since);
+}
+
+static apt_bool_t client_busy(elevenlabs_http_client_t *client)
+{
+    apr_thread_mutex_lock(client->mutex);
+    apt_bool_t busy = client->busy;
+    apr_thread_mutex_unlock(client->mutex);
+    return busy;
+}
+
+/* A lane's client and ring, owned by a pool of their own as the engine sets them up */
+static elevenlabs_http_client_t* lane_client_create(elevenlabs_config_t *config, elevenlabs_http_pool_t *http_pool,
+                                                    elevenlabs_slab_t *slab, apr_size_t high_water_bytes)
+{
+    apr_pool_t *lane_pool;
+    CHECK(apr_pool_create_unmanaged_ex(&lane_pool, NULL, NULL) == APR_SUCCESS);
+    audio_buffer_t *ring = audio_buffer_create(lane_pool, slab, high_water_bytes + 2 * CURL_MAX_WRITE_SIZE);
+    elevenlabs_http_client_t *client = elevenlabs_http_client_create(lane_pool);
+    CHECK(ring && client);
+    client->audio_buffer = ring;
+    client->config = config;
+    client->high_water_bytes = high_water_bytes;
+    client->low_water_bytes = high_water_bytes / 2;
+    elevenlabs_http_pool_attach(http_pool, client);
+    return client;
+}
+
+/* STOP, a queued SPEAK and release of a lane whose request hangs */
+static void test_http_hung(elevenlabs_config_t *config, elevenlabs_http_pool_t *http_pool,
+                           elevenlabs_slab_t *slab, apr_size_t high_water_bytes, hung_server_t *server)
+{
+    elevenlabs_http_client_t *client = lane_client_create(config, http_pool, slab, high_water_bytes);
+    int conns = atomic_load(&server->accepted);
+
+    CHECK(elevenlabs_http_client_start_synthesis(client, "First prompt", TEST_VOICE, NULL, NULL));
+    CHECK(hung_server_wait(server, conns + 1));
+
+    /* A new SPEAK while the request hangs is queued behind it, not waited for; the worker
+       may take it over before this looks, and sends it once the first has let go */
+    apr_time_t start = apr_time_now();
+    CHECK(elevenlabs_http_client_start_synthesis(client, "Second prompt", TEST_VOICE, NULL, NULL));
+    long queued_ms = elapsed_ms(start);
+    CHECK(queued_ms < TEST_CALL_LIMIT_MS);
+    CHECK(hung_server_wait(server, conns + 2));
+
+    /* STOP drops it too, and the worker lets go of the transfer without waiting it out */
+    start = apr_time_now();
+    elevenlabs_http_client_cancel(client);
+    long cancel_ms = elapsed_ms(start);
+    CHECK(cancel_ms < TEST_CALL_LIMIT_MS);
+    CHECK(atomic_load(&client->start_deferred) == 0);
+    while (client_busy(client) && elapsed_ms(start) < TEST_EXIT_LIMIT_MS) {
+        apr_sleep(apr_time_from_msec(1));
+    }
+    long idle_ms = elapsed_ms(start);
+    CHECK(!client_busy(client));
+
+    /* Channel teardown in the middle of a hung request */
+    conns = atomic_load(&server->accepted);
+    CHECK(elevenlabs_http_client_start_synthesis(client, "Third prompt", TEST_VOICE, NULL, NULL));
+    CHECK(hung_server_wait(server, conns + 1));
+    start = apr_time_now();
+    elevenlabs_http_client_release(client);
+    long release_ms = elapsed_ms(start);
+    CHECK(release_ms < TEST_CALL_LIMIT_MS);
+
+    printf("http: queued start %ld ms, cancel %ld ms (idle after %ld ms), release %ld ms\n",
+           queued_ms, cancel_ms, idle_ms, release_ms);
+}
+
+/* One request on an idle lane, read out as the media thread would; returns the audio */
+static apr_size_t soak_request(elevenlabs_http_client_t *client, const char *text)
+{
+    uint8_t frame[TEST_FRAME];
+    apr_size_t got = 0;
+    apr_time_t start = apr_time_now();
+    CHECK(elevenlabs_http_client_start_synthesis(client, text, TEST_VOICE, NULL, NULL));
+    for (;;) {
+        /* Taken before reading, so all audio is in the ring once it turns idle */
+        apt_bool_t busy = client_busy(client);
+        apr_size_t n;
+        while ((n = audio_buffer_read_frame(client->audio_buffer, frame, sizeof(frame))) > 0) {
+            got += n;
+        }
+        elevenlabs_http_client_drained(client);
+        if (!busy) {
+            break;
+        }
+        CHECK(elapsed_ms(start) < TEST_EXIT_LIMIT_MS);
+        apr_sleep(500);
+    }
+    CHECK(!client->http_error);
+    return got;
+}
+
+/* Many SPEAKs on one lane: the request pool is cleared by each start and the process
+   does not grow */
+static void test_http_soak(elevenlabs_config_t *config, elevenlabs_http_pool_t *http_pool,
+                           elevenlabs_slab_t *slab, apr_size_t high_water_bytes, audio_server_t *server)
+{
+    static const char *text = "Thank you for calling. Please hold while we connect you.";
+    elevenlabs_http_client_t *client = lane_client_create(config, http_pool, slab, high_water_bytes);
+
+    for (unsigned i = 0; i < TEST_SOAK_WARMUP; i++) {
+        CHECK(soak_request(client, text) == TEST_SOAK_AUDIO_BYTES);
+    }
+    /* Same request each time: the cleared pool hands out its first block again, so the
+       URL lands at the same address; a pool that only grew would keep moving it */
+    const char *url = client->url;
+    apr_size_t rss_before = rss_bytes();
+    apr_time_t start = apr_time_now();
+    for (unsigned i = 0; i < TEST_SOAK_REQUESTS; i++) {
+        CHECK(soak_request(client, text) == TEST_SOAK_AUDIO_BYTES);
+        CHECK(client->url == url);
+    }
+    long soak_ms = elapsed_ms(start);
+    apr_size_t rss_after = rss_bytes();
+    CHECK(atomic_load(&server->served) == TEST_SOAK_WARMUP + TEST_SOAK_REQUESTS);
+    CHECK(rss_after < rss_before + TEST_SOAK_RSS_SLACK);
+
+    elevenlabs_http_client_release(client);
+    printf("soak: %u requests in %ld ms, rss %lu -> %lu KB\n", TEST_SOAK_REQUESTS, soak_ms,
+           (unsigned long)(rss_before / 1024), (unsigned long)(rss_after / 1024));
+}
+
+/* A SPEAK queued behind a running one goes out with its own voice, which it hands to
+   the client with the text rather than setting it while the request still runs */
+static void test_http_queued_voice(elevenlabs_config_t *config, elevenlabs_http_pool_t *http_pool,
+                                   elevenlabs_slab_t *slab, apr_size_t high_water_bytes, audio_server_t *server)
+{
+    elevenlabs_http_client_t *client = lane_client_create(config, http_pool, slab, high_water_bytes);
+    int served = atomic_load(&server->served);
+    CHECK(elevenlabs_http_client_start_synthesis(client, "Queued voice", "first-voice", NULL, NULL));
+    CHECK(elevenlabs_http_client_start_synthesis(client, "Queued voice", "second-voice", NULL, NULL));
+    apt_bool_t queued = atomic_load(&client->start_deferred) != 0;
+    apr_time_t start = apr_time_now();
+    while (client_busy(client) || atomic_load(&client->start_deferred)) {
+        CHECK(elapsed_ms(start) < TEST_EXIT_LIMIT_MS);
+        apr_sleep(500);
+    }
+    /* The server notes a request once its answer is sent, which the client may have read
+       in full before that; the first request may or may not have reached it */
+    char path[sizeof(server->path)];
+    for (;;) {
+        apr_thread_mutex_lock(server->mutex);
+        memcpy(path, server->path, sizeof(path));
+        apr_thread_mutex_unlock(server->mutex);
+        if (atomic_load(&server->served) > served && strstr(path, "/second-voice/stream")) {
+            break;
+        }
+        CHECK(elapsed_ms(start) < TEST_EXIT_LIMIT_MS);
+        apr_sleep(500);
+    }
+    elevenlabs_http_client_release(client);
+    printf("queued voice: %s (%s)\n", path, queued ? "queued" : "started at once");
+}
+
+/* A cache file whose creation blocks until released: a FIFO at the .part path opens for
+   writing only once a reader comes. Released by the test, or after TEST_EXIT_LIMIT_MS
+   so that an open on the calling thread fails the check rather than hanging the test. */
+typedef struct {
+    const char *path;
+    atomic_int released;
+    int fd;
+    apr_thread_t *thread;
+} slow_file_t;
+
+static void* APR_THREAD_FUNC slow_file_run(apr_thread_t *thread, void *data)
+{
+    slow_file_t *file = data;
+    apr_time_t deadline = apr_time_now() + apr_time_from_msec(TEST_EXIT_LIMIT_MS);
+    while (!atomic_load(&file->released) && apr_time_now() < deadline) {
+        apr_sleep(apr_time_from_msec(1));
+    }
+    file->fd = open(file->path, O_RDONLY | O_NONBLOCK);
+    return NULL;
+}
+
+static void slow_file_release(slow_file_t *file)
+{
+    apr_status_t rv;
+    atomic_store(&file->released, 1);
+    apr_thread_join(&rv, file->thread);
+}
+
+static void remove_dir(apr_pool_t *pool, const char *path)
+{
+    apr_dir_t *dir;
+    apr_finfo_t finfo;
+    CHECK(apr_dir_open(&dir, path, pool) == APR_SUCCESS);
+    while (apr_dir_read(&finfo, APR_FINFO_NAME, dir) == APR_SUCCESS) {
+        if (strcmp(finfo.name, ".") && strcmp(finfo.name, "..")) {
+            apr_file_remove(apr_pstrcat(pool, path, "/", finfo.name, NULL), pool);
+        }
+    }
+    apr_dir_close(dir);
+    apr_dir_remove(path, pool);
+}
+
+/* One lane's .part file cannot be created; its SPEAK and the other lanes' do not wait */
+static void test_http_slow_cache(apr_pool_t *pool, const elevenlabs_config_t *base_config,
+                                 elevenlabs_http_pool_t *http_pool, elevenlabs_slab_t *slab,
+                                 apr_size_t high_water_bytes)
+{
+    static const char *slow_text = "This prompt is cached on a stuck disk.";
+    char dir_template[] = "/tmp/elevenlabs-session-XXXXXX";
+    CHECK(mkdtemp(dir_template));
+    elevenlabs_config_t *config = apr_pmemdup(pool, base_config, sizeof(*config));
+    config->cache_enabled = TRUE;
+    config->cache_dir = apr_pstrdup(pool, dir_template);
+
+    /* With an index, a miss goes straight to the request and its .part file */
+    elevenlabs_cache_disk_t *disk_cache = elevenlabs_cache_disk_open(pool, config);
+    apr_thread_pool_t *io_pool;
+    CHECK(disk_cache);
+    CHECK(apr_thread_pool_create(&io_pool, TEST_SLOW_IO_THREADS, TEST_SLOW_IO_THREADS, pool) == APR_SUCCESS);
+
+    char *key;
+    CHECK(elevenlabs_cache_request_key(pool, config, TEST_VOICE, slow_text, &key));
+    slow_file_t file;
+    file.path = apr_psprintf(pool, "%s/%s%s.part", config->cache_dir, key,
+                             elevenlabs_cache_file_ext(config->output_format));
+    file.fd = -1;
+    atomic_init(&file.released, 0);
+    CHECK(mkfifo(file.path, 0600) == 0);
+    CHECK(apr_thread_create(&file.thread, NULL, slow_file_run, &file, pool) == APR_SUCCESS);
+
+    elevenlabs_http_client_t *slow = lane_client_create(config, http_pool, slab, high_water_bytes);
+    slow->io_pool = io_pool;
+    slow->disk_cache = disk_cache;
+    apr_time_t start = apr_time_now();
+    CHECK(elevenlabs_http_client_start_synthesis(slow, slow_text, TEST_VOICE, NULL, NULL));
+    long slow_speak_ms = elapsed_ms(start);
+    CHECK(slow_speak_ms < TEST_CALL_LIMIT_MS);
+    /* The request waits for its file, on an I/O worker */
+    apr_sleep(apr_time_from_msec(TEST_SETTLE_MS));
+    CHECK(client_busy(slow) && !slow->cache_fp);
+
+    /* The other lanes miss too, and create their files on the remaining I/O worker */
+    long speak_max_ms = 0;
+    long request_max_ms = 0;
+    for (unsigned i = 0; i < TEST_SLOW_LANES; i++) {
+        elevenlabs_http_client_t *client = lane_client_create(config, http_pool, slab, high_water_bytes);
+        client->io_pool = io_pool;
+        client->disk_cache = disk_cache;
+        const char *text = apr_psprintf(pool, "Prompt number %u of a lane next to the stuck one.", i);
+        uint8_t frame[TEST_FRAME];
+        apr_size_t got = 0;
+        start = apr_time_now();
+        CHECK(elevenlabs_http_client_start_synthesis(client, text, TEST_VOICE, NULL, NULL));
+        long speak_ms = elapsed_ms(start);
+        for (;;) {
+            apt_bool_t busy = client_busy(client);
+            apr_size_t n;
+            while ((n = audio_buffer_read_frame(client->audio_buffer, frame, sizeof(frame))) > 0) {
+                got += n;
+            }
+            elevenlabs_http_client_drained(client);
+            if (!busy) {
+                break;
+            }
+            CHECK(elapsed_ms(start) < TEST_EXIT_LIMIT_MS);
+            apr_sleep(500);
+        }
+        long request_ms = elapsed_ms(start);
+        CHECK(got == TEST_SOAK_AUDIO_BYTES);
+        /* And their audio went into the cache */
+        char *other_key;
+        CHECK(elevenlabs_cache_request_key(pool, config, TEST_VOICE, text, &other_key));
+        CHECK(elevenlabs_cache_disk_lookup(disk_cache, other_key));
+        CHECK(speak_ms < TEST_CALL_LIMIT_MS);
+        speak_max_ms = speak_ms > speak_max_ms ? speak_ms : speak_max_ms;
+        request_max_ms = request_ms > request_max_ms ? request_ms : request_max_ms;
+        elevenlabs_http_client_release(client);
+    }
+
+    /* STOP, then the disk comes back: the request goes without keeping the file */
+    elevenlabs_http_client_cancel(slow);
+    slow_file_release(&file);
+    CHECK(file.fd >= 0);
+    start = apr_time_now();
+    while (client_busy(slow) && elapsed_ms(start) < TEST_EXIT_LIMIT_MS) {
+        apr_sleep(apr_time_from_msec(1));
+    }
+    CHECK(!client_busy(slow));
+    close(file.fd);
+    struct stat st;
+    CHECK(stat(file.path, &st) != 0);
+    elevenlabs_http_client_release(slow);
+
+    apr_thread_pool_destroy(io_pool);
+    elevenlabs_cache_disk_close(disk_cache);
+    remove_dir(pool, config->cache_dir);
+    printf("slow cache: stuck lane SPEAK %ld ms, other lanes SPEAK max %ld ms (request max %ld ms)\n",
+           slow_speak_ms, speak_max_ms, request_max_ms);
+}
+
+/* Channel teardown while the WebSocket upgrade hangs */
+static void test_ws_hung(apr_pool_t *pool, elevenlabs_config_t *config, elevenlabs_http_pool_t *http_pool,
+                         elevenlabs_slab_t *slab, apr_size_t high_water_bytes, hung_server_t *server)
+{
+    audio_buffer_t *ring = audio_buffer_create(pool, slab, high_water_bytes + 2 * CURL_MAX_WRITE_SIZE);
+    CHECK(ring);
+    elevenlabs_ws_session_t *ws = elevenlabs_ws_session_create(config, http_pool, ring, high_water_bytes);
+    CHECK(ws);
+    CHECK(atomic_load(&http_pool->ws_sessions) == 1);
+    int conns = atomic_load(&server->accepted);
+
+    CHECK(elevenlabs_ws_session_begin(ws, pool, TEST_VOICE, "Streamed prompt", TRUE) != 0);
+    CHECK(hung_server_wait(server, conns + 1));
+
+    apr_time_t start = apr_time_now();
+    elevenlabs_ws_session_destroy(ws);
+    long destroy_ms = elapsed_ms(start);
+    CHECK(destroy_ms < TEST_CALL_LIMIT_MS);
+
+    /* The thread leaves the upgrade read and frees the session by itself */
+    while (atomic_load(&http_pool->ws_sessions) && elapsed_ms(start) < TEST_EXIT_LIMIT_MS) {
+        apr_sleep(apr_time_from_msec(1));
+    }
+    long exit_ms = elapsed_ms(start);
+    CHECK(atomic_load(&http_pool->ws_sessions) == 0);
+    /* Nothing refers to the ring any more */
+    audio_buffer_destroy(ring);
+
+    printf("ws: destroy %ld ms (thread gone after %ld ms)\n", destroy_ms, exit_ms);
+}
+
+/* A miss for key as a lane client has it prepared when it asks to share a download */
+static elevenlabs_http_client_t* flight_request_create(apr_pool_t *pool, elevenlabs_config_t *config,
+                                                       const char *key, apr_size_t high_water_bytes)
+{
+    elevenlabs_http_client_t *request = elevenlabs_http_client_create(pool);
+    CHECK(request);
+    request->config = config;
+    request->url = apr_psprintf(pool, "%s/%s/stream?output_format=%s", config->base_url, TEST_VOICE,
+                                config->output_format);
+    request->post_data = "{\"text\":\"Shared prompt\",\"model_id\":\"test\"}";
+    request->api_key_header = "xi-api-key: test";
+    request->cache_key = apr_pstrdup(pool, key);
+    if (config->cache_enabled) {
+        const char *ext = elevenlabs_cache_file_ext(config->output_format);
+        request->cache_path_final = apr_psprintf(pool, "%s/%s%s", config->cache_dir, key, ext);
+        request->cache_path_tmp = apr_psprintf(pool, "%s/%s%s.part", config->cache_dir, key, ext);
+    }
+    request->high_water_bytes = high_water_bytes;
+    request->low_water_bytes = high_water_bytes / 2;
+    return request;
+}
+
+static apt_bool_t flight_registry_idle(elevenlabs_flight_registry_t *registry)
+{
+    apr_thread_mutex_lock(registry->mutex);
+    apt_bool_t idle = registry->idle->nelts == registry->clients->nelts;
+    apr_thread_mutex_unlock(registry->mutex);
+    return idle;
+}
+
+/* Time until every download client of the registry is back on its idle list */
+static long flight_wait_idle(elevenlabs_flight_registry_t *registry)
+{
+    apr_time_t start = apr_time_now();
+    while (!flight_registry_idle(registry)) {
+        CHECK(elapsed_ms(start) < TEST_EXIT_LIMIT_MS);
+        apr_sleep(apr_time_from_msec(1));
+    }
+    return elapsed_ms(start);
+}
+
+typedef struct {
+    elevenlabs_flight_t *flight;
+    atomic_int left;
+} flight_leaver_t;
+
+static void* APR_THREAD_FUNC flight_leave_run(apr_thread_t *thread, void *data)
+{
+    flight_leaver_t *leaver = data;
+    elevenlabs_flight_leave(leaver->flight);
+    atomic_store(&leaver->left, 1);
+    return NULL;
+}
+
+/* Join, leave and the last subscriber's cancel, on a download that hangs. Leaving runs
+   on the media thread, so it must not wait for the registry even while that is held. */
+static void test_flight_subscribers(apr_pool_t *pool, elevenlabs_config_t *config,
+                                    elevenlabs_http_pool_t *http_pool, apr_size_t high_water_bytes,
+                                    hung_server_t *server)
+{
+    elevenlabs_flight_registry_t *registry = elevenlabs_flight_registry_create(pool, http_pool, NULL, NULL, NULL);
+    CHECK(registry);
+    elevenlabs_http_client_t *request = flight_request_create(pool, config, "shared-hung", high_water_bytes);
+    elevenlabs_http_client_t *other = flight_request_create(pool, config, "other-hung", high_water_bytes);
+    int conns = atomic_load(&server->accepted);
+
+    /* The first miss starts the download, an identical one joins it */
+    elevenlabs_flight_t *first = elevenlabs_flight_join(registry, request);
+    CHECK(first && hung_server_wait(server, conns + 1));
+    elevenlabs_flight_t *second = elevenlabs_flight_join(registry, request);
+    CHECK(second == first);
+    CHECK(atomic_load(&first->subscribers) == 2);
+    CHECK(atomic_load(&registry->started) == 1 && atomic_load(&registry->joined) == 1);
+    elevenlabs_flight_t *third = elevenlabs_flight_join(registry, other);
+    CHECK(third && third != first && atomic_load(&registry->started) == 2);
+
+    /* One of two leaving takes no lock and leaves the download running: it is done
+       while the registry is still held, however long its thread took to be scheduled */
+    flight_leaver_t leaver = { second };
+    atomic_init(&leaver.left, 0);
+    apr_thread_t *thread;
+    apr_status_t rv;
+    apr_thread_mutex_lock(registry->mutex);
+    apr_time_t start = apr_time_now();
+    CHECK(apr_thread_create(&thread, NULL, flight_leave_run, &leaver, pool) == APR_SUCCESS);
+    while (!atomic_load(&leaver.left) && elapsed_ms(start) < TEST_EXIT_LIMIT_MS) {
+        apr_sleep(apr_time_from_msec(1));
+    }
+    long leave_ms = elapsed_ms(start);
+    int left_locked = atomic_load(&leaver.left);
+    apr_thread_mutex_unlock(registry->mutex);
+    apr_thread_join(&rv, thread);
+    CHECK(left_locked);
+    CHECK(atomic_load(&first->subscribers) == 1 && !atomic_load(&first->done));
+
+    /* The last one cancels a download that fills no cache file; the worker drops it */
+    start = apr_time_now();
+    elevenlabs_flight_leave(first);
+    long cancel_ms = elapsed_ms(start);
+    CHECK(cancel_ms < TEST_CALL_LIMIT_MS);
+    elevenlabs_flight_leave(third);
+    long idle_ms = flight_wait_idle(registry);
+
+    /* Nothing of the cancelled download is joinable: the next miss starts afresh */
+    conns = atomic_load(&server->accepted);
+    first = elevenlabs_flight_join(registry, request);
+    CHECK(first && atomic_load(&registry->started) == 3 && atomic_load(&registry->joined) == 1);
+    CHECK(hung_server_wait(server, conns + 1));
+    elevenlabs_flight_leave(first);
+    flight_wait_idle(registry);
+
+    elevenlabs_flight_registry_destroy(registry);
+    elevenlabs_http_client_destroy(request);
+    elevenlabs_http_client_destroy(other);
+    printf("flight: leave %ld ms with the registry locked, last leave %ld ms (idle after %ld ms)\n",
+           leave_ms, cancel_ms, idle_ms);
+}
+
+/* Ready bytes once the download has stopped growing: paused, or done */
+static apr_size_t flight_settle(elevenlabs_flight_t *flight)
+{
+    apr_size_t ready = atomic_load(&flight->ready);
+    apr_time_t stable = apr_time_now();
+    apr_time_t start = stable;
+    while (elapsed_ms(stable) < TEST_SETTLE_MS) {
+        CHECK(elapsed_ms(start) < TEST_EXIT_LIMIT_MS);
+        apr_sleep(apr_time_from_msec(1));
+        apr_size_t now = atomic_load(&flight->ready);
+        if (now != ready) {
+            ready = now;
+            stable = apr_time_now();
+        }
+    }
+    return ready;
+}
+
+/* A shared download is paced by its subscriber furthest along, never more than high
+   water (plus the write that crossed it) ahead; once the last subscriber leaves, a
+   cache fill runs to the end unpaced */
+static void test_flight_pacing(apr_pool_t *pool, const elevenlabs_config_t *base_config,
+                               elevenlabs_http_pool_t *http_pool, apr_size_t high_water_bytes,
+                               audio_server_t *server)
+{
+    char dir_template[] = "/tmp/elevenlabs-flight-XXXXXX";
+    CHECK(mkdtemp(dir_template));
+    elevenlabs_config_t *config = apr_pmemdup(pool, base_config, sizeof(*config));
+    config->cache_enabled = TRUE;
+    config->cache_dir = apr_pstrdup(pool, dir_template);
+    atomic_store(&server->audio_bytes, TEST_FLIGHT_AUDIO_BYTES);
+
+    elevenlabs_flight_registry_t *registry = elevenlabs_flight_registry_create(pool, http_pool, NULL, NULL, NULL);
+    CHECK(registry);
+    elevenlabs_http_client_t *request = flight_request_create(pool, config, "shared-paced", high_water_bytes);
+    elevenlabs_flight_t *flight = elevenlabs_flight_join(registry, request);
+    CHECK(flight);
+    elevenlabs_flight_t *late = elevenlabs_flight_join(registry, request);
+    CHECK(late == flight);
+
+    /* Nobody has played yet: the transfer stops at high water */
+    apr_size_t bound = high_water_bytes + CURL_MAX_WRITE_SIZE;
+    apr_size_t ready = flight_settle(flight);
+    CHECK(ready >= high_water_bytes / 2 && ready <= bound);
+    CHECK(atomic_load(&flight->paused) && !atomic_load(&flight->done));
+    apr_size_t paused_at = ready;
+
+    /* Play faster than real time; the slower subscriber stays at 0 and paces nothing */
+    apr_size_t pos = 0;
+    apr_size_t max_ahead = 0;
+    while (pos < TEST_FLIGHT_AUDIO_BYTES / 2) {
+        ready = atomic_load(&flight->ready);
+        if (ready - pos > max_ahead) {
+            max_ahead = ready - pos;
+        }
+        CHECK(ready - pos <= bound);
+        CHECK(!atomic_load(&flight->done));
+        pos += ready - pos < 10 * TEST_FRAME ? ready - pos : 10 * TEST_FRAME;
+        elevenlabs_flight_played(flight, pos);
+        apr_sleep(200);
+    }
+
+    /* With nobody listening, the cache fill is not held at high water */
+    elevenlabs_flight_leave(late);
+    elevenlabs_flight_leave(flight);
+    long fill_ms = flight_wait_idle(registry);
+    const char *path = apr_psprintf(pool, "%s/shared-paced%s", config->cache_dir,
+                                    elevenlabs_cache_file_ext(config->output_format));
+    struct stat st;
+    CHECK(stat(path, &st) == 0);
+    CHECK((apr_size_t)st.st_size >= TEST_FLIGHT_AUDIO_BYTES);
+
+    elevenlabs_flight_registry_destroy(registry);
+    elevenlabs_http_client_destroy(request);
+    atomic_store(&server->audio_bytes, TEST_SOAK_AUDIO_BYTES);
+    remove_dir(pool, dir_template);
+    printf("flight: paused at %zu of %u bytes (high water %zu), at most %zu ahead of playback, "
+           "cache fill %ld ms\n", paused_at, (unsigned)TEST_FLIGHT_AUDIO_BYTES, high_water_bytes,
+           max_ahead, fill_ms);
+}
+
+/* A response or event the plugin sent on a test channel */
+typedef struct {
+    mrcp_message_type_e type;
+    mrcp_method_id method_id;
+    apr_uint32_t request_id;
+    mrcp_request_state_e request_state;
+    mrcp_status_code_e status_code;
+    apr_time_t time;
+} test_message_t;
+
+/* The plugin's engine, loaded from a generated conf/mrcpengine.xml */
+typedef struct {
+    apr_pool_t *pool;
+    mrcp_engine_t *engine;
+    mrcp_resource_factory_t *factory;
+    mrcp_resource_t *resource;
+    atomic_int opened;
+    atomic_int respond_delay_us;         /* Each response holds the consumer task this long */
+} test_engine_t;
+
+/* One channel and what the plugin sent on it */
+typedef struct {
+    test_engine_t *test_engine;
+    apr_pool_t *pool;
+    mrcp_engine_channel_t *channel;
+    apr_thread_mutex_t *mutex;
+    apr_thread_cond_t *cond;
+    apt_bool_t opened;
+    apt_bool_t closed;
+    unsigned count;
+    test_message_t messages[TEST_MAX_MESSAGES];
+} test_channel_t;
+
+static apt_bool_t test_engine_on_open(mrcp_engine_t *engine, apt_bool_t status)
+{
+    test_engine_t *test_engine = engine->event_obj;
+    atomic_store(&test_engine->opened, status ? 1 : -1);
+    return TRUE;
+}
+
+static apt_bool_t test_engine_on_close(mrcp_engine_t *engine)
+{
+    test_engine_t *test_engine = engine->event_obj;
+    atomic_store(&test_engine->opened, 0);
+    return TRUE;
+}
+
+static const mrcp_engine_event_vtable_t test_engine_events = {
+    test_engine_on_open,
+    test_engine_on_close
+};
+
+static apt_bool_t test_channel_on_open(mrcp_engine_channel_t *channel, apt_bool_t status)
+{
+    test_channel_t *test_channel = channel->event_obj;
+    apr_thread_mutex_lock(test_channel->mutex);
+    test_channel->opened = status;
+    apr_thread_cond_broadcast(test_channel->cond);
+    apr_thread_mutex_unlock(test_channel->mutex);
+    return TRUE;
+}
+
+static apt_bool_t test_channel_on_close(mrcp_engine_channel_t *channel)
+{
+    test_channel_t *test_channel = channel->event_obj;
+    apr_thread_mutex_lock(test_channel->mutex);
+    test_channel->closed = TRUE;
+    apr_thread_cond_broadcast(test_channel->cond);
+    apr_thread_mutex_unlock(test_channel->mutex);
+    return TRUE;
+}
+
+/* Consumer task, or the media thread for events */
+static apt_bool_t test_channel_on_message(mrcp_engine_channel_t *channel, mrcp_message_t *message)
+{
+    test_channel_t *test_channel = channel->event_obj;
+    int delay_us = atomic_load(&test_channel->test_engine->respond_delay_us);
+    if (delay_us && message->start_line.message_type == MRCP_MESSAGE_TYPE_RESPONSE) {
+        apr_sleep(delay_us);
+    }
+    apr_time_t now = apr_time_now();
+    apr_thread_mutex_lock(test_channel->mutex);
+    CHECK(test_channel->count < TEST_MAX_MESSAGES);
+    test_message_t *m = &test_channel->messages[test_channel->count++];
+    m->type = message->start_line.message_type;
+    m->method_id = message->start_line.method_id;
+    m->request_id = message->start_line.request_id;
+    m->request_state = message->start_line.request_state;
+    m->status_code = message->start_line.status_code;
+    m->time = now;
+    apr_thread_cond_broadcast(test_channel->cond);
+    apr_thread_mutex_unlock(test_channel->mutex);
+    return TRUE;
+}
+
+static const mrcp_engine_channel_event_vtable_t test_channel_events = {
+    test_channel_on_open,
+    test_channel_on_close,
+    test_channel_on_message
+};
+
+/* Write dir/conf/mrcpengine.xml with the given <param> lines as the plugin's
+   configuration; returns its path */
+static const char* test_config_write(apr_pool_t *pool, const char *dir, const char *params)
+{
+    const char *conf_dir = apr_pstrcat(pool, dir, "/conf", NULL);
+    const char *conf_file = apr_pstrcat(pool, conf_dir, "/mrcpengine.xml", NULL);
+    CHECK(apr_dir_make(conf_dir, APR_FPROT_OS_DEFAULT, pool) == APR_SUCCESS);
+    FILE *f = fopen(conf_file, "w");
+    CHECK(f);
+    fprintf(f, "<unimrcpserver>\n<plugins>\n<plugin id=\"elevenlabs-synth\" name=\"elevenlabs-synth\" enable=\"true\">\n"
+            "%s</plugin>\n</plugins>\n</unimrcpserver>\n", params);
+    fclose(f);
+    return conf_file;
+}
+
+/* Load and open the plugin with the given <param> lines as its configuration */
+static void test_engine_start(test_engine_t *test_engine, apr_pool_t *pool, const char *params)
+{
+    char dir_template[] = "/tmp/elevenlabs-engine-XXXXXX";
+    char cwd[1024];
+    CHECK(mkdtemp(dir_template) && getcwd(cwd, sizeof(cwd)));
+    const char *conf_file = test_config_write(pool, dir_template, params);
+
+    CHECK(apr_pool_create(&test_engine->pool, pool) == APR_SUCCESS);
+    /* The plugin reads its configuration relative to the server's working directory */
+    CHECK(chdir(dir_template) == 0);
+    test_engine->engine = mrcp_plugin_create(test_engine->pool);
+    CHECK(chdir(cwd) == 0);
+    apr_file_remove(conf_file, pool);
+    apr_dir_remove(apr_pstrcat(pool, dir_template, "/conf", NULL), pool);
+    apr_dir_remove(dir_template, pool);
+    CHECK(test_engine->engine);
+
+    atomic_init(&test_engine->opened, 0);
+    atomic_init(&test_engine->respond_delay_us, 0);
+    test_engine->engine->event_vtable = &test_engine_events;
+    test_engine->engine->event_obj = test_engine;
+    CHECK(test_engine->engine->method_vtable->open(test_engine->engine));
+    CHECK(atomic_load(&test_engine->opened) == 1);
+    test_engine->factory = mrcp_default_factory_create(test_engine->pool);
+    test_engine->resource = mrcp_resource_get(test_engine->factory, MRCP_SYNTHESIZER_RESOURCE);
+    CHECK(test_engine->factory && test_engine->resource);
+}
+
+static void test_engine_stop(test_engine_t *test_engine)
+{
+    mrcp_engine_t *engine = test_engine->engine;
+    CHECK(engine->method_vtable->close(engine));
+    CHECK(atomic_load(&test_engine->opened) == 0);
+    engine->method_vtable->destroy(engine);
+    mrcp_resource_factory_destroy(test_engine->factory);
+    apr_pool_destroy(test_engine->pool);
+}
+
+static test_channel_t* test_channel_open(test_engine_t *test_engine)
+{
+    apr_pool_t *pool;
+    CHECK(apr_pool_create(&pool, NULL) == APR_SUCCESS);
+    test_channel_t *test_channel = apr_pcalloc(pool, sizeof(test_channel_t));
+    test_channel->test_engine = test_engine;
+    test_channel->pool = pool;
+    CHECK(apr_thread_mutex_create(&test_channel->mutex, APR_THREAD_MUTEX_DEFAULT, pool) == APR_SUCCESS);
+    CHECK(apr_thread_cond_create(&test_channel->cond, pool) == APR_SUCCESS);
+    mrcp_engine_t *engine = test_engine->engine;
+    test_channel->channel = engine->method_vtable->create_channel(engine, pool);
+    CHECK(test_channel->channel);
+    test_channel->channel->event_vtable = &test_channel_events;
+    test_channel->channel->event_obj = test_channel;
+
+    CHECK(test_channel->channel->method_vtable->open(test_channel->channel));
+    apr_thread_mutex_lock(test_channel->mutex);
+    while (!test_channel->opened) {
+        CHECK(apr_thread_cond_timedwait(test_channel->cond, test_channel->mutex,
+                                        apr_time_from_msec(TEST_EXIT_LIMIT_MS)) == APR_SUCCESS);
+    }
+    apr_thread_mutex_unlock(test_channel->mutex);
+    return test_channel;
+}
+
+static void test_channel_close(test_channel_t *test_channel)
+{
+    mrcp_engine_channel_t *channel = test_channel->channel;
+    CHECK(channel->method_vtable->close(channel));
+    apr_thread_mutex_lock(test_channel->mutex);
+    while (!test_channel->closed) {
+        CHECK(apr_thread_cond_timedwait(test_channel->cond, test_channel->mutex,
+                                        apr_time_from_msec(TEST_EXIT_LIMIT_MS)) == APR_SUCCESS);
+    }
+    apr_thread_mutex_unlock(test_channel->mutex);
+    channel->method_vtable->destroy(channel);
+    apr_pool_destroy(test_channel->pool);
+}
+
+/* A synthesizer request on the channel's pool; text is a plain-text body if not NULL */
+static mrcp_message_t* test_request_create(test_channel_t *test_channel, mrcp_method_id method_id,
+                                           const char *voice, const char *text)
+{
+    mrcp_message_t *request = mrcp_request_create(test_channel->test_engine->resource, MRCP_VERSION_2,
+                                                  method_id, test_channel->pool);
+    CHECK(request);
+    if (text) {
+        mrcp_generic_header_t *generic_header = mrcp_generic_header_prepare(request);
+        apt_string_assign(&generic_header->content_type, "text/plain", request->pool);
+        mrcp_generic_header_property_add(request, GENERIC_HEADER_CONTENT_TYPE);
+        generic_header->content_length = strlen(text);
+        mrcp_generic_header_property_add(request, GENERIC_HEADER_CONTENT_LENGTH);
+        apt_string_assign(&request->body, text, request->pool);
+    }
+    if (voice) {
+        mrcp_synth_header_t *synth_header = mrcp_resource_header_prepare(request);
+        apt_string_assign(&synth_header->voice_param.name, voice, request->pool);
+        mrcp_resource_header_property_add(request, SYNTHESIZER_HEADER_VOICE_NAME);
+    }
+    return request;
+}
+
+/* Hand a request to the channel as the server does; returns when it was handed over */
+static apr_time_t test_request_send(test_channel_t *test_channel, mrcp_message_t *request)
+{
+    apr_time_t sent = apr_time_now();
+    CHECK(test_channel->channel->method_vtable->process_request(test_channel->channel, request));
+    return sent;
+}
+
+/* Time the plugin sent a message of this type, method and state for the request, 0 if
+   it has not (yet). An event matches any request state. Called with the mutex held. */
+static apr_time_t test_channel_find(test_channel_t *test_channel, const mrcp_message_t *request,
+                                    mrcp_message_type_e type, mrcp_method_id method_id,
+                                    mrcp_request_state_e request_state)
+{
+    for (unsigned i = 0; i < test_channel->count; i++) {
+        const test_message_t *m = &test_channel->messages[i];
+        if (m->request_id == request->start_line.request_id && m->type == type &&
+            m->method_id == method_id && (type == MRCP_MESSAGE_TYPE_EVENT || m->request_state == request_state)) {
+            return m->time;
+        }
+    }
+    return 0;
+}
+
+/* The same without waiting */
+static apr_time_t test_channel_seen(test_channel_t *test_channel, const mrcp_message_t *request,
+                                    mrcp_message_type_e type, mrcp_method_id method_id,
+                                    mrcp_request_state_e request_state)
+{
+    apr_thread_mutex_lock(test_channel->mutex);
+    apr_time_t time = test_channel_find(test_channel, request, type, method_id, request_state);
+    apr_thread_mutex_unlock(test_channel->mutex);
+    return time;
+}
+
+/* The same, waiting up to TEST_EXIT_LIMIT_MS for it */
+static apr_time_t test_channel_wait(test_channel_t *test_channel, const mrcp_message_t *request,
+                                    mrcp_message_type_e type, mrcp_method_id method_id,
+                                    mrcp_request_state_e request_state)
+{
+    apr_time_t deadline = apr_time_now() + apr_time_from_msec(TEST_EXIT_LIMIT_MS);
+    apr_thread_mutex_lock(test_channel->mutex);
+    apr_time_t time;
+    while (!(time = test_channel_find(test_channel, request, type, method_id, request_state))) {
+        apr_time_t now = apr_time_now();
+        if (now >= deadline) {
+            break;
+        }
+        apr_thread_cond_timedwait(test_channel->cond, test_channel->mutex, deadline - now);
+    }
+    apr_thread_mutex_unlock(test_channel->mutex);
+    return time;
+}
+
+/* One frame as the media thread reads it; returns whether it carried audio */
+static apt_bool_t test_channel_read_frame(test_channel_t *test_channel, uint8_t *data, apr_size_t size)
+{
+    mpf_audio_stream_t *stream = test_channel->channel->termination->audio_stream;
+    mpf_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.codec_frame.buffer = data;
+    frame.codec_frame.size = size;
+    CHECK(stream->vtable->read_frame(stream, &frame));
+    return (frame.type & MEDIA_FRAME_TYPE_AUDIO) != 0;
+}
+
+/* Read frames as the media thread does, keeping the audio in them, until the lane has
+   at least want bytes or, with want 0, the request got the event */
+static apr_size_t test_channel_collect(test_channel_t *test_channel, uint8_t *audio, apr_size_t size,
+                                       apr_size_t got, apr_size_t want, const mrcp_message_t *request)
+{
+    uint8_t frame[TEST_FRAME];
+    apr_time_t start = apr_time_now();
+    while (want ? got < want : !test_channel_seen(test_channel, request, MRCP_MESSAGE_TYPE_EVENT,
+                                                  SYNTHESIZER_SPEAK_COMPLETE, 0)) {
+        CHECK(elapsed_ms(start) < TEST_EXIT_LIMIT_MS);
+        if (test_channel_read_frame(test_channel, frame, sizeof(frame))) {
+            for (apr_size_t i = 0; i < sizeof(frame); i++) {
+                if (frame[i]) {
+                    CHECK(got < size);
+                    audio[got++] = frame[i];
+                }
+            }
+        }
+        apr_sleep(apr_time_from_msec(1));
+    }
+    return got;
+}
+
+/* STOP through the channel, with its SPEAK hanging on the network: consumer task,
+   halt and STOP response within a frame, SPEAK-COMPLETE behind it, silence after */
+static void test_channel_stop(apr_pool_t *pool, hung_server_t *server)
+{
+    test_engine_t test_engine;
+    test_engine_start(&test_engine, pool, apr_psprintf(pool,
+        "<param name=\"api_key\" value=\"test\"/>\n"
+        "<param name=\"voice_id\" value=\"%s\"/>\n"
+        "<param name=\"base_url\" value=\"http://127.0.0.1:%u/v1/text-to-speech\"/>\n"
+        "<param name=\"output_format\" value=\"pcm_8000\"/>\n"
+        "<param name=\"read_timeout_ms\" value=\"%d\"/>\n"
+        "<param name=\"cache_enabled\" value=\"false\"/>\n"
+        "<param name=\"segment_mode\" value=\"none\"/>\n"
+        "<param name=\"consumer_tasks\" value=\"1\"/>\n"
+        "<param name=\"http_worker_threads\" value=\"1\"/>\n"
+        "<param name=\"http_warm_connections\" value=\"0\"/>\n"
+        "<param name=\"http_keepalive_interval_ms\" value=\"0\"/>\n"
+        "<param name=\"hedge_budget_percent\" value=\"0\"/>\n",
+        TEST_VOICE, server->port, TEST_READ_TIMEOUT_MS));
+    test_channel_t *test_channel = test_channel_open(&test_engine);
+    uint8_t frame[TEST_FRAME];
+    int conns = atomic_load(&server->accepted);
+
+    mrcp_message_t *speak = test_request_create(test_channel, SYNTHESIZER_SPEAK, TEST_VOICE, "Hanging prompt");
+    test_request_send(test_channel, speak);
+    CHECK(test_channel_wait(test_channel, speak, MRCP_MESSAGE_TYPE_RESPONSE, SYNTHESIZER_SPEAK,
+                            MRCP_REQUEST_STATE_INPROGRESS));
+    CHECK(hung_server_wait(server, conns + 1));
+    test_channel_read_frame(test_channel, frame, sizeof(frame));
+
+    mrcp_message_t *stop = test_request_create(test_channel, SYNTHESIZER_STOP, NULL, NULL);
+    apr_time_t sent = test_request_send(test_channel, stop);
+    apr_time_t answered = test_channel_wait(test_channel, stop, MRCP_MESSAGE_TYPE_RESPONSE, SYNTHESIZER_STOP,
+                                            MRCP_REQUEST_STATE_COMPLETE);
+    CHECK(answered);
+    long stop_ms = (long)apr_time_as_msec(answered - sent);
+    CHECK(stop_ms < TEST_CALL_LIMIT_MS);
+    CHECK(test_channel_wait(test_channel, speak, MRCP_MESSAGE_TYPE_EVENT, SYNTHESIZER_SPEAK_COMPLETE, 0));
+    /* The media thread plays nothing more of it */
+    memset(frame, 0xff, sizeof(frame));
+    CHECK(!test_channel_read_frame(test_channel, frame, sizeof(frame)));
+
+    apr_time_t start = apr_time_now();
+    test_channel_close(test_channel);
+    long close_ms = elapsed_ms(start);
+    test_engine_stop(&test_engine);
+    printf("channel: STOP answered in %ld ms (%ld us), close %ld ms\n", stop_ms,
+           (long)(answered - sent), close_ms);
+}
+
+/* Cache files (not .part, not the index) in a cache dir */
+static unsigned cache_files(apr_pool_t *pool, const char *path)
+{
+    apr_dir_t *dir;
+    apr_finfo_t finfo;
+    unsigned count = 0;
+    if (apr_dir_open(&dir, path, pool) != APR_SUCCESS) {
+        return 0;
+    }
+    while (apr_dir_read(&finfo, APR_FINFO_NAME, dir) == APR_SUCCESS) {
+        const char *ext = strrchr(finfo.name, '.');
+        if (ext && strcmp(ext, ".part") && strcmp(finfo.name, ELEVENLABS_CACHE_INDEX_FILE)) {
+            count++;
+        }
+    }
+    apr_dir_close(dir);
+    return count;
+}
+
+/* A SPEAK played out as the media thread reads it; returns ms from SPEAK to its first
+   audio frame */
+static long test_speak_play(test_channel_t *test_channel, const char *text)
+{
+    static uint8_t audio[4 * TEST_SOAK_AUDIO_BYTES];
+    uint8_t frame[TEST_FRAME];
+    mrcp_message_t *speak = test_request_create(test_channel, SYNTHESIZER_SPEAK, TEST_VOICE, text);
+    apr_time_t sent = test_request_send(test_channel, speak);
+    apr_size_t got = 0;
+    /* Until audio arrives the frames are silence; the stand-in's audio is not */
+    while (!got) {
+        CHECK(elapsed_ms(sent) < TEST_EXIT_LIMIT_MS);
+        if (test_channel_read_frame(test_channel, frame, sizeof(frame))) {
+            for (apr_size_t i = 0; i < sizeof(frame); i++) {
+                if (frame[i]) {
+                    audio[got++] = frame[i];
+                }
+            }
+        }
+        if (!got) {
+            apr_sleep(apr_time_from_msec(1));
+        }
+    }
+    long first_ms = elapsed_ms(sent);
+    test_channel_collect(test_channel, audio, sizeof(audio), got, 0, speak);
+    return first_ms;
+}
+
+/* Two long prompts sharing their first and last sentences, each played once, with the
+   whole text as one request and then one request per sentence. The stand-in takes
+   longer to first audio the longer the text, as the API does: split, the first audio
+   waits only on the first sentence, and the second prompt finds the shared sentences
+   in the cache the first one filled. */
+static void test_segment_pipeline(apr_pool_t *pool, audio_server_t *server)
+{
+    static const char *prompts[] = {
+        "Thank you for calling Example Corp. Your call is important to us and will be answered "
+        "in the order it was received. Please stay on the line.",
+        "Thank you for calling Example Corp. Our offices are closed for the holiday and will "
+        "reopen on Monday morning at nine. Please stay on the line."
+    };
+    static const char *modes[] = { "none", "sentence" };
+    long first_ms[2][2];
+    unsigned long segments[2], cached[2];
+
+    atomic_store(&server->text_delay_us, TEST_SEGMENT_DELAY_US);
+    for (unsigned m = 0; m < 2; m++) {
+        char dir_template[] = "/tmp/elevenlabs-segment-XXXXXX";
+        CHECK(mkdtemp(dir_template));
+        test_engine_t test_engine;
+        test_engine_start(&test_engine, pool, apr_psprintf(pool,
+            "<param name=\"api_key\" value=\"test\"/>\n"
+            "<param name=\"voice_id\" value=\"%s\"/>\n"
+            "<param name=\"base_url\" value=\"http://127.0.0.1:%u/v1/text-to-speech\"/>\n"
+            "<param name=\"output_format\" value=\"pcm_8000\"/>\n"
+            "<param name=\"cache_enabled\" value=\"true\"/>\n"
+            "<param name=\"cache_dir\" value=\"%s\"/>\n"
+            "<param name=\"segment_mode\" value=\"%s\"/>\n"
+            "<param name=\"segment_lookahead\" value=\"1\"/>\n"
+            "<param name=\"segment_min_chars\" value=\"10\"/>\n"
+            "<param name=\"consumer_tasks\" value=\"1\"/>\n"
+            "<param name=\"http_worker_threads\" value=\"1\"/>\n"
+            "<param name=\"http_warm_connections\" value=\"0\"/>\n"
+            "<param name=\"http_keepalive_interval_ms\" value=\"0\"/>\n"
+            "<param name=\"hedge_budget_percent\" value=\"0\"/>\n",
+            TEST_VOICE, server->port, dir_template, modes[m]));
+        elevenlabs_synth_engine_t *engine = test_engine.engine->obj;
+        test_channel_t *test_channel = test_channel_open(&test_engine);
+
+        first_ms[m][0] = test_speak_play(test_channel, prompts[0]);
+        /* Files are renamed into place once complete, off the consumer task */
+        unsigned files = m ? 3 : 1;
+        apr_time_t start = apr_time_now();
+        while (cache_files(pool, dir_template) < files) {
+            CHECK(elapsed_ms(start) < TEST_EXIT_LIMIT_MS);
+            apr_sleep(apr_time_from_msec(1));
+        }
+        unsigned long segments_before = atomic_load(&engine->stats_segments);
+        unsigned long cached_before = atomic_load(&engine->stats_segments_cached);
+        first_ms[m][1] = test_speak_play(test_channel, prompts[1]);
+        segments[m] = atomic_load(&engine->stats_segments) - segments_before;
+        cached[m] = atomic_load(&engine->stats_segments_cached) - cached_before;
+
+        test_channel_close(test_channel);
+        test_engine_stop(&test_engine);
+        remove_dir(pool, dir_template);
+    }
+    atomic_store(&server->text_delay_us, 0);
+
+    /* The whole text: one request, one key no other prompt shares */
+    CHECK(segments[0] == 1 && cached[0] == 0);
+    /* Per sentence: the first and last of the second prompt are the first prompt's */
+    CHECK(segments[1] == 3 && cached[1] == 2);
+    /* The first sentence is about a quarter of either prompt */
+    CHECK(first_ms[1][0] * 2 < first_ms[0][0]);
+    CHECK(first_ms[1][1] * 2 < first_ms[0][1]);
+    printf("segments: first audio %ld/%ld ms whole, %ld/%ld ms per sentence; "
+           "second prompt %lu of %lu from cache whole, %lu of %lu per sentence\n",
+           first_ms[0][0], first_ms[0][1], first_ms[1][0], first_ms[1][1],
+           cached[0], segments[0], cached[1], segments[1]);
+}
+
+/* A cache_dir left by a release before canonical keys: a SPEAK of its prompt plays the
+   old file without a request and renames it to its v2 name on the way. Under the G.711
+   fallback the old files hold what the old decoder made of the audio, so the same file
+   is a miss, is fetched again and is left where it was. */
+static void test_cache_legacy(apr_pool_t *pool, audio_server_t *server)
+{
+    static const char *text = "Thank you for calling.";
+    static const char *formats[] = { "pcm_8000", "ulaw_8000" };
+    static uint8_t legacy_audio[44 + TEST_SOAK_AUDIO_BYTES];
+    memset(legacy_audio, 0x55, sizeof(legacy_audio));
+
+    for (unsigned f = 0; f < 2; f++) {
+        apt_bool_t fallback = f == 1;
+        char dir_template[] = "/tmp/elevenlabs-legacy-XXXXXX";
+        CHECK(mkdtemp(dir_template));
+        char *legacy_key = NULL;
+        CHECK(elevenlabs_cache_compute_legacy_key(pool, TEST_VOICE, "test-model", formats[f], text, &legacy_key));
+        const char *ext = elevenlabs_cache_file_ext(formats[f]);
+        const char *legacy_path = apr_psprintf(pool, "%s/%s%s", dir_template, legacy_key, ext);
+        FILE *file = fopen(legacy_path, "wb");
+        CHECK(file && fwrite(legacy_audio, 1, sizeof(legacy_audio), file) == sizeof(legacy_audio));
+        fclose(file);
+
+        test_engine_t test_engine;
+        test_engine_start(&test_engine, pool, apr_psprintf(pool,
+            "<param name=\"api_key\" value=\"test\"/>\n"
+            "<param name=\"voice_id\" value=\"%s\"/>\n"
+            "<param name=\"model_id\" value=\"test-model\"/>\n"
+            "<param name=\"base_url\" value=\"http://127.0.0.1:%u/v1/text-to-speech\"/>\n"
+            "<param name=\"output_format\" value=\"%s\"/>\n"
+            "<param name=\"fallback_ulaw_to_pcm\" value=\"%s\"/>\n"
+            "<param name=\"cache_enabled\" value=\"true\"/>\n"
+            "<param name=\"cache_dir\" value=\"%s\"/>\n"
+            "<param name=\"consumer_tasks\" value=\"1\"/>\n"
+            "<param name=\"http_worker_threads\" value=\"1\"/>\n"
+            "<param name=\"http_warm_connections\" value=\"0\"/>\n"
+            "<param name=\"http_keepalive_interval_ms\" value=\"0\"/>\n"
+            "<param name=\"hedge_budget_percent\" value=\"0\"/>\n",
+            TEST_VOICE, server->port, formats[f], fallback ? "true" : "false", dir_template));
+        elevenlabs_synth_engine_t *engine = test_engine.engine->obj;
+        char *key = NULL;
+        CHECK(elevenlabs_cache_request_key(pool, &engine->config, TEST_VOICE, text, &key));
+        CHECK(strncmp(key, ELEVENLABS_CACHE_KEY_VERSION "-", strlen(ELEVENLABS_CACHE_KEY_VERSION) + 1) == 0);
+        const char *path = apr_psprintf(pool, "%s/%s%s", dir_template, key, ext);
+        /* Adopted by the directory scan, there being no index yet */
+        CHECK(elevenlabs_cache_disk_lookup(engine->disk_cache, legacy_key));
+
+        test_channel_t *test_channel = test_channel_open(&test_engine);
+        int served = atomic_load(&server->served);
+        test_speak_play(test_channel, text);
+        apr_finfo_t finfo;
+        if (!fallback) {
+            /* Renamed before it was mapped, so both are done by the first frame */
+            CHECK(atomic_load(&server->served) == served);
+            CHECK(apr_stat(&finfo, legacy_path, APR_FINFO_SIZE, pool) != APR_SUCCESS);
+            CHECK(apr_stat(&finfo, path, APR_FINFO_SIZE, pool) == APR_SUCCESS && finfo.size == sizeof(legacy_audio));
+            CHECK(elevenlabs_cache_disk_lookup(engine->disk_cache, key));
+            CHECK(!elevenlabs_cache_disk_lookup(engine->disk_cache, legacy_key));
+            /* Found under the new key from now on */
+            test_speak_play(test_channel, text);
+            CHECK(atomic_load(&server->served) == served);
+        } else {
+            CHECK(atomic_load(&server->served) == served + 1);
+            apr_time_t start = apr_time_now();
+            while (cache_files(pool, dir_template) < 2) {
+                CHECK(elapsed_ms(start) < TEST_EXIT_LIMIT_MS);
+                apr_sleep(apr_time_from_msec(1));
+            }
+            CHECK(apr_stat(&finfo, legacy_path, APR_FINFO_SIZE, pool) == APR_SUCCESS && finfo.size == sizeof(legacy_audio));
+            CHECK(apr_stat(&finfo, path, APR_FINFO_SIZE, pool) == APR_SUCCESS);
+        }
+
+        test_channel_close(test_channel);
+        test_engine_stop(&test_engine);
+        remove_dir(pool, dir_template);
+    }
+    printf("legacy cache: pcm_8000 file played and migrated without a request, "
+           "ulaw_8000 fallback file skipped and fetched again\n");
+}
+
+/* A burst of SPEAKs, one per channel, through an engine with this many consumer tasks.
+   Each SPEAK holds its task for TEST_LOAD_COST_US on top of its own work, standing in for
+   the file I/O and thread creation a SPEAK can block on, so the rate shows how many tasks
+   share the burst rather than how many cores this machine has. Returns SPEAKs answered
+   per second; *max_load is the most channels pinned to one task. */
+static double test_speak_burst(apr_pool_t *pool, audio_server_t *server, unsigned tasks, unsigned *max_load)
+{
+    test_engine_t test_engine;
+    test_engine_start(&test_engine, pool, apr_psprintf(pool,
+        "<param name=\"api_key\" value=\"test\"/>\n"
+        "<param name=\"voice_id\" value=\"%s\"/>\n"
+        "<param name=\"base_url\" value=\"http://127.0.0.1:%u/v1/text-to-speech\"/>\n"
+        "<param name=\"output_format\" value=\"pcm_8000\"/>\n"
+        "<param name=\"cache_enabled\" value=\"false\"/>\n"
+        "<param name=\"segment_mode\" value=\"none\"/>\n"
+        "<param name=\"consumer_tasks\" value=\"%u\"/>\n"
+        "<param name=\"http_worker_threads\" value=\"1\"/>\n"
+        "<param name=\"http_warm_connections\" value=\"0\"/>\n"
+        "<param name=\"http_keepalive_interval_ms\" value=\"0\"/>\n"
+        "<param name=\"hedge_budget_percent\" value=\"0\"/>\n",
+        TEST_VOICE, server->port, tasks));
+    elevenlabs_synth_engine_t *engine = test_engine.engine->obj;
+    CHECK(engine->shard_count == tasks);
+    test_channel_t *channels[TEST_LOAD_CHANNELS];
+    mrcp_message_t *speaks[TEST_LOAD_CHANNELS];
+    unsigned load[TEST_LOAD_TASKS] = { 0 };
+    *max_load = 0;
+    for (unsigned i = 0; i < TEST_LOAD_CHANNELS; i++) {
+        channels[i] = test_channel_open(&test_engine);
+        elevenlabs_synth_channel_t *synth_channel = channels[i]->channel->method_obj;
+        unsigned index = synth_channel->shard->index;
+        CHECK(index < tasks && index < TEST_LOAD_TASKS);
+        if (++load[index] > *max_load) {
+            *max_load = load[index];
+        }
+        speaks[i] = test_request_create(channels[i], SYNTHESIZER_SPEAK, TEST_VOICE,
+                                        apr_psprintf(channels[i]->pool, "Load prompt %u", i));
+    }
+
+    atomic_store(&test_engine.respond_delay_us, TEST_LOAD_COST_US);
+    apr_time_t start = apr_time_now();
+    for (unsigned i = 0; i < TEST_LOAD_CHANNELS; i++) {
+        test_request_send(channels[i], speaks[i]);
+    }
+    apr_time_t last = start;
+    for (unsigned i = 0; i < TEST_LOAD_CHANNELS; i++) {
+        apr_time_t answered = test_channel_wait(channels[i], speaks[i], MRCP_MESSAGE_TYPE_RESPONSE,
+                                                SYNTHESIZER_SPEAK, MRCP_REQUEST_STATE_INPROGRESS);
+        CHECK(answered);
+        if (answered > last) {
+            last = answered;
+        }
+    }
+    atomic_store(&test_engine.respond_delay_us, 0);
+
+    for (unsigned i = 0; i < TEST_LOAD_CHANNELS; i++) {
+        mrcp_message_t *stop = test_request_create(channels[i], SYNTHESIZER_STOP, NULL, NULL);
+        test_request_send(channels[i], stop);
+        CHECK(test_channel_wait(channels[i], stop, MRCP_MESSAGE_TYPE_RESPONSE, SYNTHESIZER_STOP,
+                                MRCP_REQUEST_STATE_COMPLETE));
+        test_channel_close(channels[i]);
+    }
+    test_engine_stop(&test_engine);
+    return TEST_LOAD_CHANNELS * (double)APR_USEC_PER_SEC / (double)(last - start > 0 ? last - start : 1);
+}
+
+/* SPEAK acceptance with one consumer task and with several: the burst must be answered
+   about as many times faster as the busiest task has fewer channels than all of them.
+   Each is the best of TEST_LOAD_RUNS, so one run losing the CPU does not decide it. */
+static void test_consumer_tasks(apr_pool_t *pool, audio_server_t *server)
+{
+    unsigned load = 0, sharded_load = TEST_LOAD_CHANNELS;
+    double single = 0, sharded = 0;
+    for (unsigned run = 0; run < TEST_LOAD_RUNS; run++) {
+        double rate = test_speak_burst(pool, server, 1, &load);
+        CHECK(load == TEST_LOAD_CHANNELS);
+        if (rate > single) {
+            single = rate;
+        }
+    }
+    for (unsigned run = 0; run < TEST_LOAD_RUNS; run++) {
+        /* Channels land on tasks by address, so compare each run with its own spread */
+        double rate = test_speak_burst(pool, server, TEST_LOAD_TASKS, &load);
+        CHECK(load < TEST_LOAD_CHANNELS);
+        if (rate * load > sharded * sharded_load) {
+            sharded = rate;
+            sharded_load = load;
+        }
+    }
+    double expected = (double)TEST_LOAD_CHANNELS / sharded_load;
+    CHECK(sharded >= single * expected * 0.6);
+    printf("consumer tasks: %u SPEAKs at once, %.0f/s on 1 task, %.0f/s on %u (busiest %u channels, "
+           "%.1fx of %.1fx)\n", (unsigned)TEST_LOAD_CHANNELS, single, sharded, (unsigned)TEST_LOAD_TASKS,
+           sharded_load, sharded / single, expected);
+}
+
+/* Speaks the API's multi-context WebSocket on one connection: checks the upgrade, logs
+   the text messages it gets, and answers a context's first text and its flush with
+   half of its audio each, then its close with isFinal. An audio message goes out in
+   three fragments whose lengths take a 7-, a 16- and a 64-bit length field, with a ping
+   between the first two, and the first fragment's header split across two writes. */
+typedef struct {
+    int listen_fd;
+    unsigned short port;
+    apr_thread_mutex_t *mutex;
+    char path[256];                     /* Request line of the upgrade */
+    char received[TEST_REQUEST_MAX];    /* Text messages, one per line */
+    apt_bool_t keyed;                   /* The upgrade carried the API key */
+    atomic_int upgraded;
+    atomic_int audio_sent;              /* Audio messages */
+    atomic_int pongs;                   /* Answers to our pings, payload included */
+    atomic_int closed;                  /* Close frame seen */
+    atomic_int running;
+    apr_thread_t *thread;
+} ws_server_t;
+
+/* Byte i of an utterance's audio: never 0, so silence the channel fills in around it
+   cannot pass for audio */
+static uint8_t ws_audio_byte(apr_size_t i)
+{
+    return (uint8_t)(1 + i % 251);
+}
+
+static apt_bool_t ws_server_send_frame(int fd, int opcode, apt_bool_t fin, const void *payload, apr_size_t len,
+                                       apt_bool_t split_head)
+{
+    uint8_t head[10];
+    apr_size_t n = 0;
+    head[n++] = (uint8_t)((fin ? 0x80 : 0) | opcode);
+    if (len < 126) {
+        head[n++] = (uint8_t)len;
+    } else if (len <= 0xFFFF) {
+        head[n++] = 126;
+        head[n++] = (uint8_t)(len >> 8);
+        head[n++] = (uint8_t)len;
+    } else {
+        head[n++] = 127;
+        for (int i = 7; i >= 0; i--) {
+            head[n++] = (uint8_t)((uint64_t)len >> (8 * i));
+        }
+    }
+    if (split_head) {
+        if (!send_all(fd, head, 1)) {
+            return FALSE;
+        }
+        apr_sleep(apr_time_from_msec(5));
+        return send_all(fd, head + 1, n - 1) && send_all(fd, payload, len);
+    }
+    return send_all(fd, head, n) && send_all(fd, payload, len);
+}
+
+/* Audio bytes [offset, offset + TEST_WS_MESSAGE_BYTES) of a context, as one message */
+static apt_bool_t ws_server_send_audio(ws_server_t *server, int fd, unsigned context, apr_size_t offset)
+{
+    static const char ping[] = "ping";
+    uint8_t audio[TEST_WS_MESSAGE_BYTES];
+    for (apr_size_t i = 0; i < sizeof(audio); i++) {
+        audio[i] = ws_audio_byte(offset + i);
+    }
+    apr_size_t cap = (apr_size_t)apr_base64_encode_len(sizeof(audio)) + 64;
+    char *json = malloc(cap);
+    CHECK(json);
+    int n = snprintf(json, cap, "{\"audio\":\"");
+    n += apr_base64_encode_binary(json + n, audio, sizeof(audio)) - 1;
+    n += snprintf(json + n, cap - (apr_size_t)n, "\",\"contextId\":\"c%u\"}", context);
+    apr_size_t len = (apr_size_t)n;
+    CHECK(len > 1100 + 0xFFFF);
+    apt_bool_t sent = ws_server_send_frame(fd, 0x1, FALSE, json, 100, TRUE) &&
+                      ws_server_send_frame(fd, 0x9, TRUE, ping, sizeof(ping) - 1, FALSE) &&
+                      ws_server_send_frame(fd, 0x0, FALSE, json + 100, 1000, FALSE) &&
+                      ws_server_send_frame(fd, 0x0, TRUE, json + 1100, len - 1100, FALSE);
+    free(json);
+    atomic_fetch_add(&server->audio_sent, 1);
+    return sent;
+}
+
+/* Context number of a client message, 0 if it names none */
+static unsigned ws_server_context(const char *json)
+{
+    const char *p = strstr(json, "\"context_id\":\"c");
+    return p ? (unsigned)strtoul(p + 15, NULL, 10) : 0;
+}
+
+/* Answer the upgrade request at the start of buf; returns its length, 0 if incomplete */
+static apr_size_t ws_server_upgrade(ws_server_t *server, int fd, char *buf, apr_size_t len)
+{
+    buf[len] = '\0';
+    char *end = strstr(buf, "\r\n\r\n");
+    if (!end) {
+        return 0;
+    }
+    *end = '\0';
+    const char *key = strstr(buf, "\r\nSec-WebSocket-Key: ");
+    CHECK(key && strncmp(buf, "GET ", 4) == 0);
+    key += 21;
+    apr_size_t key_len = strcspn(key, "\r\n");
+
+    apr_sha1_ctx_t sha;
+    unsigned char digest[APR_SHA1_DIGESTSIZE];
+    char accept[32];
+    apr_sha1_init(&sha);
+    apr_sha1_update(&sha, key, (unsigned int)key_len);
+    apr_sha1_update(&sha, "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", 36);
+    apr_sha1_final(digest, &sha);
+    apr_base64_encode_binary(accept, digest, APR_SHA1_DIGESTSIZE);
+    char head[256];
+    int n = snprintf(head, sizeof(head), "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                     "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept);
+
+    apr_thread_mutex_lock(server->mutex);
+    apr_size_t path_len = strcspn(buf, "\r\n");
+    if (path_len >= sizeof(server->path)) {
+        path_len = sizeof(server->path) - 1;
+    }
+    memcpy(server->path, buf, path_len);
+    server->path[path_len] = '\0';
+    const char *api_key = strstr(buf, "\r\n" ELEVENLABS_API_KEY_HEADER ": ");
+    if (api_key) {
+        api_key += strlen(ELEVENLABS_API_KEY_HEADER) + 4;
+        apr_size_t api_key_len = strcspn(api_key, "\r\n");
+        server->keyed = api_key_len == 4 && strncmp(api_key, "test", 4) == 0;
+    }
+    apr_thread_mutex_unlock(server->mutex);
+    CHECK(send_all(fd, head, (apr_size_t)n));
+    atomic_store(&server->upgraded, 1);
+    return (apr_size_t)(end - buf) + 4;
+}
+
+/* Handle one client frame at the start of buf; returns its length, 0 if incomplete */
+static apr_size_t ws_server_receive(ws_server_t *server, int fd, uint8_t *buf, apr_size_t len, unsigned *answered)
+{
+    if (len < 2) {
+        return 0;
+    }
+    int opcode = buf[0] & 0x0F;
+    CHECK(buf[0] & 0x80);               /* Client messages are not fragmented */
+    CHECK(buf[1] & 0x80);               /* and always masked */
+    apr_size_t payload_len = buf[1] & 0x7F;
+    apr_size_t head = 2;
+    if (payload_len == 126) {
+        if (len < 4) {
+            return 0;
+        }
+        payload_len = ((apr_size_t)buf[2] << 8) | buf[3];
+        head = 4;
+    }
+    CHECK(payload_len != 127);
+    if (len < head + 4 + payload_len) {
+        return 0;
+    }
+    char *payload = (char *)buf + head + 4;
+    for (apr_size_t i = 0; i < payload_len; i++) {
+        payload[i] ^= buf[head + (i & 3)];
+    }
+
+    if (opcode == 0x1) {
+        char json[TEST_REQUEST_MAX];
+        CHECK(payload_len < sizeof(json));
+        memcpy(json, payload, payload_len);
+        json[payload_len] = '\0';
+        apr_thread_mutex_lock(server->mutex);
+        apr_size_t used = strlen(server->received);
+        CHECK(used + payload_len + 2 < sizeof(server->received));
+        memcpy(server->received + used, json, payload_len);
+        strcpy(server->received + used + payload_len, "\n");
+        apr_thread_mutex_unlock(server->mutex);
+
+        unsigned context = ws_server_context(json);
+        if (strstr(json, "\"text\"") && context != *answered) {
+            /* Enough text to start on */
+            *answered = context;
+            ws_server_send_audio(server, fd, context, 0);
+        } else if (strstr(json, "\"flush\":true")) {
+            ws_server_send_audio(server, fd, context, TEST_WS_MESSAGE_BYTES);
+        } else if (strstr(json, "\"close_context\":true")) {
+            char final[64];
+            int n = snprintf(final, sizeof(final), "{\"isFinal\":true,\"contextId\":\"c%u\"}", context);
+            ws_server_send_frame(fd, 0x1, TRUE, final, (apr_size_t)n, FALSE);
+        }
+    } else if (opcode == 0xA) {
+        if (payload_len == 4 && memcmp(payload, "ping", 4) == 0) {
+            atomic_fetch_add(&server->pongs, 1);
+        }
+    } else if (opcode == 0x8) {
+        atomic_store(&server->closed, 1);
+    }
+    return head + 4 + payload_len;
+}
+
+static void* APR_THREAD_FUNC ws_server_run(apr_thread_t *thread, void *data)
+{
+    ws_server_t *server = data;
+    static uint8_t buf[TEST_REQUEST_MAX + 1];
+    apr_size_t len = 0;
+    unsigned answered = 0;
+    int fd = -1;
+    while (fd < 0 && atomic_load(&server->running)) {
+        struct pollfd pfd = { server->listen_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 20) > 0) {
+            fd = accept(server->listen_fd, NULL, NULL);
+        }
+    }
+    while (fd >= 0 && atomic_load(&server->running)) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 20) <= 0) {
+            continue;
+        }
+        ssize_t n = recv(fd, buf + len, TEST_REQUEST_MAX - len, 0);
+        if (n <= 0) {
+            break;
+        }
+        len += (apr_size_t)n;
+        for (;;) {
+            apr_size_t used = atomic_load(&server->upgraded) ?
+                ws_server_receive(server, fd, buf, len, &answered) :
+                ws_server_upgrade(server, fd, (char *)buf, len);
+            if (!used) {
+                break;
+            }
+            memmove(buf, buf + used, len - used);
+            len -= used;
+        }
+        CHECK(len < TEST_REQUEST_MAX);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return NULL;
+}
+
+static void ws_server_start(ws_server_t *server, apr_pool_t *pool)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(server, 0, sizeof(*server));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(server->listen_fd >= 0);
+    CHECK(bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    CHECK(listen(server->listen_fd, TEST_MAX_CONNS) == 0);
+    CHECK(getsockname(server->listen_fd, (struct sockaddr *)&addr, &len) == 0);
+    server->port = ntohs(addr.sin_port);
+    CHECK(apr_thread_mutex_create(&server->mutex, APR_THREAD_MUTEX_DEFAULT, pool) == APR_SUCCESS);
+    atomic_init(&server->upgraded, 0);
+    atomic_init(&server->audio_sent, 0);
+    atomic_init(&server->pongs, 0);
+    atomic_init(&server->closed, 0);
+    atomic_init(&server->running, 1);
+    CHECK(apr_thread_create(&server->thread, NULL, ws_server_run, server, pool) == APR_SUCCESS);
+}
+
+static void ws_server_stop(ws_server_t *server)
+{
+    apr_status_t rv;
+    atomic_store(&server->running, 0);
+    apr_thread_join(&rv, server->thread);
+    close(server->listen_fd);
+    apr_thread_mutex_destroy(server->mutex);
+}
+
+/* Mark a request with a Vendor-Specific-Parameters flag set to true */
+static void test_request_flag(mrcp_message_t *request, const char *name)
+{
+    mrcp_generic_header_t *generic_header = mrcp_generic_header_prepare(request);
+    if (!generic_header->vendor_specific_params) {
+        generic_header->vendor_specific_params = apt_pair_array_create(1, request->pool);
+    }
+    apt_str_t pair_name;
+    apt_str_t pair_value;
+    apt_string_assign(&pair_name, name, request->pool);
+    apt_string_assign(&pair_value, "true", request->pool);
+    apt_pair_array_append(generic_header->vendor_specific_params, &pair_name, &pair_value, request->pool);
+    mrcp_generic_header_property_add(request, GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS);
+}
+
+/* A streamed SPEAK through the channel against the WebSocket stand-in: the upgrade, the
+   text of the SPEAK and of each CONTROL in order, audio before the text is over, and
+   every byte of the fragmented audio messages in the lane, in order */
+static void test_channel_ws(apr_pool_t *pool)
+{
+    static uint8_t audio[2 * TEST_WS_MESSAGE_BYTES];
+    ws_server_t server;
+    ws_server_start(&server, pool);
+    test_engine_t test_engine;
+    test_engine_start(&test_engine, pool, apr_psprintf(pool,
+        "<param name=\"api_key\" value=\"test\"/>\n"
+        "<param name=\"voice_id\" value=\"%s\"/>\n"
+        "<param name=\"ws_base_url\" value=\"ws://127.0.0.1:%u/v1/text-to-speech\"/>\n"
+        "<param name=\"output_format\" value=\"pcm_8000\"/>\n"
+        "<param name=\"cache_enabled\" value=\"false\"/>\n"
+        "<param name=\"segment_mode\" value=\"none\"/>\n"
+        "<param name=\"consumer_tasks\" value=\"1\"/>\n"
+        "<param name=\"http_worker_threads\" value=\"1\"/>\n"
+        "<param name=\"http_warm_connections\" value=\"0\"/>\n"
+        "<param name=\"http_keepalive_interval_ms\" value=\"0\"/>\n"
+        "<param name=\"hedge_budget_percent\" value=\"0\"/>\n",
+        TEST_VOICE, server.port));
+    test_channel_t *test_channel = test_channel_open(&test_engine);
+
+    mrcp_message_t *speak = test_request_create(test_channel, SYNTHESIZER_SPEAK, TEST_VOICE, "Hello there, ");
+    test_request_flag(speak, ELEVENLABS_VSP_STREAM_INPUT);
+    test_request_send(test_channel, speak);
+    CHECK(test_channel_wait(test_channel, speak, MRCP_MESSAGE_TYPE_RESPONSE, SYNTHESIZER_SPEAK,
+                            MRCP_REQUEST_STATE_INPROGRESS));
+    /* Audio plays while more text is still to come */
+    apr_size_t got = test_channel_collect(test_channel, audio, sizeof(audio), 0, TEST_FRAME, speak);
+    CHECK(!test_channel_seen(test_channel, speak, MRCP_MESSAGE_TYPE_EVENT, SYNTHESIZER_SPEAK_COMPLETE, 0));
+
+    mrcp_message_t *control = test_request_create(test_channel, SYNTHESIZER_CONTROL, NULL, "this is streamed.");
+    test_request_send(test_channel, control);
+    CHECK(test_channel_wait(test_channel, control, MRCP_MESSAGE_TYPE_RESPONSE, SYNTHESIZER_CONTROL,
+                            MRCP_REQUEST_STATE_COMPLETE));
+    mrcp_message_t *end = test_request_create(test_channel, SYNTHESIZER_CONTROL, NULL, NULL);
+    test_request_flag(end, ELEVENLABS_VSP_STREAM_END);
+    test_request_send(test_channel, end);
+    CHECK(test_channel_wait(test_channel, end, MRCP_MESSAGE_TYPE_RESPONSE, SYNTHESIZER_CONTROL,
+                            MRCP_REQUEST_STATE_COMPLETE));
+
+    got = test_channel_collect(test_channel, audio, sizeof(audio), got, 0, speak);
+    CHECK(got == sizeof(audio));
+    for (apr_size_t i = 0; i < got; i++) {
+        CHECK(audio[i] == ws_audio_byte(i));
+    }
+
+    test_channel_close(test_channel);
+    test_engine_stop(&test_engine);
+    apr_time_t start = apr_time_now();
+    while (!atomic_load(&server.closed) && elapsed_ms(start) < TEST_EXIT_LIMIT_MS) {
+        apr_sleep(apr_time_from_msec(1));
+    }
+    CHECK(atomic_load(&server.closed));
+
+    apr_thread_mutex_lock(server.mutex);
+    CHECK(strstr(server.path, "GET /v1/text-to-speech/" TEST_VOICE "/multi-stream-input?") == server.path);
+    CHECK(strstr(server.path, "output_format=pcm_8000"));
+    CHECK(server.keyed);
+    const char *first = strstr(server.received, "{\"text\":\"Hello there, \",\"context_id\":\"c1\"}\n");
+    const char *more = first ? strstr(first, "{\"text\":\"this is streamed.\",\"context_id\":\"c1\"}\n") : NULL;
+    const char *flush = more ? strstr(more, "{\"context_id\":\"c1\",\"flush\":true}\n") : NULL;
+    CHECK(first && more && flush && strstr(flush, "{\"context_id\":\"c1\",\"close_context\":true}\n"));
+    apr_thread_mutex_unlock(server.mutex);
+    CHECK(atomic_load(&server.audio_sent) == 2);
+    CHECK(atomic_load(&server.pongs) == 2);
+    ws_server_stop(&server);
+
+    printf("ws: streamed SPEAK of 3 texts, %lu bytes from 2 fragmented messages in the lane, "
+           "%d pongs, closed\n", (unsigned long)got, atomic_load(&server.pongs));
+}
+
+/* Run the cache warm-up tool with these arguments; returns its exit status */
+static int test_tool_run(const char *const argv[])
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        execv(argv[0], (char *const *)argv);
+        _exit(127);
+    }
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* The cache warm-up tool against the audio stand-in: every manifest prompt lands in
+   cache_dir under the key a SPEAK would look up, a second run fetches nothing, and an
+   engine opened on that cache_dir has the hot prompts, and only those, in memory */
+static void test_cache_warmup(apr_pool_t *pool, const char *tool)
+{
+    static const char *manifest_text =
+        "# Warm-up test prompts\n"
+        "*Welcome to the test line.\n"
+        "Please hold.\n"
+        "other-voice\t-\t-\tGoodbye for now.\n";
+    static const struct {
+        const char *voice_id;
+        const char *text;
+        apt_bool_t hot;
+    } prompts[] = {
+        { NULL, "Welcome to the test line.", TRUE },
+        { NULL, "Please hold.", FALSE },
+        { "other-voice", "Goodbye for now.", FALSE }
+    };
+    const unsigned count = sizeof(prompts) / sizeof(prompts[0]);
+    audio_server_t server;
+    audio_server_start(&server, pool);
+
+    char dir_template[] = "/tmp/elevenlabs-warmup-XXXXXX";
+    CHECK(mkdtemp(dir_template));
+    const char *cache_dir = apr_pstrcat(pool, dir_template, "/cache", NULL);
+    const char *manifest = apr_pstrcat(pool, dir_template, "/prompts.txt", NULL);
+    FILE *f = fopen(manifest, "w");
+    CHECK(f && fputs(manifest_text, f) >= 0);
+    fclose(f);
+    const char *params = apr_psprintf(pool,
+        "<param name=\"api_key\" value=\"test\"/>\n"
+        "<param name=\"voice_id\" value=\"%s\"/>\n"
+        "<param name=\"base_url\" value=\"http://127.0.0.1:%u/v1/text-to-speech\"/>\n"
+        "<param name=\"output_format\" value=\"pcm_8000\"/>\n"
+        "<param name=\"cache_enabled\" value=\"true\"/>\n"
+        "<param name=\"cache_dir\" value=\"%s\"/>\n"
+        "<param name=\"cache_memory_max_bytes\" value=\"1048576\"/>\n"
+        "<param name=\"cache_preload_manifest\" value=\"%s\"/>\n"
+        "<param name=\"segment_mode\" value=\"none\"/>\n"
+        "<param name=\"consumer_tasks\" value=\"1\"/>\n"
+        "<param name=\"http_worker_threads\" value=\"1\"/>\n"
+        "<param name=\"http_warm_connections\" value=\"0\"/>\n"
+        "<param name=\"http_keepalive_interval_ms\" value=\"0\"/>\n"
+        "<param name=\"hedge_budget_percent\" value=\"0\"/>\n",
+        TEST_VOICE, server.port, cache_dir, manifest);
+    const char *conf_file = test_config_write(pool, dir_template, params);
+
+    /* Everything is fetched once */
+    const char *const argv[] = { tool, "-c", conf_file, "-j", "2", "-r", "0", manifest, NULL };
+    CHECK(test_tool_run(argv) == 0);
+    CHECK(atomic_load(&server.served) == (int)count);
+
+    elevenlabs_config_t config;
+    CHECK(elevenlabs_config_load(&config, conf_file, pool));
+    const char *keys[sizeof(prompts) / sizeof(prompts[0])];
+    for (unsigned i = 0; i < count; i++) {
+        char *key = NULL;
+        CHECK(elevenlabs_cache_request_key(pool, &config, prompts[i].voice_id, prompts[i].text, &key));
+        keys[i] = key;
+        apr_finfo_t finfo;
+        const char *path = apr_psprintf(pool, "%s/%s%s", cache_dir, key, elevenlabs_cache_file_ext(config.output_format));
+        CHECK(apr_stat(&finfo, path, APR_FINFO_SIZE, pool) == APR_SUCCESS);
+        CHECK(finfo.size > TEST_SOAK_AUDIO_BYTES);
+    }
+    CHECK(strcmp(keys[0], keys[1]) && strcmp(keys[1], keys[2]) && strcmp(keys[0], keys[2]));
+    apr_finfo_t finfo;
+    CHECK(apr_stat(&finfo, apr_pstrcat(pool, cache_dir, "/" ELEVENLABS_CACHE_INDEX_FILE, NULL),
+                   APR_FINFO_SIZE, pool) == APR_SUCCESS && finfo.size > 0);
+
+    /* A second run finds them all cached */
+    CHECK(test_tool_run(argv) == 0);
+    CHECK(atomic_load(&server.served) == (int)count);
+
+    /* The engine maps the hot prompt into the memory tier at open */
+    test_engine_t test_engine;
+    test_engine_start(&test_engine, pool, params);
+    elevenlabs_synth_engine_t *engine = test_engine.engine->obj;
+    CHECK(engine->memory_cache);
+    apr_time_t start = apr_time_now();
+    elevenlabs_cache_blob_t *blob;
+    while (!(blob = elevenlabs_cache_memory_get(engine->memory_cache, keys[0]))) {
+        CHECK(elapsed_ms(start) < TEST_EXIT_LIMIT_MS);
+        apr_sleep(apr_time_from_msec(1));
+    }
+    long preload_ms = elapsed_ms(start);
+    CHECK(blob->size > TEST_SOAK_AUDIO_BYTES);
+    elevenlabs_cache_blob_unref(blob);
+    for (unsigned i = 0; i < count; i++) {
+        if (!prompts[i].hot) {
+            CHECK(!elevenlabs_cache_memory_get(engine->memory_cache, keys[i]));
+        }
+    }
+    test_engine_stop(&test_engine);
+
+    remove_dir(pool, cache_dir);
+    apr_file_remove(conf_file, pool);
+    apr_dir_remove(apr_pstrcat(pool, dir_template, "/conf", NULL), pool);
+    apr_file_remove(manifest, pool);
+    apr_dir_remove(dir_template, pool);
+    audio_server_stop(&server);
+    printf("warm-up: %u prompts fetched into cache_dir, none on the second run, "
+           "hot prompt in memory %ld ms after engine open\n", count, preload_ms);
+}
+
+int main(int argc, char *argv[])
+{
+    apr_pool_t *pool;
+    CHECK(apr_initialize() == APR_SUCCESS);
+    CHECK(apr_pool_create(&pool, NULL) == APR_SUCCESS);
+    CHECK(curl_global_init(CURL_GLOBAL_DEFAULT) == CURLE_OK);
+
+    /* session_test <elevenlabs-cache-warmup>: the warm-up tool alone */
+    if (argc > 1) {
+        test_cache_warmup(pool, argv[1]);
+        curl_global_cleanup();
+        apr_pool_destroy(pool);
+        apr_terminate();
+        printf("session_test: OK\n");
+        return 0;
+    }
+
+    hung_server_t server;
+    hung_server_start(&server, pool);
+    audio_server_t audio_server;
+    audio_server_start(&audio_server, pool);
+
+    elevenlabs_config_t config;
+    CHECK(elevenlabs_config_load(&config, TEST_NO_CONFIG, pool));
+    config.base_url = apr_psprintf(pool, "http://127.0.0.1:%u/v1/text-to-speech", server.port);
+    config.ws_base_url = apr_psprintf(pool, "ws://127.0.0.1:%u/v1/text-to-speech", server.port);
+    config.api_key = "test";
+    config.output_format = "pcm_8000";
+    config.read_timeout_ms = TEST_READ_TIMEOUT_MS;
+    config.cache_enabled = FALSE;
+    config.http_worker_threads = 1;
+    config.http_warm_connections = 0;
+    config.http_keepalive_interval_ms = 0;
+    config.hedge_budget_percent = 0;
+
+    elevenlabs_http_pool_t *http_pool = elevenlabs_http_pool_create(pool, &config);
+    elevenlabs_slab_t *slab = elevenlabs_slab_create(pool);
+    CHECK(http_pool && slab);
+    /* Same sizing as a channel's ring, see elevenlabs_synth_engine_channel_create() */
+    apr_size_t high_water_bytes = (apr_size_t)config.buffer_high_water_ms * 8000 * ELEVENLABS_BYTES_PER_SAMPLE / 1000;
+
+    elevenlabs_config_t soak_config = config;
+    soak_config.base_url = apr_psprintf(pool, "http://127.0.0.1:%u/v1/text-to-speech", audio_server.port);
+    test_http_soak(&soak_config, http_pool, slab, high_water_bytes, &audio_server);
+    test_http_slow_cache(pool, &soak_config, http_pool, slab, high_water_bytes);
+    test_http_queued_voice(&soak_config, http_pool, slab, high_water_bytes, &audio_server);
+    test_http_hung(&config, http_pool, slab, high_water_bytes, &server);
+    test_ws_hung(pool, &config, http_pool, slab, high_water_bytes, &server);
+    test_flight_subscribers(pool, &config, http_pool, high_water_bytes, &server);
+    test_flight_pacing(pool, &soak_config, http_pool, high_water_bytes, &audio_server);
+    test_channel_stop(pool, &server);
+    test_consumer_tasks(pool, &audio_server);
+    test_segment_pipeline(pool, &audio_server);
+    test_cache_legacy(pool, &audio_server);
+    test_channel_ws(pool);
+
+    /* Engine close: the released client is still in its hung transfer */
+    apr_time_t start = apr_time_now();
+    elevenlabs_http_pool_destroy(http_pool);
+    long close_ms = elapsed_ms(start);
+    CHECK(close_ms < TEST_EXIT_LIMIT_MS);
+    printf("http pool: destroy %ld ms\n", close_ms);
+
+    elevenlabs_slab_destroy(slab);
+    hung_server_stop(&server);
+    audio_server_stop(&audio_server);
+    curl_global_cleanup();
+    apr_pool_destroy(pool);
+    apr_terminate();
+    printf("session_test: OK\n");
+    return 0;
+}
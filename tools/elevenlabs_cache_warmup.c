@@ -0,0 +1,261 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/**
+ * @file elevenlabs_cache_warmup.c
+ * @brief Cache warm-up tool: synthesizes a prompt manifest into cache_dir ahead of traffic.
+ * @author Alexey Izosimov
+ * @contact izosimov72@gmail.com | linkedin.com/in/izosimov72 | github.com/madmax179
+ * @date 2025
+ * @license Apache-2.0 — Copyright (c) 2025 Alexey Izosimov.
+ */
+
+/* Runs every prompt of a manifest (see elevenlabs_manifest.c) through the plugin's own
+   HTTP clients, so keys, file names and WAV headers are exactly what the engine writes
+   on a miss. Prompts already cached are skipped. The audio itself is discarded here:
+   each client's ring is emptied as it fills, standing in for the media thread.
+
+   Run it before the server starts on a cache_dir (both keep index.txt), or on a copy.
+   With -u it can point at a local mock of the API, e.g. -u http://127.0.0.1:8080/v1/text-to-speech */
+
+#include "elevenlabs_synth.h"
+#include "apr_strings.h"
+#include "apr_file_info.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define WARMUP_DEFAULT_PARALLEL 4
+#define WARMUP_DEFAULT_RATE 2        /* Request starts per second, 0 = unlimited */
+#define WARMUP_POLL_USEC 10000
+
+/* One request to make: a manifest prompt, or one segment of it */
+typedef struct {
+  const elevenlabs_config_t *config;
+  const char *voice_id;
+  const char *text;
+} warmup_job_t;
+
+/* A client with its own ring, like a channel lane */
+typedef struct {
+  elevenlabs_http_client_t *client;
+  audio_buffer_t *audio_buffer;
+  const warmup_job_t *job;
+} warmup_slot_t;
+
+static void warmup_usage(const char *prog)
+{
+  fprintf(stderr,
+          "Usage: %s [options] manifest\n"
+          "  -c file   plugin configuration (default %s)\n"
+          "  -u url    override base_url, e.g. a local mock server\n"
+          "  -k key    override api_key\n"
+          "  -j n      requests in flight (default %d)\n"
+          "  -r n      request starts per second, 0 = unlimited (default %d)\n"
+          "  -n        dry run: only report which prompts are cached\n"
+          "  -v        debug logging\n",
+          prog, ELEVENLABS_CONFIG_FILE, WARMUP_DEFAULT_PARALLEL, WARMUP_DEFAULT_RATE);
+}
+
+/* Expand manifest prompts into requests as the engine would make them: one per segment
+   when segmentation is configured, since that is how SPEAK caches them */
+static apr_array_header_t* warmup_jobs(apr_pool_t *pool, const elevenlabs_config_t *config,
+                                       const apr_array_header_t *entries)
+{
+  apr_array_header_t *jobs = apr_array_make(pool, entries->nelts, sizeof(warmup_job_t));
+  for (int i = 0; i < entries->nelts; i++) {
+    const elevenlabs_manifest_entry_t *entry = &APR_ARRAY_IDX(entries, i, elevenlabs_manifest_entry_t);
+    const elevenlabs_config_t *entry_config = elevenlabs_manifest_config(pool, config, entry);
+    unsigned count = 0;
+    char **segments = elevenlabs_text_segment(pool, entry->text, entry_config, &count);
+    for (unsigned j = 0; j < count; j++) {
+      warmup_job_t *job = apr_array_push(jobs);
+      job->config = entry_config;
+      job->voice_id = entry->voice_id;
+      job->text = segments[j];
+    }
+  }
+  return jobs;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *config_file = ELEVENLABS_CONFIG_FILE;
+  const char *base_url = NULL;
+  const char *api_key = NULL;
+  unsigned parallel = WARMUP_DEFAULT_PARALLEL;
+  unsigned rate = WARMUP_DEFAULT_RATE;
+  apt_bool_t dry_run = FALSE;
+  apt_log_priority_e priority = APT_PRIO_INFO;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "c:u:k:j:r:nvh")) != -1) {
+    switch (opt) {
+      case 'c': config_file = optarg; break;
+      case 'u': base_url = optarg; break;
+      case 'k': api_key = optarg; break;
+      case 'j': parallel = (unsigned)atoi(optarg); break;
+      case 'r': rate = (unsigned)atoi(optarg); break;
+      case 'n': dry_run = TRUE; break;
+      case 'v': priority = APT_PRIO_DEBUG; break;
+      default: warmup_usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1 || parallel == 0) {
+    warmup_usage(argv[0]);
+    return 2;
+  }
+  const char *manifest = argv[optind];
+
+  if (apr_app_initialize(&argc, (const char * const **)&argv, NULL) != APR_SUCCESS) {
+    fprintf(stderr, "Failed to initialize APR\n");
+    return 1;
+  }
+  atexit(apr_terminate);
+  apr_pool_t *pool;
+  apr_pool_create(&pool, NULL);
+  apt_log_instance_create(APT_LOG_OUTPUT_CONSOLE, priority, pool);
+
+  elevenlabs_config_t config;
+  if (!elevenlabs_config_load(&config, config_file, pool)) {
+    return 1;
+  }
+  if (base_url) {
+    config.base_url = apr_pstrdup(pool, base_url);
+  }
+  if (api_key) {
+    config.api_key = apr_pstrdup(pool, api_key);
+  }
+  if (!config.api_key || !config.cache_dir) {
+    fprintf(stderr, "api_key and cache_dir are required (set them in %s or with -k)\n", config_file);
+    return 1;
+  }
+  /* Whatever the server has configured, the point here is to write the cache */
+  config.cache_enabled = TRUE;
+  config.http_warm_connections = 0;
+  config.http_keepalive_interval_ms = 0;
+
+  apr_array_header_t *entries = elevenlabs_manifest_load(pool, manifest);
+  if (!entries) {
+    return 1;
+  }
+  apr_array_header_t *jobs = warmup_jobs(pool, &config, entries);
+  if (!elevenlabs_cache_ensure_dir(pool, config.cache_dir)) {
+    fprintf(stderr, "Cannot create cache directory %s\n", config.cache_dir);
+    return 1;
+  }
+
+  elevenlabs_cache_disk_t *disk_cache = elevenlabs_cache_disk_open(pool, &config);
+  unsigned cached = 0, fetched = 0, failed = 0;
+
+  if (dry_run) {
+    for (int i = 0; i < jobs->nelts; i++) {
+      const warmup_job_t *job = &APR_ARRAY_IDX(jobs, i, warmup_job_t);
+      char *key = NULL;
+      elevenlabs_cache_request_key(pool, job->config, job->voice_id, job->text, &key);
+      apt_bool_t hit = elevenlabs_cache_disk_lookup(disk_cache, key);
+      printf("%s\t%s\t%s\n", hit ? "cached" : "missing", key ? key : "-", job->text);
+      if (hit) cached++; else failed++;
+    }
+    printf("%u cached, %u missing\n", cached, failed);
+    elevenlabs_cache_disk_close(disk_cache);
+    return 0;
+  }
+
+  if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+    fprintf(stderr, "Failed to initialize libcurl\n");
+    return 1;
+  }
+  elevenlabs_http_pool_t *http_pool = elevenlabs_http_pool_create(pool, &config);
+  apr_thread_pool_t *io_pool = NULL;
+  if (!http_pool || apr_thread_pool_create(&io_pool, 1, 1, pool) != APR_SUCCESS) {
+    fprintf(stderr, "Failed to start HTTP workers\n");
+    return 1;
+  }
+
+  /* Same sizing as a channel's ring, see elevenlabs_synth_engine_channel_create() */
+  apr_size_t bytes_per_ms = SAMPLE_RATE * ELEVENLABS_BYTES_PER_SAMPLE / 1000;
+  apr_size_t high_water_bytes = (apr_size_t)config.buffer_high_water_ms * bytes_per_ms;
+  elevenlabs_slab_t *slab = elevenlabs_slab_create(pool);
+  warmup_slot_t *slots = apr_pcalloc(pool, parallel * sizeof(warmup_slot_t));
+  for (unsigned i = 0; i < parallel; i++) {
+    slots[i].audio_buffer = audio_buffer_create(pool, slab, high_water_bytes + 2 * CURL_MAX_WRITE_SIZE);
+    slots[i].client = elevenlabs_http_client_create(pool);
+    if (!slots[i].audio_buffer || !slots[i].client) {
+      fprintf(stderr, "Failed to create HTTP client\n");
+      return 1;
+    }
+    slots[i].client->audio_buffer = slots[i].audio_buffer;
+    slots[i].client->config = &config;
+    slots[i].client->io_pool = io_pool;
+    slots[i].client->disk_cache = disk_cache;
+    slots[i].client->high_water_bytes = high_water_bytes;
+    slots[i].client->low_water_bytes = high_water_bytes / 2;
+    elevenlabs_http_pool_attach(http_pool, slots[i].client);
+  }
+
+  apr_interval_time_t interval = rate ? apr_time_from_sec(1) / rate : 0;
+  apr_time_t next_start = apr_time_now();
+  int next_job = 0;
+  unsigned active = 0;
+  while (next_job < jobs->nelts || active > 0) {
+    for (unsigned i = 0; i < parallel; i++) {
+      warmup_slot_t *slot = &slots[i];
+      elevenlabs_http_client_t *client = slot->client;
+      if (slot->job) {
+        apr_thread_mutex_lock(client->mutex);
+        apt_bool_t busy = client->busy;
+        apr_thread_mutex_unlock(client->mutex);
+        if (busy) {
+          /* Discard what arrived and let a transfer paused at high water go on; this
+             thread stands in for the consumer */
+          audio_buffer_clear(slot->audio_buffer);
+          audio_buffer_collect(slot->audio_buffer);
+          elevenlabs_http_client_drained(client);
+          continue;
+        }
+        apr_finfo_t finfo;
+        if (client->cache_playback_mode) {
+          cached++;
+        } else if (client->cache_path_final &&
+                   apr_stat(&finfo, client->cache_path_final, APR_FINFO_SIZE, pool) == APR_SUCCESS) {
+          fetched++;
+        } else {
+          failed++;
+          apt_log(ELEVENLABS_SYNTH_LOG_MARK, APT_PRIO_WARNING, "Not cached: %s", slot->job->text);
+        }
+        slot->job = NULL;
+        active--;
+      }
+      if (next_job < jobs->nelts && apr_time_now() >= next_start) {
+        const warmup_job_t *job = &APR_ARRAY_IDX(jobs, next_job, warmup_job_t);
+        next_job++;
+        client->config = job->config;
+        audio_buffer_clear(slot->audio_buffer);
+        audio_buffer_collect(slot->audio_buffer);
+        if (!elevenlabs_http_client_start_synthesis(client, job->text, job->voice_id, NULL, NULL)) {
+          failed++;
+          continue;
+        }
+        slot->job = job;
+        active++;
+        next_start += interval;
+        if (next_start < apr_time_now()) {
+          next_start = apr_time_now();
+        }
+      }
+    }
+    apr_sleep(WARMUP_POLL_USEC);
+  }
+
+  for (unsigned i = 0; i < parallel; i++) {
+    elevenlabs_http_client_destroy(slots[i].client);
+    audio_buffer_destroy(slots[i].audio_buffer);
+  }
+  elevenlabs_slab_destroy(slab);
+  apr_thread_pool_destroy(io_pool);
+  elevenlabs_http_pool_destroy(http_pool);
+  elevenlabs_cache_disk_close(disk_cache);
+  curl_global_cleanup();
+
+  printf("%d requests: %u fetched, %u already cached, %u failed\n", jobs->nelts, fetched, cached, failed);
+  return failed ? 1 : 0;
+}